@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "csr_tools.h"
+
+#define MAX_LINE    256
+#define MAX_PATH    4096
+
+/**
+ * Converts a DIMACS shortest path (.gr, "p sp") or min-cut ("p cut") problem
+ * to the binary CSR format read by the SPLIB and mincut parsers.  With no
+ * output name the cache is written next to the input with its extension
+ * replaced by ".csr", which is where the parsers look for it.
+ *
+ *   csr_converter input [output]
+ *
+ * An input of "-" reads from stdin and then requires an output name.
+ */
+int main( int argc, char **argv )
+{
+    char line[MAX_LINE];
+    char type[4];
+    char output[MAX_PATH];
+    char name[CSR_NAME_LENGTH] = "";
+    long n, m, tail, head, source = 0;
+    double weight;
+    uint64_t line_count = 0;
+    csr_builder *builder = NULL;
+    FILE *input;
+
+    if( argc < 2 || ( strcmp( argv[1], "-" ) == 0 && argc < 3 ) )
+    {
+        fprintf( stderr, "usage: %s input [output]\n", argv[0] );
+        return -1;
+    }
+
+    if( argc > 2 )
+        snprintf( output, MAX_PATH, "%s", argv[2] );
+    else if( csr_cache_path( argv[1], output, MAX_PATH ) != 0 )
+    {
+        fprintf( stderr, "Input name too long.\n" );
+        return -1;
+    }
+
+    if( strcmp( argv[1], "-" ) == 0 )
+        input = stdin;
+    else if( ( input = fopen( argv[1], "r" ) ) == NULL )
+    {
+        fprintf( stderr, "Could not open %s.\n", argv[1] );
+        return -1;
+    }
+
+    while( fgets( line, MAX_LINE, input ) != NULL )
+    {
+        line_count++;
+        switch( line[0] )
+        {
+            case 'p':
+                if( builder != NULL || sscanf( line, "%*c %3s %ld %ld", type,
+                        &n, &m ) != 3 || n <= 0 || m < 0 )
+                    goto bad_line;
+                if( strcmp( type, "sp" ) == 0 )
+                    builder = csr_builder_create( CSR_PROBLEM_SP, n, m );
+                else if( strcmp( type, "cut" ) == 0 )
+                    builder = csr_builder_create( CSR_PROBLEM_CUT, n, m );
+                else
+                    goto bad_line;
+                if( builder == NULL )
+                    goto no_memory;
+                break;
+            case 't':
+                sscanf( line, "%*c %30s", name );
+                break;
+            case 'n':
+                if( sscanf( line, "%*c %ld", &source ) != 1 )
+                    goto bad_line;
+                break;
+            case 'a':
+                if( builder == NULL || sscanf( line, "%*c %ld %ld %lf", &tail,
+                        &head, &weight ) != 3 || tail < 0 || head < 0 ||
+                        tail > n || head > n )
+                    goto bad_line;
+                // lengths are truncated exactly as the parsers truncate them
+                if( builder->problem == CSR_PROBLEM_SP )
+                    weight = (uint32_t) (long) weight;
+                else if( weight <= 0 || weight > UINT32_MAX )
+                    goto bad_line;
+                if( csr_builder_add_arc( builder, tail, head,
+                        (uint32_t) weight ) != 0 )
+                    goto no_memory;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if( builder == NULL )
+    {
+        fprintf( stderr, "No problem line in input.\n" );
+        return -1;
+    }
+
+    builder->source = source;
+    memcpy( builder->name, name, CSR_NAME_LENGTH );
+    csr_graph *graph = csr_builder_finish( builder );
+    if( graph == NULL )
+        goto no_memory;
+
+    if( csr_write( graph, output ) != 0 )
+    {
+        fprintf( stderr, "Could not write %s.\n", output );
+        return -1;
+    }
+
+    printf( "%s: %u nodes, %llu arcs\n", output, graph->node_count,
+        (unsigned long long) graph->arc_count );
+    csr_destroy( graph );
+
+    return 0;
+
+bad_line:
+    fprintf( stderr, "Malformed input at line %llu.\n",
+        (unsigned long long) line_count );
+    return -1;
+
+no_memory:
+    fprintf( stderr, "Malloc fail.\n" );
+    return -1;
+}
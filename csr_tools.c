@@ -0,0 +1,429 @@
+#include "csr_tools.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//==============================================================================
+// STATIC DECLARATIONS
+//==============================================================================
+
+static int write_all( int fd, const void *data, uint64_t size );
+static int order_arcs( uint32_t node_count, uint64_t arc_count,
+    uint32_t *tails, uint32_t *heads, uint32_t *weights, uint64_t *offsets );
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+csr_graph* csr_create( uint32_t node_count, uint64_t arc_count )
+{
+    csr_graph *graph = calloc( 1, sizeof( csr_graph ) );
+    if( graph == NULL )
+        return NULL;
+
+    graph->node_count = node_count;
+    graph->arc_count = arc_count;
+    graph->offsets = calloc( (uint64_t) node_count + 1, sizeof( uint64_t ) );
+    graph->targets = malloc( ( arc_count + 1 ) * sizeof( uint32_t ) );
+    graph->weights = malloc( ( arc_count + 1 ) * sizeof( uint32_t ) );
+
+    if( graph->offsets == NULL || graph->targets == NULL ||
+        graph->weights == NULL )
+    {
+        csr_destroy( graph );
+        return NULL;
+    }
+
+    return graph;
+}
+
+void csr_destroy( csr_graph *graph )
+{
+    if( graph->mapping != NULL )
+        munmap( graph->mapping, graph->mapping_size );
+    else
+    {
+        free( graph->offsets );
+        free( graph->targets );
+        free( graph->weights );
+    }
+    free( graph );
+}
+
+uint32_t csr_max_weight( csr_graph *graph )
+{
+    uint64_t i;
+    uint32_t max = 0;
+    for( i = 0; i < graph->arc_count; i++ )
+    {
+        if( graph->weights[i] > max )
+            max = graph->weights[i];
+    }
+
+    return max;
+}
+
+int csr_write( csr_graph *graph, const char *path )
+{
+    csr_file_header header;
+    memset( &header, 0, sizeof( csr_file_header ) );
+    header.magic = CSR_MAGIC;
+    header.problem = graph->problem;
+    header.node_count = graph->node_count;
+    header.first_id = graph->first_id;
+    header.source = graph->source;
+    header.declared_nodes = graph->declared_nodes;
+    header.arc_count = graph->arc_count;
+    memcpy( header.name, graph->name, CSR_NAME_LENGTH );
+
+    int fd = open( path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR |
+        S_IRGRP | S_IROTH );
+    if( fd < 0 )
+        return -1;
+
+    int result = 0;
+    if( write_all( fd, &header, sizeof( csr_file_header ) ) != 0 ||
+        write_all( fd, graph->offsets, ( (uint64_t) graph->node_count + 1 ) *
+            sizeof( uint64_t ) ) != 0 ||
+        write_all( fd, graph->targets, graph->arc_count *
+            sizeof( uint32_t ) ) != 0 ||
+        write_all( fd, graph->weights, graph->arc_count *
+            sizeof( uint32_t ) ) != 0 )
+        result = -1;
+
+    if( close( fd ) != 0 )
+        result = -1;
+
+    return result;
+}
+
+csr_graph* csr_map( const char *path )
+{
+    int fd = open( path, O_RDONLY );
+    if( fd < 0 )
+        return NULL;
+
+    csr_graph *graph = csr_map_fd( fd );
+    close( fd );
+
+    return graph;
+}
+
+csr_graph* csr_map_fd( int fd )
+{
+    struct stat info;
+    csr_file_header header;
+
+    if( fstat( fd, &info ) != 0 || !S_ISREG( info.st_mode ) ||
+        info.st_size < sizeof( csr_file_header ) )
+        return NULL;
+    if( pread( fd, &header, sizeof( csr_file_header ), 0 ) !=
+            sizeof( csr_file_header ) || header.magic != CSR_MAGIC )
+        return NULL;
+
+    uint64_t expected = sizeof( csr_file_header ) +
+        ( (uint64_t) header.node_count + 1 ) * sizeof( uint64_t ) +
+        header.arc_count * 2 * sizeof( uint32_t );
+    if( (uint64_t) info.st_size < expected )
+        return NULL;
+
+    void *mapping = mmap( NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    if( mapping == MAP_FAILED )
+        return NULL;
+
+    csr_graph *graph = calloc( 1, sizeof( csr_graph ) );
+    if( graph == NULL )
+    {
+        munmap( mapping, info.st_size );
+        return NULL;
+    }
+
+    graph->node_count = header.node_count;
+    graph->source = header.source;
+    graph->arc_count = header.arc_count;
+    graph->problem = header.problem;
+    graph->first_id = header.first_id;
+    graph->declared_nodes = header.declared_nodes;
+    memcpy( graph->name, header.name, CSR_NAME_LENGTH );
+    graph->name[CSR_NAME_LENGTH-1] = '\0';
+
+    graph->mapping = mapping;
+    graph->mapping_size = info.st_size;
+    graph->offsets = (uint64_t*) ( (char*) mapping +
+        sizeof( csr_file_header ) );
+    graph->targets = (uint32_t*) ( graph->offsets + graph->node_count + 1 );
+    graph->weights = graph->targets + graph->arc_count;
+
+    return graph;
+}
+
+csr_graph* csr_map_cached( int fd )
+{
+    struct stat info, cache_info;
+    char link[64];
+    char source[4096];
+    char cache[4096];
+
+    if( fstat( fd, &info ) != 0 || !S_ISREG( info.st_mode ) )
+        return NULL;
+
+    csr_graph *graph = csr_map_fd( fd );
+    if( graph != NULL )
+        return graph;
+
+    snprintf( link, sizeof( link ), "/proc/self/fd/%d", fd );
+    ssize_t length = readlink( link, source, sizeof( source ) - 1 );
+    if( length <= 0 )
+        return NULL;
+    source[length] = '\0';
+
+    if( csr_cache_path( source, cache, sizeof( cache ) ) != 0 ||
+        strcmp( source, cache ) == 0 )
+        return NULL;
+    if( stat( cache, &cache_info ) != 0 ||
+        cache_info.st_mtime < info.st_mtime )
+        return NULL;
+
+    return csr_map( cache );
+}
+
+int csr_cache_path( const char *source, char *destination, size_t size )
+{
+    size_t length = strlen( source );
+    const char *dot = strrchr( source, '.' );
+    const char *slash = strrchr( source, '/' );
+    if( dot != NULL && ( slash == NULL || dot > slash ) )
+        length = dot - source;
+
+    if( length + 5 > size )
+        return -1;
+
+    memcpy( destination, source, length );
+    strcpy( destination + length, ".csr" );
+
+    return 0;
+}
+
+csr_builder* csr_builder_create( uint32_t problem, uint32_t declared_nodes,
+    uint64_t declared_arcs )
+{
+    csr_builder *builder = calloc( 1, sizeof( csr_builder ) );
+    if( builder == NULL )
+        return NULL;
+
+    builder->problem = problem;
+    builder->declared_nodes = declared_nodes;
+    builder->capacity = ( declared_arcs > 0 ) ? declared_arcs : 1;
+    builder->tails = malloc( builder->capacity * sizeof( uint32_t ) );
+    builder->heads = malloc( builder->capacity * sizeof( uint32_t ) );
+    builder->weights = malloc( builder->capacity * sizeof( uint32_t ) );
+
+    if( builder->tails == NULL || builder->heads == NULL ||
+        builder->weights == NULL )
+    {
+        free( builder->tails );
+        free( builder->heads );
+        free( builder->weights );
+        free( builder );
+        return NULL;
+    }
+
+    return builder;
+}
+
+int csr_builder_add_arc( csr_builder *builder, uint32_t tail, uint32_t head,
+    uint32_t weight )
+{
+    if( builder->arc_count == builder->capacity )
+    {
+        uint64_t capacity = builder->capacity << 1;
+        uint32_t *tails = realloc( builder->tails,
+            capacity * sizeof( uint32_t ) );
+        if( tails == NULL )
+            return -1;
+        builder->tails = tails;
+        uint32_t *heads = realloc( builder->heads,
+            capacity * sizeof( uint32_t ) );
+        if( heads == NULL )
+            return -1;
+        builder->heads = heads;
+        uint32_t *weights = realloc( builder->weights,
+            capacity * sizeof( uint32_t ) );
+        if( weights == NULL )
+            return -1;
+        builder->weights = weights;
+        builder->capacity = capacity;
+    }
+
+    builder->tails[builder->arc_count] = tail;
+    builder->heads[builder->arc_count] = head;
+    builder->weights[builder->arc_count] = weight;
+    builder->arc_count++;
+
+    return 0;
+}
+
+csr_graph* csr_builder_finish( csr_builder *builder )
+{
+    uint64_t i;
+    uint32_t node_min = UINT32_MAX;
+    uint32_t node_max = 0;
+    csr_graph *graph = NULL;
+
+    for( i = 0; i < builder->arc_count; i++ )
+    {
+        if( builder->tails[i] < node_min )
+            node_min = builder->tails[i];
+        if( builder->heads[i] < node_min )
+            node_min = builder->heads[i];
+        if( builder->tails[i] > node_max )
+            node_max = builder->tails[i];
+        if( builder->heads[i] > node_max )
+            node_max = builder->heads[i];
+    }
+    if( builder->arc_count == 0 )
+        node_min = node_max = builder->source;
+
+    graph = csr_create( node_max - node_min + 1, builder->arc_count );
+    if( graph == NULL )
+        goto done;
+
+    graph->problem = builder->problem;
+    graph->first_id = node_min;
+    graph->declared_nodes = builder->declared_nodes;
+    graph->source = builder->source - node_min;
+    memcpy( graph->name, builder->name, CSR_NAME_LENGTH );
+    graph->name[CSR_NAME_LENGTH-1] = '\0';
+
+    for( i = 0; i < builder->arc_count; i++ )
+    {
+        builder->tails[i] -= node_min;
+        builder->heads[i] -= node_min;
+    }
+    if( order_arcs( graph->node_count, builder->arc_count, builder->tails,
+            builder->heads, builder->weights, graph->offsets ) != 0 )
+    {
+        csr_destroy( graph );
+        graph = NULL;
+        goto done;
+    }
+
+    memcpy( graph->targets, builder->heads, builder->arc_count *
+        sizeof( uint32_t ) );
+    memcpy( graph->weights, builder->weights, builder->arc_count *
+        sizeof( uint32_t ) );
+
+done:
+    free( builder->tails );
+    free( builder->heads );
+    free( builder->weights );
+    free( builder );
+
+    return graph;
+}
+
+int csr_builder_write( csr_builder *builder, const char *path )
+{
+    csr_graph *graph = csr_builder_finish( builder );
+    if( graph == NULL )
+        return -1;
+
+    int result = csr_write( graph, path );
+    csr_destroy( graph );
+
+    return result;
+}
+
+//==============================================================================
+// STATIC METHODS
+//==============================================================================
+
+/**
+ * Writes the entire buffer, retrying on short writes.
+ *
+ * @param fd    Destination descriptor
+ * @param data  Buffer to write
+ * @param size  Number of bytes
+ * @return      0 on success, -1 on failure
+ */
+static int write_all( int fd, const void *data, uint64_t size )
+{
+    const char *current = data;
+    while( size > 0 )
+    {
+        ssize_t written = write( fd, current, size );
+        if( written <= 0 )
+            return -1;
+        current += written;
+        size -= written;
+    }
+
+    return 0;
+}
+
+/**
+ * Groups arcs by tail in place.  This is the linear-time cycle-following
+ * sort from parser_dh.c, reproduced step for step so that the relative order
+ * of each node's arcs is exactly what the text parser would produce.
+ *
+ * @param node_count    Number of nodes, ids 0-(node_count-1)
+ * @param arc_count     Number of arcs
+ * @param tails         Tail of each arc, clobbered
+ * @param heads         Head of each arc, permuted
+ * @param weights       Length of each arc, permuted
+ * @param offsets       Output, node_count + 1 entries
+ * @return              0 on success, -1 on allocation failure
+ */
+static int order_arcs( uint32_t node_count, uint64_t arc_count,
+    uint32_t *tails, uint32_t *heads, uint32_t *weights, uint64_t *offsets )
+{
+    uint64_t i, arc_num, arc_new_num, last;
+    uint32_t tail, swap;
+
+    uint64_t *arc_first = calloc( (uint64_t) node_count + 1,
+        sizeof( uint64_t ) );
+    if( arc_first == NULL )
+        return -1;
+
+    for( i = 0; i < arc_count; i++ )
+        arc_first[tails[i]+1]++;
+    for( i = 1; i <= node_count; i++ )
+        arc_first[i] += arc_first[i-1];
+    memcpy( offsets, arc_first, ( (uint64_t) node_count + 1 ) *
+        sizeof( uint64_t ) );
+
+    for( i = 0; i + 1 < node_count; i++ )
+    {
+        last = offsets[i+1];
+        for( arc_num = arc_first[i]; arc_num < last; arc_num++ )
+        {
+            tail = tails[arc_num];
+            while( tail != i )
+            {
+                arc_new_num = arc_first[tail];
+
+                swap = heads[arc_new_num];
+                heads[arc_new_num] = heads[arc_num];
+                heads[arc_num] = swap;
+
+                swap = weights[arc_new_num];
+                weights[arc_new_num] = weights[arc_num];
+                weights[arc_num] = swap;
+
+                tails[arc_num] = tails[arc_new_num];
+                tails[arc_new_num] = tail;
+                arc_first[tail]++;
+
+                tail = tails[arc_num];
+            }
+        }
+    }
+
+    free( arc_first );
+
+    return 0;
+}
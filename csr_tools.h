@@ -0,0 +1,228 @@
+#ifndef PQ_CSR_TOOLS
+#define PQ_CSR_TOOLS
+
+//==============================================================================
+// DEFINES, INCLUDES, and STRUCTS
+//==============================================================================
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define CSR_MAGIC           0x31525343
+#define CSR_NAME_LENGTH     32
+
+#define CSR_PROBLEM_SP      0
+#define CSR_PROBLEM_CUT     1
+
+/**
+ * On-disk header of a binary CSR file.  It is followed immediately by
+ * node_count + 1 offsets (uint64_t), arc_count targets (uint32_t) and
+ * arc_count weights (uint32_t), all in host byte order.
+ */
+struct csr_file_header
+{
+    //! CSR_MAGIC
+    uint32_t magic;
+    //! CSR_PROBLEM_SP or CSR_PROBLEM_CUT
+    uint32_t problem;
+    //! number of nodes actually stored
+    uint32_t node_count;
+    //! DIMACS id of node 0
+    uint32_t first_id;
+    //! source node, relative to first_id
+    uint32_t source;
+    //! node count from the DIMACS problem line
+    uint32_t declared_nodes;
+    //! number of arcs
+    uint64_t arc_count;
+    //! problem name from the DIMACS 't' line
+    char name[CSR_NAME_LENGTH];
+} __attribute__ ((packed, aligned(8)));
+
+typedef struct csr_file_header csr_file_header;
+
+/**
+ * Directed graph in compressed sparse row form.  The arcs leaving node i are
+ * stored in positions offsets[i] through offsets[i+1]-1 of the targets and
+ * weights arrays.  Nodes are numbered 0-(n-1).
+ */
+struct csr_graph_t
+{
+    //! number of nodes
+    uint32_t node_count;
+    //! designated source node, if any
+    uint32_t source;
+    //! number of arcs
+    uint64_t arc_count;
+
+    //! start of each node's arcs, node_count + 1 entries
+    uint64_t *offsets;
+    //! head node of each arc
+    uint32_t *targets;
+    //! length of each arc
+    uint32_t *weights;
+
+    //! CSR_PROBLEM_SP or CSR_PROBLEM_CUT
+    uint32_t problem;
+    //! DIMACS id of node 0
+    uint32_t first_id;
+    //! node count from the DIMACS problem line
+    uint32_t declared_nodes;
+    //! problem name, empty if none was given
+    char name[CSR_NAME_LENGTH];
+
+    //! file mapping backing the arrays, NULL if they were allocated
+    void *mapping;
+    //! length of the mapping in bytes
+    uint64_t mapping_size;
+};
+
+typedef struct csr_graph_t csr_graph;
+
+/**
+ * Collects arcs in input order so that they can be converted to CSR form
+ * once the whole graph is known.  Used by the generators and the converter.
+ */
+struct csr_builder_t
+{
+    //! CSR_PROBLEM_SP or CSR_PROBLEM_CUT
+    uint32_t problem;
+    //! node count from the DIMACS problem line
+    uint32_t declared_nodes;
+    //! DIMACS id of the source node
+    uint32_t source;
+    //! problem name
+    char name[CSR_NAME_LENGTH];
+
+    uint64_t arc_count;
+    uint64_t capacity;
+    uint32_t *tails;
+    uint32_t *heads;
+    uint32_t *weights;
+};
+
+typedef struct csr_builder_t csr_builder;
+
+//==============================================================================
+// PUBLIC DECLARATIONS
+//==============================================================================
+
+/**
+ * Allocates an empty graph with room for the specified number of nodes and
+ * arcs.  Offsets are zeroed; targets and weights are uninitialized.
+ *
+ * @param node_count    Number of nodes
+ * @param arc_count     Number of arcs
+ * @return              Pointer to the new graph, or NULL on failure
+ */
+csr_graph* csr_create( uint32_t node_count, uint64_t arc_count );
+
+/**
+ * Releases all memory associated with the graph, unmapping it if it was
+ * loaded from a file.
+ *
+ * @param graph Graph to release
+ */
+void csr_destroy( csr_graph *graph );
+
+/**
+ * Returns the largest arc length in the graph.
+ *
+ * @param graph Graph to query
+ * @return      Maximum arc length, or 0 if there are no arcs
+ */
+uint32_t csr_max_weight( csr_graph *graph );
+
+/**
+ * Writes the graph to a binary CSR file.
+ *
+ * @param graph Graph to write
+ * @param path  Destination file
+ * @return      0 on success, -1 on failure
+ */
+int csr_write( csr_graph *graph, const char *path );
+
+/**
+ * Maps a binary CSR file into memory.  The returned graph's arrays point
+ * into the read-only mapping.
+ *
+ * @param path  File to map
+ * @return      Pointer to the graph, or NULL if the file is not a CSR file
+ */
+csr_graph* csr_map( const char *path );
+
+/**
+ * Maps an already open binary CSR file into memory.
+ *
+ * @param fd    Descriptor of the file to map
+ * @return      Pointer to the graph, or NULL if the file is not a CSR file
+ */
+csr_graph* csr_map_fd( int fd );
+
+/**
+ * Looks for a binary version of the graph the DIMACS parsers are about to
+ * read from the given descriptor.  If the descriptor is itself a CSR file it
+ * is mapped directly.  Otherwise, if it refers to a regular file, a sibling
+ * with the extension replaced by ".csr" is used when it exists and is not
+ * older than the text file.
+ *
+ * @param fd    Descriptor the parser would read from, usually stdin
+ * @return      Pointer to the mapped graph, or NULL if there is no cache
+ */
+csr_graph* csr_map_cached( int fd );
+
+/**
+ * Derives the cache file name for a DIMACS file by replacing its extension
+ * with ".csr".
+ *
+ * @param source        Name of the DIMACS file
+ * @param destination   Output buffer
+ * @param size          Size of the output buffer
+ * @return              0 on success, -1 if the buffer is too small
+ */
+int csr_cache_path( const char *source, char *destination, size_t size );
+
+/**
+ * Creates an empty arc collector.
+ *
+ * @param problem           CSR_PROBLEM_SP or CSR_PROBLEM_CUT
+ * @param declared_nodes    Node count from the problem line
+ * @param declared_arcs     Expected number of arcs, used as initial capacity
+ * @return                  Pointer to the new builder, or NULL on failure
+ */
+csr_builder* csr_builder_create( uint32_t problem, uint32_t declared_nodes,
+    uint64_t declared_arcs );
+
+/**
+ * Appends an arc.  Node ids are the DIMACS ids.
+ *
+ * @param builder   Builder to append to
+ * @param tail      Tail node id
+ * @param head      Head node id
+ * @param weight    Arc length or capacity
+ * @return          0 on success, -1 on allocation failure
+ */
+int csr_builder_add_arc( csr_builder *builder, uint32_t tail, uint32_t head,
+    uint32_t weight );
+
+/**
+ * Converts the collected arcs to CSR form and releases the builder.  Arcs
+ * leaving each node end up in the order parser_dh.c produces for the same
+ * input, so traces generated from the cache match those generated from text.
+ *
+ * @param builder   Builder to convert
+ * @return          Pointer to the new graph, or NULL on failure
+ */
+csr_graph* csr_builder_finish( csr_builder *builder );
+
+/**
+ * Converts the collected arcs to CSR form, writes them to a file and
+ * releases the builder.
+ *
+ * @param builder   Builder to convert
+ * @param path      Destination file
+ * @return          0 on success, -1 on failure
+ */
+int csr_builder_write( csr_builder *builder, const char *path );
+
+#endif
@@ -0,0 +1,553 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "trace_tools.h"
+
+#define MAX_LINE    256
+
+#define DIST_EXPONENTIAL    0
+#define DIST_UNIFORM        1
+#define DIST_BIMODAL        2
+#define DIST_TRIANGULAR     3
+
+// keys follow the trace convention: time in the high 32 bits, node id in the
+// low 32 bits, so every exact queue deletes events in the same order
+#define MAKE_KEY(t,id)      ( ( (key_type) (t) << 32 ) | (id) )
+#define KEY_TIME(k)         ( (k) >> 32 )
+#define KEY_ID(k)           ( (uint32_t) ( (k) & 0xFFFFFFFF ) )
+#define MAX_TIME            0xFFFFFFFFULL
+
+/**
+ * Pending event set of the generator.  A binary heap of keys, indexed by node
+ * id so that events can be cancelled and rescheduled.  It mirrors the queue
+ * under test, which tells the generator which node id each deletion frees.
+ */
+typedef struct event_set_t
+{
+    key_type *keys;
+    //! heap position of each node id
+    uint32_t *pos;
+    uint32_t size;
+    uint32_t capacity;
+
+    //! node ids released by deletions, reused before new ones
+    uint32_t *free_ids;
+    uint32_t free_count;
+    uint32_t next_id;
+} event_set;
+
+static event_set events;
+static uint64_t rng_state;
+static int trace_file;
+static pq_trace_header header;
+static uint32_t peak_size;
+static uint64_t last_time;
+
+static int generate( int argc, char **argv );
+static int import( int argc, char **argv );
+static double uniform( void );
+static uint64_t draw( uint32_t dist, double mean );
+static int schedule( uint64_t time, uint32_t *id );
+static void execute( void );
+static void cancel( uint32_t id );
+static void reschedule( uint32_t id, uint64_t time );
+static void write_op( void *op );
+static int reserve( uint32_t capacity );
+static void sift_up( uint32_t i );
+static void sift_down( uint32_t i );
+static void place( uint32_t i, key_type key );
+
+/**
+ * Writes priority queue traces of discrete-event simulation workloads.
+ *
+ *   des_converter hold trace size holds dist [mean [seed]]
+ *   des_converter markov trace size events dist [mean [seed [up [down]]]]
+ *   des_converter import trace [log]
+ *
+ * The hold model fills the queue with size events and then performs the
+ * given number of holds: the earliest event is deleted and a new one is
+ * scheduled at its time plus a random increment, so the size stays constant.
+ * The Markov hold model lets each executed event schedule two new events with
+ * probability up, none with probability down and one otherwise (defaults
+ * 0.25 each), so the size performs a random walk; an empty queue is refilled
+ * with a single event.  Increments are integer ticks drawn from dist:
+ *
+ *   exponential    mean m
+ *   uniform        on [0, 2m]
+ *   bimodal        90% on [0, m/5], 10% on [8.2m, 10m], overall mean m
+ *   triangular     on [0, 2m] peaking at m
+ *
+ * with m = mean (default 1000).  import reads a timestamped event log, one
+ * command per line, from the file or stdin:
+ *
+ *   s event time   schedule event at time
+ *   r event time   move pending event to time
+ *   c event        cancel pending event
+ *   e [event]      execute the earliest pending event, which must be event
+ *                  if given, up to ties in time
+ *
+ * Event names are integers and may be reused once the event has executed or
+ * been cancelled; times are integer ticks below 2^32.  Lines starting with #
+ * are ignored.  Rescheduling becomes a decrease-key or an increase-key, and
+ * executing one of several events due at the same time deletes that event.
+ */
+int main( int argc, char **argv )
+{
+    if( argc < 3 )
+        goto usage;
+
+    trace_file = open( argv[2], O_RDWR | O_CREAT | O_TRUNC, S_IRWXU );
+    if( trace_file < 0 )
+    {
+        fprintf( stderr, "Failed to open trace file.\n" );
+        return -1;
+    }
+
+    header.op_count = 0;
+    header.pq_ids = 1;
+    header.node_ids = 0;
+    pq_trace_write_header( trace_file, header );
+
+    pq_op_create op_create;
+    op_create.code = PQ_OP_CREATE;
+    op_create.pq_id = 0;
+    write_op( &op_create );
+
+    int result;
+    if( strcmp( argv[1], "hold" ) == 0 || strcmp( argv[1], "markov" ) == 0 )
+        result = generate( argc, argv );
+    else if( strcmp( argv[1], "import" ) == 0 )
+        result = import( argc, argv );
+    else
+        result = 1;
+    if( result == 1 )
+        goto usage;
+    if( result != 0 )
+        return -1;
+
+    pq_op_destroy op_destroy;
+    op_destroy.code = PQ_OP_DESTROY;
+    op_destroy.pq_id = 0;
+    write_op( &op_destroy );
+
+    header.node_ids = events.next_id;
+    pq_trace_write_header( trace_file, header );
+    pq_trace_flush_buffer( trace_file );
+    close( trace_file );
+
+    printf( "%s: %llu ops, %u node ids, peak size %u, final time %llu\n",
+        argv[2], (unsigned long long) header.op_count, header.node_ids,
+        peak_size, (unsigned long long) last_time );
+
+    return 0;
+
+usage:
+    fprintf( stderr, "usage: %s hold trace size holds dist [mean [seed]]\n"
+        "       %s markov trace size events dist [mean [seed [up [down]]]]\n"
+        "       %s import trace [log]\n"
+        "dist is one of exponential, uniform, bimodal, triangular\n",
+        argv[0], argv[0], argv[0] );
+    return -1;
+}
+
+/**
+ * Runs the hold or Markov hold model.
+ *
+ * @param argc  Argument count of the program
+ * @param argv  Arguments of the program
+ * @return      0 on success, 1 on bad arguments, -1 on failure
+ */
+static int generate( int argc, char **argv )
+{
+    uint64_t i, count, now = 0;
+    uint32_t id, size, dist;
+    double r;
+    static const char *dist_names[4] =
+        { "exponential", "uniform", "bimodal", "triangular" };
+
+    int markov = ( strcmp( argv[1], "markov" ) == 0 );
+    if( argc < 6 )
+        return 1;
+    size = atoi( argv[3] );
+    count = strtoull( argv[4], NULL, 10 );
+    for( dist = 0; dist < 4; dist++ )
+    {
+        if( strcmp( argv[5], dist_names[dist] ) == 0 )
+            break;
+    }
+    double mean = ( argc > 6 ) ? atof( argv[6] ) : 1000;
+    rng_state = ( argc > 7 ) ? strtoull( argv[7], NULL, 10 ) : 1;
+    double up = ( argc > 8 ) ? atof( argv[8] ) : 0.25;
+    double down = ( argc > 9 ) ? atof( argv[9] ) : 0.25;
+    if( size < 1 || dist == 4 || mean <= 0 || up < 0 || down < 0 ||
+        up + down > 1 )
+        return 1;
+
+    // xorshift state must be non-zero
+    rng_state = rng_state * 0x9E3779B97F4A7C15ULL + 1;
+
+    for( i = 0; i < size; i++ )
+    {
+        if( schedule( draw( dist, mean ), &id ) != 0 )
+            return -1;
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        now = KEY_TIME( events.keys[0] );
+        execute();
+
+        r = markov ? uniform() : 1;
+        if( r < up )
+        {
+            if( schedule( now + draw( dist, mean ), &id ) != 0 ||
+                    schedule( now + draw( dist, mean ), &id ) != 0 )
+                return -1;
+        }
+        else if( r >= up + down || events.size == 0 )
+        {
+            if( schedule( now + draw( dist, mean ), &id ) != 0 )
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Converts an event log to a trace.
+ *
+ * @param argc  Argument count of the program
+ * @param argv  Arguments of the program
+ * @return      0 on success, 1 on bad arguments, -1 on failure
+ */
+static int import( int argc, char **argv )
+{
+    char line[MAX_LINE];
+    char command;
+    unsigned long long name, time;
+    uint64_t line_count = 0;
+    uint32_t *node_of = NULL;
+    uint64_t names = 0;
+    FILE *input = stdin;
+    int fields;
+
+    if( argc > 3 && ( input = fopen( argv[3], "r" ) ) == NULL )
+    {
+        fprintf( stderr, "Could not open %s.\n", argv[3] );
+        return -1;
+    }
+
+    // node_of[name] is the event's node id plus one, 0 while not pending
+    while( fgets( line, MAX_LINE, input ) != NULL )
+    {
+        line_count++;
+        fields = sscanf( line, " %c %llu %llu", &command, &name, &time );
+        if( fields < 1 || command == '#' )
+            continue;
+        if( fields >= 2 && name >= names )
+        {
+            uint64_t grown = ( names == 0 ) ? 1024 : names;
+            while( grown <= name )
+                grown <<= 1;
+            node_of = realloc( node_of, grown * sizeof( uint32_t ) );
+            if( node_of == NULL )
+                goto no_memory;
+            memset( node_of + names, 0, ( grown - names ) *
+                sizeof( uint32_t ) );
+            names = grown;
+        }
+
+        switch( command )
+        {
+            case 's':
+                if( fields != 3 || time > MAX_TIME || node_of[name] != 0 )
+                    goto bad_line;
+                if( schedule( time, node_of + name ) != 0 )
+                    goto no_memory;
+                node_of[name]++;
+                break;
+            case 'r':
+                if( fields != 3 || time > MAX_TIME || node_of[name] == 0 )
+                    goto bad_line;
+                reschedule( node_of[name] - 1, time );
+                break;
+            case 'c':
+                if( fields != 2 || node_of[name] == 0 )
+                    goto bad_line;
+                cancel( node_of[name] - 1 );
+                node_of[name] = 0;
+                break;
+            case 'e':
+                if( events.size == 0 )
+                    goto bad_line;
+                if( fields == 1 )
+                {
+                    execute();
+                    break;
+                }
+                if( node_of[name] == 0 || KEY_TIME( events.keys[
+                        events.pos[node_of[name] - 1]] ) !=
+                        KEY_TIME( events.keys[0] ) )
+                    goto bad_line;
+                if( events.pos[node_of[name] - 1] == 0 )
+                    execute();
+                else
+                {
+                    last_time = KEY_TIME( events.keys[0] );
+                    cancel( node_of[name] - 1 );
+                }
+                node_of[name] = 0;
+                break;
+            default:
+                goto bad_line;
+        }
+    }
+
+    // events executed without a name may still be mapped; names are dropped
+    free( node_of );
+    if( input != stdin )
+        fclose( input );
+
+    return 0;
+
+bad_line:
+    fprintf( stderr, "Malformed or inconsistent input at line %llu.\n",
+        (unsigned long long) line_count );
+    return -1;
+
+no_memory:
+    fprintf( stderr, "Malloc fail.\n" );
+    return -1;
+}
+
+/**
+ * Draws a uniform number from xorshift64*, so that traces are reproducible
+ * across platforms.
+ *
+ * @return  Number in [0, 1)
+ */
+static double uniform( void )
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return ( rng_state * 0x2545F4914F6CDD1DULL >> 11 ) * 0x1.0p-53;
+}
+
+/**
+ * Draws an increment from the distribution.
+ *
+ * @param dist  Distribution to use
+ * @param mean  Mean of the increment
+ * @return      Increment in ticks
+ */
+static uint64_t draw( uint32_t dist, double mean )
+{
+    double u[2];
+
+    u[0] = uniform();
+    u[1] = uniform();
+
+    switch( dist )
+    {
+        case DIST_EXPONENTIAL:
+            return (uint64_t) ( -mean * log( 1 - u[0] ) );
+        case DIST_UNIFORM:
+            return (uint64_t) ( 2 * mean * u[0] );
+        case DIST_BIMODAL:
+            if( u[1] < 0.9 )
+                return (uint64_t) ( 0.2 * mean * u[0] );
+            return (uint64_t) ( mean * ( 8.2 + 1.8 * u[0] ) );
+        default:
+            return (uint64_t) ( mean * ( u[0] + u[1] ) );
+    }
+}
+
+/**
+ * Schedules an event and records the insertion.
+ *
+ * @param time  Time of the event
+ * @param id    Output node id of the event
+ * @return      0 on success, -1 on failure
+ */
+static int schedule( uint64_t time, uint32_t *id )
+{
+    pq_op_insert op;
+
+    if( time > MAX_TIME )
+    {
+        fprintf( stderr, "Time exceeds 2^32 ticks, use a smaller mean.\n" );
+        return -1;
+    }
+
+    if( events.free_count > 0 )
+        *id = events.free_ids[--events.free_count];
+    else
+    {
+        if( reserve( events.next_id + 1 ) != 0 )
+        {
+            fprintf( stderr, "Malloc fail.\n" );
+            return -1;
+        }
+        *id = events.next_id++;
+    }
+
+    events.pos[*id] = events.size;
+    place( events.size++, MAKE_KEY( time, *id ) );
+    sift_up( events.pos[*id] );
+    if( events.size > peak_size )
+        peak_size = events.size;
+
+    op.code = PQ_OP_INSERT;
+    op.pq_id = 0;
+    op.node_id = *id;
+    op.key = MAKE_KEY( time, *id );
+    op.item = *id;
+    write_op( &op );
+
+    return 0;
+}
+
+/**
+ * Executes the earliest event and records the delete-min.
+ */
+static void execute( void )
+{
+    pq_op_delete_min op;
+    uint32_t id = KEY_ID( events.keys[0] );
+
+    last_time = KEY_TIME( events.keys[0] );
+    events.free_ids[events.free_count++] = id;
+    if( --events.size > 0 )
+    {
+        place( 0, events.keys[events.size] );
+        sift_down( 0 );
+    }
+
+    op.code = PQ_OP_DELETE_MIN;
+    op.pq_id = 0;
+    write_op( &op );
+}
+
+/**
+ * Cancels a pending event and records the deletion.
+ *
+ * @param id    Node id of the event
+ */
+static void cancel( uint32_t id )
+{
+    pq_op_delete op;
+    uint32_t i = events.pos[id];
+
+    events.free_ids[events.free_count++] = id;
+    if( --events.size > i )
+    {
+        place( i, events.keys[events.size] );
+        sift_up( i );
+        sift_down( events.pos[KEY_ID( events.keys[events.size] )] );
+    }
+
+    op.code = PQ_OP_DELETE;
+    op.pq_id = 0;
+    op.node_id = id;
+    write_op( &op );
+}
+
+/**
+ * Moves a pending event to a new time and records the key change.
+ *
+ * @param id    Node id of the event
+ * @param time  New time
+ */
+static void reschedule( uint32_t id, uint64_t time )
+{
+    pq_op_decrease_key op;
+    uint32_t i = events.pos[id];
+    key_type key = MAKE_KEY( time, id );
+
+    if( key == events.keys[i] )
+        return;
+
+    op.code = ( key < events.keys[i] ) ? PQ_OP_DECREASE_KEY :
+        PQ_OP_INCREASE_KEY;
+    op.pq_id = 0;
+    op.node_id = id;
+    op.key = key;
+
+    place( i, key );
+    sift_up( i );
+    sift_down( events.pos[id] );
+
+    write_op( &op );
+}
+
+static void write_op( void *op )
+{
+    pq_trace_write_op( trace_file, op );
+    header.op_count++;
+}
+
+/**
+ * Grows the event set to hold the given number of node ids.
+ *
+ * @param capacity  Number of node ids needed
+ * @return          0 on success, -1 on failure
+ */
+static int reserve( uint32_t capacity )
+{
+    if( capacity <= events.capacity )
+        return 0;
+
+    uint32_t grown = ( events.capacity == 0 ) ? 1024 : events.capacity;
+    while( grown < capacity )
+        grown <<= 1;
+
+    events.keys = realloc( events.keys, grown * sizeof( key_type ) );
+    events.pos = realloc( events.pos, grown * sizeof( uint32_t ) );
+    events.free_ids = realloc( events.free_ids, grown * sizeof( uint32_t ) );
+    if( events.keys == NULL || events.pos == NULL || events.free_ids == NULL )
+        return -1;
+    events.capacity = grown;
+
+    return 0;
+}
+
+static void sift_up( uint32_t i )
+{
+    key_type key = events.keys[i];
+    while( i > 0 && events.keys[( i - 1 ) >> 1] > key )
+    {
+        place( i, events.keys[( i - 1 ) >> 1] );
+        i = ( i - 1 ) >> 1;
+    }
+    place( i, key );
+}
+
+static void sift_down( uint32_t i )
+{
+    uint32_t child;
+    key_type key = events.keys[i];
+    while( ( child = ( i << 1 ) + 1 ) < events.size )
+    {
+        if( child + 1 < events.size &&
+                events.keys[child + 1] < events.keys[child] )
+            child++;
+        if( events.keys[child] >= key )
+            break;
+        place( i, events.keys[child] );
+        i = child;
+    }
+    place( i, key );
+}
+
+static void place( uint32_t i, key_type key )
+{
+    events.keys[i] = key;
+    events.pos[KEY_ID( key )] = i;
+}
@@ -0,0 +1,443 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#ifdef USE_EAGER
+    #include "../memory_management_eager.h"
+#elif USE_LAZY
+    #include "../memory_management_lazy.h"
+#else
+    #include "../memory_management_dumb.h"
+#endif
+
+#include "../trace_tools.h"
+#include "../typedefs.h"
+
+#define PQ_MIN_USEC 2000000
+#define CHUNK_SIZE 1000000
+#define MAX_THREADS 256
+#define MIN(a,b) ( b < a ? b : a )
+
+// Replays a trace with its operations split across several threads.  Node
+// operations (insert, delete, decrease-key, etc.) go to thread node_id % t so
+// that each node sees its own operations in trace order, and node-less
+// operations are dealt out round-robin.  Creates are applied up front, while
+// clears and destroys are deferred to the end of each replay.
+//
+// With USE_SPRAY_LIST the queue is called directly, since it is lock-free.
+// Any other queue is wrapped in a single global mutex as a baseline.  In both
+// cases the node_id is used as the item so that a delete-min can be attributed
+// to a node; since interleaving changes which node a delete-min removes, later
+// operations on an already removed node are skipped.
+
+#ifdef USE_BINOMIAL
+    #include "../queues/binomial_queue.h"
+#elif USE_EXPLICIT_2
+    #include "../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_4
+    #include "../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_8
+    #include "../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_16
+    #include "../queues/explicit_heap.h"
+#elif defined USE_FIBONACCI
+    #include "../queues/fibonacci_heap.h"
+#elif defined USE_IMPLICIT_2
+    #include "../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_4
+    #include "../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_8
+    #include "../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_16
+    #include "../queues/implicit_heap.h"
+#elif defined USE_PAIRING
+    #include "../queues/pairing_heap.h"
+#elif defined USE_QUAKE
+    #include "../queues/quake_heap.h"
+#elif defined USE_RANK_PAIRING
+    #include "../queues/rank_pairing_heap.h"
+#elif defined USE_RANK_RELAXED_WEAK
+    #include "../queues/rank_relaxed_weak_queue.h"
+#elif defined USE_STRICT_FIBONACCI
+    #include "../queues/strict_fibonacci_heap.h"
+#elif defined USE_VIOLATION
+    #include "../queues/violation_heap.h"
+#elif defined USE_SPRAY_LIST
+    #include "../queues/spray_list.h"
+#endif
+
+#ifdef USE_SPRAY_LIST
+    #define LOCK()
+    #define UNLOCK()
+#else
+    #define LOCK()      pthread_mutex_lock( &global_lock )
+    #define UNLOCK()    pthread_mutex_unlock( &global_lock )
+    static pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+#ifdef USE_STRICT_FIBONACCI
+    static uint32_t mem_types = 3;
+    static uint32_t mem_sizes[3] =
+    {
+        sizeof( strict_fibonacci_node ),
+        sizeof( active_record ),
+        sizeof( rank_record )
+    };
+    static uint32_t mem_capacities[3] =
+    {
+        0,
+        1000,
+        1000
+    };
+#elif defined USE_QUAKE
+    static uint32_t mem_types = 2;
+    static uint32_t mem_sizes[2] =
+    {
+        sizeof( quake_item ),
+        sizeof( quake_node )
+    };
+    static uint32_t mem_capacities[2] =
+    {
+        0,
+        0
+    };
+#else
+    static uint32_t mem_types = 1;
+    static uint32_t mem_sizes[1] =
+    {
+        sizeof( pq_node_type )
+    };
+    static uint32_t mem_capacities[1] =
+    {
+        0
+    };
+#endif
+
+// state shared with the worker threads
+static pq_op_blank *ops;
+static uint32_t *order;
+static uint64_t bounds[MAX_THREADS + 1];
+static pq_type **pq_index;
+static pq_node_type **node_index;
+static pthread_barrier_t chunk_start;
+static pthread_barrier_t chunk_end;
+static volatile uint32_t replay_done;
+
+static void apply_op( pq_op_blank *op );
+static void* replay_worker( void *arg );
+
+int main( int argc, char** argv )
+{
+    uint64_t i;
+    uint32_t t;
+
+    if( argc < 2 )
+        exit( -1 );
+
+    uint32_t thread_count = ( argc > 2 ) ? atoi( argv[2] ) : 1;
+#ifdef USE_SPRAY_LIST
+    uint32_t spray_width = ( argc > 3 ) ? atoi( argv[3] ) : thread_count;
+#endif
+    if( thread_count < 1 || thread_count > MAX_THREADS )
+    {
+        fprintf( stderr, "Thread count must be between 1 and %d.\n",
+            MAX_THREADS );
+        return -1;
+    }
+
+    int trace_file = open( argv[1], O_RDONLY );
+    if( trace_file < 0 )
+    {
+        fprintf( stderr, "Could not open file.\n" );
+        return -1;
+    }
+
+    pq_trace_header header;
+    pq_trace_read_header( trace_file, &header );
+    close( trace_file );
+
+    ops = calloc( MIN( header.op_count, CHUNK_SIZE ), sizeof( pq_op_blank ) );
+    order = calloc( MIN( header.op_count, CHUNK_SIZE ), sizeof( uint32_t ) );
+    uint32_t *owners = calloc( MIN( header.op_count, CHUNK_SIZE ),
+        sizeof( uint32_t ) );
+    pq_index = calloc( header.pq_ids, sizeof( pq_type* ) );
+    node_index = calloc( header.node_ids, sizeof( pq_node_type* ) );
+    if( ops == NULL || order == NULL || owners == NULL || pq_index == NULL ||
+        node_index == NULL )
+    {
+        fprintf( stderr, "Calloc fail.\n" );
+        return -1;
+    }
+
+    mem_capacities[0] = header.node_ids;
+#ifdef USE_QUAKE
+    // decay keeps each height at most ALPHA times the one below, bounding
+    // internal nodes by ALPHA / ( 1 - ALPHA ) = 3 per item
+    mem_capacities[1] = ( header.node_ids * 3 ) + 1;
+#endif
+#ifdef USE_EAGER
+    mem_map *map = mm_create( mem_types, mem_sizes, mem_capacities );
+#else
+    mem_map *map = mm_create( mem_types, mem_sizes );
+#endif
+
+    pthread_t threads[MAX_THREADS];
+    pthread_barrier_init( &chunk_start, NULL, thread_count + 1 );
+    pthread_barrier_init( &chunk_end, NULL, thread_count + 1 );
+    replay_done = 0;
+    for( t = 0; t < thread_count; t++ )
+        pthread_create( &threads[t], NULL, replay_worker,
+            (void*) (uintptr_t) t );
+
+    uint64_t op_remaining, op_chunk;
+    uint64_t counts[MAX_THREADS];
+    uint32_t round_robin, owner, code;
+    int status;
+    struct timeval t0, t1;
+    uint32_t iterations = 0;
+    uint32_t total_time = 0;
+
+    while( iterations < 5 || total_time < PQ_MIN_USEC )
+    {
+        mm_clear( map );
+        iterations++;
+        round_robin = 0;
+
+        trace_file = open( argv[1], O_RDONLY );
+        if( trace_file < 0 )
+        {
+            fprintf( stderr, "Could not open file.\n" );
+            return -1;
+        }
+        pq_trace_read_header( trace_file, &header );
+        op_remaining = header.op_count;
+
+        while( op_remaining > 0 )
+        {
+            op_chunk = MIN( CHUNK_SIZE, op_remaining );
+            op_remaining -= op_chunk;
+
+            // read and assign each op to a thread, counting per thread
+            memset( counts, 0, thread_count * sizeof( uint64_t ) );
+            for( i = 0; i < op_chunk; i++ )
+            {
+                status = pq_trace_read_op( trace_file, ops + i );
+                if( status == -1 )
+                {
+                    fprintf( stderr, "Invalid operation!" );
+                    return -1;
+                }
+
+                code = ops[i].code;
+                if( code == PQ_OP_CREATE )
+                {
+                    pq_index[ops[i].pq_id] = pq_create( map );
+#ifdef USE_SPRAY_LIST
+                    pq_set_spray_width( pq_index[ops[i].pq_id], spray_width );
+#endif
+                    owner = thread_count;
+                }
+                else if( code == PQ_OP_DESTROY || code == PQ_OP_CLEAR )
+                    owner = thread_count;
+                else if( code == PQ_OP_GET_KEY || code == PQ_OP_GET_ITEM ||
+                    code == PQ_OP_INSERT || code == PQ_OP_DELETE ||
+                    code == PQ_OP_DECREASE_KEY || code == PQ_OP_INCREASE_KEY )
+                    owner = ops[i].node_id % thread_count;
+                else
+                    owner = round_robin++ % thread_count;
+
+                owners[i] = owner;
+                if( owner < thread_count )
+                    counts[owner]++;
+            }
+
+            // counting sort the op indices into per-thread ranges
+            bounds[0] = 0;
+            for( t = 0; t < thread_count; t++ )
+                bounds[t+1] = bounds[t] + counts[t];
+            memcpy( counts, bounds, thread_count * sizeof( uint64_t ) );
+            for( i = 0; i < op_chunk; i++ )
+            {
+                if( owners[i] < thread_count )
+                    order[counts[owners[i]]++] = i;
+            }
+
+            gettimeofday(&t0, NULL);
+            pthread_barrier_wait( &chunk_start );
+            pthread_barrier_wait( &chunk_end );
+            gettimeofday(&t1, NULL);
+            total_time += (t1.tv_sec - t0.tv_sec) * 1000000 +
+                (t1.tv_usec - t0.tv_usec);
+        }
+
+        close( trace_file );
+
+        for( i = 0; i < header.pq_ids; i++ )
+        {
+            if( pq_index[i] != NULL )
+                pq_destroy( pq_index[i] );
+            pq_index[i] = NULL;
+        }
+        memset( node_index, 0, header.node_ids * sizeof( pq_node_type* ) );
+    }
+
+    replay_done = 1;
+    pthread_barrier_wait( &chunk_start );
+    for( t = 0; t < thread_count; t++ )
+        pthread_join( threads[t], NULL );
+
+    pthread_barrier_destroy( &chunk_start );
+    pthread_barrier_destroy( &chunk_end );
+    mm_destroy( map );
+    free( pq_index );
+    free( node_index );
+    free( owners );
+    free( order );
+    free( ops );
+
+    printf( "%d\n", total_time / iterations );
+
+    return 0;
+}
+
+/**
+ * Applies a single operation to its queue.  Without a concurrent queue, the
+ * whole operation runs under the global lock.
+ *
+ * @param op    Operation to apply
+ */
+static void apply_op( pq_op_blank *op )
+{
+    pq_op_decrease_key *op_decrease_key;
+    pq_op_increase_key *op_increase_key;
+    pq_type *q = pq_index[op->pq_id];
+    pq_node_type *n;
+#ifndef USE_SPRAY_LIST
+    item_type id;
+#endif
+
+    switch( op->code )
+    {
+        case PQ_OP_GET_KEY:
+            LOCK();
+            n = node_index[op->node_id];
+            if( n != NULL )
+                pq_get_key( q, n );
+            UNLOCK();
+            break;
+        case PQ_OP_GET_ITEM:
+            LOCK();
+            n = node_index[op->node_id];
+            if( n != NULL )
+                pq_get_item( q, n );
+            UNLOCK();
+            break;
+        case PQ_OP_GET_SIZE:
+            LOCK();
+            pq_get_size( q );
+            UNLOCK();
+            break;
+        case PQ_OP_INSERT:
+            LOCK();
+            node_index[op->node_id] = pq_insert( q, op->node_id, op->key );
+            UNLOCK();
+            break;
+        case PQ_OP_FIND_MIN:
+            LOCK();
+            pq_find_min( q );
+            UNLOCK();
+            break;
+        case PQ_OP_DELETE:
+#ifdef USE_SPRAY_LIST
+            n = node_index[op->node_id];
+            if( n != NULL )
+                pq_delete( q, n );
+#else
+            LOCK();
+            n = node_index[op->node_id];
+            if( n != NULL )
+            {
+                pq_delete( q, n );
+                node_index[op->node_id] = NULL;
+            }
+            UNLOCK();
+#endif
+            break;
+        case PQ_OP_DELETE_MIN:
+#ifdef USE_SPRAY_LIST
+            pq_delete_min( q );
+#else
+            LOCK();
+            if( !pq_empty( q ) )
+            {
+                id = *pq_get_item( q, pq_find_min( q ) );
+                pq_delete_min( q );
+                node_index[id] = NULL;
+            }
+            UNLOCK();
+#endif
+            break;
+        case PQ_OP_DECREASE_KEY:
+            op_decrease_key = (pq_op_decrease_key*) op;
+            LOCK();
+            n = node_index[op_decrease_key->node_id];
+#ifdef USE_SPRAY_LIST
+            if( n != NULL )
+#else
+            if( n != NULL && op_decrease_key->key < pq_get_key( q, n ) )
+#endif
+                pq_decrease_key( q, n, op_decrease_key->key );
+            UNLOCK();
+            break;
+        case PQ_OP_INCREASE_KEY:
+            op_increase_key = (pq_op_increase_key*) op;
+            LOCK();
+            n = node_index[op_increase_key->node_id];
+#ifdef USE_SPRAY_LIST
+            if( n != NULL )
+#else
+            if( n != NULL && op_increase_key->key > pq_get_key( q, n ) )
+#endif
+                pq_increase_key( q, n, op_increase_key->key );
+            UNLOCK();
+            break;
+        case PQ_OP_EMPTY:
+            LOCK();
+            pq_empty( q );
+            UNLOCK();
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Worker loop.  Waits for each chunk to be partitioned, replays its share of
+ * the chunk and then waits for the other workers to finish.
+ *
+ * @param arg   Index of this worker
+ * @return      Nothing
+ */
+static void* replay_worker( void *arg )
+{
+    uint32_t id = (uint32_t) (uintptr_t) arg;
+    uint64_t j;
+
+    while( TRUE )
+    {
+        pthread_barrier_wait( &chunk_start );
+        if( replay_done )
+            break;
+
+        for( j = bounds[id]; j < bounds[id+1]; j++ )
+            apply_op( ops + order[j] );
+
+        pthread_barrier_wait( &chunk_end );
+    }
+
+    return NULL;
+}
@@ -0,0 +1,470 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef USE_EAGER
+    #include "../memory_management_eager.h"
+#elif USE_LAZY
+    #include "../memory_management_lazy.h"
+#else
+    #include "../memory_management_dumb.h"
+#endif
+
+#include "../trace_tools.h"
+#include "../typedefs.h"
+
+#define DEFAULT_REPS 5
+
+// Measures how fast a queue comes back from a snapshot.  The first cut
+// operations of a trace (half of it by default) are replayed, every live
+// queue is written with pq_serialize, and the queues are destroyed.  Each
+// repetition then restores all of them twice: once with pq_deserialize and
+// once by creating empty queues and inserting the snapshot entries one at a
+// time, which is what a restart has to do without snapshots.  Both restores
+// also time the first delete-min that follows, since a lazy queue can put off
+// until then the work a restore appears to save.
+//
+// The handles of the trace are remapped through the item table filled by
+// either restore, which needs the items within each queue to be unique.  The
+// rest of the trace is then replayed on both restored copies, and the keys
+// they delete must match an uninterrupted replay.  Usage:
+//
+//   snapshot_<queue> trace [cut] [reps]
+//
+// Prints the live items, the snapshot bytes, the serialize time, and the
+// average restore and insertion times in microseconds, each of the latter
+// two followed by the time of the first delete-min.
+
+#ifdef USE_BINOMIAL
+    #include "../queues/binomial_queue.h"
+#elif USE_EXPLICIT_2
+    #include "../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_4
+    #include "../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_8
+    #include "../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_16
+    #include "../queues/explicit_heap.h"
+#elif defined USE_FIBONACCI
+    #include "../queues/fibonacci_heap.h"
+#elif defined USE_IMPLICIT_2
+    #include "../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_4
+    #include "../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_8
+    #include "../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_16
+    #include "../queues/implicit_heap.h"
+#elif defined USE_WEAK
+    #include "../queues/weak_heap.h"
+#elif defined USE_PAIRING
+    #include "../queues/pairing_heap.h"
+#elif defined USE_SMOOTH
+    #include "../queues/smooth_heap.h"
+#elif defined USE_QUAKE
+    #include "../queues/quake_heap.h"
+#elif defined USE_RANK_PAIRING
+    #include "../queues/rank_pairing_heap.h"
+#elif defined USE_RANK_RELAXED_WEAK
+    #include "../queues/rank_relaxed_weak_queue.h"
+#elif defined USE_STRICT_FIBONACCI
+    #include "../queues/strict_fibonacci_heap.h"
+#elif defined USE_VIOLATION
+    #include "../queues/violation_heap.h"
+#elif defined USE_HOLLOW
+    #include "../queues/hollow_heap.h"
+#elif defined USE_CALENDAR
+    #include "../queues/calendar_queue.h"
+#elif defined USE_LADDER
+    #include "../queues/ladder_queue.h"
+#elif defined USE_KNHEAP
+    #include "../queues/knheap.h"
+#elif defined USE_SPRAY_LIST
+    #include "../queues/spray_list.h"
+#endif
+
+#ifdef USE_STRICT_FIBONACCI
+    static uint32_t mem_types = 3;
+    static uint32_t mem_sizes[3] =
+    {
+        sizeof( strict_fibonacci_node ),
+        sizeof( active_record ),
+        sizeof( rank_record )
+    };
+    static uint32_t mem_capacities[3] =
+    {
+        0,
+        1000,
+        1000
+    };
+#elif defined USE_HOLLOW
+    static uint32_t mem_types = 2;
+    static uint32_t mem_sizes[2] =
+    {
+        sizeof( hollow_item ),
+        sizeof( hollow_node )
+    };
+    static uint32_t mem_capacities[2] =
+    {
+        0,
+        0
+    };
+#elif defined USE_QUAKE
+    static uint32_t mem_types = 2;
+    static uint32_t mem_sizes[2] =
+    {
+        sizeof( quake_item ),
+        sizeof( quake_node )
+    };
+    static uint32_t mem_capacities[2] =
+    {
+        0,
+        0
+    };
+#else
+    static uint32_t mem_types = 1;
+    static uint32_t mem_sizes[1] =
+    {
+        sizeof( pq_node_type )
+    };
+    static uint32_t mem_capacities[1] =
+    {
+        0
+    };
+#endif
+
+
+// replay state, kept across the restores that continue it
+static pq_trace_header header;
+static pq_op_blank *ops;
+static mem_map *map;
+static pq_type **pq_index;
+static pq_node_type **node_index;
+static item_type *node_items;
+static uint32_t *node_pqs;
+static pq_snapshot_header **snapshots;
+static pq_node_type **handles;
+
+static uint32_t elapsed( struct timeval *t0 )
+{
+    struct timeval t1;
+    gettimeofday( &t1, NULL );
+    return ( t1.tv_sec - t0->tv_sec ) * 1000000 +
+        ( t1.tv_usec - t0->tv_usec );
+}
+
+// Replays ops[start,end) and returns a hash of the keys removed by
+// delete-min, in order.  The item and queue of each inserted node are kept
+// so that its handle can be found again after a restore.
+static uint64_t replay( uint64_t start, uint64_t end )
+{
+    pq_op_create *op_create;
+    pq_op_destroy *op_destroy;
+    pq_op_clear *op_clear;
+    pq_op_insert *op_insert;
+    pq_op_find_min *op_find_min;
+    pq_op_delete *op_delete;
+    pq_op_delete_min *op_delete_min;
+    pq_op_decrease_key *op_decrease_key;
+    pq_op_increase_key *op_increase_key;
+    pq_type *q;
+    uint64_t hash = 0;
+    uint64_t i;
+
+    for( i = start; i < end; i++ )
+    {
+        switch( ops[i].code )
+        {
+            case PQ_OP_CREATE:
+                op_create = (pq_op_create*) ( ops + i );
+                pq_index[op_create->pq_id] = pq_create( map );
+                break;
+            case PQ_OP_DESTROY:
+                op_destroy = (pq_op_destroy*) ( ops + i );
+                pq_destroy( pq_index[op_destroy->pq_id] );
+                pq_index[op_destroy->pq_id] = NULL;
+                break;
+            case PQ_OP_CLEAR:
+                op_clear = (pq_op_clear*) ( ops + i );
+                pq_clear( pq_index[op_clear->pq_id] );
+                break;
+            case PQ_OP_INSERT:
+                op_insert = (pq_op_insert*) ( ops + i );
+                q = pq_index[op_insert->pq_id];
+                node_index[op_insert->node_id] = pq_insert( q,
+                    op_insert->item, op_insert->key );
+                node_items[op_insert->node_id] = op_insert->item;
+                node_pqs[op_insert->node_id] = op_insert->pq_id;
+                break;
+            case PQ_OP_FIND_MIN:
+                op_find_min = (pq_op_find_min*) ( ops + i );
+                pq_find_min( pq_index[op_find_min->pq_id] );
+                break;
+            case PQ_OP_DELETE:
+                op_delete = (pq_op_delete*) ( ops + i );
+                pq_delete( pq_index[op_delete->pq_id],
+                    node_index[op_delete->node_id] );
+                break;
+            case PQ_OP_DELETE_MIN:
+                op_delete_min = (pq_op_delete_min*) ( ops + i );
+                hash = hash * 31 +
+                    pq_delete_min( pq_index[op_delete_min->pq_id] );
+                break;
+            case PQ_OP_DECREASE_KEY:
+                op_decrease_key = (pq_op_decrease_key*) ( ops + i );
+                pq_decrease_key( pq_index[op_decrease_key->pq_id],
+                    node_index[op_decrease_key->node_id],
+                    op_decrease_key->key );
+                break;
+            case PQ_OP_INCREASE_KEY:
+                op_increase_key = (pq_op_increase_key*) ( ops + i );
+                pq_increase_key( pq_index[op_increase_key->pq_id],
+                    node_index[op_increase_key->node_id],
+                    op_increase_key->key );
+                break;
+            default:
+                break;
+        }
+    }
+
+    return hash;
+}
+
+// Restores every saved queue, with pq_deserialize or by inserting the
+// entries of its snapshot, and times the restore and the first delete-min
+// after it.  With remap set the first delete-min is skipped and the node
+// handles of the trace are pointed at the restored nodes instead.
+static void restore( int insert, int remap, uint32_t *restore_time,
+    uint32_t *first_time )
+{
+    pq_snapshot_entry *entries;
+    struct timeval t0;
+    uint32_t p, j, n;
+
+    gettimeofday( &t0, NULL );
+    for( p = 0; p < header.pq_ids; p++ )
+    {
+        if( snapshots[p] == NULL )
+            continue;
+        if( !insert )
+            pq_index[p] = pq_deserialize( map, snapshots[p], handles );
+        else
+        {
+            entries = SNAPSHOT_ENTRIES( snapshots[p] );
+            pq_index[p] = pq_create( map );
+            for( j = 0; j < snapshots[p]->size; j++ )
+                handles[entries[j].item] = pq_insert( pq_index[p],
+                    entries[j].item, entries[j].key );
+        }
+
+        if( !remap )
+            continue;
+
+        for( n = 0; n < header.node_ids; n++ )
+        {
+            if( node_index[n] != NULL && node_pqs[n] == p )
+                node_index[n] = handles[node_items[n]];
+        }
+        entries = SNAPSHOT_ENTRIES( snapshots[p] );
+        for( j = 0; j < snapshots[p]->size; j++ )
+            handles[entries[j].item] = NULL;
+    }
+    *restore_time += elapsed( &t0 );
+
+    if( remap )
+        return;
+
+    gettimeofday( &t0, NULL );
+    for( p = 0; p < header.pq_ids; p++ )
+    {
+        if( pq_index[p] != NULL && !pq_empty( pq_index[p] ) )
+            pq_delete_min( pq_index[p] );
+    }
+    *first_time += elapsed( &t0 );
+}
+
+// Checks that no item occurs twice in a snapshot, since the handles of the
+// trace are found again by item.
+static int unique_items( pq_snapshot_header *snapshot )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    pq_node_type *mark = (pq_node_type *) handles;
+    uint32_t j;
+    int unique = 1;
+
+    for( j = 0; j < snapshot->size; j++ )
+    {
+        if( handles[entries[j].item] == mark )
+            unique = 0;
+        handles[entries[j].item] = mark;
+    }
+    for( j = 0; j < snapshot->size; j++ )
+        handles[entries[j].item] = NULL;
+
+    return unique;
+}
+
+static void destroy_all( void )
+{
+    uint32_t p;
+    for( p = 0; p < header.pq_ids; p++ )
+    {
+        if( pq_index[p] != NULL )
+            pq_destroy( pq_index[p] );
+        pq_index[p] = NULL;
+    }
+    mm_clear( map );
+}
+
+int main( int argc, char** argv )
+{
+    uint64_t i, cut, reference, hash;
+    uint32_t p, r, reps;
+    uint32_t live = 0;
+    uint32_t max_item = 0;
+    size_t length, bytes = 0;
+    struct timeval t0;
+    uint32_t serialize_time = 0;
+    uint32_t restore_time = 0;
+    uint32_t restore_first = 0;
+    uint32_t insert_time = 0;
+    uint32_t insert_first = 0;
+    uint32_t unused = 0;
+
+    if( argc < 2 )
+        exit( -1 );
+
+    int trace_file = open( argv[1], O_RDONLY );
+    if( trace_file < 0 )
+    {
+        fprintf( stderr, "Could not open file.\n" );
+        return -1;
+    }
+    pq_trace_read_header( trace_file, &header );
+
+    cut = ( argc > 2 ) ? strtoull( argv[2], NULL, 10 ) : header.op_count / 2;
+    if( cut > header.op_count )
+        cut = header.op_count;
+    reps = ( argc > 3 ) ? atoi( argv[3] ) : DEFAULT_REPS;
+    if( reps < 1 )
+        reps = 1;
+
+    ops = (pq_op_blank *)calloc( header.op_count, sizeof( pq_op_blank ) );
+    pq_index = (pq_type **)calloc( header.pq_ids, sizeof( pq_type* ) );
+    node_index = (pq_node_type **)calloc( header.node_ids,
+        sizeof( pq_node_type* ) );
+    node_items = (item_type *)calloc( header.node_ids, sizeof( item_type ) );
+    node_pqs = (uint32_t *)calloc( header.node_ids, sizeof( uint32_t ) );
+    snapshots = (pq_snapshot_header **)calloc( header.pq_ids,
+        sizeof( pq_snapshot_header* ) );
+    if( ops == NULL || pq_index == NULL || node_index == NULL ||
+        node_items == NULL || node_pqs == NULL || snapshots == NULL )
+    {
+        fprintf( stderr, "Calloc fail.\n" );
+        return -1;
+    }
+
+    for( i = 0; i < header.op_count; i++ )
+    {
+        if( pq_trace_read_op( trace_file, ops + i ) == -1 )
+        {
+            fprintf( stderr, "Invalid operation!" );
+            return -1;
+        }
+        if( ops[i].code == PQ_OP_INSERT && ops[i].item > max_item )
+            max_item = ops[i].item;
+    }
+    close( trace_file );
+
+    handles = (pq_node_type **)calloc( (uint64_t) max_item + 1,
+        sizeof( pq_node_type* ) );
+    if( handles == NULL )
+    {
+        fprintf( stderr, "Calloc fail.\n" );
+        return -1;
+    }
+
+    mem_capacities[0] = header.node_ids;
+#ifdef USE_QUAKE
+    mem_capacities[1] = ( header.node_ids * 3 ) + 1;
+#endif
+#ifdef USE_HOLLOW
+    mem_capacities[1] = ( header.node_ids << 1 ) + 1;
+#endif
+
+#ifdef USE_EAGER
+    map = mm_create( mem_types, mem_sizes, mem_capacities );
+#else
+    map = mm_create( mem_types, mem_sizes );
+#endif
+
+    // keys deleted after the cut when nothing is interrupted
+    replay( 0, cut );
+    reference = replay( cut, header.op_count );
+    destroy_all();
+
+    replay( 0, cut );
+    gettimeofday( &t0, NULL );
+    for( p = 0; p < header.pq_ids; p++ )
+    {
+        if( pq_index[p] == NULL )
+            continue;
+        snapshots[p] = pq_serialize( pq_index[p], &length );
+        if( snapshots[p] == NULL )
+        {
+            fprintf( stderr, "Serialize fail.\n" );
+            return -1;
+        }
+        if( !unique_items( snapshots[p] ) )
+        {
+            fprintf( stderr, "Items are not unique in queue %u.\n", p );
+            return -1;
+        }
+        live += snapshots[p]->size;
+        bytes += length;
+    }
+    serialize_time = elapsed( &t0 );
+    destroy_all();
+
+    for( r = 0; r < reps; r++ )
+    {
+        restore( 0, 0, &restore_time, &restore_first );
+        destroy_all();
+        restore( 1, 0, &insert_time, &insert_first );
+        destroy_all();
+    }
+
+    // both restores must carry on exactly like the original queues
+    for( r = 0; r < 2; r++ )
+    {
+        restore( r, 1, &unused, &unused );
+        hash = replay( cut, header.op_count );
+        destroy_all();
+        if( hash != reference )
+        {
+            fprintf( stderr, "%s restore diverged from the trace.\n",
+                r ? "Inserting" : "Snapshot" );
+            return -1;
+        }
+    }
+
+    printf( "live %u bytes %lu serialize %u restore %u %u insert %u %u\n",
+        live, (unsigned long) bytes, serialize_time, restore_time / reps,
+        restore_first / reps, insert_time / reps, insert_first / reps );
+
+    for( p = 0; p < header.pq_ids; p++ )
+        free( snapshots[p] );
+    mm_destroy( map );
+    free( snapshots );
+    free( handles );
+    free( node_pqs );
+    free( node_items );
+    free( node_index );
+    free( pq_index );
+    free( ops );
+
+    return 0;
+}
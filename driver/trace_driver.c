@@ -35,6 +35,7 @@
     #define pq_delete(q,n)          dummy = 0
     #define pq_delete_min(q)        dummy = 0
     #define pq_decrease_key(q,n,k)  dummy = 0
+    #define pq_increase_key(q,n,k)  dummy = 0
     //#define pq_meld(q,r)            dummy = ( q == r ) ? 1 : 0
     #define pq_empty(q)             dummy = 0
     typedef void pq_type;
@@ -61,8 +62,12 @@
         #include "../queues/implicit_heap.h"
     #elif defined USE_IMPLICIT_16
         #include "../queues/implicit_heap.h"
+    #elif defined USE_WEAK
+        #include "../queues/weak_heap.h"
     #elif defined USE_PAIRING
         #include "../queues/pairing_heap.h"
+    #elif defined USE_SMOOTH
+        #include "../queues/smooth_heap.h"
     #elif defined USE_QUAKE
         #include "../queues/quake_heap.h"
     #elif defined USE_RANK_PAIRING
@@ -73,27 +78,57 @@
         #include "../queues/strict_fibonacci_heap.h"
     #elif defined USE_VIOLATION
         #include "../queues/violation_heap.h"
+    #elif defined USE_HOLLOW
+        #include "../queues/hollow_heap.h"
+    #elif defined USE_CALENDAR
+        #include "../queues/calendar_queue.h"
+    #elif defined USE_LADDER
+        #include "../queues/ladder_queue.h"
     #elif defined USE_KNHEAP
         #include "../queues/knheap.h"
+    #elif defined USE_SPRAY_LIST
+        #include "../queues/spray_list.h"
     #endif
 #endif
 
 #ifdef USE_STRICT_FIBONACCI
-    static uint32_t mem_types = 4;
-    static uint32_t mem_sizes[4] =
+    static uint32_t mem_types = 3;
+    static uint32_t mem_sizes[3] =
     {
         sizeof( strict_fibonacci_node ),
-        sizeof( fix_node ),
         sizeof( active_record ),
         sizeof( rank_record )
     };
-    static uint32_t mem_capacities[4] =
+    static uint32_t mem_capacities[3] =
     {
         0,
-        100000,
         1000,
         1000
     };
+#elif defined USE_HOLLOW
+    static uint32_t mem_types = 2;
+    static uint32_t mem_sizes[2] =
+    {
+        sizeof( hollow_item ),
+        sizeof( hollow_node )
+    };
+    static uint32_t mem_capacities[2] =
+    {
+        0,
+        0
+    };
+#elif defined USE_QUAKE
+    static uint32_t mem_types = 2;
+    static uint32_t mem_sizes[2] =
+    {
+        sizeof( quake_item ),
+        sizeof( quake_node )
+    };
+    static uint32_t mem_capacities[2] =
+    {
+        0,
+        0
+    };
 #else
     static uint32_t mem_types = 1;
     static uint32_t mem_sizes[1] =
@@ -122,6 +157,7 @@ int main( int argc, char** argv )
     pq_op_delete *op_delete;
     pq_op_delete_min *op_delete_min;
     pq_op_decrease_key *op_decrease_key;
+    pq_op_increase_key *op_increase_key;
     //pq_op_meld *op_meld;
     pq_op_empty *op_empty;
 
@@ -157,10 +193,15 @@ int main( int argc, char** argv )
         return -1;
     }
 
-#ifdef USE_QUAKE
-    mem_capacities[0] = header.node_ids << 2;
-#else
     mem_capacities[0] = header.node_ids;
+#ifdef USE_QUAKE
+    // decay keeps each height at most ALPHA times the one below, bounding
+    // internal nodes by ALPHA / ( 1 - ALPHA ) = 3 per item
+    mem_capacities[1] = ( header.node_ids * 3 ) + 1;
+#endif
+#ifdef USE_HOLLOW
+    // rebuilds keep hollow nodes from outnumbering the items
+    mem_capacities[1] = ( header.node_ids << 1 ) + 1;
 #endif
 
 #ifdef USE_EAGER
@@ -297,6 +338,12 @@ int main( int argc, char** argv )
                         n = node_index[op_decrease_key->node_id];
                         pq_decrease_key( q, n, op_decrease_key->key );
                         break;
+                    case PQ_OP_INCREASE_KEY:
+                        op_increase_key = (pq_op_increase_key*) ( ops + i );
+                        q = pq_index[op_increase_key->pq_id];
+                        n = node_index[op_increase_key->node_id];
+                        pq_increase_key( q, n, op_increase_key->key );
+                        break;
                     /*case PQ_OP_MELD:
                         printf("Meld.\n");
                         op_meld = (pq_op_meld*) ( ops + i );
@@ -334,6 +381,22 @@ int main( int argc, char** argv )
             pq_destroy( pq_index[i] );
     }
 
+#ifdef MEM_REPORT
+    // peak node memory from the allocator, per element of the first type
+    uint64_t mem_bytes = 0;
+    uint32_t mem_type, mem_peak;
+    for( mem_type = 0; mem_type < mem_types; mem_type++ )
+    {
+        mem_peak = mm_peak_nodes( map, mem_type );
+        mem_bytes += (uint64_t) mem_peak * mem_sizes[mem_type];
+        fprintf( stderr, "type %u: %u nodes of %u bytes\n", mem_type,
+            mem_peak, mem_sizes[mem_type] );
+    }
+    if( mm_peak_nodes( map, 0 ) > 0 )
+        fprintf( stderr, "%.1f bytes per element\n",
+            (double) mem_bytes / mm_peak_nodes( map, 0 ) );
+#endif
+
     mm_destroy( map );
     free( pq_index );
     free( node_index );
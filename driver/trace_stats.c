@@ -1,17 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/time.h>
 #include <stdint.h>
 #include <fcntl.h>
 #include <unistd.h>
-
-#ifdef USE_EAGER
-    #include "../memory_management_eager.h"
-#elif USE_LAZY
-    #include "../memory_management_lazy.h"
-#else
-    #include "../memory_management_dumb.h"
-#endif
+#include <math.h>
 
 #include "../trace_tools.h"
 #include "../typedefs.h"
@@ -19,90 +11,126 @@
 #define CHUNK_SIZE 1000000
 #define MIN(a,b) ( b < a ? b : a )
 
-#ifdef DUMMY
-    // This measures the overhead of processing the input files, which should be
-    // subtracted from all heap time measurements.  Does some silly stuff to
-    // avoid compiler warnings.
-    #define pq_create(m)            map
-    #define pq_destroy(q)           dummy = ( q == NULL ) ? 1 : 0
-    #define pq_clear(q)             dummy = 0
-    #define pq_get_key(q,n)         dummy = 0
-    #define pq_get_item(q,n)        dummy = 0
-    #define pq_get_size(q)          dummy = 0
-    #define pq_insert(q,i,k)        n
-    #define pq_find_min(q)          dummy = 0
-    #define pq_delete(q,n)          dummy = 0
-    #define pq_delete_min(q)        dummy = 0
-    #define pq_decrease_key(q,n,k)  dummy = 0
-    //#define pq_meld(q,r)            dummy = ( q == r ) ? 1 : 0
-    #define pq_empty(q)             dummy = 0
-    typedef void pq_type;
-    typedef void pq_node_type;
-    static uint32_t dummy;
-#else
-    #ifdef USE_BINOMIAL
-        #include "../queues/binomial_queue.h"
-    #elif USE_EXPLICIT_2
-        #include "../queues/explicit_heap.h"
-    #elif defined USE_EXPLICIT_4
-        #include "../queues/explicit_heap.h"
-    #elif defined USE_EXPLICIT_8
-        #include "../queues/explicit_heap.h"
-    #elif defined USE_EXPLICIT_16
-        #include "../queues/explicit_heap.h"
-    #elif defined USE_FIBONACCI
-        #include "../queues/fibonacci_heap.h"
-    #elif defined USE_IMPLICIT_2
-        #include "../queues/implicit_heap.h"
-    #elif defined USE_IMPLICIT_4
-        #include "../queues/implicit_heap.h"
-    #elif defined USE_IMPLICIT_8
-        #include "../queues/implicit_heap.h"
-    #elif defined USE_IMPLICIT_16
-        #include "../queues/implicit_heap.h"
-    #elif defined USE_PAIRING
-        #include "../queues/pairing_heap.h"
-    #elif defined USE_QUAKE
-        #include "../queues/quake_heap.h"
-    #elif defined USE_RANK_PAIRING
-        #include "../queues/rank_pairing_heap.h"
-    #elif defined USE_RANK_RELAXED_WEAK
-        #include "../queues/rank_relaxed_weak_queue.h"
-    #elif defined USE_STRICT_FIBONACCI
-        #include "../queues/strict_fibonacci_heap.h"
-    #elif defined USE_VIOLATION
-        #include "../queues/violation_heap.h"
-    #endif
-#endif
-
-#ifdef USE_STRICT_FIBONACCI
-    static uint32_t mem_types = 4;
-    static uint32_t mem_sizes[4] =
-    {
-        sizeof( strict_fibonacci_node ),
-        sizeof( fix_node ),
-        sizeof( active_record ),
-        sizeof( rank_record )
-    };
-    static uint32_t mem_capacities[4] =
-    {
-        0,
-        1000,
-        1000,
-        1000
-    };
-#else
-    static uint32_t mem_types = 1;
-    static uint32_t mem_sizes[1] =
-    {
-        sizeof( pq_node_type )
-    };
-    static uint32_t mem_capacities[1] =
-    {
-        0
-    };
-#endif
+#define NIL         0xFFFFFFFF
+#define NO_QUEUE    0xFFFFFFFF
+
+// log2 buckets: bucket 0 counts zeros, bucket b counts [2^(b-1), 2^b)
+#define LOG_BUCKETS         33
+#define DECILES             10
+#define DEFAULT_WINDOWS     100
+// L1 distance between the operation mix of a window and that of the current
+// phase beyond which the window starts a new phase
+#define PHASE_THRESHOLD     0.25
+
+/**
+ * A treap over node ids, ordered by an external key array with ties broken
+ * by node id, which counts the nodes below each node so that ranks take
+ * logarithmic time.  Priorities are a hash of the node id, so the shape and
+ * thus the output do not depend on a random seed.
+ */
+typedef struct order_tree_t
+{
+    uint32_t *left;
+    uint32_t *right;
+    //! number of nodes in the subtree of each node
+    uint32_t *count;
+    //! key of each node id
+    key_type *key;
+} order_tree;
+
+/**
+ * Counters for a range of operations, used both for fixed windows of the
+ * trace and for the phases they are merged into.
+ */
+typedef struct range_stats_t
+{
+    uint64_t first;
+    uint64_t ops;
+    uint64_t insert;
+    uint64_t delete_min;
+    uint64_t decrease_key;
+    uint64_t delete;
+    uint64_t sum_size;
+    double sum_rank;
+} range_stats;
 
+static order_tree live;
+//! live tree root of each queue
+static uint32_t *roots;
+//! queue holding each node id, NO_QUEUE if none
+static uint32_t *owner;
+static key_type *keys;
+//! Fenwick tree over access slots, marking the last access of each node id
+static uint32_t *marks;
+//! node id accessed in each slot
+static uint32_t *slot_node;
+//! slot of the last access of each node id, 0 if never used
+static uint32_t *last_slot;
+static uint32_t slot_count;
+//! next free slot
+static uint32_t next_slot = 1;
+//! number of marked slots, the node ids used so far
+static uint32_t distinct;
+
+static uint32_t priority( uint32_t n );
+static int before( order_tree *tree, uint32_t a, uint32_t b );
+static uint32_t tree_count( order_tree *tree, uint32_t t );
+static void tree_update( order_tree *tree, uint32_t t );
+static void tree_split( order_tree *tree, uint32_t t, uint32_t n,
+    uint32_t *l, uint32_t *r );
+static uint32_t tree_merge( order_tree *tree, uint32_t a, uint32_t b );
+static uint32_t tree_insert( order_tree *tree, uint32_t root, uint32_t n );
+static uint32_t tree_remove( order_tree *tree, uint32_t t, uint32_t n );
+static uint32_t tree_rank( order_tree *tree, uint32_t t, key_type key );
+static uint32_t tree_first( order_tree *tree, uint32_t t );
+static void release( uint32_t t );
+static uint32_t reuse( uint32_t node_id );
+static uint32_t marked( uint32_t slot );
+static void mark( uint32_t slot, int32_t delta );
+static void compact( void );
+static int tree_create( order_tree *tree, uint32_t n, key_type *key );
+static void tree_destroy( order_tree *tree );
+static uint32_t log_bucket( uint64_t value );
+static void print_counts( const char *name, uint64_t *counts, uint32_t n );
+static void print_range( const char *name, uint32_t index, range_stats *s );
+static void add_range( range_stats *a, range_stats *b );
+static double mix_distance( range_stats *a, range_stats *b );
+
+/**
+ * Profiles a trace in a single pass, holding only a fixed buffer of
+ * operations and a few words per node and queue id, so traces of any length
+ * can be read.
+ *
+ *   trace_stats trace [windows]
+ *
+ * Besides the operation counts and queue sizes, the items of each queue are
+ * kept in order, which gives the features that decide between queues:
+ *
+ * insert_rank counts insertions by the log2 bucket of the number of smaller
+ * keys in the queue, and insert_rank_decile by that rank relative to the
+ * queue size, which insert_relative_rank averages.
+ *
+ * decrease_key_new_min counts decrease-keys that make their node the minimum.
+ * decrease_key_ratio counts the others by the decile of the new distance to
+ * the minimum relative to the old one, and decrease_key_mean_ratio averages
+ * that ratio over all of them, a new minimum counting as zero.
+ * decrease_key_overtaken counts decrease-keys by the log2 bucket of the
+ * number of items the node passes.
+ *
+ * reuse_distance counts operations on a node id by the log2 bucket of the
+ * number of distinct node ids used since the last operation on it, the stack
+ * distance of the handle lookups, and reuse_mean_distance averages it.
+ * reuse_cold counts first uses.
+ *
+ * The trace is cut into windows of equal length, 100 unless given.  Each
+ * window line holds its first operation, length, insert, delete-min,
+ * decrease-key and delete counts, average size and average relative rank of
+ * its insertions.  Consecutive windows are merged into a phase until the
+ * operation mix of a window is far from that of the phase, and phase lines
+ * hold the same fields.
+ *
+ * Every line is a name, a colon and one or more numbers.
+ */
 int main( int argc, char** argv )
 {
     uint64_t i;
@@ -119,10 +147,26 @@ int main( int argc, char** argv )
     uint64_t count_delete = 0;
     uint64_t count_delete_min = 0;
     uint64_t count_decrease_key = 0;
+    uint64_t count_increase_key = 0;
     uint64_t count_empty = 0;
 
+    uint64_t insert_rank[LOG_BUCKETS] = { 0 };
+    uint64_t insert_rank_decile[DECILES] = { 0 };
+    double sum_insert_rank = 0;
+    uint64_t decrease_key_new_min = 0;
+    uint64_t decrease_key_ratio[DECILES] = { 0 };
+    uint64_t decrease_key_overtaken[LOG_BUCKETS] = { 0 };
+    double sum_decrease_key_ratio = 0;
+    uint64_t reuse_distance[LOG_BUCKETS] = { 0 };
+    uint64_t reuse_cold = 0;
+    uint64_t reuse_count = 0;
+    double sum_reuse_distance = 0;
+
     if( argc < 2 )
+    {
+        fprintf( stderr, "usage: %s trace [windows]\n", argv[0] );
         exit( -1 );
+    }
 
     int trace_file = open( argv[1], O_RDONLY );
     if( trace_file < 0 )
@@ -134,38 +178,47 @@ int main( int argc, char** argv )
     pq_trace_header header;
     pq_trace_read_header( trace_file, &header );
 
-    //printf("Header: (%llu,%lu,%lu)\n",header.op_count,header.pq_ids,
-    //    header.node_ids);
+    uint32_t window_count = ( argc > 2 ) ? atoi( argv[2] ) : DEFAULT_WINDOWS;
+    if( window_count == 0 )
+        window_count = 1;
+    uint64_t window_length = ( header.op_count + window_count - 1 ) /
+        window_count;
+    if( window_length == 0 )
+        window_length = 1;
 
-    pq_op_blank *ops = calloc( header.op_count, sizeof( pq_op_blank ) );
-    pq_type **pq_index = calloc( header.pq_ids, sizeof( pq_type* ) );
-    pq_node_type **node_index = calloc( header.node_ids,
-        sizeof( pq_node_type* ) );
-    if( ops == NULL || pq_index == NULL || node_index == NULL )
+    pq_op_blank *ops = calloc( CHUNK_SIZE, sizeof( pq_op_blank ) );
+    roots = malloc( ( header.pq_ids + 1 ) * sizeof( uint32_t ) );
+    owner = malloc( ( header.node_ids + 1 ) * sizeof( uint32_t ) );
+    keys = calloc( header.node_ids + 1, sizeof( key_type ) );
+    // compaction leaves at most node_ids slots in use, so it frees at least
+    // as many as it keeps
+    slot_count = 2 * header.node_ids + 2;
+    marks = calloc( slot_count, sizeof( uint32_t ) );
+    slot_node = calloc( slot_count, sizeof( uint32_t ) );
+    last_slot = calloc( header.node_ids + 1, sizeof( uint32_t ) );
+    range_stats *windows = calloc( window_count, sizeof( range_stats ) );
+    if( ops == NULL || roots == NULL || owner == NULL || keys == NULL ||
+            marks == NULL || slot_node == NULL || last_slot == NULL ||
+            windows == NULL || tree_create( &live, header.node_ids, keys ) != 0 )
     {
         fprintf( stderr, "Calloc fail.\n" );
         return -1;
     }
-
-#ifdef USE_QUAKE
-    mem_capacities[0] = header.node_ids << 2;
-#else
-    mem_capacities[0] = header.node_ids;
-#endif
-#ifdef USE_EAGER
-    mem_map *map = mm_create( mem_types, mem_sizes, mem_capacities );
-#else
-    mem_map *map = mm_create( mem_types, mem_sizes );
-#endif
+    for( i = 0; i < header.pq_ids; i++ )
+        roots[i] = NIL;
+    for( i = 0; i < header.node_ids; i++ )
+        owner[i] = NO_QUEUE;
 
     uint64_t op_remaining = header.op_count;
     uint64_t op_chunk;
+    uint64_t op_index = 0;
     int status;
     uint32_t queue_size = 0;
     uint64_t sum_size = 0;
     uint32_t max_size = 0;
-
-    mm_clear( map );
+    uint32_t pq_id, node_id, min, size, rank, old_rank;
+    key_type key;
+    range_stats *w;
 
     while( op_remaining > 0 )
     {
@@ -182,19 +235,53 @@ int main( int argc, char** argv )
             }
         }
 
-        for( i = 0; i < op_chunk; i++ )
+        for( i = 0; i < op_chunk; i++, op_index++ )
         {
+            w = windows + ( op_index / window_length );
+            if( w->ops++ == 0 )
+                w->first = op_index;
+            w->sum_size += queue_size;
             sum_size += queue_size;
+
+            pq_id = ( (uint32_t*) ( ops + i ) )[1];
+            node_id = ( (uint32_t*) ( ops + i ) )[2];
+            switch( ops[i].code )
+            {
+                case PQ_OP_GET_KEY:
+                case PQ_OP_GET_ITEM:
+                case PQ_OP_INSERT:
+                case PQ_OP_DELETE:
+                case PQ_OP_DECREASE_KEY:
+                case PQ_OP_INCREASE_KEY:
+                    rank = reuse( node_id );
+                    if( rank == NIL )
+                        reuse_cold++;
+                    else
+                    {
+                        reuse_distance[log_bucket( rank )]++;
+                        sum_reuse_distance += rank;
+                        reuse_count++;
+                    }
+                    break;
+                default:
+                    break;
+            }
+
             switch( ops[i].code )
             {
                 case PQ_OP_CREATE:
                     count_create++;
+                    roots[pq_id] = NIL;
                     break;
                 case PQ_OP_DESTROY:
                     count_destroy++;
+                    release( roots[pq_id] );
+                    roots[pq_id] = NIL;
                     break;
                 case PQ_OP_CLEAR:
                     count_clear++;
+                    release( roots[pq_id] );
+                    roots[pq_id] = NIL;
                     break;
                 case PQ_OP_GET_KEY:
                     count_get_key++;
@@ -210,6 +297,20 @@ int main( int argc, char** argv )
                     if( queue_size > max_size )
                         max_size = queue_size;
                     count_insert++;
+                    w->insert++;
+
+                    key = ( (pq_op_insert*) ( ops + i ) )->key;
+                    size = tree_count( &live, roots[pq_id] );
+                    rank = tree_rank( &live, roots[pq_id], key );
+                    insert_rank[log_bucket( rank )]++;
+                    insert_rank_decile[( (uint64_t) rank * DECILES ) /
+                        ( size + 1 )]++;
+                    sum_insert_rank += (double) rank / ( size + 1 );
+                    w->sum_rank += (double) rank / ( size + 1 );
+
+                    keys[node_id] = key;
+                    owner[node_id] = pq_id;
+                    roots[pq_id] = tree_insert( &live, roots[pq_id], node_id );
                     break;
                 case PQ_OP_FIND_MIN:
                     count_find_min++;
@@ -217,13 +318,62 @@ int main( int argc, char** argv )
                 case PQ_OP_DELETE:
                     queue_size--;
                     count_delete++;
+                    w->delete++;
+                    if( owner[node_id] != NO_QUEUE )
+                    {
+                        pq_id = owner[node_id];
+                        roots[pq_id] = tree_remove( &live, roots[pq_id],
+                            node_id );
+                        owner[node_id] = NO_QUEUE;
+                    }
                     break;
                 case PQ_OP_DELETE_MIN:
                     queue_size--;
                     count_delete_min++;
+                    w->delete_min++;
+                    min = tree_first( &live, roots[pq_id] );
+                    if( min != NIL )
+                    {
+                        roots[pq_id] = tree_remove( &live, roots[pq_id], min );
+                        owner[min] = NO_QUEUE;
+                    }
                     break;
                 case PQ_OP_DECREASE_KEY:
                     count_decrease_key++;
+                    w->decrease_key++;
+                    if( owner[node_id] == NO_QUEUE )
+                        break;
+                    pq_id = owner[node_id];
+
+                    key = ( (pq_op_decrease_key*) ( ops + i ) )->key;
+                    min = tree_first( &live, roots[pq_id] );
+                    if( min == node_id || key < keys[min] )
+                        decrease_key_new_min++;
+                    else
+                    {
+                        double ratio = (double) ( key - keys[min] ) /
+                            (double) ( keys[node_id] - keys[min] );
+                        decrease_key_ratio[MIN( (uint32_t) ( ratio *
+                            DECILES ), DECILES - 1 )]++;
+                        sum_decrease_key_ratio += ratio;
+                    }
+
+                    old_rank = tree_rank( &live, roots[pq_id],
+                        keys[node_id] );
+                    roots[pq_id] = tree_remove( &live, roots[pq_id], node_id );
+                    rank = tree_rank( &live, roots[pq_id], key );
+                    decrease_key_overtaken[log_bucket( old_rank - rank )]++;
+                    keys[node_id] = key;
+                    roots[pq_id] = tree_insert( &live, roots[pq_id], node_id );
+                    break;
+                case PQ_OP_INCREASE_KEY:
+                    count_increase_key++;
+                    if( owner[node_id] == NO_QUEUE )
+                        break;
+                    pq_id = owner[node_id];
+                    roots[pq_id] = tree_remove( &live, roots[pq_id], node_id );
+                    keys[node_id] = ( (pq_op_increase_key*) ( ops + i ) )->key;
+                    roots[pq_id] = tree_insert( &live, roots[pq_id], node_id );
                     break;
                 /*case PQ_OP_MELD:
                     printf("Meld.\n");
@@ -244,31 +394,419 @@ int main( int argc, char** argv )
 
     close( trace_file );
 
-    for( i = 0; i < header.pq_ids; i++ )
+    printf("create: %llu\n",(unsigned long long)count_create);
+    printf("destroy: %llu\n",(unsigned long long)count_destroy);
+    printf("clear: %llu\n",(unsigned long long)count_clear);
+    printf("get_key: %llu\n",(unsigned long long)count_get_key);
+    printf("get_item: %llu\n",(unsigned long long)count_get_item);
+    printf("get_size: %llu\n",(unsigned long long)count_get_size);
+    printf("insert: %llu\n",(unsigned long long)count_insert);
+    printf("find_min: %llu\n",(unsigned long long)count_find_min);
+    printf("delete: %llu\n",(unsigned long long)count_delete);
+    printf("delete_min: %llu\n",(unsigned long long)count_delete_min);
+    printf("decrease_key: %llu\n",(unsigned long long)count_decrease_key);
+    printf("increase_key: %llu\n",(unsigned long long)count_increase_key);
+    printf("empty: %llu\n",(unsigned long long)count_empty);
+    printf("max_size: %u\n",max_size);
+    printf("avg_size: %f\n",((double)sum_size)/((double)header.op_count));
+
+    print_counts( "insert_rank", insert_rank, LOG_BUCKETS );
+    print_counts( "insert_rank_decile", insert_rank_decile, DECILES );
+    printf("insert_relative_rank: %f\n",
+        count_insert ? sum_insert_rank / count_insert : 0.0);
+    printf("decrease_key_new_min: %llu\n",
+        (unsigned long long)decrease_key_new_min);
+    print_counts( "decrease_key_ratio", decrease_key_ratio, DECILES );
+    print_counts( "decrease_key_overtaken", decrease_key_overtaken,
+        LOG_BUCKETS );
+    printf("decrease_key_mean_ratio: %f\n", count_decrease_key ?
+        sum_decrease_key_ratio / count_decrease_key : 0.0);
+    printf("reuse_cold: %llu\n",(unsigned long long)reuse_cold);
+    print_counts( "reuse_distance", reuse_distance, LOG_BUCKETS );
+    printf("reuse_mean_distance: %f\n",
+        reuse_count ? sum_reuse_distance / reuse_count : 0.0);
+
+    // merge windows into phases with a similar operation mix
+    range_stats phase = windows[0];
+    uint32_t phase_count = 0;
+    for( i = 0; i < window_count && windows[i].ops > 0; i++ )
     {
-        if( pq_index[i] != NULL )
-            pq_destroy( pq_index[i] );
+        print_range( "window", i, windows + i );
+        if( i == 0 )
+            continue;
+        if( mix_distance( &phase, windows + i ) > PHASE_THRESHOLD )
+        {
+            print_range( "phase", phase_count++, &phase );
+            phase = windows[i];
+        }
+        else
+            add_range( &phase, windows + i );
     }
+    if( header.op_count > 0 )
+        print_range( "phase", phase_count++, &phase );
+    printf("phases: %u\n",phase_count);
 
-    mm_destroy( map );
-    free( pq_index );
-    free( node_index );
+    tree_destroy( &live );
+    free( roots );
+    free( owner );
+    free( keys );
+    free( marks );
+    free( slot_node );
+    free( last_slot );
+    free( windows );
     free( ops );
 
-    printf("create: %llu\n",count_create);
-    printf("destroy: %llu\n",count_destroy);
-    printf("clear: %llu\n",count_clear);
-    printf("get_key: %llu\n",count_get_key);
-    printf("get_item: %llu\n",count_get_item);
-    printf("get_size: %llu\n",count_get_size);
-    printf("insert: %llu\n",count_insert);
-    printf("find_min: %llu\n",count_find_min);
-    printf("delete: %llu\n",count_delete);
-    printf("delete_min: %llu\n",count_delete_min);
-    printf("decrease_key: %llu\n",count_decrease_key);
-    printf("empty: %llu\n",count_empty);
-    printf("max_size: %lu\n",max_size);
-    printf("avg_size: %f\n",((double)sum_size)/((double)header.op_count));
-
     return 0;
 }
+
+/**
+ * Hashes a node id into a treap priority.
+ *
+ * @param n Node id
+ * @return  Priority of the node
+ */
+static uint32_t priority( uint32_t n )
+{
+    n ^= n >> 16;
+    n *= 0x85EBCA6B;
+    n ^= n >> 13;
+    n *= 0xC2B2AE35;
+    n ^= n >> 16;
+    return n;
+}
+
+static int before( order_tree *tree, uint32_t a, uint32_t b )
+{
+    return tree->key[a] < tree->key[b] ||
+        ( tree->key[a] == tree->key[b] && a < b );
+}
+
+static uint32_t tree_count( order_tree *tree, uint32_t t )
+{
+    return ( t == NIL ) ? 0 : tree->count[t];
+}
+
+static void tree_update( order_tree *tree, uint32_t t )
+{
+    tree->count[t] = tree_count( tree, tree->left[t] ) +
+        tree_count( tree, tree->right[t] ) + 1;
+}
+
+/**
+ * Splits a subtree into the nodes before a given node and the rest.
+ *
+ * @param tree  Tree to split
+ * @param t     Root of the subtree
+ * @param n     Node to split at, which need not be in the tree
+ * @param l     Output root of the nodes before n
+ * @param r     Output root of the remaining nodes
+ */
+static void tree_split( order_tree *tree, uint32_t t, uint32_t n,
+    uint32_t *l, uint32_t *r )
+{
+    if( t == NIL )
+    {
+        *l = NIL;
+        *r = NIL;
+    }
+    else if( before( tree, t, n ) )
+    {
+        *l = t;
+        tree_split( tree, tree->right[t], n, tree->right + t, r );
+        tree_update( tree, t );
+    }
+    else
+    {
+        *r = t;
+        tree_split( tree, tree->left[t], n, l, tree->left + t );
+        tree_update( tree, t );
+    }
+}
+
+/**
+ * Joins two subtrees, every node of the first before every node of the
+ * second.
+ *
+ * @param tree  Tree to join in
+ * @param a     Root of the first subtree
+ * @param b     Root of the second subtree
+ * @return      Root of the joined subtree
+ */
+static uint32_t tree_merge( order_tree *tree, uint32_t a, uint32_t b )
+{
+    if( a == NIL )
+        return b;
+    if( b == NIL )
+        return a;
+
+    if( priority( a ) > priority( b ) )
+    {
+        tree->right[a] = tree_merge( tree, tree->right[a], b );
+        tree_update( tree, a );
+        return a;
+    }
+    else
+    {
+        tree->left[b] = tree_merge( tree, a, tree->left[b] );
+        tree_update( tree, b );
+        return b;
+    }
+}
+
+/**
+ * Inserts a node, descending to the first node of lower priority and
+ * splitting its subtree around the new node.
+ *
+ * @param tree  Tree to insert into
+ * @param root  Root of the tree
+ * @param n     Node to insert
+ * @return      New root of the tree
+ */
+static uint32_t tree_insert( order_tree *tree, uint32_t root, uint32_t n )
+{
+    uint32_t *link = &root;
+    uint32_t p = priority( n );
+
+    while( *link != NIL && priority( *link ) > p )
+    {
+        tree->count[*link]++;
+        link = before( tree, n, *link ) ? tree->left + *link :
+            tree->right + *link;
+    }
+    tree_split( tree, *link, n, tree->left + n, tree->right + n );
+    tree_update( tree, n );
+    *link = n;
+
+    return root;
+}
+
+/**
+ * Removes a node, which must be in the tree, before its key changes.
+ *
+ * @param tree  Tree to remove from
+ * @param root  Root of the tree
+ * @param n     Node to remove
+ * @return      New root of the tree
+ */
+static uint32_t tree_remove( order_tree *tree, uint32_t root, uint32_t n )
+{
+    uint32_t *link = &root;
+
+    while( *link != n )
+    {
+        tree->count[*link]--;
+        link = before( tree, n, *link ) ? tree->left + *link :
+            tree->right + *link;
+    }
+    *link = tree_merge( tree, tree->left[n], tree->right[n] );
+
+    return root;
+}
+
+/**
+ * Counts the nodes with a key smaller than the given one.
+ *
+ * @param tree  Tree to query
+ * @param t     Root of the subtree
+ * @param key   Key to compare with
+ * @return      Number of smaller keys
+ */
+static uint32_t tree_rank( order_tree *tree, uint32_t t, key_type key )
+{
+    uint32_t rank = 0;
+
+    while( t != NIL )
+    {
+        if( tree->key[t] < key )
+        {
+            rank += tree_count( tree, tree->left[t] ) + 1;
+            t = tree->right[t];
+        }
+        else
+            t = tree->left[t];
+    }
+
+    return rank;
+}
+
+static uint32_t tree_first( order_tree *tree, uint32_t t )
+{
+    if( t == NIL )
+        return NIL;
+    while( tree->left[t] != NIL )
+        t = tree->left[t];
+    return t;
+}
+
+/**
+ * Marks every node of a live subtree as held by no queue.
+ *
+ * @param t Root of the subtree
+ */
+static void release( uint32_t t )
+{
+    if( t == NIL )
+        return;
+    owner[t] = NO_QUEUE;
+    release( live.left[t] );
+    release( live.right[t] );
+}
+
+/**
+ * Records an operation on a node id and finds its stack distance: the number
+ * of distinct node ids used since the last operation on it.  Each id marks
+ * the slot of its last operation, so the distance is the number of marks
+ * after that slot.
+ *
+ * @param node_id   Node id used
+ * @return          Stack distance, NIL on the first use
+ */
+static uint32_t reuse( uint32_t node_id )
+{
+    uint32_t distance = NIL;
+
+    if( next_slot == slot_count )
+        compact();
+    if( last_slot[node_id] == 0 )
+        distinct++;
+    else
+    {
+        distance = distinct - marked( last_slot[node_id] );
+        mark( last_slot[node_id], -1 );
+    }
+
+    last_slot[node_id] = next_slot;
+    slot_node[next_slot] = node_id;
+    mark( next_slot++, 1 );
+
+    return distance;
+}
+
+static uint32_t marked( uint32_t slot )
+{
+    uint32_t sum = 0;
+
+    for( ; slot > 0; slot &= slot - 1 )
+        sum += marks[slot];
+    return sum;
+}
+
+static void mark( uint32_t slot, int32_t delta )
+{
+    for( ; slot < slot_count; slot += slot & -slot )
+        marks[slot] += delta;
+}
+
+/**
+ * Moves the marked slots to the front, in order, and rebuilds the Fenwick
+ * tree over them.
+ */
+static void compact( void )
+{
+    uint32_t slot, node_id, next;
+
+    next_slot = 1;
+    for( slot = 1; slot < slot_count; slot++ )
+    {
+        node_id = slot_node[slot];
+        if( last_slot[node_id] == slot )
+        {
+            last_slot[node_id] = next_slot;
+            slot_node[next_slot++] = node_id;
+        }
+    }
+
+    for( slot = 1; slot < slot_count; slot++ )
+        marks[slot] = ( slot < next_slot ) ? 1 : 0;
+    for( slot = 1; slot < slot_count; slot++ )
+    {
+        next = slot + ( slot & -slot );
+        if( next < slot_count )
+            marks[next] += marks[slot];
+    }
+}
+
+static int tree_create( order_tree *tree, uint32_t n, key_type *key )
+{
+    tree->left = malloc( ( n + 1 ) * sizeof( uint32_t ) );
+    tree->right = malloc( ( n + 1 ) * sizeof( uint32_t ) );
+    tree->count = malloc( ( n + 1 ) * sizeof( uint32_t ) );
+    tree->key = key;
+
+    return ( tree->left == NULL || tree->right == NULL ||
+        tree->count == NULL ) ? -1 : 0;
+}
+
+static void tree_destroy( order_tree *tree )
+{
+    free( tree->left );
+    free( tree->right );
+    free( tree->count );
+}
+
+static uint32_t log_bucket( uint64_t value )
+{
+    return ( value == 0 ) ? 0 : 64 - __builtin_clzll( value );
+}
+
+static void print_counts( const char *name, uint64_t *counts, uint32_t n )
+{
+    uint32_t i;
+
+    printf( "%s:", name );
+    for( i = 0; i < n; i++ )
+        printf( " %llu", (unsigned long long) counts[i] );
+    printf( "\n" );
+}
+
+static void print_range( const char *name, uint32_t index, range_stats *s )
+{
+    printf( "%s: %u %llu %llu %llu %llu %llu %llu %f %f\n", name, index,
+        (unsigned long long) s->first, (unsigned long long) s->ops,
+        (unsigned long long) s->insert, (unsigned long long) s->delete_min,
+        (unsigned long long) s->decrease_key, (unsigned long long) s->delete,
+        (double) s->sum_size / s->ops,
+        s->insert ? s->sum_rank / s->insert : 0.0 );
+}
+
+static void add_range( range_stats *a, range_stats *b )
+{
+    a->ops += b->ops;
+    a->insert += b->insert;
+    a->delete_min += b->delete_min;
+    a->decrease_key += b->decrease_key;
+    a->delete += b->delete;
+    a->sum_size += b->sum_size;
+    a->sum_rank += b->sum_rank;
+}
+
+/**
+ * Compares the operation mix of two ranges: the L1 distance between the
+ * shares of insert, delete-min, decrease-key, delete and all other
+ * operations.
+ *
+ * @param a First range
+ * @param b Second range
+ * @return  Distance in [0, 2]
+ */
+static double mix_distance( range_stats *a, range_stats *b )
+{
+    double x[5], y[5], distance = 0;
+    uint32_t i;
+
+    x[0] = a->insert;
+    x[1] = a->delete_min;
+    x[2] = a->decrease_key;
+    x[3] = a->delete;
+    x[4] = a->ops - a->insert - a->delete_min - a->decrease_key - a->delete;
+    y[0] = b->insert;
+    y[1] = b->delete_min;
+    y[2] = b->decrease_key;
+    y[3] = b->delete;
+    y[4] = b->ops - b->insert - b->delete_min - b->decrease_key - b->delete;
+
+    for( i = 0; i < 5; i++ )
+        distance += fabs( x[i] / a->ops - y[i] / b->ops );
+
+    return distance;
+}
@@ -10,6 +10,9 @@ mem_map* mm_create( uint32_t types, uint32_t *sizes )
     mem_map *map = malloc( sizeof( mem_map ) );
     map->types = types;
     map->sizes = malloc( types * sizeof( uint32_t ) );
+    memcpy( map->sizes, sizes, types * sizeof( uint32_t ) );
+    map->live = calloc( types, sizeof( uint32_t ) );
+    map->peak = calloc( types, sizeof( uint32_t ) );
 
     return map;
 }
@@ -17,22 +20,34 @@ mem_map* mm_create( uint32_t types, uint32_t *sizes )
 void mm_destroy( mem_map *map )
 {
     free( map->sizes );
+    free( map->live );
+    free( map->peak );
     free( map );
 }
 
 void mm_clear( mem_map *map )
 {
-    return;
+    // nodes are not reclaimed, only the live counts start over
+    memset( map->live, 0, map->types * sizeof( uint32_t ) );
 }
 
 void* pq_alloc_node( mem_map *map, uint32_t type )
 {
     void *node = calloc( 1, map->sizes[type] );
+    if( ++(map->live[type]) > map->peak[type] )
+        map->peak[type] = map->live[type];
 
     return node;
 }
 
 void pq_free_node( mem_map *map, uint32_t type, void *node )
 {
+    if( map->live[type] > 0 )
+        (map->live[type])--;
     free( node );
 }
+
+uint32_t mm_peak_nodes( mem_map *map, uint32_t type )
+{
+    return map->peak[type];
+}
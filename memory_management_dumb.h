@@ -22,12 +22,21 @@ typedef struct mem_map_t
     uint32_t types;
     //! sizes of single nodes
     uint32_t *sizes;
+
+    //! number of live nodes of each type
+    uint32_t *live;
+    //! largest number of live nodes of each type
+    uint32_t *peak;
 } mem_map;
 
 //==============================================================================
 // PUBLIC DECLARATIONS
 //==============================================================================
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * Creates a new memory map for the specified node sizes
  *
@@ -73,4 +82,18 @@ void* pq_alloc_node( mem_map *map, uint32_t type );
  */
 void pq_free_node( mem_map *map, uint32_t type, void *node );
 
+/**
+ * Reports the largest number of nodes of a type that have been live at once
+ * since the map was created.  Survives clearing the map.
+ *
+ * @param map   Map to query
+ * @param type  Type of node to query
+ * @return      Peak number of live nodes
+ */
+uint32_t mm_peak_nodes( mem_map *map, uint32_t type );
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
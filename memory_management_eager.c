@@ -17,6 +17,7 @@ mem_map* mm_create( uint32_t types, uint32_t *sizes, uint32_t *capacities )
     map->free = malloc( types * sizeof( uint8_t** ) );
     map->index_data = calloc( types, sizeof( uint32_t ) );
     map->index_free = calloc( types, sizeof( uint32_t ) );
+    map->peak = calloc( types, sizeof( uint32_t ) );
 
 
     for( i = 0; i < types; i++ )
@@ -47,6 +48,7 @@ void mm_destroy( mem_map *map )
     free( map->free );
     free( map->capacities );
     free( map->sizes );
+    free( map->peak );
 
     free( map );
 }
@@ -56,6 +58,7 @@ void mm_clear( mem_map *map )
     int i;
     for( i = 0; i < map->types; i++ )
     {
+        map->peak[i] = mm_peak_nodes( map, i );
         map->index_data[i] = 0;
         map->index_free[i] = 0;
     }
@@ -79,3 +82,10 @@ void pq_free_node( mem_map *map, uint32_t type, void *node )
 {
     map->free[type][(map->index_free[type])++] = node;
 }
+
+uint32_t mm_peak_nodes( mem_map *map, uint32_t type )
+{
+    // nodes only come off the data array when the free list is empty
+    uint32_t used = map->index_data[type];
+    return ( used > map->peak[type] ) ? used : map->peak[type];
+}
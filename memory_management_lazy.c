@@ -37,6 +37,7 @@ mem_map* mm_create( uint32_t types, uint32_t *sizes )
     map->chunk_free = calloc( types, sizeof( uint32_t ) );
     map->index_data = calloc( types, sizeof( uint32_t ) );
     map->index_free = calloc( types, sizeof( uint32_t ) );
+    map->peak = calloc( types, sizeof( uint32_t ) );
 
 
     for( i = 0; i < types; i++ )
@@ -77,6 +78,7 @@ void mm_destroy( mem_map *map )
     free( map->chunk_free );
     free( map->index_data );
     free( map->index_free );
+    free( map->peak );
 
     free( map );
 }
@@ -86,6 +88,7 @@ void mm_clear( mem_map *map )
     int i;
     for( i = 0; i < map->types; i++ )
     {
+        map->peak[i] = mm_peak_nodes( map, i );
         map->chunk_data[i] = 0;
         map->chunk_free[i] = 0;
         map->index_data[i] = 0;
@@ -126,6 +129,14 @@ void pq_free_node( mem_map *map, uint32_t type, void *node )
     map->free[type][map->chunk_free[type]][(map->index_free[type])++] = node;
 }
 
+uint32_t mm_peak_nodes( mem_map *map, uint32_t type )
+{
+    // nodes only come off the data chunks when the free list is empty
+    uint32_t used = ( mm_sizes[map->chunk_data[type]] - 1 ) +
+        map->index_data[type];
+    return ( used > map->peak[type] ) ? used : map->peak[type];
+}
+
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
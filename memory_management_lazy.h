@@ -32,12 +32,19 @@ typedef struct mem_map_t
 
     uint32_t *index_data;
     uint32_t *index_free;
+
+    //! largest number of nodes of each type handed out before a clear
+    uint32_t *peak;
 } mem_map;
 
 //==============================================================================
 // PUBLIC DECLARATIONS
 //==============================================================================
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * Creates a new memory map for the specified node sizes
  *
@@ -82,4 +89,18 @@ void* pq_alloc_node( mem_map *map, uint32_t type );
  */
 void pq_free_node( mem_map *map, uint32_t type, void *node );
 
+/**
+ * Reports the largest number of nodes of a type that have been live at once
+ * since the map was created.  Survives clearing the map.
+ *
+ * @param map   Map to query
+ * @param type  Type of node to query
+ * @return      Peak number of live nodes
+ */
+uint32_t mm_peak_nodes( mem_map *map, uint32_t type );
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
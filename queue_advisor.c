@@ -0,0 +1,750 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <dirent.h>
+
+#define MAX_LINE            1024
+#define MAX_NAME            64
+#define MAX_COMBINATIONS    512
+#define MAX_TRACES          64
+#define DEFAULT_CANDIDATES  3
+
+// matches the log2 buckets of trace_stats
+#define LOG_BUCKETS         33
+// handle lookups at a reuse distance of 2^(CACHE_LOG) node ids or more, and
+// delete-mins in a queue larger than that, are taken to miss the cache
+#define CACHE_LOG           13
+
+#define FEATURES            8
+
+static const char *feature_names[FEATURES] =
+{
+    "ops",
+    "insert",
+    "delete_min_log",
+    "decrease_key",
+    "decrease_key_log",
+    "decrease_key_min",
+    "far_reuse",
+    "delete_min_miss"
+};
+
+/**
+ * The parts of a trace_stats profile that the cost model uses.
+ */
+typedef struct profile_t
+{
+    double ops;
+    double insert;
+    double delete_min;
+    double delete;
+    double decrease_key;
+    double decrease_key_new_min;
+    double avg_size;
+    double reuse_cold;
+    double overtaken[LOG_BUCKETS];
+    double reuse[LOG_BUCKETS];
+} profile;
+
+/**
+ * A queue built with one allocator, with the cost of each feature in
+ * microseconds.
+ */
+typedef struct combination_t
+{
+    char mem[MAX_NAME];
+    char queue[MAX_NAME];
+    double cost[FEATURES];
+    //! mean relative error of the fit on the calibration traces
+    double error;
+    double predicted;
+} combination;
+
+static combination models[MAX_COMBINATIONS];
+static uint32_t model_count;
+
+static int calibrate( int argc, char **argv );
+static int predict( int argc, char **argv );
+static int validate( int argc, char **argv );
+static int read_profile( FILE *file, profile *p );
+static int profile_trace( const char *drivers, const char *trace,
+    profile *p );
+static void features( profile *p, double *x );
+static double run_driver( const char *drivers, const char *mem,
+    const char *queue, const char *trace );
+static uint32_t list_queues( const char *drivers, const char *mem,
+    char names[][MAX_NAME], uint32_t capacity );
+static int by_name( const void *a, const void *b );
+static int by_prediction( const void *a, const void *b );
+static int read_model( const char *name );
+static void rank_models( profile *p );
+static void fit( double *x, double *y, uint32_t m, double *cost );
+static void nnls( double *a, double *b, uint32_t m, double *x );
+static int solve( double *a, double *b, uint32_t m, uint8_t *passive,
+    double *z );
+
+/**
+ * Predicts which queue and allocator replay a trace fastest, from a cost
+ * model calibrated on this machine.
+ *
+ *   queue_advisor calibrate drivers model mem[,mem...] trace ...
+ *   queue_advisor predict model profile
+ *   queue_advisor validate drivers model trace [candidates]
+ *
+ * drivers is the driver directory, holding trace_stats and a directory of
+ * drivers per allocator.
+ *
+ * The model takes a driver's time as a sum of costs per feature of the
+ * trace_stats profile: operations, insertions, delete-mins and deletes times
+ * the log of the average size, decrease-keys, decrease-keys times the log of
+ * the number of items they overtake, node operations whose handle was last
+ * used 2^13 or more distinct nodes before, and delete-mins and deletes times
+ * the log of the average size beyond 2^13.  This is the model analysis.R
+ * fits to cache and branch counts, with the features a profile can give
+ * before anything is run.
+ *
+ * calibrate profiles the traces, times every driver of the given allocators
+ * on each of them, and fits the costs of each driver by non-negative least
+ * squares.  The traces should vary in size and operation mix, as those of
+ * run_scripts/calibrate_advisor do, and there should be at least as many as
+ * features.  The model file has a line per driver: allocator, queue, the
+ * cost of each feature and the mean relative error of the fit.
+ *
+ * predict reads a profile, as written by trace_stats, or - for standard
+ * input, and prints every driver from the fastest predicted on, then the
+ * fastest as best.
+ *
+ * validate profiles the trace, replays the candidates predicted fastest,
+ * three unless given, and prints their predicted and measured times and the
+ * fastest measured as best.
+ *
+ * Times are in microseconds per replay, as trace_driver prints them.
+ */
+int main( int argc, char **argv )
+{
+    int result;
+
+    if( argc < 2 )
+        result = 1;
+    else if( strcmp( argv[1], "calibrate" ) == 0 )
+        result = calibrate( argc, argv );
+    else if( strcmp( argv[1], "predict" ) == 0 )
+        result = predict( argc, argv );
+    else if( strcmp( argv[1], "validate" ) == 0 )
+        result = validate( argc, argv );
+    else
+        result = 1;
+
+    if( result == 1 )
+    {
+        fprintf( stderr, "usage: %s calibrate drivers model mem[,mem...] "
+            "trace ...\n"
+            "       %s predict model profile\n"
+            "       %s validate drivers model trace [candidates]\n",
+            argv[0], argv[0], argv[0] );
+        return -1;
+    }
+
+    return result;
+}
+
+/**
+ * Times every driver of the given allocators on the calibration traces and
+ * writes the fitted costs.
+ *
+ * @param argc  Argument count of the program
+ * @param argv  Arguments of the program
+ * @return      0 on success, 1 on bad arguments, -1 on failure
+ */
+static int calibrate( int argc, char **argv )
+{
+    static char queues[MAX_COMBINATIONS][MAX_NAME];
+    double x[MAX_TRACES * FEATURES], y[MAX_TRACES], cost[FEATURES];
+    profile p;
+    uint32_t i, j, k, count;
+    char *mem;
+
+    if( argc < 6 )
+        return 1;
+    uint32_t trace_count = argc - 5;
+    if( trace_count > MAX_TRACES )
+    {
+        fprintf( stderr, "At most %d traces.\n", MAX_TRACES );
+        return -1;
+    }
+
+    for( i = 0; i < trace_count; i++ )
+    {
+        if( profile_trace( argv[2], argv[5 + i], &p ) != 0 )
+            return -1;
+        features( &p, x + i * FEATURES );
+    }
+
+    FILE *model = fopen( argv[3], "w" );
+    if( model == NULL )
+    {
+        fprintf( stderr, "Could not open %s.\n", argv[3] );
+        return -1;
+    }
+    fprintf( model, "# mem queue" );
+    for( k = 0; k < FEATURES; k++ )
+        fprintf( model, " %s", feature_names[k] );
+    fprintf( model, " error\n" );
+
+    for( mem = strtok( argv[4], "," ); mem != NULL;
+            mem = strtok( NULL, "," ) )
+    {
+        count = list_queues( argv[2], mem, queues, MAX_COMBINATIONS );
+        for( j = 0; j < count; j++ )
+        {
+            for( i = 0; i < trace_count; i++ )
+            {
+                y[i] = run_driver( argv[2], mem, queues[j], argv[5 + i] );
+                if( y[i] < 0 )
+                    break;
+                printf( "measure: %s %s %s %.0f\n", mem, queues[j],
+                    argv[5 + i], y[i] );
+            }
+            if( i < trace_count )
+                continue;
+
+            fit( x, y, trace_count, cost );
+
+            double error = 0, fit;
+            for( i = 0; i < trace_count; i++ )
+            {
+                for( fit = 0, k = 0; k < FEATURES; k++ )
+                    fit += cost[k] * x[i * FEATURES + k];
+                error += fabs( fit - y[i] ) / y[i];
+            }
+            error /= trace_count;
+
+            fprintf( model, "%s %s", mem, queues[j] );
+            for( k = 0; k < FEATURES; k++ )
+                fprintf( model, " %g", cost[k] );
+            fprintf( model, " %f\n", error );
+            fflush( model );
+            printf( "calibrate: %s %s %f\n", mem, queues[j], error );
+            fflush( stdout );
+        }
+    }
+    fclose( model );
+
+    return 0;
+}
+
+/**
+ * Ranks every driver of the model on a profile.
+ *
+ * @param argc  Argument count of the program
+ * @param argv  Arguments of the program
+ * @return      0 on success, 1 on bad arguments, -1 on failure
+ */
+static int predict( int argc, char **argv )
+{
+    profile p;
+    uint32_t i;
+
+    if( argc < 4 )
+        return 1;
+    if( read_model( argv[2] ) != 0 )
+        return -1;
+
+    FILE *file = ( strcmp( argv[3], "-" ) == 0 ) ? stdin :
+        fopen( argv[3], "r" );
+    if( file == NULL || read_profile( file, &p ) != 0 )
+    {
+        fprintf( stderr, "Could not read profile %s.\n", argv[3] );
+        return -1;
+    }
+    if( file != stdin )
+        fclose( file );
+
+    rank_models( &p );
+    for( i = 0; i < model_count; i++ )
+        printf( "predict: %s %s %.0f\n", models[i].mem, models[i].queue,
+            models[i].predicted );
+    printf( "best: %s %s\n", models[0].mem, models[0].queue );
+
+    return 0;
+}
+
+/**
+ * Replays the drivers predicted fastest on a trace.
+ *
+ * @param argc  Argument count of the program
+ * @param argv  Arguments of the program
+ * @return      0 on success, 1 on bad arguments, -1 on failure
+ */
+static int validate( int argc, char **argv )
+{
+    profile p;
+    double measured, best_time = -1;
+    uint32_t i, best = 0;
+
+    if( argc < 5 )
+        return 1;
+    uint32_t candidates = ( argc > 5 ) ? atoi( argv[5] ) : DEFAULT_CANDIDATES;
+    if( read_model( argv[3] ) != 0 ||
+            profile_trace( argv[2], argv[4], &p ) != 0 )
+        return -1;
+
+    rank_models( &p );
+    if( candidates > model_count )
+        candidates = model_count;
+    for( i = 0; i < candidates; i++ )
+    {
+        measured = run_driver( argv[2], models[i].mem, models[i].queue,
+            argv[4] );
+        if( measured < 0 )
+            return -1;
+        printf( "validate: %s %s %.0f %.0f\n", models[i].mem,
+            models[i].queue, models[i].predicted, measured );
+        if( best_time < 0 || measured < best_time )
+        {
+            best_time = measured;
+            best = i;
+        }
+    }
+    printf( "best: %s %s\n", models[best].mem, models[best].queue );
+
+    return 0;
+}
+
+/**
+ * Reads the lines of a trace_stats profile that the model uses.  The
+ * operation count is the sum of the counts of every operation type.
+ *
+ * @param file  Profile to read
+ * @param p     Output profile
+ * @return      0 on success, -1 if the profile has no operation counts
+ */
+static int read_profile( FILE *file, profile *p )
+{
+    static const char *op_names[] = { "create", "destroy", "clear",
+        "get_key", "get_item", "get_size", "insert", "find_min", "delete",
+        "delete_min", "decrease_key", "increase_key", "empty" };
+    char line[MAX_LINE];
+    char *name, *values, *value;
+    double *buckets;
+    uint32_t i, found = 0;
+
+    memset( p, 0, sizeof( profile ) );
+    while( fgets( line, MAX_LINE, file ) != NULL )
+    {
+        name = line;
+        values = strchr( line, ':' );
+        if( values == NULL )
+            continue;
+        *values++ = '\0';
+
+        for( i = 0; i < sizeof( op_names ) / sizeof( char* ); i++ )
+        {
+            if( strcmp( name, op_names[i] ) == 0 )
+            {
+                p->ops += atof( values );
+                found++;
+            }
+        }
+
+        if( strcmp( name, "insert" ) == 0 )
+            p->insert = atof( values );
+        else if( strcmp( name, "delete_min" ) == 0 )
+            p->delete_min = atof( values );
+        else if( strcmp( name, "delete" ) == 0 )
+            p->delete = atof( values );
+        else if( strcmp( name, "decrease_key" ) == 0 )
+            p->decrease_key = atof( values );
+        else if( strcmp( name, "decrease_key_new_min" ) == 0 )
+            p->decrease_key_new_min = atof( values );
+        else if( strcmp( name, "avg_size" ) == 0 )
+            p->avg_size = atof( values );
+        else if( strcmp( name, "reuse_cold" ) == 0 )
+            p->reuse_cold = atof( values );
+
+        if( strcmp( name, "decrease_key_overtaken" ) == 0 )
+            buckets = p->overtaken;
+        else if( strcmp( name, "reuse_distance" ) == 0 )
+            buckets = p->reuse;
+        else
+            continue;
+        for( i = 0, value = strtok( values, " \n" );
+                i < LOG_BUCKETS && value != NULL;
+                i++, value = strtok( NULL, " \n" ) )
+            buckets[i] = atof( value );
+    }
+
+    return ( found > 0 ) ? 0 : -1;
+}
+
+/**
+ * Runs trace_stats on a trace.
+ *
+ * @param drivers   Driver directory
+ * @param trace     Trace to profile
+ * @param p         Output profile
+ * @return          0 on success, -1 on failure
+ */
+static int profile_trace( const char *drivers, const char *trace,
+    profile *p )
+{
+    char command[MAX_LINE];
+    int status;
+
+    snprintf( command, MAX_LINE, "%s/trace_stats %s 1", drivers, trace );
+    FILE *output = popen( command, "r" );
+    if( output == NULL )
+        status = -1;
+    else
+    {
+        status = read_profile( output, p );
+        if( pclose( output ) != 0 )
+            status = -1;
+    }
+
+    if( status != 0 )
+        fprintf( stderr, "Could not profile %s.\n", trace );
+    return status;
+}
+
+static void features( profile *p, double *x )
+{
+    double size_log = log2( p->avg_size + 2 );
+    double deletions = p->delete_min + p->delete;
+    uint32_t i;
+
+    x[0] = p->ops;
+    x[1] = p->insert;
+    x[2] = deletions * size_log;
+    x[3] = p->decrease_key;
+    x[4] = 0;
+    for( i = 1; i < LOG_BUCKETS; i++ )
+        x[4] += p->overtaken[i] * i;
+    x[5] = p->decrease_key_new_min;
+    x[6] = p->reuse_cold;
+    for( i = CACHE_LOG + 1; i < LOG_BUCKETS; i++ )
+        x[6] += p->reuse[i];
+    x[7] = ( size_log > CACHE_LOG ) ? deletions * ( size_log - CACHE_LOG ) :
+        0;
+}
+
+/**
+ * Replays a trace with a driver.
+ *
+ * @param drivers   Driver directory
+ * @param mem       Allocator of the driver
+ * @param queue     Queue of the driver
+ * @param trace     Trace to replay
+ * @return          Microseconds per replay, -1 on failure
+ */
+static double run_driver( const char *drivers, const char *mem,
+    const char *queue, const char *trace )
+{
+    char command[MAX_LINE];
+    double time = -1;
+
+    snprintf( command, MAX_LINE, "%s/%s/driver_%s %s", drivers, mem, queue,
+        trace );
+    FILE *output = popen( command, "r" );
+    if( output == NULL || fscanf( output, "%lf", &time ) != 1 )
+        time = -1;
+    if( output != NULL && pclose( output ) != 0 )
+        time = -1;
+
+    if( time < 0 )
+        fprintf( stderr, "Could not run %s.\n", command );
+    return time;
+}
+
+/**
+ * Lists the timing drivers of an allocator, leaving out the cachegrind
+ * builds and the dummy driver.
+ *
+ * @param drivers   Driver directory
+ * @param mem       Allocator
+ * @param names     Output queue names, sorted
+ * @param capacity  Maximum number of names
+ * @return          Number of names
+ */
+static uint32_t list_queues( const char *drivers, const char *mem,
+    char names[][MAX_NAME], uint32_t capacity )
+{
+    char path[MAX_LINE];
+    struct dirent *entry;
+    uint32_t count = 0;
+
+    snprintf( path, MAX_LINE, "%s/%s", drivers, mem );
+    DIR *dir = opendir( path );
+    if( dir == NULL )
+    {
+        fprintf( stderr, "Could not open %s.\n", path );
+        return 0;
+    }
+
+    while( ( entry = readdir( dir ) ) != NULL && count < capacity )
+    {
+        if( strncmp( entry->d_name, "driver_", 7 ) != 0 ||
+                strncmp( entry->d_name, "driver_cg_", 10 ) == 0 ||
+                strcmp( entry->d_name, "driver_dummy" ) == 0 ||
+                strlen( entry->d_name + 7 ) >= MAX_NAME )
+            continue;
+        strcpy( names[count++], entry->d_name + 7 );
+    }
+    closedir( dir );
+
+    qsort( names, count, MAX_NAME, by_name );
+    return count;
+}
+
+static int by_name( const void *a, const void *b )
+{
+    return strcmp( (const char*) a, (const char*) b );
+}
+
+static int by_prediction( const void *a, const void *b )
+{
+    double x = ( (const combination*) a )->predicted;
+    double y = ( (const combination*) b )->predicted;
+
+    return ( x < y ) ? -1 : ( x > y );
+}
+
+static int read_model( const char *name )
+{
+    char line[MAX_LINE];
+    combination *c;
+    int offset, k;
+    char *values;
+
+    FILE *file = fopen( name, "r" );
+    if( file == NULL )
+    {
+        fprintf( stderr, "Could not open %s.\n", name );
+        return -1;
+    }
+
+    model_count = 0;
+    while( fgets( line, MAX_LINE, file ) != NULL &&
+            model_count < MAX_COMBINATIONS )
+    {
+        if( line[0] == '#' )
+            continue;
+        c = models + model_count;
+        if( sscanf( line, "%63s %63s%n", c->mem, c->queue, &offset ) != 2 )
+            continue;
+        values = line + offset;
+        for( k = 0; k < FEATURES; k++ )
+            c->cost[k] = strtod( values, &values );
+        c->error = strtod( values, NULL );
+        model_count++;
+    }
+    fclose( file );
+
+    if( model_count == 0 )
+    {
+        fprintf( stderr, "No drivers in %s.\n", name );
+        return -1;
+    }
+    return 0;
+}
+
+static void rank_models( profile *p )
+{
+    double x[FEATURES];
+    uint32_t i, k;
+
+    features( p, x );
+    for( i = 0; i < model_count; i++ )
+    {
+        models[i].predicted = 0;
+        for( k = 0; k < FEATURES; k++ )
+            models[i].predicted += models[i].cost[k] * x[k];
+    }
+    qsort( models, model_count, sizeof( combination ), by_prediction );
+}
+
+/**
+ * Fits the costs of a driver, minimizing the relative rather than the
+ * absolute error so that the short traces count as much as the long ones.
+ *
+ * @param x     Features of m traces
+ * @param y     Times of the driver on the m traces
+ * @param m     Number of traces
+ * @param cost  Output cost of each feature
+ */
+static void fit( double *x, double *y, uint32_t m, double *cost )
+{
+    double a[MAX_TRACES * FEATURES], b[MAX_TRACES];
+    uint32_t i, k;
+
+    for( i = 0; i < m; i++ )
+    {
+        for( k = 0; k < FEATURES; k++ )
+            a[i * FEATURES + k] = x[i * FEATURES + k] / y[i];
+        b[i] = 1;
+    }
+    nnls( a, b, m, cost );
+}
+
+/**
+ * Solves min |Ax - b| subject to x >= 0 with the active set method of
+ * Lawson and Hanson.  The columns are scaled to unit length first, since the
+ * features differ by orders of magnitude.
+ *
+ * @param a Matrix with m rows of FEATURES values
+ * @param b Vector of m values
+ * @param m Number of rows
+ * @param x Output solution of FEATURES values
+ */
+static void fit( double *x, double *y, uint32_t m, double *cost );
+static void nnls( double *a, double *b, uint32_t m, double *x )
+{
+    double scaled[MAX_TRACES * FEATURES], norm[FEATURES];
+    double w[FEATURES], z[FEATURES], residual, alpha, best;
+    uint8_t passive[FEATURES] = { 0 }, unusable[FEATURES] = { 0 };
+    uint32_t i, j, k, iteration;
+
+    for( k = 0; k < FEATURES; k++ )
+    {
+        for( norm[k] = 0, i = 0; i < m; i++ )
+            norm[k] += a[i * FEATURES + k] * a[i * FEATURES + k];
+        norm[k] = sqrt( norm[k] );
+        unusable[k] = ( norm[k] == 0 );
+        for( i = 0; i < m; i++ )
+            scaled[i * FEATURES + k] = unusable[k] ? 0 :
+                a[i * FEATURES + k] / norm[k];
+        x[k] = 0;
+    }
+
+    for( iteration = 0; iteration < 3 * FEATURES; iteration++ )
+    {
+        // gradient of the residual
+        for( k = 0; k < FEATURES; k++ )
+            w[k] = 0;
+        for( i = 0; i < m; i++ )
+        {
+            for( residual = b[i], k = 0; k < FEATURES; k++ )
+                residual -= scaled[i * FEATURES + k] * x[k];
+            for( k = 0; k < FEATURES; k++ )
+                w[k] += scaled[i * FEATURES + k] * residual;
+        }
+
+        for( best = 0, j = FEATURES, k = 0; k < FEATURES; k++ )
+        {
+            if( !passive[k] && !unusable[k] && w[k] > best )
+            {
+                best = w[k];
+                j = k;
+            }
+        }
+        if( j == FEATURES || best <= 1e-12 * fabs( b[0] ) )
+            break;
+        passive[j] = 1;
+
+        while( 1 )
+        {
+            if( solve( scaled, b, m, passive, z ) != 0 )
+            {
+                // collinear with the passive columns
+                passive[j] = 0;
+                unusable[j] = 1;
+                break;
+            }
+
+            for( alpha = 2, k = 0; k < FEATURES; k++ )
+            {
+                if( passive[k] && z[k] <= 0 && x[k] - z[k] > 0 &&
+                        x[k] / ( x[k] - z[k] ) < alpha )
+                    alpha = x[k] / ( x[k] - z[k] );
+            }
+            if( alpha > 1 )
+            {
+                for( k = 0; k < FEATURES; k++ )
+                    x[k] = passive[k] ? z[k] : 0;
+                break;
+            }
+
+            for( k = 0; k < FEATURES; k++ )
+            {
+                x[k] += alpha * ( z[k] - x[k] );
+                if( passive[k] && x[k] <= 1e-15 )
+                {
+                    passive[k] = 0;
+                    x[k] = 0;
+                }
+            }
+        }
+    }
+
+    for( k = 0; k < FEATURES; k++ )
+        x[k] = unusable[k] ? 0 : x[k] / norm[k];
+}
+
+/**
+ * Solves the least squares problem restricted to the passive columns by
+ * Gaussian elimination on the normal equations.
+ *
+ * @param a         Matrix with m rows of FEATURES values
+ * @param b         Vector of m values
+ * @param m         Number of rows
+ * @param passive   Columns to use
+ * @param z         Output solution, zero outside the passive columns
+ * @return          0 on success, -1 if the columns are dependent
+ */
+static int solve( double *a, double *b, uint32_t m, uint8_t *passive,
+    double *z )
+{
+    double g[FEATURES][FEATURES + 1], factor;
+    uint32_t columns[FEATURES];
+    uint32_t i, j, k, n = 0, pivot;
+
+    for( k = 0; k < FEATURES; k++ )
+    {
+        z[k] = 0;
+        if( passive[k] )
+            columns[n++] = k;
+    }
+
+    for( j = 0; j < n; j++ )
+    {
+        for( k = 0; k < n; k++ )
+            for( g[j][k] = 0, i = 0; i < m; i++ )
+                g[j][k] += a[i * FEATURES + columns[j]] *
+                    a[i * FEATURES + columns[k]];
+        for( g[j][n] = 0, i = 0; i < m; i++ )
+            g[j][n] += a[i * FEATURES + columns[j]] * b[i];
+    }
+
+    for( j = 0; j < n; j++ )
+    {
+        for( pivot = j, i = j + 1; i < n; i++ )
+            if( fabs( g[i][j] ) > fabs( g[pivot][j] ) )
+                pivot = i;
+        // the columns have unit length, so this is relative
+        if( fabs( g[pivot][j] ) < 1e-10 )
+            return -1;
+        for( k = j; k <= n; k++ )
+        {
+            factor = g[j][k];
+            g[j][k] = g[pivot][k];
+            g[pivot][k] = factor;
+        }
+        for( i = j + 1; i < n; i++ )
+        {
+            factor = g[i][j] / g[j][j];
+            for( k = j; k <= n; k++ )
+                g[i][k] -= factor * g[j][k];
+        }
+    }
+
+    for( j = n; j-- > 0; )
+    {
+        for( factor = g[j][n], k = j + 1; k < n; k++ )
+            factor -= g[j][k] * z[columns[k]];
+        z[columns[j]] = factor / g[j][j];
+    }
+
+    return 0;
+}
@@ -1,5 +1,15 @@
 #include "binomial_queue.h"
 
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define SNAPSHOT_LAYOUT "binomial"
+#define SNAPSHOT_LEFT   1
+#define SNAPSHOT_RIGHT  2
+#define SNAPSHOT_MIN    4
+#define SNAPSHOT_RANK   3
+
 //==============================================================================
 // STATIC DECLARATIONS
 //==============================================================================
@@ -98,8 +108,22 @@ key_type pq_delete_min( binomial_queue *queue )
 key_type pq_delete( binomial_queue *queue, binomial_node *node )
 {
     key_type key = node->key;
+    binomial_node *current, *parent;
 
-    pq_decrease_key( queue, node, 0 );
+    // sift all the way up, as other keys may tie with zero
+    node->key = 0;
+    while( node->parent != NULL )
+    {
+        parent = node->parent;
+        current = node;
+        while( parent->right == current )
+        {
+            current = current->parent;
+            parent = current->parent;
+        }
+        swap_with_parent( queue, node, parent );
+    }
+    queue->minimum = node;
     pq_delete_min( queue );
 
     return key;
@@ -130,11 +154,156 @@ void pq_decrease_key( binomial_queue *queue, binomial_node *node,
         queue->minimum = node;
 }
 
+void pq_increase_key( binomial_queue *queue, binomial_node *node,
+    key_type new_key )
+{
+    node->key = new_key;
+    binomial_node *current, *child;
+    while( node->left != NULL )
+    {
+        // the heap order children are the first child and its siblings
+        child = node->left;
+        for( current = child->right; current != NULL; current = current->right )
+        {
+            if( current->key < child->key )
+                child = current;
+        }
+
+        if( child->key < node->key )
+            swap_with_parent( queue, child, node );
+        else
+            break;
+    }
+
+    if( queue->minimum == node )
+        cherry_pick_min( queue );
+}
+
 bool pq_empty( binomial_queue *queue )
 {
     return ( queue->size == 0 );
 }
 
+pq_snapshot_header* pq_serialize( binomial_queue *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    binomial_node **stack = malloc( ( queue->size + 1 ) *
+        sizeof( binomial_node* ) );
+    uint64_t registry = queue->registry;
+    binomial_node *node;
+    uint32_t rank, k = 0, top = 0;
+
+    if( snapshot == NULL || stack == NULL )
+    {
+        free( snapshot );
+        free( stack );
+        return NULL;
+    }
+
+    // each tree is written in preorder over the left and right pointers
+    while( registry )
+    {
+        rank = REGISTRY_LEADER( registry );
+        REGISTRY_UNSET( registry, rank );
+        stack[top++] = queue->roots[rank];
+        while( top > 0 )
+        {
+            node = stack[--top];
+            entries[k].item = node->item;
+            entries[k].key = node->key;
+            entries[k].hint = node->rank << SNAPSHOT_RANK;
+            if( node == queue->minimum )
+                entries[k].hint |= SNAPSHOT_MIN;
+            if( node->right != NULL )
+            {
+                entries[k].hint |= SNAPSHOT_RIGHT;
+                stack[top++] = node->right;
+            }
+            if( node->left != NULL )
+            {
+                entries[k].hint |= SNAPSHOT_LEFT;
+                stack[top++] = node->left;
+            }
+            k++;
+        }
+    }
+    free( stack );
+
+    return snapshot;
+}
+
+binomial_queue* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    binomial_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    binomial_node *node, *last, *owner;
+    binomial_node **stack;
+    uint32_t k, top = 0;
+
+    if( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    binomial_queue *queue = pq_create( map );
+    if( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for( k = 0; k < snapshot->size; k++ )
+        {
+            node = pq_insert( queue, entries[k].item, entries[k].key );
+            if( handles != NULL )
+                handles[entries[k].item] = node;
+        }
+        return queue;
+    }
+
+    // nodes on the stack still wait for their right pointer
+    stack = malloc( ( snapshot->size + 1 ) * sizeof( binomial_node* ) );
+    if( stack == NULL )
+        exit( -1 );
+
+    last = NULL;
+    for( k = 0; k < snapshot->size; k++ )
+    {
+        node = pq_alloc_node( map, 0 );
+        ITEM_ASSIGN( node->item, entries[k].item );
+        node->key = entries[k].key;
+        node->rank = entries[k].hint >> SNAPSHOT_RANK;
+        if( entries[k].hint & SNAPSHOT_MIN )
+            queue->minimum = node;
+        if( handles != NULL )
+            handles[entries[k].item] = node;
+
+        if( last == NULL )
+        {
+            queue->roots[node->rank] = node;
+            REGISTRY_SET( queue->registry, node->rank );
+        }
+        else if( entries[k-1].hint & SNAPSHOT_LEFT )
+        {
+            last->left = node;
+            node->parent = last;
+        }
+        else
+        {
+            owner = stack[--top];
+            owner->right = node;
+            node->parent = owner;
+        }
+
+        if( entries[k].hint & SNAPSHOT_RIGHT )
+            stack[top++] = node;
+        // a tree ends at a leaf with no sibling still to come
+        last = ( !( entries[k].hint & SNAPSHOT_LEFT ) && top == 0 ) ?
+            NULL : node;
+    }
+
+    free( stack );
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
@@ -168,10 +337,13 @@ static void cherry_pick_min( binomial_queue *queue )
 {
     uint32_t rank;
     uint64_t registry = queue->registry;
-    uint32_t min = REGISTRY_LEADER( registry );
-    if( min >= MAXRANK )
+    uint32_t min;
+    // the leader of an empty registry is undefined
+    if( registry == 0 )
         return;
 
+    min = REGISTRY_LEADER( registry );
+
     REGISTRY_UNSET( registry, min );
     while( registry )
     {
@@ -165,6 +165,19 @@ key_type pq_delete( binomial_queue *queue, binomial_node *node );
 void pq_decrease_key( binomial_queue *queue, binomial_node *node,
     key_type new_key );
 
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve the heap invariant
+ * given a pointer to the corresponding node.  Swaps the node down past its
+ * smallest child until order is restored.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( binomial_queue *queue, binomial_node *node,
+    key_type new_key );
+
 /**
  * Determines whether the queue is empty, or if it holds some items.
  *
@@ -174,5 +187,30 @@ void pq_decrease_key( binomial_queue *queue, binomial_node *node,
 bool pq_empty( binomial_queue *queue );
 
 //void verify_queue( binomial_queue *queue, uint32_t node_count );
+/**
+ * Writes a snapshot of the queue, every item with its key.  Each tree is
+ * written in preorder over the left and right pointers, with hints holding
+ * the rank of each node and which pointers it has.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( binomial_queue *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  A snapshot of a binomial
+ * queue is relinked into the same trees without comparing keys.  A snapshot of
+ * another queue type is restored by inserting its items one by one.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+binomial_queue* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    binomial_node **handles );
+
 #endif
 
@@ -0,0 +1,367 @@
+#include "calendar_queue.h"
+
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define DAY(q,k)        ( (k) >> (q)->shift )
+#define BUCKET(q,d)     ( (d) & ( (q)->bucket_count - 1 ) )
+
+#define SNAPSHOT_LAYOUT "calendar"
+
+//==============================================================================
+// STATIC DECLARATIONS
+//==============================================================================
+
+static void link_node( calendar_queue *queue, calendar_node *node );
+static void unlink_node( calendar_queue *queue, calendar_node *node );
+static void resize( calendar_queue *queue, uint32_t bucket_count );
+static uint32_t estimate_shift( calendar_queue *queue );
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+calendar_queue* pq_create( mem_map *map )
+{
+    calendar_queue *queue = calloc( 1, sizeof( calendar_queue ) );
+    queue->bucket_count = CALENDAR_MIN_BUCKETS;
+    queue->buckets = calloc( queue->bucket_count, sizeof( calendar_node* ) );
+    queue->map = map;
+
+    return queue;
+}
+
+void pq_destroy( calendar_queue *queue )
+{
+    pq_clear( queue );
+    free( queue->buckets );
+    free( queue );
+}
+
+void pq_clear( calendar_queue *queue )
+{
+    mm_clear( queue->map );
+    memset( queue->buckets, 0, queue->bucket_count *
+        sizeof( calendar_node* ) );
+    queue->size = 0;
+    queue->day = 0;
+}
+
+key_type pq_get_key( calendar_queue *queue, calendar_node *node )
+{
+    return node->key;
+}
+
+item_type* pq_get_item( calendar_queue *queue, calendar_node *node )
+{
+    return (item_type*) &(node->item);
+}
+
+uint32_t pq_get_size( calendar_queue *queue )
+{
+    return queue->size;
+}
+
+calendar_node* pq_insert( calendar_queue *queue, item_type item,
+    key_type key )
+{
+    calendar_node *node = pq_alloc_node( queue->map, 0 );
+    ITEM_ASSIGN( node->item, item );
+    node->key = key;
+
+    link_node( queue, node );
+    queue->size++;
+    if ( queue->size > ( queue->bucket_count << 1 ) )
+        resize( queue, queue->bucket_count << 1 );
+
+    return node;
+}
+
+calendar_node* pq_find_min( calendar_queue *queue )
+{
+    calendar_node *node, *min = NULL;
+    uint64_t day = queue->day;
+    uint32_t i;
+
+    if ( pq_empty( queue ) )
+        return NULL;
+
+    // the head of a bucket is its smallest key, so it is the minimum as soon
+    // as it falls on the day being scanned
+    for ( i = 0; i < queue->bucket_count; i++, day++ )
+    {
+        node = queue->buckets[BUCKET( queue, day )];
+        if ( node != NULL && DAY( queue, node->key ) == day )
+        {
+            queue->day = day;
+            return node;
+        }
+    }
+
+    // nothing within a year, so search the heads directly
+    for ( i = 0; i < queue->bucket_count; i++ )
+    {
+        node = queue->buckets[i];
+        if ( node != NULL && ( min == NULL || node->key < min->key ) )
+            min = node;
+    }
+    queue->day = DAY( queue, min->key );
+
+    return min;
+}
+
+key_type pq_delete_min( calendar_queue *queue )
+{
+    return pq_delete( queue, pq_find_min( queue ) );
+}
+
+key_type pq_delete( calendar_queue *queue, calendar_node *node )
+{
+    key_type key = node->key;
+
+    unlink_node( queue, node );
+    pq_free_node( queue->map, 0, node );
+    queue->size--;
+    if ( queue->size < ( queue->bucket_count >> 1 ) &&
+            queue->bucket_count > CALENDAR_MIN_BUCKETS )
+        resize( queue, queue->bucket_count >> 1 );
+
+    return key;
+}
+
+void pq_decrease_key( calendar_queue *queue, calendar_node *node,
+    key_type new_key )
+{
+    unlink_node( queue, node );
+    node->key = new_key;
+    link_node( queue, node );
+}
+
+void pq_increase_key( calendar_queue *queue, calendar_node *node,
+    key_type new_key )
+{
+    unlink_node( queue, node );
+    node->key = new_key;
+    link_node( queue, node );
+}
+
+bool pq_empty( calendar_queue *queue )
+{
+    return ( queue->size == 0 );
+}
+
+pq_snapshot_header* pq_serialize( calendar_queue *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 3, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    key_type *words = SNAPSHOT_WORDS( snapshot );
+    calendar_node *node;
+    uint32_t i, k = 0;
+
+    if ( snapshot == NULL )
+        return NULL;
+
+    // buckets in order, each node with its bucket as the hint
+    for ( i = 0; i < queue->bucket_count; i++ )
+    {
+        for ( node = queue->buckets[i]; node != NULL; node = node->next )
+        {
+            entries[k].item = node->item;
+            entries[k].key = node->key;
+            entries[k].hint = i;
+            k++;
+        }
+    }
+    words[0] = queue->bucket_count;
+    words[1] = queue->shift;
+    words[2] = queue->day;
+
+    return snapshot;
+}
+
+calendar_queue* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    calendar_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    key_type *words = SNAPSHOT_WORDS( snapshot );
+    calendar_node *node, *last = NULL;
+    uint32_t k;
+
+    if ( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    calendar_queue *queue = pq_create( map );
+    if ( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for ( k = 0; k < snapshot->size; k++ )
+        {
+            node = pq_insert( queue, entries[k].item, entries[k].key );
+            if ( handles != NULL )
+                handles[entries[k].item] = node;
+        }
+        return queue;
+    }
+
+    free( queue->buckets );
+    queue->bucket_count = words[0];
+    queue->buckets = calloc( queue->bucket_count, sizeof( calendar_node* ) );
+    queue->shift = words[1];
+    queue->day = words[2];
+
+    // each bucket is already sorted, so nodes are appended in order
+    for ( k = 0; k < snapshot->size; k++ )
+    {
+        node = pq_alloc_node( map, 0 );
+        ITEM_ASSIGN( node->item, entries[k].item );
+        node->key = entries[k].key;
+        if ( handles != NULL )
+            handles[entries[k].item] = node;
+
+        if ( k > 0 && entries[k-1].hint == entries[k].hint )
+        {
+            last->next = node;
+            node->prev = last;
+        }
+        else
+            queue->buckets[entries[k].hint] = node;
+        last = node;
+    }
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
+//==============================================================================
+// STATIC METHODS
+//==============================================================================
+
+/**
+ * Links a node into the bucket of its key, behind all smaller or equal keys.
+ * Moves the scan back to the node's day if it is earlier.
+ *
+ * @param queue Queue to which the node belongs
+ * @param node  Node to link
+ */
+static void link_node( calendar_queue *queue, calendar_node *node )
+{
+    uint64_t day = DAY( queue, node->key );
+    calendar_node **bucket = queue->buckets + BUCKET( queue, day );
+    calendar_node *prev = NULL;
+    calendar_node *next = *bucket;
+
+    while ( next != NULL && next->key <= node->key )
+    {
+        prev = next;
+        next = next->next;
+    }
+
+    node->prev = prev;
+    node->next = next;
+    if ( prev == NULL )
+        *bucket = node;
+    else
+        prev->next = node;
+    if ( next != NULL )
+        next->prev = node;
+
+    if ( day < queue->day )
+        queue->day = day;
+}
+
+/**
+ * Removes a node from its bucket.
+ *
+ * @param queue Queue to which the node belongs
+ * @param node  Node to unlink
+ */
+static void unlink_node( calendar_queue *queue, calendar_node *node )
+{
+    if ( node->prev == NULL )
+        queue->buckets[BUCKET( queue, DAY( queue, node->key ) )] = node->next;
+    else
+        node->prev->next = node->next;
+    if ( node->next != NULL )
+        node->next->prev = node->prev;
+}
+
+/**
+ * Rebuilds the calendar with a new number of buckets and a width estimated
+ * from the current contents.
+ *
+ * @param queue         Queue to rebuild
+ * @param bucket_count  New number of buckets, a power of two
+ */
+static void resize( calendar_queue *queue, uint32_t bucket_count )
+{
+    calendar_node **old_buckets = queue->buckets;
+    uint32_t old_count = queue->bucket_count;
+    calendar_node *node, *next;
+    uint32_t i;
+
+    queue->shift = estimate_shift( queue );
+    queue->buckets = calloc( bucket_count, sizeof( calendar_node* ) );
+    queue->bucket_count = bucket_count;
+
+    // linking moves the scan back to the earliest day
+    queue->day = DAY( queue, MAX_KEY );
+    for ( i = 0; i < old_count; i++ )
+    {
+        for ( node = old_buckets[i]; node != NULL; node = next )
+        {
+            next = node->next;
+            link_node( queue, node );
+        }
+    }
+
+    free( old_buckets );
+}
+
+/**
+ * Estimates a bucket width from a sample of keys spread evenly over the
+ * queue: three times the average separation of the keys up to the sample
+ * median, rounded up to a power of two.  Brown samples the smallest keys
+ * instead, but when ties in time are broken by low-order bits, as in the
+ * traces, those keys often share a time and the width collapses to the
+ * spacing of the tie breakers, leaving almost every year empty.
+ *
+ * @param queue Queue to sample
+ * @return      Log of the new width
+ */
+static uint32_t estimate_shift( calendar_queue *queue )
+{
+    key_type sample[CALENDAR_SAMPLE];
+    key_type width;
+    calendar_node *node;
+    uint32_t i, j, half, count = 0;
+    uint32_t stride = queue->size / CALENDAR_SAMPLE + 1;
+    uint32_t skip = 0;
+
+    for ( i = 0; i < queue->bucket_count && count < CALENDAR_SAMPLE; i++ )
+    {
+        for ( node = queue->buckets[i]; node != NULL &&
+                count < CALENDAR_SAMPLE; node = node->next )
+        {
+            if ( skip-- > 0 )
+                continue;
+            skip = stride - 1;
+            for ( j = count++; j > 0 && sample[j-1] > node->key; j-- )
+                sample[j] = sample[j-1];
+            sample[j] = node->key;
+        }
+    }
+
+    if ( count < 2 )
+        return queue->shift;
+
+    // each pair of neighbours in the sample is about stride keys apart
+    half = count >> 1;
+    width = ( sample[half] - sample[0] ) / ( (key_type) half * stride );
+    width = ( width > MAX_KEY / 3 ) ? MAX_KEY : width * 3;
+    if ( width <= 1 )
+        return 0;
+
+    i = 64 - __builtin_clzll( width - 1 );
+    return ( i > 63 ) ? 63 : i;
+}
@@ -0,0 +1,225 @@
+#ifndef CALENDAR_QUEUE
+#define CALENDAR_QUEUE
+
+//==============================================================================
+// DEFINES, INCLUDES, and STRUCTS
+//==============================================================================
+
+#include "queue_common.h"
+
+#define CALENDAR_MIN_BUCKETS    2
+#define CALENDAR_SAMPLE         25
+
+/**
+ * Holds an inserted element, as well as pointers to maintain its bucket.
+ * Acts as a handle to clients for the purpose of mutability.  Each bucket is
+ * a doubly linked list sorted by key, equal keys in insertion order.  The
+ * first node of a bucket has a null prev pointer.
+ */
+struct calendar_node_t
+{
+    //! Next node in the bucket
+    struct calendar_node_t *next;
+    //! Previous node in the bucket
+    struct calendar_node_t *prev;
+
+    //! Pointer to a piece of client data
+    item_type item;
+    //! Key for the item
+    key_type key;
+} __attribute__ ((aligned(4)));
+
+typedef struct calendar_node_t calendar_node;
+typedef calendar_node pq_node_type;
+
+/**
+ * A mutable calendar queue (Brown, 1988).  Keys are hashed into an array of
+ * buckets like days of a year: a key falls on day key / width, which is kept
+ * in bucket day mod bucket_count.  Deleting the minimum scans the buckets from
+ * the current day for the first one whose head falls on the day being
+ * scanned, so when keys are inserted near the minimum, as in event
+ * simulation, each operation takes expected constant time.  If a whole year
+ * holds no event, the minimum is found by a direct search over the bucket
+ * heads.
+ *
+ * The bucket count doubles when the size exceeds twice the bucket count and
+ * halves when it falls below half of it.  Every resize estimates a new width
+ * as three times the average separation of keys near the front of the queue,
+ * from a sample spread evenly over it.  The width is rounded up to a power of
+ * two, so days are found by a shift rather than a division.  Keys on the same
+ * day stay sorted, so many events at one time, told apart only by low-order
+ * tie breakers, make insertion linear in their number.
+ */
+struct calendar_queue_t
+{
+    //! Memory map to use for node allocation
+    mem_map *map;
+    //! The number of items held in the queue
+    uint32_t size;
+    //! The number of buckets, a power of two
+    uint32_t bucket_count;
+    //! The array of buckets
+    calendar_node **buckets;
+    //! Log of the bucket width
+    uint32_t shift;
+    //! Day of the scan, no key falls on an earlier day
+    uint64_t day;
+} __attribute__ ((aligned(4)));
+
+typedef struct calendar_queue_t calendar_queue;
+typedef calendar_queue pq_type;
+
+//==============================================================================
+// PUBLIC DECLARATIONS
+//==============================================================================
+
+/**
+ * Creates a new, empty queue.
+ *
+ * @param map   Memory map to use for node allocation
+ * @return      Pointer to the new queue
+ */
+calendar_queue* pq_create( mem_map *map );
+
+/**
+ * Frees all the memory used by the queue.
+ *
+ * @param queue Queue to destroy
+ */
+void pq_destroy( calendar_queue *queue );
+
+/**
+ * Removes all items from the queue, leaving it empty.
+ *
+ * @param queue Queue to clear
+ */
+void pq_clear( calendar_queue *queue );
+
+/**
+ * Returns the key associated with the queried node.
+ *
+ * @param queue Queue to which node belongs
+ * @param node  Node to query
+ * @return      Node's key
+ */
+key_type pq_get_key( calendar_queue *queue, calendar_node *node );
+
+/**
+ * Returns the item associated with the queried node.
+ *
+ * @param queue Queue to which node belongs
+ * @param node  Node to query
+ * @return      Node's item
+ */
+item_type* pq_get_item( calendar_queue *queue, calendar_node *node );
+
+/**
+ * Returns the current size of the queue.
+ *
+ * @param queue Queue to query
+ * @return      Size of queue
+ */
+uint32_t pq_get_size( calendar_queue *queue );
+
+/**
+ * Takes an item-key pair to insert into the queue and creates a new
+ * corresponding node.  Links the node into its bucket behind any smaller or
+ * equal keys and moves the scan back if the key falls before the current
+ * day.  May double the number of buckets.
+ *
+ * @param queue Queue to insert into
+ * @param item  Item to insert
+ * @param key   Key to use for node priority
+ * @return      Pointer to corresponding node
+ */
+calendar_node* pq_insert( calendar_queue *queue, item_type item,
+    key_type key );
+
+/**
+ * Returns the minimum item from the queue.  Advances the current day up to
+ * the day of the minimum, which does not change the contents of the queue.
+ *
+ * @param queue Queue to query
+ * @return      Node with minimum key
+ */
+calendar_node* pq_find_min( calendar_queue *queue );
+
+/**
+ * Removes the minimum item from the queue and returns it.  Relies on
+ * @ref <pq_find_min> to locate it.
+ *
+ * @param queue Queue to query
+ * @return      Minimum key, corresponding to item deleted
+ */
+key_type pq_delete_min( calendar_queue *queue );
+
+/**
+ * Removes an arbitrary item from the queue by unlinking it from its bucket.
+ * May halve the number of buckets.
+ *
+ * @param queue Queue in which the node resides
+ * @param node  Pointer to node corresponding to the target item
+ * @return      Key of item removed
+ */
+key_type pq_delete( calendar_queue *queue, calendar_node *node );
+
+/**
+ * If the item in the queue is modified in such a way to decrease the
+ * key, then this function will update the queue to preserve queue
+ * properties given a pointer to the corresponding node.  Moves the node to
+ * the bucket of its new key.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_decrease_key( calendar_queue *queue, calendar_node *node,
+    key_type new_key );
+
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve queue properties
+ * given a pointer to the corresponding node.  Moves the node to the bucket of
+ * its new key.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( calendar_queue *queue, calendar_node *node,
+    key_type new_key );
+
+/**
+ * Determines whether the queue is empty, or if it holds some items.
+ *
+ * @param queue Queue to query
+ * @return      True if queue holds nothing, false otherwise
+ */
+bool pq_empty( calendar_queue *queue );
+
+/**
+ * Writes a snapshot of the queue, every item with its key.  Nodes are written
+ * bucket by bucket, each with its bucket as the hint, followed by the bucket
+ * count, width and current day.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( calendar_queue *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  A snapshot of a calendar
+ * queue is relinked into the same buckets without comparing keys.  A snapshot
+ * of another queue type is restored by inserting its items one by one.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+calendar_queue* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    calendar_node **handles );
+
+#endif
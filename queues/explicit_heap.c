@@ -1,5 +1,11 @@
 #include "explicit_heap.h"
 
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define SNAPSHOT_LAYOUT "explicit_" SNAPSHOT_NUMBER( BRANCHING_FACTOR )
+
 //==============================================================================
 // STATIC DECLARATIONS
 //==============================================================================
@@ -11,6 +17,7 @@ static void swap_disconnected( explicit_heap *queue, explicit_node *a,
     explicit_node *b );
 static void fill_back_pointers( explicit_heap *queue, explicit_node *a,
     explicit_node *b );
+static void fill_parent_pointer( explicit_node *node, explicit_node *other );
 static void heapify_down( explicit_heap *queue, explicit_node *node );
 static void heapify_up( explicit_heap *queue, explicit_node *node );
 static explicit_node* find_last_node( explicit_heap *queue );
@@ -126,7 +133,11 @@ key_type pq_delete( explicit_heap *queue, explicit_node* node )
     if ( pq_empty( queue ) )
         queue->root = NULL;
     else if ( node != last_node)
+    {
+        // the last node may belong above or below the vacated position
         heapify_down( queue, last_node );
+        heapify_up( queue, last_node );
+    }
 
     return key;
 }
@@ -138,11 +149,123 @@ void pq_decrease_key( explicit_heap *queue, explicit_node *node,
     heapify_up( queue, node );
 }
 
+void pq_increase_key( explicit_heap *queue, explicit_node *node,
+    key_type new_key )
+{
+    node->key = new_key;
+    heapify_down( queue, node );
+}
+
 bool pq_empty( explicit_heap *queue )
 {
     return ( queue->size == 0 );
 }
 
+pq_snapshot_header* pq_serialize( explicit_heap *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    explicit_node **stack = malloc( ( queue->size + 1 ) *
+        sizeof( explicit_node* ) );
+    explicit_node *node;
+    uint32_t k, top = 0;
+    int i;
+
+    if( snapshot == NULL || stack == NULL )
+    {
+        free( snapshot );
+        free( stack );
+        return NULL;
+    }
+
+    if( queue->root != NULL )
+        stack[top++] = queue->root;
+    for( k = 0; top > 0; k++ )
+    {
+        node = stack[--top];
+        entries[k].item = node->item;
+        entries[k].key = node->key;
+        entries[k].hint = 0;
+        for( i = BRANCHING_FACTOR - 1; i >= 0; i-- )
+        {
+            if( node->children[i] != NULL )
+            {
+                entries[k].hint |= 1 << i;
+                stack[top++] = node->children[i];
+            }
+        }
+    }
+    free( stack );
+
+    return snapshot;
+}
+
+explicit_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    explicit_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    explicit_node *node, *parent;
+    uint32_t k, slot, top = 0;
+    explicit_node **stack;
+    uint32_t *pending;
+
+    if( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    explicit_heap *queue = pq_create( map );
+    if( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for( k = 0; k < snapshot->size; k++ )
+        {
+            node = pq_insert( queue, entries[k].item, entries[k].key );
+            if( handles != NULL )
+                handles[entries[k].item] = node;
+        }
+        return queue;
+    }
+
+    // each node on the stack still waits for the children in pending
+    stack = malloc( ( snapshot->size + 1 ) * sizeof( explicit_node* ) );
+    pending = malloc( ( snapshot->size + 1 ) * sizeof( uint32_t ) );
+    if( stack == NULL || pending == NULL )
+        exit( -1 );
+
+    for( k = 0; k < snapshot->size; k++ )
+    {
+        node = pq_alloc_node( map, 0 );
+        ITEM_ASSIGN( node->item, entries[k].item );
+        node->key = entries[k].key;
+        if( handles != NULL )
+            handles[entries[k].item] = node;
+
+        if( k == 0 )
+            queue->root = node;
+        else
+        {
+            parent = stack[top-1];
+            slot = __builtin_ctz( pending[top-1] );
+            pending[top-1] &= pending[top-1] - 1;
+            parent->children[slot] = node;
+            node->parent = parent;
+            while( top > 0 && pending[top-1] == 0 )
+                top--;
+        }
+
+        if( entries[k].hint != 0 )
+        {
+            stack[top] = node;
+            pending[top++] = entries[k].hint;
+        }
+    }
+
+    free( stack );
+    free( pending );
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
@@ -247,28 +370,21 @@ static void fill_back_pointers( explicit_heap *queue, explicit_node *a,
 {
     int i;
 
-    if ( a->parent != NULL )
+    // siblings trade places within the same child array
+    if ( a->parent != NULL && a->parent == b->parent )
     {
         for( i = 0; i < BRANCHING_FACTOR; i++ )
         {
-            if( a->parent->children[i] == a || a->parent->children[i] == b )
-            {
+            if( a->parent->children[i] == a )
+                a->parent->children[i] = b;
+            else if( a->parent->children[i] == b )
                 a->parent->children[i] = a;
-                break;
-            }
         }
     }
-
-    if ( b->parent != NULL )
+    else
     {
-        for( i = 0; i < BRANCHING_FACTOR; i++ )
-        {
-            if( b->parent->children[i] == a || b->parent->children[i] == b )
-            {
-                b->parent->children[i] = b;
-                break;
-            }
-        }
+        fill_parent_pointer( a, b );
+        fill_parent_pointer( b, a );
     }
 
     for( i = 0; i < BRANCHING_FACTOR; i++ )
@@ -280,6 +396,31 @@ static void fill_back_pointers( explicit_heap *queue, explicit_node *a,
     }
 }
 
+/**
+ * Points the parent of a recently moved node back at it, replacing whichever
+ * of the two swapped nodes the parent still refers to.
+ *
+ * @param node  Node whose parent to update
+ * @param other Node it was swapped with
+ */
+static void fill_parent_pointer( explicit_node *node, explicit_node *other )
+{
+    int i;
+
+    if ( node->parent != NULL )
+    {
+        for( i = 0; i < BRANCHING_FACTOR; i++ )
+        {
+            if( node->parent->children[i] == node ||
+                node->parent->children[i] == other )
+            {
+                node->parent->children[i] = node;
+                break;
+            }
+        }
+    }
+}
+
 /**
  * Takes a node that is potentially at a higher position in the tree
  * than it should be, and pushes it down to the correct location.
@@ -167,6 +167,19 @@ key_type pq_delete( explicit_heap *queue, explicit_node* node );
 void pq_decrease_key( explicit_heap *queue, explicit_node *node,
     key_type new_key );
 
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve the heap invariant
+ * given a pointer to the corresponding node.  Swaps the node down past its
+ * smaller children.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( explicit_heap *queue, explicit_node *node,
+    key_type new_key );
+
 /**
  * Determines whether the queue is empty, or if it holds some items.
  *
@@ -175,4 +188,28 @@ void pq_decrease_key( explicit_heap *queue, explicit_node *node,
  */
 bool pq_empty( explicit_heap *queue );
 
+/**
+ * Writes a snapshot of the queue, every item with its key.  Nodes are written
+ * in preorder, each with a hint marking which of its child slots are filled.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( explicit_heap *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  A snapshot of the same
+ * variant is relinked into the same tree without comparing keys.  A snapshot
+ * of another queue type is restored by inserting its items one by one.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+explicit_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    explicit_node **handles );
+
 #endif
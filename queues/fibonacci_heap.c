@@ -1,5 +1,15 @@
 #include "fibonacci_heap.h"
 
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define SNAPSHOT_LAYOUT "fibonacci"
+#define SNAPSHOT_CHILD  1
+#define SNAPSHOT_NEXT   2
+#define SNAPSHOT_MARKED 4
+#define SNAPSHOT_RANK   3
+
 //==============================================================================
 // STATIC DECLARATIONS
 //==============================================================================
@@ -36,7 +46,7 @@ void pq_clear( fibonacci_heap *queue )
     mm_clear( queue->map );
     queue->minimum = NULL;
     memset( queue->roots, 0, MAXRANK * sizeof( fibonacci_node* ) );
-    queue->largest_rank = 0;
+    queue->registry = 0;
     queue->size = 0;
 }
 
@@ -132,6 +142,16 @@ key_type pq_delete( fibonacci_heap *queue, fibonacci_node *node )
     pq_free_node( queue->map, 0, node );
     queue->size--;
 
+    // children become roots and must not point at the freed node
+    if ( child != NULL )
+    {
+        fibonacci_node *current = child;
+        do
+        {
+            current->parent = NULL;
+            current = current->next_sibling;
+        } while ( current != child );
+    }
     append_lists( queue, queue->minimum, child );
     
     return key;
@@ -144,11 +164,164 @@ void pq_decrease_key( fibonacci_heap *queue, fibonacci_node *node,
     cut_from_parent( queue, node );
 }
 
+void pq_increase_key( fibonacci_heap *queue, fibonacci_node *node,
+    key_type new_key )
+{
+    fibonacci_node *child = node->first_child;
+    fibonacci_node *current;
+
+    node->key = new_key;
+    // a child may now be smaller, so make the node a root without children
+    if ( node->parent != NULL )
+        cut_from_parent( queue, node );
+    if ( child != NULL )
+    {
+        current = child;
+        do
+        {
+            current->parent = NULL;
+            current = current->next_sibling;
+        } while ( current != child );
+        node->first_child = NULL;
+        node->rank = 0;
+    }
+
+    // the old minimum may have been passed, so consolidate to find a new one
+    if ( node == queue->minimum )
+        merge_and_fix_roots( queue, node, child );
+    else
+        queue->minimum = append_lists( queue, queue->minimum, child );
+}
+
 bool pq_empty( fibonacci_heap *queue )
 {
     return ( queue->size == 0 );
 }
 
+pq_snapshot_header* pq_serialize( fibonacci_heap *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    fibonacci_node **stack = malloc( ( queue->size + 1 ) *
+        sizeof( fibonacci_node* ) );
+    fibonacci_node *node, *head;
+    uint32_t k = 0;
+    uint32_t top = 0;
+
+    if ( snapshot == NULL || stack == NULL )
+    {
+        free( snapshot );
+        free( stack );
+        return NULL;
+    }
+
+    // the root list from the minimum and the child lists are written in
+    // preorder, as if each list ended just before wrapping around
+    if ( queue->minimum != NULL )
+        stack[top++] = queue->minimum;
+    while ( top > 0 )
+    {
+        node = stack[--top];
+        entries[k].item = node->item;
+        entries[k].key = node->key;
+        entries[k].hint = node->rank << SNAPSHOT_RANK;
+        if ( node->marked )
+            entries[k].hint |= SNAPSHOT_MARKED;
+
+        head = ( node->parent == NULL ) ? queue->minimum :
+            node->parent->first_child;
+        if ( node->next_sibling != head )
+        {
+            entries[k].hint |= SNAPSHOT_NEXT;
+            stack[top++] = node->next_sibling;
+        }
+        if ( node->first_child != NULL )
+        {
+            entries[k].hint |= SNAPSHOT_CHILD;
+            stack[top++] = node->first_child;
+        }
+        k++;
+    }
+    free( stack );
+
+    return snapshot;
+}
+
+fibonacci_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    fibonacci_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    fibonacci_node *node, *last, *owner, *head;
+    fibonacci_node **stack;
+    uint32_t k;
+    uint32_t top = 0;
+
+    if ( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    fibonacci_heap *queue = pq_create( map );
+    if ( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for ( k = 0; k < snapshot->size; k++ )
+        {
+            node = pq_insert( queue, entries[k].item, entries[k].key );
+            if ( handles != NULL )
+                handles[entries[k].item] = node;
+        }
+        return queue;
+    }
+
+    // nodes on the stack still wait for their next sibling
+    stack = malloc( ( snapshot->size + 1 ) * sizeof( fibonacci_node* ) );
+    if ( stack == NULL )
+        exit( -1 );
+
+    last = NULL;
+    for ( k = 0; k < snapshot->size; k++ )
+    {
+        node = pq_alloc_node( map, 0 );
+        ITEM_ASSIGN( node->item, entries[k].item );
+        node->key = entries[k].key;
+        node->rank = entries[k].hint >> SNAPSHOT_RANK;
+        node->marked = ( entries[k].hint & SNAPSHOT_MARKED ) ? TRUE : FALSE;
+        if ( handles != NULL )
+            handles[entries[k].item] = node;
+
+        if ( last == NULL )
+            queue->minimum = node;
+        else if ( entries[k-1].hint & SNAPSHOT_CHILD )
+        {
+            last->first_child = node;
+            node->parent = last;
+        }
+        else
+        {
+            owner = stack[--top];
+            owner->next_sibling = node;
+            node->prev_sibling = owner;
+            node->parent = owner->parent;
+        }
+
+        if ( entries[k].hint & SNAPSHOT_NEXT )
+            stack[top++] = node;
+        else
+        {
+            // close the circular list
+            head = ( node->parent == NULL ) ? queue->minimum :
+                node->parent->first_child;
+            node->next_sibling = head;
+            head->prev_sibling = node;
+        }
+        last = node;
+    }
+
+    free( stack );
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
@@ -169,7 +342,7 @@ static void merge_and_fix_roots( fibonacci_heap *queue, fibonacci_node *a,
 {
     fibonacci_node *start = append_lists( queue, a, b );
     fibonacci_node *current, *next;
-    int32_t i, rank;
+    uint32_t rank;
 
     if ( start == NULL )
         return;
@@ -179,7 +352,7 @@ static void merge_and_fix_roots( fibonacci_heap *queue, fibonacci_node *a,
     start->prev_sibling = NULL;
     // insert an initial node
     queue->roots[start->rank] = start;
-    queue->largest_rank = start->rank;
+    REGISTRY_SET( queue->registry, start->rank );
     start->parent = NULL;
     current = start->next_sibling;
 
@@ -199,32 +372,34 @@ static void merge_and_fix_roots( fibonacci_heap *queue, fibonacci_node *a,
             rank = current->rank;
             current = link( queue, current, queue->roots[rank] );
             queue->roots[rank] = NULL;
+            REGISTRY_UNSET( queue->registry, rank );
         }
         current = next;
     }
 
     // pick the largest tree out of the registry to start reforming the list
-    start = queue->roots[queue->largest_rank];
-    queue->roots[queue->largest_rank] = NULL;
+    rank = REGISTRY_LAST( queue->registry );
+    REGISTRY_UNSET( queue->registry, rank );
+    start = queue->roots[rank];
+    queue->roots[rank] = NULL;
     queue->minimum = start;
 
     current = start;
-    // pull the rest out and clear the registry for later use
-    for ( i = queue->largest_rank - 1; i >= 0; i-- )
+    // pull the rest out and clear the registry for later use, visiting only
+    // occupied ranks
+    while( queue->registry )
     {
-        if( queue->roots[i] != NULL )
-        {
-            if( queue->roots[i]->key < queue->minimum->key )
-                queue->minimum = queue->roots[i];
-            current->prev_sibling = queue->roots[i];
-            queue->roots[i]->next_sibling = current;
-            current = queue->roots[i];
-            queue->roots[i] = NULL;
-        }
+        rank = REGISTRY_LAST( queue->registry );
+        REGISTRY_UNSET( queue->registry, rank );
+        if( queue->roots[rank]->key < queue->minimum->key )
+            queue->minimum = queue->roots[rank];
+        current->prev_sibling = queue->roots[rank];
+        queue->roots[rank]->next_sibling = current;
+        current = queue->roots[rank];
+        queue->roots[rank] = NULL;
     }
     current->prev_sibling = start;
     start->next_sibling = current;
-    queue->largest_rank = 0;
 }
 
 /**
@@ -357,8 +532,7 @@ static bool attempt_insert( fibonacci_heap *queue, fibonacci_node *node )
         return FALSE;
 
     queue->roots[rank] = node;
-    if ( rank > queue->largest_rank )
-        queue->largest_rank = rank;
+    REGISTRY_SET( queue->registry, rank );
 
     return TRUE;
 }
@@ -57,8 +57,8 @@ struct fibonacci_heap_t
     fibonacci_node *minimum;
     //! An array of roots of the queue, indexed by rank
     fibonacci_node *roots[MAXRANK];
-    //! Current largest rank in queue
-    uint32_t largest_rank;
+    //! A registry to keep track of non-null entries in roots
+    uint64_t registry;
 } __attribute__ ((aligned(4)));
 
 typedef struct fibonacci_heap_t fibonacci_heap;
@@ -171,6 +171,19 @@ key_type pq_delete( fibonacci_heap *queue, fibonacci_node *node );
 void pq_decrease_key( fibonacci_heap *queue, fibonacci_node *node,
     key_type new_key );
 
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve the heap invariant
+ * given a pointer to the corresponding node.  The node is made a root and its
+ * children are moved to the root list.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( fibonacci_heap *queue, fibonacci_node *node,
+    key_type new_key );
+
 /**
  * Determines whether the queue is empty, or if it holds some items.
  *
@@ -179,4 +192,29 @@ void pq_decrease_key( fibonacci_heap *queue, fibonacci_node *node,
  */
 bool pq_empty( fibonacci_heap *queue );
 
+/**
+ * Writes a snapshot of the queue, every item with its key.  The root list,
+ * starting from the minimum, and the child lists are written in preorder,
+ * with hints holding the rank and mark of each node.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( fibonacci_heap *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  A snapshot of a Fibonacci
+ * heap is relinked into the same lists without comparing keys.  A snapshot of
+ * another queue type is restored by inserting its items one by one.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+fibonacci_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    fibonacci_node **handles );
+
 #endif
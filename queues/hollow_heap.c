@@ -0,0 +1,410 @@
+#include "hollow_heap.h"
+
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define SNAPSHOT_LAYOUT "hollow"
+
+//==============================================================================
+// STATIC DECLARATIONS
+//==============================================================================
+
+static hollow_node* make_node( hollow_heap *queue, hollow_item *item,
+    key_type key );
+static void add_root( hollow_heap *queue, hollow_node *node );
+static hollow_node* link( hollow_heap *queue, hollow_node *a, hollow_node *b );
+static void ranked_links( hollow_heap *queue, hollow_node *node );
+static void restructure( hollow_heap *queue, bool rebuild );
+static void check_hollow( hollow_heap *queue );
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+hollow_heap* pq_create( mem_map *map )
+{
+    hollow_heap *queue = calloc( 1, sizeof( hollow_heap ) );
+    queue->map = map;
+
+    return queue;
+}
+
+void pq_destroy( hollow_heap *queue )
+{
+    pq_clear( queue );
+    free( queue );
+}
+
+void pq_clear( hollow_heap *queue )
+{
+    mm_clear( queue->map );
+    queue->roots = NULL;
+    queue->minimum = NULL;
+    queue->registry = 0;
+    queue->size = 0;
+    queue->hollow = 0;
+}
+
+key_type pq_get_key( hollow_heap *queue, hollow_item *item )
+{
+    return item->node->key;
+}
+
+item_type* pq_get_item( hollow_heap *queue, hollow_item *item )
+{
+    return (item_type*) &(item->item);
+}
+
+uint32_t pq_get_size( hollow_heap *queue )
+{
+    return queue->size;
+}
+
+hollow_item* pq_insert( hollow_heap *queue, item_type item, key_type key )
+{
+    hollow_item *wrapper = pq_alloc_node( queue->map, 0 );
+    ITEM_ASSIGN( wrapper->item, item );
+    add_root( queue, make_node( queue, wrapper, key ) );
+    queue->size++;
+
+    return wrapper;
+}
+
+hollow_item* pq_find_min( hollow_heap *queue )
+{
+    if ( pq_empty( queue ) )
+        return NULL;
+    return queue->minimum->item;
+}
+
+key_type pq_delete_min( hollow_heap *queue )
+{
+    return pq_delete( queue, queue->minimum->item );
+}
+
+key_type pq_delete( hollow_heap *queue, hollow_item *item )
+{
+    hollow_node *node = item->node;
+    key_type key = node->key;
+
+    node->item = NULL;
+    pq_free_node( queue->map, 0, item );
+    queue->size--;
+    queue->hollow++;
+
+    // anything but the minimum is cleaned up lazily
+    if ( node == queue->minimum )
+        restructure( queue, FALSE );
+    else
+        check_hollow( queue );
+
+    return key;
+}
+
+void pq_decrease_key( hollow_heap *queue, hollow_item *item, key_type new_key )
+{
+    hollow_node *old_node = item->node;
+    hollow_node *new_node;
+
+    if ( old_node == queue->minimum )
+    {
+        old_node->key = new_key;
+        return;
+    }
+
+    // the old node stays put as a hollow child of the new one
+    new_node = make_node( queue, item, new_key );
+    old_node->item = NULL;
+    queue->hollow++;
+    if ( old_node->rank > 2 )
+        new_node->rank = old_node->rank - 2;
+    new_node->child = old_node;
+    old_node->ep = new_node;
+
+    add_root( queue, new_node );
+    check_hollow( queue );
+}
+
+void pq_increase_key( hollow_heap *queue, hollow_item *item, key_type new_key )
+{
+    hollow_node *old_node = item->node;
+
+    // the old node is left hollow as in a delete, the item moves to a new root
+    old_node->item = NULL;
+    queue->hollow++;
+    add_root( queue, make_node( queue, item, new_key ) );
+
+    if ( old_node == queue->minimum )
+        restructure( queue, FALSE );
+    else
+        check_hollow( queue );
+}
+
+bool pq_empty( hollow_heap *queue )
+{
+    return ( queue->size == 0 );
+}
+
+pq_snapshot_header* pq_serialize( hollow_heap *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    uint32_t capacity = queue->size + queue->hollow + 1;
+    hollow_node **lists = malloc( capacity * sizeof( hollow_node* ) );
+    hollow_node **parents = malloc( capacity * sizeof( hollow_node* ) );
+    hollow_node *node, *parent;
+    uint32_t k = 0;
+    uint32_t top = 0;
+
+    if ( snapshot == NULL || lists == NULL || parents == NULL )
+    {
+        free( snapshot );
+        free( lists );
+        free( parents );
+        return NULL;
+    }
+
+    // walk the child lists, leaving a node with two parents to the first one
+    if ( queue->roots != NULL )
+    {
+        lists[top] = queue->roots;
+        parents[top++] = NULL;
+    }
+    while ( top > 0 )
+    {
+        top--;
+        parent = parents[top];
+        for ( node = lists[top]; node != NULL; node = node->next )
+        {
+            if ( parent != NULL && node->ep == parent )
+                break;
+            if ( node->item != NULL )
+            {
+                entries[k].item = node->item->item;
+                entries[k].key = node->key;
+                entries[k].hint = 0;
+                k++;
+            }
+            if ( node->child != NULL )
+            {
+                lists[top] = node->child;
+                parents[top++] = node;
+            }
+        }
+    }
+    free( lists );
+    free( parents );
+
+    return snapshot;
+}
+
+hollow_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    hollow_item **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    hollow_item *item;
+    uint32_t k;
+
+    if ( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    // an insertion only adds a root, as cheap as relinking the node
+    hollow_heap *queue = pq_create( map );
+    for ( k = 0; k < snapshot->size; k++ )
+    {
+        item = pq_insert( queue, entries[k].item, entries[k].key );
+        if ( handles != NULL )
+            handles[entries[k].item] = item;
+    }
+
+    return queue;
+}
+
+//==============================================================================
+// STATIC METHODS
+//==============================================================================
+
+/**
+ * Allocates a full node for an item and points the item at it.
+ *
+ * @param queue Queue to allocate from
+ * @param item  Item the node will hold
+ * @param key   Key of the item
+ * @return      The new node
+ */
+static hollow_node* make_node( hollow_heap *queue, hollow_item *item,
+    key_type key )
+{
+    hollow_node *node = pq_alloc_node( queue->map, 1 );
+    node->item = item;
+    node->key = key;
+    item->node = node;
+
+    return node;
+}
+
+/**
+ * Prepends a full node to the root list and updates the minimum.
+ *
+ * @param queue Queue to add to
+ * @param node  Node to add
+ */
+static void add_root( hollow_heap *queue, hollow_node *node )
+{
+    node->next = queue->roots;
+    queue->roots = node;
+    if ( queue->minimum == NULL || node->key < queue->minimum->key )
+        queue->minimum = node;
+}
+
+/**
+ * Makes the node with the larger key the most recent child of the other.
+ *
+ * @param queue Queue in which the nodes reside
+ * @param a     First node
+ * @param b     Second node
+ * @return      The winning node, now parent of the other
+ */
+static hollow_node* link( hollow_heap *queue, hollow_node *a, hollow_node *b )
+{
+    hollow_node *parent, *child;
+    if ( b->key < a->key )
+    {
+        parent = b;
+        child = a;
+    }
+    else
+    {
+        parent = a;
+        child = b;
+    }
+
+    child->next = parent->child;
+    parent->child = child;
+
+    return parent;
+}
+
+/**
+ * Links a full node with trees of the same rank until it finds a free slot
+ * in the rank array.
+ *
+ * @param queue Queue in which the node resides
+ * @param node  Full node to place
+ */
+static void ranked_links( hollow_heap *queue, hollow_node *node )
+{
+    while ( OCCUPIED( queue->registry, node->rank ) )
+    {
+        uint32_t rank = node->rank;
+        node = link( queue, node, queue->ranks[rank] );
+        REGISTRY_UNSET( queue->registry, rank );
+        node->rank = rank + 1;
+    }
+    queue->ranks[node->rank] = node;
+    REGISTRY_SET( queue->registry, node->rank );
+}
+
+/**
+ * Destroys hollow roots and links the full nodes uncovered, then rebuilds
+ * the root list from the rank array.  The root list is treated as the child
+ * list of a virtual hollow parent.  A hollow node with two parents is only
+ * destroyed once both parents are gone; it is the last child of its second
+ * parent, so the scan of that parent's list stops there.  When rebuilding,
+ * every full node is also expanded and relinked from scratch, so all hollow
+ * nodes are destroyed.
+ *
+ * @param queue     Queue to restructure
+ * @param rebuild   Whether to dismantle full nodes as well
+ */
+static void restructure( hollow_heap *queue, bool rebuild )
+{
+    hollow_node *hollow_stack = NULL;
+    hollow_node *full_stack = NULL;
+    hollow_node *parent = NULL;
+    hollow_node *current = queue->roots;
+    hollow_node *node;
+    uint32_t k;
+
+    queue->roots = NULL;
+    queue->minimum = NULL;
+
+    while ( TRUE )
+    {
+        while ( current != NULL )
+        {
+            node = current;
+            current = current->next;
+            if ( node->item == NULL )
+            {
+                if ( node->ep == NULL )
+                {
+                    node->next = hollow_stack;
+                    hollow_stack = node;
+                }
+                else
+                {
+                    if ( node->ep == parent )
+                        current = NULL;
+                    else
+                        node->next = NULL;
+                    node->ep = NULL;
+                }
+            }
+            else if ( rebuild )
+            {
+                node->next = full_stack;
+                full_stack = node;
+            }
+            else
+                ranked_links( queue, node );
+        }
+
+        if ( parent != NULL && parent->item == NULL )
+        {
+            pq_free_node( queue->map, 1, parent );
+            queue->hollow--;
+        }
+        else if ( parent != NULL )
+        {
+            parent->child = NULL;
+            parent->rank = 0;
+            ranked_links( queue, parent );
+        }
+
+        if ( hollow_stack != NULL )
+        {
+            parent = hollow_stack;
+            hollow_stack = hollow_stack->next;
+        }
+        else if ( full_stack != NULL )
+        {
+            parent = full_stack;
+            full_stack = full_stack->next;
+        }
+        else
+            break;
+        current = parent->child;
+    }
+
+    while ( queue->registry )
+    {
+        k = REGISTRY_LEADER( queue->registry );
+        add_root( queue, queue->ranks[k] );
+        REGISTRY_UNSET( queue->registry, k );
+    }
+}
+
+/**
+ * Rebuilds the heap once hollow nodes outnumber the items, bounding the
+ * memory held by hollow nodes.
+ *
+ * @param queue Queue to check
+ */
+static void check_hollow( hollow_heap *queue )
+{
+    if ( queue->hollow > queue->size )
+        restructure( queue, TRUE );
+}
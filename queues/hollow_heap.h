@@ -0,0 +1,230 @@
+#ifndef HOLLOW_HEAP
+#define HOLLOW_HEAP
+
+//==============================================================================
+// DEFINES, INCLUDES, and STRUCTS
+//==============================================================================
+
+#include "queue_common.h"
+
+struct hollow_item_t;
+
+/**
+ * A node of the heap DAG.  A node holding an item is full; once its item is
+ * deleted or moved to a new node by a key decrease, the node becomes hollow
+ * and stays in place until it is found as a root.  Children are kept in a
+ * singly linked list, most recently linked first.  A hollow node left behind
+ * by a key decrease has a second parent, the node that took over its item,
+ * and is the last child of that parent.
+ */
+struct hollow_node_t
+{
+    //! Item held by this node, NULL if the node is hollow
+    struct hollow_item_t *item;
+    //! Most recently linked child of this node
+    struct hollow_node_t *child;
+    //! Next node in the list of this node's siblings, or next root
+    struct hollow_node_t *next;
+    //! Second parent of a hollow node
+    struct hollow_node_t *ep;
+
+    //! Rank used for ranked links
+    uint32_t rank;
+    //! Key for the item
+    key_type key;
+} __attribute__ ((aligned(4)));
+
+typedef struct hollow_node_t hollow_node;
+
+/**
+ * Holds an inserted element and the node currently holding it.  Acts as a
+ * handle to clients for the purpose of mutability, since the node changes
+ * with every key decrease.
+ */
+struct hollow_item_t
+{
+    //! Node currently holding this item
+    hollow_node *node;
+    //! Pointer to a piece of client data
+    item_type item;
+} __attribute__ ((aligned(4)));
+
+typedef struct hollow_item_t hollow_item;
+typedef hollow_item pq_node_type;
+
+/**
+ * A mutable hollow heap, multi-root DAG version.  Inserts and key decreases
+ * only add a root; a decrease leaves a hollow node behind instead of cutting
+ * a subtree.  Deletion of anything but the minimum just hollows the node.
+ * Deleting the minimum destroys the hollow roots and performs ranked links on
+ * the full nodes they expose.  Items and nodes are allocated from the memory
+ * map as types 0 and 1 respectively.  When hollow nodes outnumber the items,
+ * the heap is rebuilt from its full nodes, so at most 2n + 1 nodes exist for
+ * n items.
+ */
+struct hollow_heap_t
+{
+    //! Memory map to use for item (type 0) and node (type 1) allocation
+    mem_map *map;
+    //! The number of items held in the queue
+    uint32_t size;
+    //! The number of hollow nodes in the queue
+    uint32_t hollow;
+    //! Head of the list of roots
+    hollow_node *roots;
+    //! Root with the minimum key
+    hollow_node *minimum;
+    //! Scratch array of trees indexed by rank, used while linking
+    hollow_node *ranks[MAXRANK];
+    //! A registry to keep track of non-null entries in ranks
+    uint64_t registry;
+} __attribute__ ((aligned(4)));
+
+typedef struct hollow_heap_t hollow_heap;
+typedef hollow_heap pq_type;
+
+//==============================================================================
+// PUBLIC DECLARATIONS
+//==============================================================================
+
+/**
+ * Creates a new, empty queue.
+ *
+ * @param map   Memory map to use for item and node allocation
+ * @return      Pointer to the new queue
+ */
+hollow_heap* pq_create( mem_map *map );
+
+/**
+ * Frees all the memory used by the queue.
+ *
+ * @param queue Queue to destroy
+ */
+void pq_destroy( hollow_heap *queue );
+
+/**
+ * Deletes all nodes, leaving the queue empty.
+ *
+ * @param queue Queue to clear
+ */
+void pq_clear( hollow_heap *queue );
+
+/**
+ * Returns the key associated with the queried item.
+ *
+ * @param queue Queue to which item belongs
+ * @param item  Item to query
+ * @return      Item's key
+ */
+key_type pq_get_key( hollow_heap *queue, hollow_item *item );
+
+/**
+ * Returns the client data associated with the queried item.
+ *
+ * @param queue Queue to which item belongs
+ * @param item  Item to query
+ * @return      Item's client data
+ */
+item_type* pq_get_item( hollow_heap *queue, hollow_item *item );
+
+/**
+ * Returns the current size of the queue.
+ *
+ * @param queue Queue to query
+ * @return      Size of queue
+ */
+uint32_t pq_get_size( hollow_heap *queue );
+
+/**
+ * Takes an item-key pair to insert it into the queue and creates a new
+ * corresponding node.  Adds the node to the list of roots.
+ *
+ * @param queue Queue to insert into
+ * @param item  Item to insert
+ * @param key   Key to use for node priority
+ * @return      Pointer to corresponding item handle
+ */
+hollow_item* pq_insert( hollow_heap *queue, item_type item, key_type key );
+
+/**
+ * Returns the minimum item from the queue without modifying any data.
+ *
+ * @param queue Queue to query
+ * @return      Item with minimum key
+ */
+hollow_item* pq_find_min( hollow_heap *queue );
+
+/**
+ * Deletes the minimum item from the queue and returns its key.  Destroys
+ * hollow roots, links full nodes of equal rank and rebuilds the root list.
+ *
+ * @param queue Queue to query
+ * @return      Minimum key, corresponding to item deleted
+ */
+key_type pq_delete_min( hollow_heap *queue );
+
+/**
+ * Deletes an arbitrary item from the queue.  Unless the item is the minimum,
+ * its node is simply made hollow and cleaned up later.
+ *
+ * @param queue Queue in which the item resides
+ * @param item  Item to delete
+ * @return      Key of item deleted
+ */
+key_type pq_delete( hollow_heap *queue, hollow_item *item );
+
+/**
+ * Decreases the key of an item.  Moves the item to a new root whose only
+ * child is the old, now hollow, node.
+ *
+ * @param queue     Queue in which the item resides
+ * @param item      Item to change
+ * @param new_key   New key to use for the given item
+ */
+void pq_decrease_key( hollow_heap *queue, hollow_item *item,
+    key_type new_key );
+
+/**
+ * Increases the key of an item.  Leaves the old node hollow and moves the
+ * item to a new root.
+ *
+ * @param queue     Queue in which the item resides
+ * @param item      Item to change
+ * @param new_key   New key to use for the given item
+ */
+void pq_increase_key( hollow_heap *queue, hollow_item *item,
+    key_type new_key );
+
+/**
+ * Determines whether the queue is empty, or if it holds some items.
+ *
+ * @param queue Queue to query
+ * @return      True if queue holds nothing, false otherwise
+ */
+bool pq_empty( hollow_heap *queue );
+
+/**
+ * Writes a snapshot of the queue, every item with its key.  Full nodes are
+ * written as they are found in the child lists.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( hollow_heap *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  The items are always
+ * inserted one by one: an insertion only adds a root, so it costs about as
+ * much as relinking a node would.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+hollow_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    hollow_item **handles );
+
+#endif
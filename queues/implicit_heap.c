@@ -1,5 +1,33 @@
 #include "implicit_heap.h"
 
+#ifdef IMPLICIT_BHEAP
+    #include <sys/mman.h>
+#endif
+
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#ifdef IMPLICIT_BHEAP
+    // array position of the k-th node in fill order
+    #define POSITION(k)     ( ( (k) / BHEAP_NODES ) * BHEAP_SLOTS + \
+                                (k) % BHEAP_NODES )
+#else
+    #define POSITION(k)     (k)
+#endif
+
+#ifdef IMPLICIT_BHEAP
+    #ifdef BHEAP_HUGE
+        #define SNAPSHOT_LAYOUT "implicit_bheap_huge_" \
+                                    SNAPSHOT_NUMBER( BRANCHING_FACTOR )
+    #else
+        #define SNAPSHOT_LAYOUT "implicit_bheap_" \
+                                    SNAPSHOT_NUMBER( BRANCHING_FACTOR )
+    #endif
+#else
+    #define SNAPSHOT_LAYOUT     "implicit_" SNAPSHOT_NUMBER( BRANCHING_FACTOR )
+#endif
+
 //==============================================================================
 // STATIC DECLARATIONS
 //==============================================================================
@@ -8,7 +36,12 @@ static void push( implicit_heap *queue, uint32_t src, uint32_t dst );
 static void dump( implicit_heap *queue, implicit_node *node, uint32_t dst );
 static uint32_t heapify_down( implicit_heap *queue, implicit_node *node );
 static uint32_t heapify_up( implicit_heap *queue, implicit_node *node );
+static inline uint64_t first_child( uint64_t index, uint64_t *stride );
+static inline uint32_t parent( uint32_t index );
 static void grow_heap( implicit_heap *queue );
+#ifdef IMPLICIT_BHEAP
+static implicit_node** alloc_pages( uint32_t capacity );
+#endif
 
 //==============================================================================
 // PUBLIC METHODS
@@ -17,7 +50,14 @@ static void grow_heap( implicit_heap *queue );
 implicit_heap* pq_create( mem_map *map )
 {
     implicit_heap *queue = calloc( 1, sizeof( implicit_heap ) );
-#ifndef USE_EAGER
+#ifdef IMPLICIT_BHEAP
+    #ifndef USE_EAGER
+    queue->capacity = BHEAP_NODES;
+    #else
+    queue->capacity = map->capacities[0];
+    #endif
+    queue->nodes = alloc_pages( queue->capacity );
+#elif !defined USE_EAGER
     queue->capacity = 1;
     queue->nodes = calloc( 1, sizeof( implicit_node* ) );
 #else
@@ -62,7 +102,8 @@ implicit_node* pq_insert( implicit_heap *queue, item_type item, key_type key )
     implicit_node *node = pq_alloc_node( queue->map, 0 );
     ITEM_ASSIGN( node->item, item );
     node->key = key;
-    node->index = queue->size++;
+    node->index = POSITION( queue->size );
+    queue->size++;
 
 #ifndef USE_EAGER
     if( queue->size == queue->capacity )
@@ -89,14 +130,18 @@ key_type pq_delete_min( implicit_heap *queue )
 key_type pq_delete( implicit_heap *queue, implicit_node* node )
 {
     key_type key = node->key;
-    implicit_node *last_node = queue->nodes[queue->size - 1];
+    implicit_node *last_node = queue->nodes[POSITION( queue->size - 1 )];
     push( queue, last_node->index, node->index );
 
     pq_free_node( queue->map, 0, node );
     queue->size--;
 
+    // the last node may belong above or below the vacated position
     if ( node != last_node )
+    {
         heapify_down( queue, last_node );
+        heapify_up( queue, last_node );
+    }
 
     return key;
 }
@@ -108,11 +153,81 @@ void pq_decrease_key( implicit_heap *queue, implicit_node *node,
     heapify_up( queue, node );
 }
 
+void pq_increase_key( implicit_heap *queue, implicit_node *node,
+    key_type new_key )
+{
+    node->key = new_key;
+    heapify_down( queue, node );
+}
+
 bool pq_empty( implicit_heap *queue )
 {
     return ( queue->size == 0 );
 }
 
+pq_snapshot_header* pq_serialize( implicit_heap *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    implicit_node *node;
+    uint32_t k;
+
+    if( snapshot == NULL )
+        return NULL;
+
+    for( k = 0; k < queue->size; k++ )
+    {
+        node = queue->nodes[POSITION( k )];
+        entries[k].item = node->item;
+        entries[k].key = node->key;
+        entries[k].hint = 0;
+    }
+
+    return snapshot;
+}
+
+implicit_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    implicit_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    implicit_node *node;
+    uint32_t k;
+
+    if( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    implicit_heap *queue = pq_create( map );
+    if( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for( k = 0; k < snapshot->size; k++ )
+        {
+            node = pq_insert( queue, entries[k].item, entries[k].key );
+            if( handles != NULL )
+                handles[entries[k].item] = node;
+        }
+        return queue;
+    }
+
+#ifndef USE_EAGER
+    while( queue->capacity <= snapshot->size )
+        grow_heap( queue );
+#endif
+    for( k = 0; k < snapshot->size; k++ )
+    {
+        node = pq_alloc_node( map, 0 );
+        ITEM_ASSIGN( node->item, entries[k].item );
+        node->key = entries[k].key;
+        node->index = POSITION( k );
+        queue->nodes[node->index] = node;
+        if( handles != NULL )
+            handles[entries[k].item] = node;
+    }
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
@@ -130,7 +245,8 @@ bool pq_empty( implicit_heap *queue )
  */
 static void push( implicit_heap *queue, uint32_t src, uint32_t dst )
 {
-    if ( ( src >= queue->size ) || ( dst >= queue->size ) || ( src == dst ) )
+    uint32_t end = POSITION( queue->size );
+    if ( ( src >= end ) || ( dst >= end ) || ( src == dst ) )
         return;
 
     queue->nodes[dst] = queue->nodes[src];
@@ -163,17 +279,17 @@ static uint32_t heapify_down( implicit_heap *queue, implicit_node *node )
     if ( node == NULL )
         return -1;
 
-    uint32_t sentinel, i, min;
+    uint64_t sentinel, i, min, stride;
+    uint64_t end = POSITION( queue->size );
     uint32_t base = node->index;
-    while( base * BRANCHING_FACTOR + 1 < queue->size )
+    while( ( i = first_child( base, &stride ) ) < end )
     {
-        i = base * BRANCHING_FACTOR + 1;
-        sentinel = i + BRANCHING_FACTOR;
-        if( sentinel > queue->size )
-            sentinel = queue->size;
+        sentinel = i + BRANCHING_FACTOR * stride;
+        if( sentinel > end )
+            sentinel = end;
 
-        min = i++;
-        for( i = i; i < sentinel; i++ )
+        min = i;
+        for( i += stride; i < sentinel; i += stride )
         {
             if( queue->nodes[i]->key < queue->nodes[min]->key )
                 min = i;
@@ -205,10 +321,10 @@ static uint32_t heapify_up( implicit_heap *queue, implicit_node *node )
         return -1;
 
     uint32_t i;
-    for( i = node->index; i > 0; i = (i-1)/BRANCHING_FACTOR )
+    for( i = node->index; i > 0; i = parent( i ) )
     {
-        if ( node->key < queue->nodes[(i-1)/BRANCHING_FACTOR]->key )
-            push( queue, (i-1)/BRANCHING_FACTOR, i );
+        if ( node->key < queue->nodes[parent( i )]->key )
+            push( queue, parent( i ), i );
         else
             break;
     }
@@ -217,6 +333,99 @@ static uint32_t heapify_up( implicit_heap *queue, implicit_node *node )
     return node->index;
 }
 
+/**
+ * Finds the position of the first child of a node, and the distance between
+ * the positions of consecutive children.
+ *
+ * @param index     Position of the parent
+ * @param stride    Set to the distance between siblings
+ * @return          Position of the first child
+ */
+static inline uint64_t first_child( uint64_t index, uint64_t *stride )
+{
+#ifdef IMPLICIT_BHEAP
+    uint64_t block = index / BHEAP_SLOTS;
+    uint64_t offset = index % BHEAP_SLOTS;
+
+    if ( offset < BHEAP_FIRST_LEAF )
+    {
+        *stride = 1;
+        return block * BHEAP_SLOTS + offset * BRANCHING_FACTOR + 1;
+    }
+
+    // children of a block leaf are the roots of consecutive child blocks
+    *stride = BHEAP_SLOTS;
+    return ( block * BHEAP_FANOUT + 1 + ( offset - BHEAP_FIRST_LEAF ) *
+        BRANCHING_FACTOR ) * BHEAP_SLOTS;
+#else
+    *stride = 1;
+    return index * BRANCHING_FACTOR + 1;
+#endif
+}
+
+/**
+ * Finds the position of the parent of a non-root node.
+ *
+ * @param index Position of the child
+ * @return      Position of the parent
+ */
+static inline uint32_t parent( uint32_t index )
+{
+#ifdef IMPLICIT_BHEAP
+    uint32_t block = index / BHEAP_SLOTS;
+    uint32_t offset = index % BHEAP_SLOTS;
+
+    if ( offset > 0 )
+        return block * BHEAP_SLOTS + ( offset - 1 ) / BRANCHING_FACTOR;
+
+    block--;
+    return ( block / BHEAP_FANOUT ) * BHEAP_SLOTS + BHEAP_FIRST_LEAF +
+        ( block % BHEAP_FANOUT ) / BRANCHING_FACTOR;
+#else
+    return ( index - 1 ) / BRANCHING_FACTOR;
+#endif
+}
+
+#ifdef IMPLICIT_BHEAP
+
+/**
+ * Allocates a page-aligned node array with room for the given number of
+ * nodes.  Asks for transparent huge pages where they are supported.
+ *
+ * @param capacity  Number of nodes to hold
+ * @return          The new array
+ */
+static implicit_node** alloc_pages( uint32_t capacity )
+{
+    uint64_t blocks = ( capacity + BHEAP_NODES - 1 ) / BHEAP_NODES + 1;
+    uint64_t bytes = blocks * BHEAP_SLOTS * sizeof( implicit_node* );
+    void *array;
+
+    bytes = ( bytes + BHEAP_PAGE_BYTES - 1 ) & ~( (uint64_t) BHEAP_PAGE_BYTES - 1 );
+    if ( posix_memalign( &array, BHEAP_PAGE_BYTES, bytes ) != 0 )
+        exit( -1 );
+#if defined BHEAP_HUGE && defined MADV_HUGEPAGE
+    madvise( array, bytes, MADV_HUGEPAGE );
+#endif
+
+    return (implicit_node**) array;
+}
+
+static void grow_heap( implicit_heap *queue )
+{
+    uint32_t new_capacity = queue->capacity * 2;
+    implicit_node **new_array = alloc_pages( new_capacity );
+
+    memcpy( new_array, queue->nodes, POSITION( queue->size ) *
+        sizeof( implicit_node* ) );
+    free( queue->nodes );
+
+    queue->capacity = new_capacity;
+    queue->nodes = new_array;
+}
+
+#else
+
 static void grow_heap( implicit_heap *queue )
 {
     uint32_t new_capacity = queue->capacity * 2;
@@ -229,3 +438,5 @@ static void grow_heap( implicit_heap *queue )
     queue->capacity = new_capacity;
     queue->nodes = new_array;
 }
+
+#endif
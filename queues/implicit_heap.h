@@ -17,6 +17,46 @@
 
 #include "queue_common.h"
 
+#ifdef IMPLICIT_BHEAP
+    // Page-blocked layout: each block holds a complete d-ary subtree of
+    // BHEAP_LEVELS levels, and each leaf of a block has its d children at the
+    // roots of d child blocks.  BHEAP_FANOUT is the number of child blocks.
+    // Blocks take BHEAP_SLOTS array slots, the next power of two, so that no
+    // block straddles a page.
+    #ifdef BHEAP_HUGE
+        #define BHEAP_PAGE_BYTES    ( 1 << 21 )
+        #if BRANCHING_FACTOR == 16
+            #define BHEAP_LEVELS    5
+        #elif BRANCHING_FACTOR == 8
+            #define BHEAP_LEVELS    6
+        #elif BRANCHING_FACTOR == 4
+            #define BHEAP_LEVELS    9
+        #else
+            #define BHEAP_LEVELS    18
+        #endif
+    #else
+        #define BHEAP_PAGE_BYTES    ( 1 << 12 )
+        #if BRANCHING_FACTOR == 16
+            #define BHEAP_LEVELS    3
+        #elif BRANCHING_FACTOR == 8
+            #define BHEAP_LEVELS    3
+        #elif BRANCHING_FACTOR == 4
+            #define BHEAP_LEVELS    5
+        #else
+            #define BHEAP_LEVELS    9
+        #endif
+    #endif
+
+    #define BHEAP_FANOUT        ( (uint64_t) 1 << ( BHEAP_LEVELS * \
+                                    __builtin_ctz( BRANCHING_FACTOR ) ) )
+    #define BHEAP_NODES         ( ( BHEAP_FANOUT - 1 ) / \
+                                    ( BRANCHING_FACTOR - 1 ) )
+    #define BHEAP_FIRST_LEAF    ( ( BHEAP_FANOUT / BRANCHING_FACTOR - 1 ) / \
+                                    ( BRANCHING_FACTOR - 1 ) )
+    #define BHEAP_SLOTS         ( (uint64_t) 1 << \
+                                    ( 64 - __builtin_clzll( BHEAP_NODES ) ) )
+#endif
+
 /**
  * Holds an inserted element, as well as the current index in the node array.
  * Acts as a handle to clients for the purpose of mutability.
@@ -38,6 +78,12 @@ typedef implicit_node pq_node_type;
 /**
  * A mutable, meldable, array-based d-ary heap.  Maintains a single, complete
  * d-ary tree.  Imposes the standard heap invariant.
+ *
+ * With IMPLICIT_BHEAP defined the tree is laid out in page-blocked (B-heap)
+ * order instead of breadth first, so that a path from the root touches one
+ * page per BHEAP_LEVELS levels.  Pages are 4 KB, or 2 MB with BHEAP_HUGE,
+ * and the array is page aligned.  The tree is filled page by page, so node
+ * indices are positions in the array rather than ranks.
  */
 struct implicit_heap_t
 {
@@ -161,6 +207,19 @@ key_type pq_delete( implicit_heap *queue, implicit_node* node );
 void pq_decrease_key( implicit_heap *queue, implicit_node *node,
     key_type new_key );
 
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve the heap invariant
+ * given a pointer to the corresponding node.  Sifts the node down past its
+ * smaller children.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( implicit_heap *queue, implicit_node *node,
+    key_type new_key );
+
 /**
  * Determines whether the queue is empty, or if it holds some items.
  *
@@ -169,4 +228,29 @@ void pq_decrease_key( implicit_heap *queue, implicit_node *node,
  */
 bool pq_empty( implicit_heap *queue );
 
+/**
+ * Writes a snapshot of the queue, every item with its key.  Nodes are written
+ * in array order, which is the heap itself.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( implicit_heap *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  A snapshot of the same
+ * variant is copied straight into the array without comparing keys.  A
+ * snapshot of another queue type is restored by inserting its items one by
+ * one.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+implicit_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    implicit_node **handles );
+
 #endif
@@ -1,5 +1,11 @@
 #include "implicit_simple_heap.h"
 
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define SNAPSHOT_LAYOUT "implicit_simple_" SNAPSHOT_NUMBER( BRANCHING_FACTOR )
+
 //==============================================================================
 // STATIC DECLARATIONS
 //==============================================================================
@@ -104,11 +110,69 @@ void pq_decrease_key( implicit_simple_heap *queue, implicit_simple_node *node,
     heapify_up( queue, node );
 }
 
+void pq_increase_key( implicit_simple_heap *queue, implicit_simple_node *node,
+    key_type new_key )
+{
+    node->key = new_key;
+    heapify_down( queue, node );
+}
+
 bool pq_empty( implicit_simple_heap *queue )
 {
     return ( queue->size == 0 );
 }
 
+pq_snapshot_header* pq_serialize( implicit_simple_heap *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    uint32_t i;
+
+    if( snapshot == NULL )
+        return NULL;
+
+    for( i = 0; i < queue->size; i++ )
+    {
+        entries[i].item = queue->nodes[i].item;
+        entries[i].key = queue->nodes[i].key;
+        entries[i].hint = 0;
+    }
+
+    return snapshot;
+}
+
+implicit_simple_heap* pq_deserialize( mem_map *map,
+    pq_snapshot_header *snapshot, implicit_simple_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    uint32_t i;
+
+    if( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    implicit_simple_heap *queue = pq_create( map );
+    if( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for( i = 0; i < snapshot->size; i++ )
+            pq_insert( queue, entries[i].item, entries[i].key );
+        return queue;
+    }
+
+#ifndef USE_EAGER
+    while( queue->capacity < snapshot->size )
+        grow_heap( queue );
+#endif
+    for( i = 0; i < snapshot->size; i++ )
+    {
+        queue->nodes[i].key = entries[i].key;
+        ITEM_ASSIGN( queue->nodes[i].item, entries[i].item );
+    }
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
@@ -207,8 +271,8 @@ static uint32_t heapify_up( implicit_simple_heap *queue, implicit_simple_node *n
 static void grow_heap( implicit_simple_heap *queue )
 {
     uint32_t new_capacity = queue->capacity * 2;
-    implicit_simple_node **new_array = realloc( queue->nodes, new_capacity *
-        sizeof( implicit_simple_node* ) );
+    implicit_simple_node *new_array = realloc( queue->nodes, new_capacity *
+        sizeof( implicit_simple_node ) );
 
     if( new_array == NULL )
         exit( -1 );
@@ -6,38 +6,36 @@
 #include <limits>
 
 const int KNBufferSize1 = 32; // equalize procedure call overheads etc.
-const int KNN = 512; // bandwidth
-const int KNKMAX = 64;  // maximal arity
-const int KNLevels = 4; // overall capacity >= KNN*KNKMAX^KNLevels
-const int LogKNKMAX = 6;  // ceil(log KNK)
-/*
-const int KNBufferSize1 = 3; // equalize procedure call overheads etc.
-const int KNN = 10; // bandwidth
-const int KNKMAX = 4;  // maximal arity
-const int KNLevels = 4; // overall capacity >= KNN*KNKMAX^KNLevels
-const int LogKNKMAX = 2;  // ceil(log KNK)
-*/
+const int KNDefaultN = 512; // default bandwidth
+const int KNDefaultKMAX = 64;  // default maximal arity
+// the number of levels is not bounded, each level multiplies the
+// capacity by the arity: overall capacity >= n*kmax^levels
+
 template <class Key, class Value>
 struct KNElement {Key key; Value value;};
 
 //////////////////////////////////////////////////////////////////////
-// fixed size binary heap
-template <class Key, class Value, int capacity>
+// binary heap with capacity fixed at construction
+template <class Key, class Value>
 class BinaryHeap {
   //  static const Key infimum  = 4;
   //static const Key supremum = numeric_limits<Key>.max();
   typedef KNElement<Key, Value> Element;
-  Element data[capacity + 2];
+  Element *data; // capacity + 2 elements
+  int capacity;
   int size;  // index of last used element
 public:
-  BinaryHeap(Key sup, Key infimum):size(0) {
+  BinaryHeap(Key sup, Key infimum, int cap):capacity(cap), size(0) {
+    data = new Element[capacity + 2];
     data[0].key = infimum; // sentinel
     data[capacity + 1].key = sup;
     reset();
   }
+  ~BinaryHeap() { delete [] data; }
   Key getSupremum() { return data[capacity + 1].key; }
   void reset();
   int   getSize()     const { return size; }
+  int   getCapacity() const { return capacity; }
   Key   getMinKey()   const { return data[1].key; }
   Value getMinValue() const { return data[1].value; }
   void  deleteMin();
@@ -53,8 +51,8 @@ public:
 
 
 // reset size to 0 and fill data array with sentinels
-template <class Key, class Value, int capacity>
-inline void BinaryHeap<Key, Value, capacity>::
+template <class Key, class Value>
+inline void BinaryHeap<Key, Value>::
 reset() {
   size = 0;
   Key sup = getSupremum();
@@ -66,8 +64,8 @@ reset() {
   // memcpy-s
 }
 
-template <class Key, class Value, int capacity>
-inline void BinaryHeap<Key, Value, capacity>::
+template <class Key, class Value>
+inline void BinaryHeap<Key, Value>::
 deleteMin()
 {
   Assert2(size > 0);
@@ -77,16 +75,9 @@ deleteMin()
   int succ = 2;
   int sz   = size;
   while (succ < sz) {
-    Key key1 = data[succ].key;
-    Key key2 = data[succ + 1].key;
-    if (key1 > key2) {
-      succ++;
-      data[hole].key   = key2;
-      data[hole].value = data[succ].value;
-    } else {
-      data[hole].key   = key1;
-      data[hole].value = data[succ].value;
-    }
+    // branchless choice of the smaller child
+    succ += data[succ + 1].key < data[succ].key;
+    data[hole] = data[succ];
     hole = succ;
     succ <<= 1;
   }
@@ -111,8 +102,8 @@ deleteMin()
 
 // empty the heap and put the element to "to"
 // sorted in increasing order
-template <class Key, class Value, int capacity>
-inline void BinaryHeap<Key, Value, capacity>::
+template <class Key, class Value>
+inline void BinaryHeap<Key, Value>::
 sortTo(Element *to)
 {
   const int           sz = size;
@@ -128,16 +119,8 @@ sortTo(Element *to)
     int hole = 1;
     int succ = 2;
     while (succ <= sz) {
-      Key key1 = data[succ    ].key;
-      Key key2 = data[succ + 1].key;
-      if (key1 > key2) {
-        succ++;
-        data[hole].key   = key2;
-        data[hole].value = data[succ].value;
-      } else {
-        data[hole].key = key1;
-        data[hole].value = data[succ].value;
-      }
+      succ += data[succ + 1].key < data[succ].key;
+      data[hole] = data[succ];
       hole = succ;
       succ <<= 1;
     }
@@ -149,8 +132,8 @@ sortTo(Element *to)
 }
 
 
-template <class Key, class Value, int capacity>
-inline void BinaryHeap<Key, Value, capacity>::
+template <class Key, class Value>
+inline void BinaryHeap<Key, Value>::
 insert(Key k, Value v)
 {
   Assert2(size < capacity);
@@ -186,8 +169,10 @@ class KNLooserTree {
     int index; // number of loosing segment
   };
 
+  int kMax; // maximal arity, a power of two
+
   // stack of empty segments
-  int empty[KNKMAX]; // indices of empty segments
+  int *empty; // indices of empty segments
   int lastFree;  // where in "empty" is the last valid entry?
 
   int size; // total number of elements stored
@@ -198,13 +183,13 @@ class KNLooserTree {
 
   // upper levels of looser trees
   // entry[0] contains the winner info
-  Entry entry[KNKMAX];
+  Entry *entry;
 
   // leaf information
   // note that Knuth uses indices k..k-1
   // while we use 0..k-1
-  Element *current[KNKMAX]; // pointer to actual element
-  Element *segment[KNKMAX]; // start of Segments
+  Element **current; // pointer to actual element
+  Element **segment; // start of Segments
 
   // private member functions
   int initWinner(int root);
@@ -217,20 +202,14 @@ class KNLooserTree {
   int segmentIsEmpty(int i);
 public:
   KNLooserTree();
-  void init(Key sup); // before, no consistent state is reached :-(
+  ~KNLooserTree();
+  void init(Key sup, int maxArity); // before, no consistent state is reached :-(
 
-  void multiMergeUnrolled3(Element *to, int l);
-  void multiMergeUnrolled4(Element *to, int l);
-  void multiMergeUnrolled5(Element *to, int l);
-  void multiMergeUnrolled6(Element *to, int l);
-  void multiMergeUnrolled7(Element *to, int l);
-  void multiMergeUnrolled8(Element *to, int l);
-  void multiMergeUnrolled9(Element *to, int l);
-  void multiMergeUnrolled10(Element *to, int l);
+  template <int LogK> void multiMergeUnrolled(Element *to, int l);
 
   void multiMerge(Element *to, int l); // delete l smallest element to "to"
   void multiMergeK(Element *to, int l);
-  int  spaceIsAvailable() { return k < KNKMAX || lastFree >= 0; }
+  int  spaceIsAvailable() { return k < kMax || lastFree >= 0; }
      // for new segment
   void insertSegment(Element *to, int sz); // insert segment beginning at to
   int  getSize() { return size; }
@@ -239,23 +218,36 @@ public:
 
 
 //////////////////////////////////////////////////////////////////////
-// 2 level multi-merge tree
+// multi level multi-merge tree
+// buffer sizes and arity are chosen at construction,
+// levels are added as they are needed
 template <class Key, class Value>
 class KNHeap {
   typedef KNElement<Key, Value> Element;
 
-  KNLooserTree<Key, Value> tree[KNLevels];
+  int n; // bandwidth: insert heap capacity and buffer2 size
+  int kMax; // maximal arity of each tree
+  Key sup; // supremum, used as sentinel
+
+  // one tree per level, levels are allocated on demand
+  KNLooserTree<Key, Value> **tree;
 
   // one delete buffer for each tree (extra space for sentinel)
-  Element buffer2[KNLevels][KNN + 1]; // tree->buffer2->buffer1
-  Element *minBuffer2[KNLevels];
+  Element **buffer2; // tree->buffer2->buffer1
+  Element **minBuffer2;
 
   // overall delete buffer
   Element buffer1[KNBufferSize1 + 1];
   Element *minBuffer1;
 
   // insert buffer
-  BinaryHeap<Key, Value, KNN> insertHeap;
+  BinaryHeap<Key, Value> insertHeap;
+
+  // scratch space for emptyInsertHeap
+  Element *temp;
+
+  // how many levels are allocated
+  int levels;
 
   // how many levels are active
   int activeLevels;
@@ -264,23 +256,23 @@ class KNHeap {
   int size;
 
   // private member functions
+  void addLevel();
   void refillBuffer1();
-  void refillBuffer11(int sz);
-  void refillBuffer12(int sz);
-  void refillBuffer13(int sz);
-  void refillBuffer14(int sz);
   int refillBuffer2(int k);
   int makeSpaceAvailable(int level);
   void emptyInsertHeap();
-  Key getSupremum() const { return buffer2[0][KNN].key; }
+  Key getSupremum() const { return sup; }
   int getSize1( ) const { return ( buffer1 + KNBufferSize1) - minBuffer1; }
-  int getSize2(int i) const { return &(buffer2[i][KNN])     - minBuffer2[i]; }
+  int getSize2(int i) const { return &(buffer2[i][n])     - minBuffer2[i]; }
 public:
-  KNHeap(Key sup, Key infimum);
+  KNHeap(Key sup, Key infimum, int bandwidth = KNDefaultN,
+         int maxArity = KNDefaultKMAX);
+  ~KNHeap();
   int   getSize() const;
   void  getMin(Key *key, Value *value);
   void  deleteMin(Key *key, Value *value);
   void  insert(Key key, Value value);
+  void  insertSorted(Element *segment, int sz); // into an empty heap
 };
 
 
@@ -327,19 +319,81 @@ inline void  KNHeap<Key, Value>::deleteMin(Key *key, Value *value) {
 
 template <class Key, class Value>
 inline  void  KNHeap<Key, Value>::insert(Key k, Value v) {
-  if (insertHeap.getSize() == KNN) { emptyInsertHeap(); }
+  if (insertHeap.getSize() == n) { emptyInsertHeap(); }
   insertHeap.insert(k, v);
 }
 
 
 //////////////////////////////////////////////////////////////////////
-// Wrapper API for ompatibility with trace driver
+// Wrapper API for compatibility with trace driver
+//
+// The sequence heap cannot locate or modify an element once inserted,
+// so clients get handles from a handle table instead.  Each handle owns a
+// slot with a stamp, and heap elements carry (slot, stamp) as their value.
+// Changing a key or deleting an item bumps the stamp and, for a key
+// change, inserts a fresh element; elements whose stamp no longer
+// matches are invalid and are skipped when they reach the front.
+//
+// A snapshot holds the live items sorted by key.  Restoring it from a
+// sequence heap hands the whole array to the first tree as one segment
+// instead of passing every item through the insert heap.
+//
+// The bandwidth and maximal arity default to KNDefaultN and KNDefaultKMAX
+// and can be overridden through the KNHEAP_N and KNHEAP_KMAX environment
+// variables (kmax is rounded up to a power of two).
+
+static const key_type PQ_KEY_SUP = std::numeric_limits<key_type>::max();
+static const key_type PQ_KEY_INF = 0;
+
+struct knheap_node_t
+{
+    //! Slot in the handle table
+    uint32_t slot;
+
+    //! Pointer to a piece of client data
+    item_type item;
+    //! Current key for the item
+    key_type key;
+} __attribute__ ((aligned(4)));
+
+typedef struct knheap_node_t knheap_node;
+typedef knheap_node pq_node_type;
+
+struct knheap_slot_t
+{
+    //! Node currently owning the slot, NULL if free
+    knheap_node *node;
+    //! Incremented whenever elements for the slot become invalid
+    uint32_t stamp;
+};
 
-key_type PQ_KEY_SUP = std::numeric_limits<uint64_t>::max();
-key_type PQ_KEY_INF = 0;
+typedef struct knheap_slot_t knheap_slot;
 
-typedef KNHeap<key_type, item_type> pq_type;
-typedef KNElement<key_type, item_type> pq_node_type;
+struct knheap_t
+{
+    //! Memory map to use for node allocation
+    mem_map *map;
+    //! Underlying sequence heap, values are (slot << 32) | stamp
+    KNHeap<key_type, uint64_t> *heap;
+    //! Handle table
+    knheap_slot *slots;
+    //! Number of slots allocated
+    uint32_t slot_capacity;
+    //! Number of slots ever used
+    uint32_t slot_count;
+    //! Stack of free slots
+    uint32_t *free_slots;
+    //! Number of entries on the free stack
+    uint32_t free_count;
+    //! The number of live items held in the queue
+    uint32_t size;
+    //! Bandwidth and maximal arity of the sequence heap
+    int n;
+    int k_max;
+};
+
+typedef struct knheap_t knheap;
+typedef knheap pq_type;
 
 pq_type* pq_create( mem_map *map );
 void pq_destroy( pq_type *queue );
@@ -353,7 +407,12 @@ key_type pq_delete_min( pq_type *queue );
 key_type pq_delete( pq_type *queue, pq_node_type* node );
 void pq_decrease_key( pq_type *queue, pq_node_type *node,
     key_type new_key );
+void pq_increase_key( pq_type *queue, pq_node_type *node,
+    key_type new_key );
 bool pq_empty( pq_type *queue );
+pq_snapshot_header* pq_serialize( pq_type *queue, size_t *length );
+pq_type* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    pq_node_type **handles );
 
 //////////////////////////////////////////////////////////////////////
 
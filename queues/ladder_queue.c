@@ -0,0 +1,545 @@
+#include "ladder_queue.h"
+
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define SNAPSHOT_LAYOUT "ladder"
+
+//==============================================================================
+// STATIC DECLARATIONS
+//==============================================================================
+
+static void place( ladder_queue *queue, ladder_node *node );
+static void refill( ladder_queue *queue );
+static void spawn( ladder_queue *queue, ladder_list *list, key_type start,
+    key_type last );
+static key_type boundary( ladder_rung *rung );
+static void push( ladder_list *list, ladder_node *node );
+static void unlink_node( ladder_node *node );
+static void insert_sorted( ladder_list *list, ladder_node *node );
+static ladder_node* sort( ladder_node *head, uint32_t count );
+static void write_list( ladder_list *list, uint32_t hint,
+    pq_snapshot_entry *entries, uint32_t *k );
+static ladder_list* find_list( ladder_queue *queue, uint32_t hint );
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+ladder_queue* pq_create( mem_map *map )
+{
+    ladder_queue *queue = calloc( 1, sizeof( ladder_queue ) );
+    queue->map = map;
+
+    return queue;
+}
+
+void pq_destroy( ladder_queue *queue )
+{
+    uint32_t i;
+
+    pq_clear( queue );
+    for ( i = 0; i < LADDER_MAX_RUNGS; i++ )
+        free( queue->rungs[i].buckets );
+    free( queue );
+}
+
+void pq_clear( ladder_queue *queue )
+{
+    mm_clear( queue->map );
+    queue->top.head = NULL;
+    queue->top.count = 0;
+    queue->top_start = 0;
+    queue->rung_count = 0;
+    queue->bottom.head = NULL;
+    queue->bottom.count = 0;
+    queue->size = 0;
+}
+
+key_type pq_get_key( ladder_queue *queue, ladder_node *node )
+{
+    return node->key;
+}
+
+item_type* pq_get_item( ladder_queue *queue, ladder_node *node )
+{
+    return (item_type*) &(node->item);
+}
+
+uint32_t pq_get_size( ladder_queue *queue )
+{
+    return queue->size;
+}
+
+ladder_node* pq_insert( ladder_queue *queue, item_type item, key_type key )
+{
+    ladder_node *node = pq_alloc_node( queue->map, 0 );
+    ITEM_ASSIGN( node->item, item );
+    node->key = key;
+
+    place( queue, node );
+    queue->size++;
+
+    return node;
+}
+
+ladder_node* pq_find_min( ladder_queue *queue )
+{
+    if ( pq_empty( queue ) )
+        return NULL;
+    if ( queue->bottom.count == 0 )
+        refill( queue );
+
+    return queue->bottom.head;
+}
+
+key_type pq_delete_min( ladder_queue *queue )
+{
+    return pq_delete( queue, pq_find_min( queue ) );
+}
+
+key_type pq_delete( ladder_queue *queue, ladder_node *node )
+{
+    key_type key = node->key;
+
+    unlink_node( node );
+    pq_free_node( queue->map, 0, node );
+    queue->size--;
+
+    return key;
+}
+
+void pq_decrease_key( ladder_queue *queue, ladder_node *node,
+    key_type new_key )
+{
+    unlink_node( node );
+    node->key = new_key;
+    place( queue, node );
+}
+
+void pq_increase_key( ladder_queue *queue, ladder_node *node,
+    key_type new_key )
+{
+    unlink_node( node );
+    node->key = new_key;
+    place( queue, node );
+}
+
+bool pq_empty( ladder_queue *queue )
+{
+    return ( queue->size == 0 );
+}
+
+pq_snapshot_header* pq_serialize( ladder_queue *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 2 + 4 * queue->rung_count, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    key_type *words = SNAPSHOT_WORDS( snapshot );
+    ladder_rung *rung;
+    uint32_t i, j, k = 0;
+    uint32_t offset = 2;
+
+    if ( snapshot == NULL )
+        return NULL;
+
+    // every list in order, each node with the index of its list as the hint
+    write_list( &(queue->top), 0, entries, &k );
+    write_list( &(queue->bottom), 1, entries, &k );
+    words[0] = queue->top_start;
+    words[1] = queue->rung_count;
+    for ( i = 0; i < queue->rung_count; i++ )
+    {
+        rung = queue->rungs + i;
+        for ( j = rung->current; j < rung->bucket_count; j++ )
+            write_list( rung->buckets + j, offset + j, entries, &k );
+        offset += rung->bucket_count;
+
+        words[2+4*i] = rung->bucket_count;
+        words[3+4*i] = rung->current;
+        words[4+4*i] = rung->start;
+        words[5+4*i] = rung->width;
+    }
+
+    return snapshot;
+}
+
+ladder_queue* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    ladder_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    key_type *words = SNAPSHOT_WORDS( snapshot );
+    ladder_node *node, *last = NULL;
+    ladder_list *list = NULL;
+    ladder_rung *rung;
+    uint32_t i, k;
+
+    if ( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    ladder_queue *queue = pq_create( map );
+    if ( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for ( k = 0; k < snapshot->size; k++ )
+        {
+            node = pq_insert( queue, entries[k].item, entries[k].key );
+            if ( handles != NULL )
+                handles[entries[k].item] = node;
+        }
+        return queue;
+    }
+
+    queue->top_start = words[0];
+    queue->rung_count = words[1];
+    for ( i = 0; i < queue->rung_count; i++ )
+    {
+        rung = queue->rungs + i;
+        rung->bucket_count = words[2+4*i];
+        rung->capacity = rung->bucket_count;
+        rung->current = words[3+4*i];
+        rung->start = words[4+4*i];
+        rung->width = words[5+4*i];
+        rung->buckets = calloc( rung->capacity, sizeof( ladder_list ) );
+    }
+
+    // the nodes of a list are contiguous, so each one follows the last
+    for ( k = 0; k < snapshot->size; k++ )
+    {
+        node = pq_alloc_node( map, 0 );
+        ITEM_ASSIGN( node->item, entries[k].item );
+        node->key = entries[k].key;
+        if ( handles != NULL )
+            handles[entries[k].item] = node;
+
+        if ( k == 0 || entries[k-1].hint != entries[k].hint )
+        {
+            list = find_list( queue, entries[k].hint );
+            list->head = node;
+        }
+        else
+        {
+            last->next = node;
+            node->prev = last;
+        }
+        node->list = list;
+        list->count++;
+        last = node;
+    }
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
+//==============================================================================
+// STATIC METHODS
+//==============================================================================
+
+/**
+ * Puts a node into top, into the highest rung that does not start above its
+ * key, or into bottom.  A bottom grown too long becomes a new rung.
+ *
+ * @param queue Queue to which the node belongs
+ * @param node  Node to place
+ */
+static void place( ladder_queue *queue, ladder_node *node )
+{
+    ladder_rung *rung;
+    key_type limit;
+    uint32_t i;
+
+    if ( node->key >= queue->top_start )
+    {
+        push( &(queue->top), node );
+        return;
+    }
+
+    for ( i = 0; i < queue->rung_count; i++ )
+    {
+        rung = queue->rungs + i;
+        if ( node->key >= boundary( rung ) )
+        {
+            push( rung->buckets + ( node->key - rung->start ) / rung->width,
+                node );
+            return;
+        }
+    }
+
+    insert_sorted( &(queue->bottom), node );
+    if ( queue->bottom.count > LADDER_THRESHOLD &&
+            queue->rung_count < LADDER_MAX_RUNGS )
+    {
+        // bottom lies below everything else, up to the lowest rung
+        limit = ( queue->rung_count == 0 ) ? queue->top_start :
+            boundary( queue->rungs + queue->rung_count - 1 );
+        spawn( queue, &(queue->bottom), queue->bottom.head->key, limit - 1 );
+    }
+}
+
+/**
+ * Fills the empty bottom from the first nonempty bucket of the lowest rung,
+ * splitting large buckets into new rungs on the way.  Rungs that run out are
+ * dropped, and when the ladder is empty, top becomes its first rung.
+ *
+ * @param queue Queue to refill, not empty
+ */
+static void refill( ladder_queue *queue )
+{
+    ladder_rung *rung;
+    ladder_list *bucket;
+    ladder_node *node;
+    key_type start, min, max;
+
+    while ( queue->bottom.count == 0 )
+    {
+        if ( queue->rung_count == 0 )
+        {
+            min = MAX_KEY;
+            max = 0;
+            for ( node = queue->top.head; node != NULL; node = node->next )
+            {
+                if ( node->key < min )
+                    min = node->key;
+                if ( node->key > max )
+                    max = node->key;
+            }
+            spawn( queue, &(queue->top), min, max );
+
+            // everything past the end of the new rung goes to top
+            queue->rungs[0].current = queue->rungs[0].bucket_count;
+            queue->top_start = boundary( queue->rungs );
+            queue->rungs[0].current = 0;
+            continue;
+        }
+
+        rung = queue->rungs + queue->rung_count - 1;
+        while ( rung->current < rung->bucket_count &&
+                rung->buckets[rung->current].count == 0 )
+            rung->current++;
+        if ( rung->current == rung->bucket_count )
+        {
+            queue->rung_count--;
+            continue;
+        }
+
+        bucket = rung->buckets + rung->current;
+        start = rung->start + rung->current * rung->width;
+        rung->current++;
+
+        if ( bucket->count > LADDER_THRESHOLD &&
+                queue->rung_count < LADDER_MAX_RUNGS && rung->width > 1 )
+        {
+            spawn( queue, bucket, start, ( rung->width - 1 > MAX_KEY - start ) ?
+                MAX_KEY : start + rung->width - 1 );
+            continue;
+        }
+
+        queue->bottom.head = sort( bucket->head, bucket->count );
+        queue->bottom.count = bucket->count;
+        bucket->head = NULL;
+        bucket->count = 0;
+        for ( node = queue->bottom.head; node != NULL; node = node->next )
+        {
+            node->list = &(queue->bottom);
+            if ( node->next != NULL )
+                node->next->prev = node;
+        }
+        queue->bottom.head->prev = NULL;
+    }
+}
+
+/**
+ * Moves a list into a new lowest rung covering the given keys.  The rung gets
+ * about one bucket per node.
+ *
+ * @param queue Queue to which the list belongs
+ * @param list  List to move, with keys from start to last
+ * @param start Smallest key the rung covers
+ * @param last  Largest key the rung covers
+ */
+static void spawn( ladder_queue *queue, ladder_list *list, key_type start,
+    key_type last )
+{
+    ladder_rung *rung = queue->rungs + queue->rung_count++;
+    ladder_node *node, *next;
+    key_type span = last - start;
+    uint32_t count = list->count;
+
+    if ( span < count )
+        count = span + 1;
+    rung->width = span / count + 1;
+    rung->bucket_count = span / rung->width + 1;
+    rung->start = start;
+    rung->current = 0;
+
+    if ( rung->capacity < rung->bucket_count )
+    {
+        free( rung->buckets );
+        rung->capacity = rung->bucket_count;
+        rung->buckets = malloc( rung->capacity * sizeof( ladder_list ) );
+    }
+    memset( rung->buckets, 0, rung->bucket_count * sizeof( ladder_list ) );
+
+    for ( node = list->head; node != NULL; node = next )
+    {
+        next = node->next;
+        push( rung->buckets + ( node->key - start ) / rung->width, node );
+    }
+    list->head = NULL;
+    list->count = 0;
+}
+
+/**
+ * Returns the smallest key of the current bucket of a rung, or MAX_KEY past
+ * the end of the key range.
+ *
+ * @param rung  Rung to query
+ * @return      Smallest key a node placed in the rung may have
+ */
+static key_type boundary( ladder_rung *rung )
+{
+    key_type key;
+    if ( __builtin_mul_overflow( (key_type) rung->current, rung->width, &key ) ||
+            __builtin_add_overflow( rung->start, key, &key ) )
+        return MAX_KEY;
+    return key;
+}
+
+static void push( ladder_list *list, ladder_node *node )
+{
+    node->list = list;
+    node->prev = NULL;
+    node->next = list->head;
+    if ( list->head != NULL )
+        list->head->prev = node;
+    list->head = node;
+    list->count++;
+}
+
+static void unlink_node( ladder_node *node )
+{
+    if ( node->prev == NULL )
+        node->list->head = node->next;
+    else
+        node->prev->next = node->next;
+    if ( node->next != NULL )
+        node->next->prev = node->prev;
+    node->list->count--;
+}
+
+/**
+ * Links a node into a sorted list, behind all smaller or equal keys.
+ *
+ * @param list  List to insert into
+ * @param node  Node to insert
+ */
+static void insert_sorted( ladder_list *list, ladder_node *node )
+{
+    ladder_node *prev = NULL;
+    ladder_node *next = list->head;
+
+    while ( next != NULL && next->key <= node->key )
+    {
+        prev = next;
+        next = next->next;
+    }
+
+    node->list = list;
+    node->prev = prev;
+    node->next = next;
+    if ( prev == NULL )
+        list->head = node;
+    else
+        prev->next = node;
+    if ( next != NULL )
+        next->prev = node;
+    list->count++;
+}
+
+/**
+ * Merge sorts a list by key, following next pointers only.
+ *
+ * @param head  First node of the list
+ * @param count Length of the list
+ * @return      First node of the sorted list
+ */
+static ladder_node* sort( ladder_node *head, uint32_t count )
+{
+    ladder_node *a, *b, *result, **tail = &result;
+    uint32_t i;
+
+    if ( count < 2 )
+        return head;
+
+    for ( b = head, i = 1; i < ( count >> 1 ); i++ )
+        b = b->next;
+    a = b;
+    b = b->next;
+    a->next = NULL;
+
+    a = sort( head, count >> 1 );
+    b = sort( b, count - ( count >> 1 ) );
+    while ( a != NULL && b != NULL )
+    {
+        if ( b->key < a->key )
+        {
+            *tail = b;
+            b = b->next;
+        }
+        else
+        {
+            *tail = a;
+            a = a->next;
+        }
+        tail = &((*tail)->next);
+    }
+    *tail = ( a != NULL ) ? a : b;
+
+    return result;
+}
+
+/**
+ * Writes the nodes of a list to a snapshot in list order.
+ *
+ * @param list      List to write
+ * @param hint      Index of the list, top and bottom first, then the buckets
+ *                  of each rung
+ * @param entries   Entries of the snapshot
+ * @param k         Index of the next entry, advanced past the list
+ */
+static void write_list( ladder_list *list, uint32_t hint,
+    pq_snapshot_entry *entries, uint32_t *k )
+{
+    ladder_node *node;
+
+    for ( node = list->head; node != NULL; node = node->next )
+    {
+        entries[*k].item = node->item;
+        entries[*k].key = node->key;
+        entries[*k].hint = hint;
+        (*k)++;
+    }
+}
+
+/**
+ * Finds a list by the index written by @ref <write_list>.
+ *
+ * @param queue Queue holding the list
+ * @param hint  Index of the list
+ * @return      The list
+ */
+static ladder_list* find_list( ladder_queue *queue, uint32_t hint )
+{
+    uint32_t i;
+
+    if ( hint == 0 )
+        return &(queue->top);
+    if ( hint == 1 )
+        return &(queue->bottom);
+
+    hint -= 2;
+    for ( i = 0; hint >= queue->rungs[i].bucket_count; i++ )
+        hint -= queue->rungs[i].bucket_count;
+
+    return queue->rungs[i].buckets + hint;
+}
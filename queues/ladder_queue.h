@@ -0,0 +1,262 @@
+#ifndef LADDER_QUEUE
+#define LADDER_QUEUE
+
+//==============================================================================
+// DEFINES, INCLUDES, and STRUCTS
+//==============================================================================
+
+#include "queue_common.h"
+
+#define LADDER_THRESHOLD    50
+#define LADDER_MAX_RUNGS    8
+
+struct ladder_list_t;
+
+/**
+ * Holds an inserted element, as well as pointers to maintain the list it is
+ * in.  Acts as a handle to clients for the purpose of mutability.  Every list
+ * is doubly linked, and the first node of a list has a null prev pointer.
+ */
+struct ladder_node_t
+{
+    //! Next node in the list
+    struct ladder_node_t *next;
+    //! Previous node in the list
+    struct ladder_node_t *prev;
+    //! List holding this node
+    struct ladder_list_t *list;
+
+    //! Pointer to a piece of client data
+    item_type item;
+    //! Key for the item
+    key_type key;
+} __attribute__ ((aligned(4)));
+
+typedef struct ladder_node_t ladder_node;
+typedef ladder_node pq_node_type;
+
+/**
+ * A list of nodes with its length: top, bottom and every bucket of a rung.
+ */
+struct ladder_list_t
+{
+    //! First node of the list
+    ladder_node *head;
+    //! The number of nodes in the list
+    uint32_t count;
+} __attribute__ ((aligned(4)));
+
+typedef struct ladder_list_t ladder_list;
+
+/**
+ * A rung of the ladder, an array of unsorted buckets of equal width covering
+ * a range of keys.  Buckets before the current one have been consumed.
+ */
+struct ladder_rung_t
+{
+    //! The array of buckets
+    ladder_list *buckets;
+    //! The number of buckets in use
+    uint32_t bucket_count;
+    //! The number of buckets allocated
+    uint32_t capacity;
+    //! First bucket that may hold nodes
+    uint32_t current;
+    //! Smallest key of the first bucket
+    key_type start;
+    //! Range of keys per bucket
+    key_type width;
+} __attribute__ ((aligned(4)));
+
+typedef struct ladder_rung_t ladder_rung;
+
+/**
+ * A mutable ladder queue (Tang, Goh and Thng, 2005).  Keys are kept in three
+ * tiers.  Top is an unsorted list of keys from top_start on, which is where
+ * the far future of an event simulation goes.  The ladder is a stack of rungs,
+ * each rung splitting one bucket of the rung above it into finer buckets, with
+ * the first rung covering all of top at the time it was made.  Bottom is a
+ * short sorted list of the smallest keys, from which the minimum is taken.
+ *
+ * When bottom runs empty, the first nonempty bucket of the lowest rung is
+ * either sorted into bottom or, if it holds more than LADDER_THRESHOLD nodes,
+ * split into a new rung; once the ladder is empty, top becomes its first rung.
+ * An insertion goes to top, to the highest rung whose current bucket does not
+ * lie above the key, or into bottom, which is turned into a new rung when it
+ * grows past LADDER_THRESHOLD.  Each node is therefore moved a bounded number
+ * of times and all operations take amortized constant time on the keys of
+ * event simulation.  A node remembers its list, so deletions and key changes
+ * unlink it directly.  At most LADDER_MAX_RUNGS rungs are used; past that,
+ * buckets are sorted into bottom whatever their size.
+ */
+struct ladder_queue_t
+{
+    //! Memory map to use for node allocation
+    mem_map *map;
+    //! The number of items held in the queue
+    uint32_t size;
+    //! Unsorted list of the largest keys
+    ladder_list top;
+    //! Smallest key that goes to top
+    key_type top_start;
+    //! Rungs of the ladder, the first one coarsest
+    ladder_rung rungs[LADDER_MAX_RUNGS];
+    //! The number of rungs in use
+    uint32_t rung_count;
+    //! Sorted list of the smallest keys
+    ladder_list bottom;
+} __attribute__ ((aligned(4)));
+
+typedef struct ladder_queue_t ladder_queue;
+typedef ladder_queue pq_type;
+
+//==============================================================================
+// PUBLIC DECLARATIONS
+//==============================================================================
+
+/**
+ * Creates a new, empty queue.
+ *
+ * @param map   Memory map to use for node allocation
+ * @return      Pointer to the new queue
+ */
+ladder_queue* pq_create( mem_map *map );
+
+/**
+ * Frees all the memory used by the queue.
+ *
+ * @param queue Queue to destroy
+ */
+void pq_destroy( ladder_queue *queue );
+
+/**
+ * Removes all items from the queue, leaving it empty.
+ *
+ * @param queue Queue to clear
+ */
+void pq_clear( ladder_queue *queue );
+
+/**
+ * Returns the key associated with the queried node.
+ *
+ * @param queue Queue to which node belongs
+ * @param node  Node to query
+ * @return      Node's key
+ */
+key_type pq_get_key( ladder_queue *queue, ladder_node *node );
+
+/**
+ * Returns the item associated with the queried node.
+ *
+ * @param queue Queue to which node belongs
+ * @param node  Node to query
+ * @return      Node's item
+ */
+item_type* pq_get_item( ladder_queue *queue, ladder_node *node );
+
+/**
+ * Returns the current size of the queue.
+ *
+ * @param queue Queue to query
+ * @return      Size of queue
+ */
+uint32_t pq_get_size( ladder_queue *queue );
+
+/**
+ * Takes an item-key pair to insert into the queue and creates a new
+ * corresponding node.  Places the node in top, in a rung or in bottom.
+ *
+ * @param queue Queue to insert into
+ * @param item  Item to insert
+ * @param key   Key to use for node priority
+ * @return      Pointer to corresponding node
+ */
+ladder_node* pq_insert( ladder_queue *queue, item_type item, key_type key );
+
+/**
+ * Returns the minimum item from the queue, which is the head of bottom.  If
+ * bottom is empty, refills it from the ladder first.
+ *
+ * @param queue Queue to query
+ * @return      Node with minimum key
+ */
+ladder_node* pq_find_min( ladder_queue *queue );
+
+/**
+ * Removes the minimum item from the queue and returns it.  Relies on
+ * @ref <pq_find_min> to locate it.
+ *
+ * @param queue Queue to query
+ * @return      Minimum key, corresponding to item deleted
+ */
+key_type pq_delete_min( ladder_queue *queue );
+
+/**
+ * Removes an arbitrary item from the queue by unlinking it from its list.
+ *
+ * @param queue Queue in which the node resides
+ * @param node  Pointer to node corresponding to the target item
+ * @return      Key of item removed
+ */
+key_type pq_delete( ladder_queue *queue, ladder_node *node );
+
+/**
+ * If the item in the queue is modified in such a way to decrease the
+ * key, then this function will update the queue to preserve queue
+ * properties given a pointer to the corresponding node.  Unlinks the node and
+ * places it again as if inserted.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_decrease_key( ladder_queue *queue, ladder_node *node,
+    key_type new_key );
+
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve queue properties
+ * given a pointer to the corresponding node.  Unlinks the node and places it
+ * again as if inserted.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( ladder_queue *queue, ladder_node *node,
+    key_type new_key );
+
+/**
+ * Determines whether the queue is empty, or if it holds some items.
+ *
+ * @param queue Queue to query
+ * @return      True if queue holds nothing, false otherwise
+ */
+bool pq_empty( ladder_queue *queue );
+
+/**
+ * Writes a snapshot of the queue, every item with its key.  Nodes are written
+ * list by list, top, bottom and then the buckets of each rung, with the index
+ * of the list as the hint, followed by the bounds of the rungs.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( ladder_queue *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  A snapshot of a ladder
+ * queue is relinked into the same lists without comparing keys.  A snapshot of
+ * another queue type is restored by inserting its items one by one.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+ladder_queue* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    ladder_node **handles );
+
+#endif
@@ -1,5 +1,23 @@
 #include "pairing_heap.h"
 
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define SNAPSHOT_CHILD  1
+#define SNAPSHOT_NEXT   2
+#define SNAPSHOT_AUX    4
+
+#ifdef PAIRING_MULTIPASS
+    #define SNAPSHOT_LAYOUT "pairing_multipass"
+#elif defined PAIRING_BACK_TO_FRONT
+    #define SNAPSHOT_LAYOUT "pairing_back_to_front"
+#elif defined PAIRING_AUX_TWOPASS
+    #define SNAPSHOT_LAYOUT "pairing_aux_twopass"
+#else
+    #define SNAPSHOT_LAYOUT "pairing"
+#endif
+
 //==============================================================================
 // STATIC DECLARATIONS
 //==============================================================================
@@ -7,6 +25,13 @@
 static pairing_node* merge( pairing_heap *queue, pairing_node *a,
     pairing_node *b );
 static pairing_node* collapse( pairing_heap *queue, pairing_node *node );
+#if defined PAIRING_MULTIPASS || defined PAIRING_AUX_TWOPASS
+static pairing_node* multipass( pairing_heap *queue, pairing_node *node );
+#endif
+#ifdef PAIRING_AUX_TWOPASS
+static void push_aux( pairing_heap *queue, pairing_node *node );
+static void merge_aux( pairing_heap *queue );
+#endif
 
 //==============================================================================
 // PUBLIC METHODS
@@ -30,6 +55,9 @@ void pq_clear( pairing_heap *queue )
 {
     mm_clear( queue->map );
     queue->root = NULL;
+#ifdef PAIRING_AUX_TWOPASS
+    queue->aux = NULL;
+#endif
     queue->size = 0;
 }
 
@@ -55,7 +83,14 @@ pairing_node* pq_insert( pairing_heap *queue, item_type item, key_type key )
     wrapper->key = key;
     queue->size++;
 
+#ifdef PAIRING_AUX_TWOPASS
+    if ( queue->root == NULL )
+        queue->root = wrapper;
+    else
+        push_aux( queue, wrapper );
+#else
     queue->root = merge( queue, queue->root, wrapper );
+#endif
 
     return wrapper;
 }
@@ -64,11 +99,17 @@ pairing_node* pq_find_min( pairing_heap *queue )
 {
     if ( pq_empty( queue ) )
         return NULL;
+#ifdef PAIRING_AUX_TWOPASS
+    merge_aux( queue );
+#endif
     return queue->root;
 }
 
 key_type pq_delete_min( pairing_heap *queue )
 {
+#ifdef PAIRING_AUX_TWOPASS
+    merge_aux( queue );
+#endif
     return pq_delete( queue, queue->root );
 }
 
@@ -80,6 +121,12 @@ key_type pq_delete( pairing_heap *queue, pairing_node *node )
         queue->root = collapse( queue, node->child );
     else
     {
+#ifdef PAIRING_AUX_TWOPASS
+        // the head of the auxiliary list has no predecessor
+        if ( node->prev == NULL )
+            queue->aux = node->next;
+        else
+#endif
         if ( node->prev->child == node )
             node->prev->child = node->next;
         else
@@ -88,7 +135,12 @@ key_type pq_delete( pairing_heap *queue, pairing_node *node )
         if ( node->next != NULL )
             node->next->prev = node->prev;
 
+#ifdef PAIRING_AUX_TWOPASS
+        if ( node->child != NULL )
+            push_aux( queue, collapse( queue, node->child ) );
+#else
         queue->root = merge( queue, queue->root, collapse( queue, node->child ) );
+#endif
     }
 
     pq_free_node( queue->map, 0, node );
@@ -102,6 +154,11 @@ void pq_decrease_key( pairing_heap *queue, pairing_node *node, key_type new_key
     node->key = new_key;
     if ( node == queue->root )
         return;
+#ifdef PAIRING_AUX_TWOPASS
+    // already a root in the auxiliary list
+    if ( node->prev == NULL )
+        return;
+#endif
 
     if ( node->prev->child == node )
         node->prev->child = node->next;
@@ -111,7 +168,34 @@ void pq_decrease_key( pairing_heap *queue, pairing_node *node, key_type new_key
     if ( node->next != NULL )
         node->next->prev = node->prev;
 
+#ifdef PAIRING_AUX_TWOPASS
+    push_aux( queue, node );
+#else
     queue->root = merge( queue, queue->root, node );
+#endif
+}
+
+void pq_increase_key( pairing_heap *queue, pairing_node *node,
+    key_type new_key )
+{
+    pairing_node *children;
+
+    node->key = new_key;
+    if ( node->child == NULL )
+        return;
+
+    // the node keeps its place, its children are combined and merged back
+    children = collapse( queue, node->child );
+    node->child = NULL;
+
+    if ( node == queue->root )
+        queue->root = merge( queue, node, children );
+    else
+#ifdef PAIRING_AUX_TWOPASS
+        push_aux( queue, children );
+#else
+        queue->root = merge( queue, queue->root, children );
+#endif
 }
 
 bool pq_empty( pairing_heap *queue )
@@ -119,6 +203,130 @@ bool pq_empty( pairing_heap *queue )
     return ( queue->size == 0 );
 }
 
+pq_snapshot_header* pq_serialize( pairing_heap *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    pairing_node **stack = malloc( ( queue->size + 2 ) *
+        sizeof( pairing_node* ) );
+    pairing_node *node;
+    uint32_t k = 0;
+    uint32_t top = 0;
+
+    if ( snapshot == NULL || stack == NULL )
+    {
+        free( snapshot );
+        free( stack );
+        return NULL;
+    }
+
+    // the child and next pointers form a binary tree, written in preorder
+#ifdef PAIRING_AUX_TWOPASS
+    if ( queue->aux != NULL )
+        stack[top++] = queue->aux;
+#endif
+    if ( queue->root != NULL )
+        stack[top++] = queue->root;
+    while ( top > 0 )
+    {
+        node = stack[--top];
+        entries[k].item = node->item;
+        entries[k].key = node->key;
+        entries[k].hint = 0;
+#ifdef PAIRING_AUX_TWOPASS
+        if ( node == queue->aux )
+            entries[k].hint |= SNAPSHOT_AUX;
+#endif
+        if ( node->next != NULL )
+        {
+            entries[k].hint |= SNAPSHOT_NEXT;
+            stack[top++] = node->next;
+        }
+        if ( node->child != NULL )
+        {
+            entries[k].hint |= SNAPSHOT_CHILD;
+            stack[top++] = node->child;
+        }
+        k++;
+    }
+    free( stack );
+
+    return snapshot;
+}
+
+pairing_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    pairing_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    pairing_node *node, *last, *owner;
+    pairing_node **stack;
+    uint32_t k;
+    uint32_t top = 0;
+
+    if ( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    pairing_heap *queue = pq_create( map );
+    if ( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for ( k = 0; k < snapshot->size; k++ )
+        {
+            node = pq_insert( queue, entries[k].item, entries[k].key );
+            if ( handles != NULL )
+                handles[entries[k].item] = node;
+        }
+        return queue;
+    }
+
+    // nodes on the stack still wait for their next sibling
+    stack = malloc( ( snapshot->size + 1 ) * sizeof( pairing_node* ) );
+    if ( stack == NULL )
+        exit( -1 );
+
+    last = NULL;
+    for ( k = 0; k < snapshot->size; k++ )
+    {
+        node = pq_alloc_node( map, 0 );
+        ITEM_ASSIGN( node->item, entries[k].item );
+        node->key = entries[k].key;
+        if ( handles != NULL )
+            handles[entries[k].item] = node;
+
+        if ( last == NULL )
+        {
+#ifdef PAIRING_AUX_TWOPASS
+            if ( entries[k].hint & SNAPSHOT_AUX )
+                queue->aux = node;
+            else
+#endif
+            queue->root = node;
+        }
+        else if ( entries[k-1].hint & SNAPSHOT_CHILD )
+        {
+            last->child = node;
+            node->prev = last;
+        }
+        else
+        {
+            owner = stack[--top];
+            owner->next = node;
+            node->prev = owner;
+        }
+
+        if ( entries[k].hint & SNAPSHOT_NEXT )
+            stack[top++] = node;
+        // a tree ends at a leaf with no sibling still to come
+        last = ( !( entries[k].hint & SNAPSHOT_CHILD ) && top == 0 ) ?
+            NULL : node;
+    }
+
+    free( stack );
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
@@ -167,6 +375,78 @@ static pairing_node* merge( pairing_heap *queue, pairing_node *a,
     return parent;
 }
 
+#ifdef PAIRING_MULTIPASS
+
+/**
+ * Collapses a list of nodes into a single tree with the multipass method.
+ *
+ * @param queue Queue in which to operate
+ * @param node  Head of the list to collapse
+ * @return      Root of the collapsed tree
+ */
+static pairing_node* collapse( pairing_heap *queue, pairing_node *node )
+{
+    return multipass( queue, node );
+}
+
+#elif defined PAIRING_BACK_TO_FRONT
+
+/**
+ * Performs an iterative pairwise merging of a list of nodes until a
+ * single tree remains.  The first pass pairs nodes starting from the end of
+ * the list, so the oldest children are paired first and an odd node out is
+ * the first in the list.  The second pass merges the pairs from the front.
+ *
+ * @param queue Queue in which to operate
+ * @param node  Head of the list to collapse
+ * @return      Root of the collapsed tree
+ */
+static pairing_node* collapse( pairing_heap *queue, pairing_node *node )
+{
+    pairing_node *current, *list, *a, *b, *next, *result;
+
+    if ( node == NULL )
+        return NULL;
+
+    current = node;
+    while ( current->next != NULL )
+        current = current->next;
+
+    // walk back through the list via prev, chaining the pairs through next
+    list = NULL;
+    while ( current != NULL )
+    {
+        if ( current == node )
+        {
+            current->prev = NULL;
+            current->next = list;
+            list = current;
+            break;
+        }
+
+        b = current;
+        a = b->prev;
+        next = ( a == node ) ? NULL : a->prev;
+        result = merge( queue, a, b );
+        result->next = list;
+        list = result;
+        current = next;
+    }
+
+    result = NULL;
+    while ( list != NULL )
+    {
+        next = list->next;
+        list->next = NULL;
+        result = merge( queue, result, list );
+        list = next;
+    }
+
+    return result;
+}
+
+#else
+
 /**
  * Performs an iterative pairwise merging of a list of nodes until a
  * single tree remains.  Implements the two-pass method without using
@@ -218,3 +498,79 @@ static pairing_node* collapse( pairing_heap *queue, pairing_node *node )
 
     return result;
 }
+
+#endif
+
+#if defined PAIRING_MULTIPASS || defined PAIRING_AUX_TWOPASS
+
+/**
+ * Repeatedly merges the first two trees of a list of nodes and appends the
+ * result to the end of the list until a single tree remains.
+ *
+ * @param queue Queue in which to operate
+ * @param node  Head of the list to collapse
+ * @return      Root of the collapsed tree
+ */
+static pairing_node* multipass( pairing_heap *queue, pairing_node *node )
+{
+    pairing_node *tail, *a, *b, *result;
+
+    if ( node == NULL )
+        return NULL;
+
+    tail = node;
+    while ( tail->next != NULL )
+        tail = tail->next;
+
+    while ( node != tail )
+    {
+        a = node;
+        b = a->next;
+        node = b->next;
+        result = merge( queue, a, b );
+        if ( node == NULL )
+            node = result;
+        else
+            tail->next = result;
+        tail = result;
+    }
+    node->prev = NULL;
+
+    return node;
+}
+
+#endif
+
+#ifdef PAIRING_AUX_TWOPASS
+
+/**
+ * Adds a tree to the front of the auxiliary list.
+ *
+ * @param queue Queue in which to operate
+ * @param node  Root of the tree to add
+ */
+static void push_aux( pairing_heap *queue, pairing_node *node )
+{
+    node->prev = NULL;
+    node->next = queue->aux;
+    if ( queue->aux != NULL )
+        queue->aux->prev = node;
+    queue->aux = node;
+}
+
+/**
+ * Combines the auxiliary list into a single tree with the multipass method
+ * and merges it with the root.
+ *
+ * @param queue Queue in which to operate
+ */
+static void merge_aux( pairing_heap *queue )
+{
+    if ( queue->aux == NULL )
+        return;
+
+    queue->root = merge( queue, queue->root, multipass( queue, queue->aux ) );
+    queue->aux = NULL;
+}
+
+#endif
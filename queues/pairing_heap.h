@@ -39,6 +39,19 @@ typedef pairing_node pq_node_type;
  * Handles most operations through cutting and pairwise merging.  Primarily uses
  * iteration for merging rather than the standard recursion methods (due to
  * concerns for stackframe overhead).
+ *
+ * The way children are combined after a deletion is selected at compile time:
+ *
+ * - default: pairs children front to back, then merges the pairs back to
+ *   front into a single tree (standard two-pass).
+ * - PAIRING_BACK_TO_FRONT: pairs children back to front, starting with the
+ *   oldest, then merges the pairs front to back.
+ * - PAIRING_MULTIPASS: repeatedly pairs the first two trees of the list and
+ *   appends the result to the end until a single tree remains.
+ * - PAIRING_AUX_TWOPASS: standard two-pass, but inserted and decreased nodes
+ *   are collected in an auxiliary list of roots rather than merged with the
+ *   root immediately.  The auxiliary list is combined multipass and merged
+ *   with the root on the next find-min or delete-min.
  */
 struct pairing_heap_t
 {
@@ -48,6 +61,10 @@ struct pairing_heap_t
     uint32_t size;
     //! Pointer to the minimum node in the queue
     pairing_node *root;
+#ifdef PAIRING_AUX_TWOPASS
+    //! Head of the list of trees not yet merged with the root
+    pairing_node *aux;
+#endif
 } __attribute__ ((aligned(4)));
 
 typedef struct pairing_heap_t pairing_heap;
@@ -117,7 +134,8 @@ uint32_t pq_get_size( pairing_heap *queue );
 pairing_node* pq_insert( pairing_heap *queue, item_type item, key_type key );
 
 /**
- * Returns the minimum item from the queue without modifying any data.
+ * Returns the minimum item from the queue without modifying any data.  With
+ * PAIRING_AUX_TWOPASS, first merges the auxiliary list into the root.
  *
  * @param queue Queue to query
  * @return      Node with minimum key
@@ -160,6 +178,19 @@ key_type pq_delete( pairing_heap *queue, pairing_node *node );
 void pq_decrease_key( pairing_heap *queue, pairing_node *node,
     key_type new_key );
 
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve the heap invariant
+ * given a pointer to the corresponding node.  The children of the node are
+ * combined and merged back into the heap.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( pairing_heap *queue, pairing_node *node,
+    key_type new_key );
+
 /**
  * Determines whether the queue is empty, or if it holds some items.
  *
@@ -168,4 +199,29 @@ void pq_decrease_key( pairing_heap *queue, pairing_node *node,
  */
 bool pq_empty( pairing_heap *queue );
 
+/**
+ * Writes a snapshot of the queue, every item with its key.  Nodes are written
+ * in preorder over the child and next pointers, with hints marking which of
+ * the two each node has.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( pairing_heap *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  A snapshot of the same
+ * variant is relinked into the same trees without comparing keys.  A snapshot
+ * of another queue type is restored by inserting its items one by one.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+pairing_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    pairing_node **handles );
+
 #endif
@@ -1,22 +1,27 @@
 #include "quake_heap.h"
 
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define SNAPSHOT_LAYOUT "quake"
+
 //==============================================================================
 // STATIC DECLARATIONS
 //==============================================================================
 
-static void make_root( quake_heap *queue, quake_node *node );
-static void remove_from_roots( quake_heap *queue, quake_node *node );
-static void cut( quake_heap *queue, quake_node *node );
-static quake_node* join( quake_heap *queue, quake_node *a, quake_node *b );
+static void make_root( quake_heap *queue, quake_link *node );
+static void remove_from_roots( quake_heap *queue, quake_link *node );
+static void cut( quake_heap *queue, quake_item *item );
+static quake_link* join( quake_heap *queue, quake_link *a, quake_link *b );
 static void fix_roots( quake_heap *queue );
-static bool attempt_insert( quake_heap *queue, quake_node *node );
-static void fix_min( quake_heap *queue );
+static bool attempt_insert( quake_heap *queue, quake_link *node );
 static void fix_decay( quake_heap *queue );
 static void check_decay( quake_heap *queue );
 static bool violation_exists( quake_heap *queue );
-static void prune( quake_heap *queue, quake_node *node );
-static quake_node* clone_node( quake_heap *queue, quake_node *original );
-static bool is_root( quake_heap *queue, quake_node *node );
+static void prune( quake_heap *queue, quake_link *node );
+static quake_item* leaf_of( quake_link *node );
+static bool is_root( quake_heap *queue, quake_link *node );
 
 //==============================================================================
 // PUBLIC METHODS
@@ -40,19 +45,20 @@ void pq_clear( quake_heap *queue )
 {
     mm_clear( queue->map );
     queue->minimum = NULL;
-    memset( queue->roots, 0, MAXRANK * sizeof( quake_node* ) );
+    memset( queue->roots, 0, MAXRANK * sizeof( quake_link* ) );
+    queue->registry = 0;
     memset( queue->nodes, 0, MAXRANK * sizeof( uint32_t ) );
     queue->highest_node = 0;
     queue->violation = 0;
     queue->size = 0;
 }
 
-key_type pq_get_key( quake_heap *queue, quake_node *node )
+key_type pq_get_key( quake_heap *queue, quake_item *node )
 {
     return node->key;
 }
 
-item_type* pq_get_item( quake_heap *queue, quake_node *node )
+item_type* pq_get_item( quake_heap *queue, quake_item *node )
 {
     return (item_type*) &(node->item);
 }
@@ -62,36 +68,38 @@ uint32_t pq_get_size( quake_heap *queue )
     return queue->size;
 }
 
-quake_node* pq_insert( quake_heap *queue, item_type item, key_type key )
+quake_item* pq_insert( quake_heap *queue, item_type item, key_type key )
 {
-    quake_node *wrapper = pq_alloc_node( queue->map, 0 );
+    quake_item *wrapper = pq_alloc_node( queue->map, QUAKE_ITEM );
     ITEM_ASSIGN( wrapper->item, item );
     wrapper->key = key;
-    wrapper->parent = wrapper;
+    wrapper->link.other = &( wrapper->link );
     
-    make_root( queue, wrapper );
+    make_root( queue, &( wrapper->link ) );
     queue->size++;
     (queue->nodes[0])++;
 
     return wrapper;
 }
 
-quake_node* pq_find_min( quake_heap *queue )
+quake_item* pq_find_min( quake_heap *queue )
 {
     if ( pq_empty( queue ) )
         return NULL;
-    return queue->minimum;
+    return leaf_of( queue->minimum );
 }
 
 key_type pq_delete_min( quake_heap *queue )
 {
-    return pq_delete( queue, queue->minimum );
+    return pq_delete( queue, leaf_of( queue->minimum ) );
 }
 
-key_type pq_delete( quake_heap *queue, quake_node *node )
+key_type pq_delete( quake_heap *queue, quake_item *node )
 {
     key_type key = node->key;
     cut( queue, node );
+    (queue->nodes[0])--;
+    pq_free_node( queue->map, QUAKE_ITEM, node );
 
     fix_roots( queue );
     fix_decay( queue );
@@ -101,29 +109,46 @@ key_type pq_delete( quake_heap *queue, quake_node *node )
     return key;
 }
 
-void pq_decrease_key( quake_heap *queue, quake_node *node, key_type new_key )
+void pq_decrease_key( quake_heap *queue, quake_item *node, key_type new_key )
 {
+    quake_link *top = node->link.other;
+    quake_node *parent;
+
     node->key = new_key;
-    if ( is_root( queue, node ) )
+    if ( is_root( queue, top ) )
     {
-        if ( node->key < queue->minimum->key )
-            queue->minimum = node;
+        if ( new_key < leaf_of( queue->minimum )->key )
+            queue->minimum = top;
     }
     else
     {
-        if ( node->parent->left == node )
-            node->parent->left = NULL;
+        parent = (quake_node*) top->parent;
+        if ( parent->left == top )
+            parent->left = NULL;
         else
-            node->parent->right = NULL;
+            parent->right = NULL;
 
-        make_root( queue, node );
+        make_root( queue, top );
     }
 }
 
+void pq_increase_key( quake_heap *queue, quake_item *node, key_type new_key )
+{
+    // the item loses all its tournament wins and restarts as a lone root
+    cut( queue, node );
+    node->key = new_key;
+    node->height = 0;
+    node->link.other = &( node->link );
+    make_root( queue, &( node->link ) );
+
+    fix_roots( queue );
+    fix_decay( queue );
+}
+
 quake_heap* pq_meld( quake_heap *a, quake_heap *b )
 {
     quake_heap *result, *trash;
-    quake_node *temp;
+    quake_link *temp;
     
     if( a->size >= b->size )
     {
@@ -154,6 +179,76 @@ bool pq_empty( quake_heap *queue )
     return ( queue->size == 0 );
 }
 
+pq_snapshot_header* pq_serialize( quake_heap *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    quake_link **stack = malloc( ( queue->size + 1 ) * sizeof( quake_link* ) );
+    quake_link *root, *node;
+    quake_item *leaf;
+    uint32_t k = 0;
+    uint32_t top = 0;
+
+    if ( snapshot == NULL || stack == NULL )
+    {
+        free( snapshot );
+        free( stack );
+        return NULL;
+    }
+
+    // every item is carried highest by a root or a right child, and reaches
+    // its leaf down the left spine below it
+    root = queue->minimum;
+    while ( root != NULL )
+    {
+        stack[top++] = root;
+        while ( top > 0 )
+        {
+            node = stack[--top];
+            leaf = leaf_of( node );
+            while ( node != (quake_link*) leaf )
+            {
+                if ( ( (quake_node*) node )->right != NULL )
+                    stack[top++] = ( (quake_node*) node )->right;
+                node = ( (quake_node*) node )->left;
+            }
+            entries[k].item = leaf->item;
+            entries[k].key = leaf->key;
+            entries[k].hint = 0;
+            k++;
+        }
+        root = root->parent;
+        if ( root == queue->minimum )
+            root = NULL;
+    }
+    free( stack );
+
+    return snapshot;
+}
+
+quake_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    quake_item **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    quake_item *item;
+    uint32_t k;
+
+    if ( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    // an insertion only adds a root, as cheap as relinking the leaf
+    quake_heap *queue = pq_create( map );
+    for ( k = 0; k < snapshot->size; k++ )
+    {
+        item = pq_insert( queue, entries[k].item, entries[k].key );
+        if ( handles != NULL )
+            handles[entries[k].item] = item;
+    }
+
+    return queue;
+}
+
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
@@ -164,7 +259,7 @@ bool pq_empty( quake_heap *queue )
  * @param queue Queue in which to operate
  * @param node  Node to make a new root
  */
-static void make_root( quake_heap *queue, quake_node* node )
+static void make_root( quake_heap *queue, quake_link *node )
 {
     if ( node == NULL )
         return;
@@ -178,7 +273,7 @@ static void make_root( quake_heap *queue, quake_node* node )
     {
         node->parent = queue->minimum->parent;
         queue->minimum->parent = node;
-        if ( node->key < queue->minimum->key )
+        if ( leaf_of( node )->key < leaf_of( queue->minimum )->key )
             queue->minimum = node;
     }
 }
@@ -189,9 +284,9 @@ static void make_root( quake_heap *queue, quake_node* node )
  * @param queue Queue the node belongs to
  * @param node  Node to remove
  */
-static void remove_from_roots( quake_heap *queue, quake_node *node )
+static void remove_from_roots( quake_heap *queue, quake_link *node )
 {
-    quake_node *current = node->parent;
+    quake_link *current = node->parent;
     while ( current->parent != node )
         current = current->parent;
     if ( current == node )
@@ -205,95 +300,104 @@ static void remove_from_roots( quake_heap *queue, quake_node *node )
 }
 
 /**
- * Removes the node from the structure.  Recurses down through the left
- * child, which contains the same item, separating the right subtrees, making
- * the right child a new root.
+ * Removes an item from the structure.  Detaches the highest node carrying
+ * the item, then walks down the chain of left children, which carry the same
+ * item, making each right child a new root and freeing the chain down to
+ * the leaf.  The leaf itself is left to the caller.
  *
- * @param queue Queue the node belongs to
- * @param node  Node to remove
+ * @param queue Queue the item belongs to
+ * @param item  Item to remove
  */
-static void cut( quake_heap *queue, quake_node *node )
+static void cut( quake_heap *queue, quake_item *item )
 {
-    if ( node == NULL )
-        return;
+    quake_link *current = item->link.other;
+    quake_node *node;
+    uint32_t height = item->height;
 
-    if ( is_root( queue, node ) )
-        remove_from_roots( queue, node );
+    if ( is_root( queue, current ) )
+        remove_from_roots( queue, current );
     else
+        ( (quake_node*) current->parent )->right = NULL;
+
+    while ( height > 0 )
     {
-        if ( node->parent->left == node )
-            node->parent->left = NULL;
-        else if ( node->parent->right == node )
-            node->parent->right = NULL;
-    }
-        
-    cut( queue, node->left );
-    make_root( queue, node->right );
+        node = (quake_node*) current;
+        make_root( queue, node->right );
+        current = node->left;
 
-    (queue->nodes[node->height])--;
-    pq_free_node( queue->map, 0, node );
+        (queue->nodes[height])--;
+        pq_free_node( queue->map, QUAKE_NODE, node );
+        height--;
+    }
 }
 
 /**
- * Links two trees, making the larger-key tree the child of the lesser.
- * Creates a duplicate node to take the larger-key root's place.
- * Promotes the larger-key root as the new root of the joined tree.
+ * Links two trees of equal height under a new internal node.  The
+ * lesser-key root becomes the left child and its item is carried up to
+ * the new node, the larger-key root becomes the right child.
  *
  * @param queue Queue in which to operate
  * @param a     First node
  * @param b     Second node
  * @return      Returns the resulting tree
  */
-static quake_node* join( quake_heap *queue, quake_node *a, quake_node *b )
+static quake_link* join( quake_heap *queue, quake_link *a, quake_link *b )
 {
-    quake_node *parent, *child, *duplicate;
+    quake_link *winner, *loser;
+    quake_item *leaf_a = leaf_of( a );
+    quake_item *leaf_b = leaf_of( b );
+    quake_item *leaf;
+    quake_node *node;
 
-    if ( b->key < a->key )
+    if ( leaf_b->key < leaf_a->key )
     {
-        parent = b;
-        child = a;
+        winner = b;
+        loser = a;
+        leaf = leaf_b;
     }
     else
     {
-        parent = a;
-        child = b;
+        winner = a;
+        loser = b;
+        leaf = leaf_a;
     }
 
-    duplicate = clone_node( queue, parent );
-    if ( duplicate->left != NULL )
-        duplicate->left->parent = duplicate;
-    if ( duplicate->right != NULL )
-        duplicate->right->parent = duplicate;
+    node = pq_alloc_node( queue->map, QUAKE_NODE );
+    node->link.other = &( leaf->link );
+    node->left = winner;
+    node->right = loser;
+    winner->parent = &( node->link );
+    loser->parent = &( node->link );
 
-    duplicate->parent = parent;
-    child->parent = parent;
+    leaf->link.other = &( node->link );
+    leaf->height++;
+    (queue->nodes[leaf->height])++;
 
-    parent->parent = NULL;
-    parent->left = duplicate;
-    parent->right = child;
-
-    parent->height++;
-    (queue->nodes[parent->height])++;
-
-    return parent;
+    return &( node->link );
 }
 
 /**
  * Performs an iterative linking on the list of roots until no two trees
- * of the same height remain.
+ * of the same height remain, then selects the new minimum.  The roots array
+ * is left filled for fix_decay.
  *
  * @param queue Queue whose roots to fix
  */
 static void fix_roots( quake_heap *queue )
 {
-    quake_node *current, *next, *tail, *head, *joined;
-    uint32_t i, height;
+    quake_link *current, *next, *tail, *head, *joined;
+    uint32_t height;
+    uint64_t registry;
 
     if ( queue->minimum == NULL )
         return;
 
-    for ( i = 0; i <= queue->highest_node; i++ )
-        queue->roots[i] = NULL;
+    while ( queue->registry )
+    {
+        height = REGISTRY_LEADER( queue->registry );
+        REGISTRY_UNSET( queue->registry, height );
+        queue->roots[height] = NULL;
+    }
     queue->highest_node = 0;
 
     current = queue->minimum->parent;
@@ -306,7 +410,7 @@ static void fix_roots( quake_heap *queue )
         current->parent = NULL;
         if ( !attempt_insert( queue, current ) )
         {
-            height = current->height;
+            height = leaf_of( current )->height;
             joined = join( queue, current, queue->roots[height] );
             if ( current == tail )
             {
@@ -319,32 +423,35 @@ static void fix_roots( quake_heap *queue )
                 tail = tail->parent;
             }
             queue->roots[height] = NULL;
+            REGISTRY_UNSET( queue->registry, height );
         }
         current = next;
     }
 
+    // visit only occupied heights
     head = NULL;
     tail = NULL;
-    for ( i = 0; i <= queue->highest_node; i++ )
+    registry = queue->registry;
+    while ( registry )
     {
-        if ( queue->roots[i] != NULL )
+        height = REGISTRY_LEADER( registry );
+        REGISTRY_UNSET( registry, height );
+        current = queue->roots[height];
+        if ( head == NULL )
         {
-            if ( head == NULL )
-            {
-                head = queue->roots[i];
-                tail = queue->roots[i];
-            }
-            else
-            {
-                tail->parent = queue->roots[i];
-                tail = tail->parent;
-            }
+            head = current;
+            tail = current;
+            queue->minimum = current;
+        }
+        else
+        {
+            tail->parent = current;
+            tail = tail->parent;
+            if ( leaf_of( current )->key < leaf_of( queue->minimum )->key )
+                queue->minimum = current;
         }
     }
     tail->parent = head;
-
-    queue->minimum = head;
-    fix_min( queue );
 }
 
 /**
@@ -356,54 +463,56 @@ static void fix_roots( quake_heap *queue )
  * @param node  Node to insert
  * @return      True if inserted, false if not
  */
-static bool attempt_insert( quake_heap *queue, quake_node *node )
+static bool attempt_insert( quake_heap *queue, quake_link *node )
 {
-    uint32_t height = node->height;
+    uint32_t height = leaf_of( node )->height;
     if ( ( queue->roots[height] != NULL ) && ( queue->roots[height] != node ) )
         return FALSE;
 
     if ( height > queue->highest_node )
         queue->highest_node = height;
     queue->roots[height] = node;
+    REGISTRY_SET( queue->registry, height );
 
     return TRUE;
 }
 
-/**
- * Scans through the roots list starting from the current, potentially
- * inaccurate, minimum to find the tree with the minimum-value
- * root.
- * 
- * @param queue Queue to fix
- */
-static void fix_min( quake_heap *queue )
-{
-    quake_node *start = queue->minimum;
-    quake_node *current = queue->minimum->parent;
-    while ( current != start )
-    {
-        if ( current->key < queue->minimum->key )
-            queue->minimum = current;
-        current = current->parent;
-    }
-}
-
 /**
  * If a decay violation exists, this will remove all nodes of height
- * greater than or equal to the first violation.
+ * greater than or equal to the first violation.  The trees below the
+ * violation are relinked as the new list of roots and the others are
+ * pruned into it.
  * 
  * @param queue Queue to fix
  */
 static void fix_decay( quake_heap *queue )
 {
-    uint32_t i;
+    uint32_t height;
+    uint64_t mask, registry;
     check_decay( queue );
-    if ( violation_exists( queue ) )
+    if ( !violation_exists( queue ) )
+        return;
+
+    // nothing to do unless some tree reaches the violation
+    mask = ~( (uint64_t) 0 ) << queue->violation;
+    if ( queue->registry & mask )
     {
-        for ( i = queue->violation; i < MAXRANK; i++ )
+        queue->minimum = NULL;
+        registry = queue->registry & ~mask;
+        while ( registry )
         {
-            if ( queue->roots[i] != NULL )
-                prune( queue, queue->roots[i] );
+            height = REGISTRY_LEADER( registry );
+            REGISTRY_UNSET( registry, height );
+            make_root( queue, queue->roots[height] );
+        }
+
+        // only the occupied heights at or above the violation
+        registry = queue->registry & mask;
+        while ( registry )
+        {
+            height = REGISTRY_LEADER( registry );
+            REGISTRY_UNSET( registry, height );
+            prune( queue, queue->roots[height] );
         }
     }
 }
@@ -437,76 +546,66 @@ static bool violation_exists( quake_heap *queue )
 }
 
 /**
- * If the current node is higher than the violation, this function
- * rotates the current node down into the place of it's duplicate, and
- * deletes the duplicate.  Then it recurses on itself and its old
- * non-duplicate child.
+ * Takes a tree that is no longer linked into the list of roots.  While its
+ * root is at or above the violation, frees the root, hands the item down
+ * to the left child and prunes the right subtree.  Makes whatever remains a
+ * new root.
  *
  * @param queue Queue to fix
- * @param node  Node to check and prune
+ * @param node  Root of the tree to prune
  */
-static void prune( quake_heap *queue, quake_node *node )
+static void prune( quake_heap *queue, quake_link *node )
 {
-    quake_node *duplicate, *child;
+    quake_item *leaf;
+    quake_node *top;
 
     if ( node == NULL )
         return;
 
-    if ( node->height < queue->violation )
+    leaf = leaf_of( node );
+    while ( leaf->height >= queue->violation )
     {
-        if ( !is_root( queue, node ) )
-            make_root( queue, node );
-            
-        return;
+        top = (quake_node*) node;
+        prune( queue, top->right );
+
+        node = top->left;
+        leaf->link.other = node;
+        (queue->nodes[leaf->height])--;
+        leaf->height--;
+        pq_free_node( queue->map, QUAKE_NODE, top );
     }
 
-    duplicate = node->left;
-    child = node->right;
-
-    prune( queue, child );        
-
-    node->left = duplicate->left;
-    if ( node->left != NULL )
-        node->left->parent = node;
-    node->right = duplicate->right;
-    if ( node->right != NULL )
-        node->right->parent = node;
-    (queue->nodes[node->height])--;
-    node->height--;
-    pq_free_node( queue->map, 0, duplicate );
-
-    prune( queue, node );
+    make_root( queue, node );
 }
 
 /**
- * Copies internal data of another node for purposes of tournament resolution.
+ * Finds the leaf of the item carried by a node.  Only valid for internal
+ * nodes and for leaves that are the highest node of their item, which
+ * covers roots and right children.
  *
- * @param queue     Queue to which node belongs
- * @param original  Node to copy data from
- * @return          Copy of the new node
+ * @param node  Node to query
+ * @return      Leaf carrying the node's item
  */
-static quake_node* clone_node( quake_heap *queue, quake_node *original )
+static quake_item* leaf_of( quake_link *node )
 {
-    quake_node *clone = pq_alloc_node( queue->map, 0 );
-        
-    ITEM_ASSIGN( clone->item, original->item );
-    clone->key = original->key;
-    clone->height = original->height;
-    clone->left = original->left;
-    clone->right = original->right;
-
-    return clone;
+    if ( node->other == node )
+        return (quake_item*) node;
+    return (quake_item*) node->other;
 }
 
 /**
- * Determines whether this node is a root
+ * Determines whether this node is a root.  The parent of a root is the next
+ * root, and only internal nodes can have children.
  *
  * @param queue Queue in which node resides
  * @param node  Node to query
  * @return      True if root, false otherwise
  */
-static bool is_root( quake_heap *queue, quake_node *node )
+static bool is_root( quake_heap *queue, quake_link *node )
 {
-    return ( ( node->parent->left != node ) &&
-        ( node->parent->right != node ) );
+    quake_link *parent = node->parent;
+    if ( parent->other == parent )
+        return TRUE;
+    return ( ( ( (quake_node*) parent )->left != node ) &&
+        ( ( (quake_node*) parent )->right != node ) );
 }
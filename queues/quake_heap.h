@@ -7,32 +7,67 @@
 
 #include "queue_common.h"
 
+// node types for memory map allocation, leaves and internal nodes are
+// pooled separately
+#define QUAKE_ITEM  0
+#define QUAKE_NODE  1
+
+/**
+ * Part shared by leaves and internal tournament nodes, embedded at the start
+ * of both.  Links the node to its parent in the tournament tree, or to the
+ * next root if the node is a root.  The second pointer leads from an internal
+ * node to the leaf whose item it carries, and from a leaf to the highest node
+ * carrying its item, which is the leaf itself at height zero.  A root or right
+ * child is therefore a leaf exactly when it points to itself.
+ */
+struct quake_link_t
+{
+    //! Parent node, or next root if this node is a root
+    struct quake_link_t *parent;
+    //! Leaf for an internal node, highest node carrying the item for a leaf
+    struct quake_link_t *other;
+};
+
+typedef struct quake_link_t quake_link;
+
 /**
- * Holds an inserted element, as well as pointers to maintain tree
- * structure.  Acts as a handle to clients for the purpose of
- * mutability.  Keeps track of the height of the node as well as pointer
- * to the node's parent, left child (duplicate), and right child.
+ * Internal tournament node.  Refers to the winning item through its leaf
+ * rather than holding a copy of the key, and takes its height from the
+ * leaf when it is the highest node for that item.  Lives in its own pool,
+ * separate from the leaves.
  */
 struct quake_node_t
 {
-    //! Parent node
-    struct quake_node_t *parent;
-    //! Left child
-    struct quake_node_t *left;
-    //! Right child, or next root if this node is a root
-    struct quake_node_t *right;
+    //! Parent and leaf links
+    quake_link link;
+    //! Left child, carrying the same item as this node
+    quake_link *left;
+    //! Right child, the loser of the link that created this node
+    quake_link *right;
+};
 
-    //! The height of this node
-    uint8_t height;
+typedef struct quake_node_t quake_node;
+
+/**
+ * Leaf item record.  Holds an inserted element and acts as a handle to
+ * clients for the purpose of mutability.  Keeps track of the height of the
+ * highest node carrying the element.
+ */
+struct quake_item_t
+{
+    //! Parent link, and link to the highest node carrying this item
+    quake_link link;
 
-    //! Pointer to a piece of client data
-    item_type item;
     //! Key for the item
     key_type key;
-} __attribute__ ((aligned(4)));
+    //! Pointer to a piece of client data
+    item_type item;
+    //! Height of the highest node carrying this item
+    uint32_t height;
+};
 
-typedef struct quake_node_t quake_node;
-typedef quake_node pq_node_type;
+typedef struct quake_item_t quake_item;
+typedef quake_item pq_node_type;
 
 /**
  * A mutable, meldable, Quake heap.  Maintains a forest of (binary) tournament
@@ -45,10 +80,12 @@ struct quake_heap_t
     mem_map *map;
     //! The number of items held in the queue
     uint32_t size;
-    //! Pointer to the minimum node in the queue
-    quake_node *minimum;
+    //! Pointer to the minimum root in the queue
+    quake_link *minimum;
     //! An array of roots of the queue, indexed by height
-    quake_node *roots[MAXRANK];
+    quake_link *roots[MAXRANK];
+    //! A registry to keep track of non-null entries in roots
+    uint64_t registry;
     //! An array of counters corresponding to the number of nodes at height
     //! equal to the index
     uint32_t nodes[MAXRANK];
@@ -94,7 +131,7 @@ void pq_clear( quake_heap *queue );
  * @param node  Node to query
  * @return      Node's key
  */
-key_type pq_get_key( quake_heap *queue, quake_node *node );
+key_type pq_get_key( quake_heap *queue, quake_item *node );
 
 /**
  * Returns the item associated with the queried node.
@@ -103,7 +140,7 @@ key_type pq_get_key( quake_heap *queue, quake_node *node );
  * @param node  Node to query
  * @return      Node's item
  */
-item_type* pq_get_item( quake_heap *queue, quake_node *node );
+item_type* pq_get_item( quake_heap *queue, quake_item *node );
 
 /**
  * Returns the current size of the queue.
@@ -122,7 +159,7 @@ uint32_t pq_get_size( quake_heap *queue );
  * @param key   Key to use for node priority
  * @return      Pointer to corresponding node
  */
-quake_node* pq_insert( quake_heap *queue, item_type item, key_type key );
+quake_item* pq_insert( quake_heap *queue, item_type item, key_type key );
 
 /**
  * Returns the minimum item from the queue.
@@ -130,7 +167,7 @@ quake_node* pq_insert( quake_heap *queue, item_type item, key_type key );
  * @param queue Queue to query
  * @return      Node with minimum key
  */
-quake_node* pq_find_min( quake_heap *queue );
+quake_item* pq_find_min( quake_heap *queue );
 
 /**
  * Removes the minimum item from the queue and returns it, restructuring
@@ -153,19 +190,32 @@ key_type pq_delete_min( quake_heap *queue );
  * @param node  Pointer to node corresponding to the item to remove
  * @return      Key of item removed
  */
-key_type pq_delete( quake_heap *queue, quake_node *node );
+key_type pq_delete( quake_heap *queue, quake_item *node );
 
 /**
  * If the item in the queue is modified in such a way to decrease the
  * key, then this function will update the queue to preserve queue
  * properties given a pointer to the corresponding node.  Removes the
- * subtree rooted at the given node and makes it a new tree in the queue.
+ * subtree rooted at the highest node carrying the item and makes it a new
+ * tree in the queue.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_decrease_key( quake_heap *queue, quake_item *node, key_type new_key );
+
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve the heap invariant
+ * given a pointer to the corresponding node.  Removes every internal node
+ * carrying the item and makes its leaf a new tree in the queue.
  *
  * @param queue     Queue in which the node resides
  * @param node      Node to change
  * @param new_key   New key to use for the given node
  */
-void pq_decrease_key( quake_heap *queue, quake_node *node, key_type new_key );
+void pq_increase_key( quake_heap *queue, quake_item *node, key_type new_key );
 
 /**
  * Combines two different item-disjoint queues which share a memory map.
@@ -186,5 +236,30 @@ quake_heap* pq_meld( quake_heap *a, quake_heap *b );
  */
 bool pq_empty( quake_heap *queue );
 
+/**
+ * Writes a snapshot of the queue, every item with its key.  Each item is
+ * written from its leaf, found down the left spine of the highest node
+ * carrying it.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( quake_heap *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  The items are always
+ * inserted one by one: an insertion only adds a leaf as a new root, so it
+ * costs about as much as relinking the leaf would.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+quake_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    quake_item **handles );
+
 #endif
 
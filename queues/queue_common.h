@@ -43,5 +43,92 @@ typedef uint32_t bool;
 #define REGISTRY_SET(a,b)   ( a |= ( ( (uint64_t) 1 ) << b ) )
 #define REGISTRY_UNSET(a,b) ( a &= ~( ( (uint64_t) 1 ) << b ) )
 #define REGISTRY_LEADER(a)  ( (uint32_t) __builtin_ctzll( a ) )
+#define REGISTRY_LAST(a)    ( (uint32_t) ( 63 - __builtin_clzll( a ) ) )
+
+//==============================================================================
+// SNAPSHOTS
+//==============================================================================
+
+#define PQ_SNAPSHOT_MAGIC   0x53535150
+#define PQ_SNAPSHOT_LAYOUT  24
+
+/**
+ * Starts a snapshot written by pq_serialize.  The header is followed by size
+ * entries, one per item, and by word_count words of queue-wide hints.  The
+ * layout names the queue type and variant that wrote the snapshot; only a
+ * queue of the same layout interprets the order of the entries, their hints
+ * and the words, while any other queue just inserts the items.
+ */
+struct pq_snapshot_header_t
+{
+    uint32_t magic;
+    char layout[PQ_SNAPSHOT_LAYOUT];
+    //! The number of entries
+    uint32_t size;
+    //! The number of hint words after the entries
+    uint32_t word_count;
+} __attribute__ ((packed, aligned(4)));
+
+typedef struct pq_snapshot_header_t pq_snapshot_header;
+
+/**
+ * An item of a snapshot.  The hint holds whatever structure the queue needs
+ * to relink the node directly, such as its rank or which pointers it has.
+ */
+struct pq_snapshot_entry_t
+{
+    item_type item;
+    key_type key;
+    uint32_t hint;
+} __attribute__ ((packed, aligned(4)));
+
+typedef struct pq_snapshot_entry_t pq_snapshot_entry;
+
+#define SNAPSHOT_ENTRIES(s) ( (pq_snapshot_entry*) ( (s) + 1 ) )
+#define SNAPSHOT_WORDS(s)   ( (key_type*) ( SNAPSHOT_ENTRIES(s) + (s)->size ) )
+
+// layout names with a compile time number, e.g. "implicit_" SNAPSHOT_NUMBER(4)
+#define SNAPSHOT_STRING(a)  #a
+#define SNAPSHOT_NUMBER(a)  SNAPSHOT_STRING(a)
+
+/**
+ * Allocates a snapshot and fills in its header.
+ *
+ * @param layout        Queue type and variant writing the snapshot
+ * @param size          The number of entries
+ * @param word_count    The number of hint words
+ * @param length        Output length of the snapshot in bytes
+ * @return              The snapshot, NULL on failure
+ */
+static inline pq_snapshot_header* pq_snapshot_create( const char *layout,
+    uint32_t size, uint32_t word_count, size_t *length )
+{
+    *length = sizeof( pq_snapshot_header ) + size *
+        sizeof( pq_snapshot_entry ) + word_count * sizeof( key_type );
+    pq_snapshot_header *snapshot = (pq_snapshot_header*) malloc( *length );
+    if( snapshot == NULL )
+        return NULL;
+
+    snapshot->magic = PQ_SNAPSHOT_MAGIC;
+    strncpy( snapshot->layout, layout, PQ_SNAPSHOT_LAYOUT );
+    snapshot->size = size;
+    snapshot->word_count = word_count;
+
+    return snapshot;
+}
+
+/**
+ * Checks whether a snapshot was written by the given queue type and variant,
+ * so that its structure can be restored directly.
+ *
+ * @param snapshot  Snapshot to check
+ * @param layout    Queue type and variant reading the snapshot
+ * @return          True if the layouts match
+ */
+static inline bool pq_snapshot_matches( pq_snapshot_header *snapshot,
+    const char *layout )
+{
+    return ( strncmp( snapshot->layout, layout, PQ_SNAPSHOT_LAYOUT ) == 0 );
+}
 
 #endif
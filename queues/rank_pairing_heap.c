@@ -1,5 +1,18 @@
 #include "rank_pairing_heap.h"
 
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#ifdef USE_TYPE_1
+    #define SNAPSHOT_LAYOUT "rank_pairing_t1"
+#else
+    #define SNAPSHOT_LAYOUT "rank_pairing_t2"
+#endif
+#define SNAPSHOT_LEFT   1
+#define SNAPSHOT_RIGHT  2
+#define SNAPSHOT_RANK   2
+
 //==============================================================================
 // STATIC DECLARATIONS
 //==============================================================================
@@ -14,13 +27,13 @@ static rank_pairing_node* join( rank_pairing_heap *queue, rank_pairing_node *a,
     rank_pairing_node *b );
 static void fix_roots( rank_pairing_heap *queue );
 static bool attempt_insert( rank_pairing_heap *queue, rank_pairing_node *node );
-static void fix_min( rank_pairing_heap *queue );
 static void propagate_ranks_t1( rank_pairing_heap *queue,
     rank_pairing_node *node );
 static void propagate_ranks_t2( rank_pairing_heap *queue,
     rank_pairing_node *node );
 static rank_pairing_node* sever_spine( rank_pairing_heap *queue,
     rank_pairing_node *node );
+static void extract_node( rank_pairing_heap *queue, rank_pairing_node *node );
 
 //==============================================================================
 // PUBLIC METHODS
@@ -45,7 +58,7 @@ void pq_clear( rank_pairing_heap *queue )
     mm_clear( queue->map );
     queue->minimum = NULL;
     memset( queue->roots, 0, MAXRANK * sizeof( rank_pairing_node* ) );
-    queue->largest_rank = 0;
+    queue->registry = 0;
     queue->size = 0;
 }
 
@@ -94,41 +107,9 @@ key_type pq_delete_min( rank_pairing_heap *queue )
 
 key_type pq_delete( rank_pairing_heap *queue, rank_pairing_node *node )
 {
-    rank_pairing_node *old_min, *left_list, *right_list, *full_list, *current;
     key_type key = node->key;
 
-    if ( node->parent != NULL )
-    {
-        if ( node->parent->right == node )
-            node->parent->right = NULL;
-        else
-            node->parent->left = NULL;
-    }
-    else
-    {
-        current = node;
-        while ( current->right != node )
-            current = current->right;
-        current->right = node->right;
-    }
-
-    left_list = ( node->left != NULL ) ? sever_spine( queue, node->left ) : NULL;
-    right_list = ( ( node->parent != NULL ) && ( node->right != NULL ) ) ?
-        sever_spine( queue, node->right ) : NULL;
-    merge_lists( queue, left_list, right_list );
-    full_list = pick_min( queue, left_list, right_list );
-
-    if ( queue->minimum == node )
-        queue->minimum = ( node->right == node ) ? full_list : node->right;
-
-    // in order to guarantee linking complies with analysis we save the
-    // original minimum so that we perform a one-pass link on the new
-    // trees before we do general multi-pass linking
-    old_min = queue->minimum;
-    merge_roots( queue, queue->minimum, full_list );
-    queue->minimum = old_min;
-    fix_roots( queue );
-
+    extract_node( queue, node );
     pq_free_node( queue->map, 0, node );
     queue->size--;
 
@@ -167,11 +148,137 @@ void pq_decrease_key( rank_pairing_heap *queue, rank_pairing_node *node,
     }
 }
 
+void pq_increase_key( rank_pairing_heap *queue, rank_pairing_node *node,
+    key_type new_key )
+{
+    // take the node out as in a delete and reinsert it as a fresh singleton
+    extract_node( queue, node );
+    node->key = new_key;
+    node->rank = 0;
+    node->parent = NULL;
+    node->left = NULL;
+    node->right = node;
+    merge_roots( queue, queue->minimum, node );
+}
+
 bool pq_empty( rank_pairing_heap *queue )
 {
     return ( queue->size == 0 );
 }
 
+pq_snapshot_header* pq_serialize( rank_pairing_heap *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    rank_pairing_node **stack = malloc( ( queue->size + 1 ) *
+        sizeof( rank_pairing_node* ) );
+    rank_pairing_node *node;
+    uint32_t k = 0;
+    uint32_t top = 0;
+
+    if ( snapshot == NULL || stack == NULL )
+    {
+        free( snapshot );
+        free( stack );
+        return NULL;
+    }
+
+    // the half-trees are written in preorder, starting from the minimum and
+    // following the root list as far as it wraps around
+    if ( queue->minimum != NULL )
+        stack[top++] = queue->minimum;
+    while ( top > 0 )
+    {
+        node = stack[--top];
+        entries[k].item = node->item;
+        entries[k].key = node->key;
+        entries[k].hint = node->rank << SNAPSHOT_RANK;
+        if ( node->right != NULL && node->right != queue->minimum )
+        {
+            entries[k].hint |= SNAPSHOT_RIGHT;
+            stack[top++] = node->right;
+        }
+        if ( node->left != NULL )
+        {
+            entries[k].hint |= SNAPSHOT_LEFT;
+            stack[top++] = node->left;
+        }
+        k++;
+    }
+    free( stack );
+
+    return snapshot;
+}
+
+rank_pairing_heap* pq_deserialize( mem_map *map,
+    pq_snapshot_header *snapshot, rank_pairing_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    rank_pairing_node *node, *last, *owner;
+    rank_pairing_node **stack;
+    uint32_t k;
+    uint32_t top = 0;
+
+    if ( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    rank_pairing_heap *queue = pq_create( map );
+    if ( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for ( k = 0; k < snapshot->size; k++ )
+        {
+            node = pq_insert( queue, entries[k].item, entries[k].key );
+            if ( handles != NULL )
+                handles[entries[k].item] = node;
+        }
+        return queue;
+    }
+
+    // nodes on the stack still wait for their right pointer
+    stack = malloc( ( snapshot->size + 1 ) * sizeof( rank_pairing_node* ) );
+    if ( stack == NULL )
+        exit( -1 );
+
+    last = NULL;
+    for ( k = 0; k < snapshot->size; k++ )
+    {
+        node = pq_alloc_node( map, 0 );
+        ITEM_ASSIGN( node->item, entries[k].item );
+        node->key = entries[k].key;
+        node->rank = entries[k].hint >> SNAPSHOT_RANK;
+        if ( handles != NULL )
+            handles[entries[k].item] = node;
+
+        if ( last == NULL )
+            queue->minimum = node;
+        else if ( entries[k-1].hint & SNAPSHOT_LEFT )
+        {
+            last->left = node;
+            node->parent = last;
+        }
+        else
+        {
+            // only roots lack a parent, and the next root has none either
+            owner = stack[--top];
+            owner->right = node;
+            if ( owner->parent != NULL )
+                node->parent = owner;
+        }
+
+        if ( entries[k].hint & SNAPSHOT_RIGHT )
+            stack[top++] = node;
+        else if ( node->parent == NULL )
+            node->right = queue->minimum;
+        last = node;
+    }
+
+    free( stack );
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
@@ -280,7 +387,7 @@ static rank_pairing_node* join( rank_pairing_heap *queue, rank_pairing_node *a,
 
 /**
  * Performs a one-pass linking run through the list of roots.  Links
- * trees of equal ranks.
+ * trees of equal ranks and selects the new minimum along the way.
  *
  * @param queue Queue whose roots to fix
  */
@@ -288,14 +395,13 @@ static void fix_roots( rank_pairing_heap *queue )
 {
     rank_pairing_node *output_head = NULL;
     rank_pairing_node *output_tail = NULL;
+    rank_pairing_node *min = NULL;
     rank_pairing_node *current, *next, *joined;
-    uint32_t i, rank;
+    uint32_t rank;
 
     if ( queue->minimum == NULL )
         return;
 
-    queue->largest_rank = 0;
-
     current = queue->minimum->right;
     queue->minimum->right = NULL;
     while ( current != NULL ) {
@@ -306,33 +412,48 @@ static void fix_roots( rank_pairing_heap *queue )
             // keep a running list of joined trees
             joined = join( queue, current, queue->roots[rank] );
             if ( output_head == NULL )
+            {
                 output_head = joined;
+                min = joined;
+            }
             else
+            {
                 output_tail->right = joined;
+                if ( joined->key < min->key )
+                    min = joined;
+            }
             output_tail = joined;
             queue->roots[rank] = NULL;
+            REGISTRY_UNSET( queue->registry, rank );
         }
         current = next;
     }
 
-    // move the untouched trees to the list and repair pointers
-    for ( i = 0; i <= queue->largest_rank; i++ )
+    // move the untouched trees to the list and repair pointers, visiting only
+    // occupied ranks
+    while ( queue->registry )
     {
-        if ( queue->roots[i] != NULL )
+        rank = REGISTRY_LEADER( queue->registry );
+        REGISTRY_UNSET( queue->registry, rank );
+        current = queue->roots[rank];
+        if ( output_head == NULL )
         {
-            if ( output_head == NULL )
-                output_head = queue->roots[i];
-            else
-                output_tail->right = queue->roots[i];
-            output_tail = queue->roots[i];
-            queue->roots[i] = NULL;
+            output_head = current;
+            min = current;
         }
+        else
+        {
+            output_tail->right = current;
+            if ( current->key < min->key )
+                min = current;
+        }
+        output_tail = current;
+        queue->roots[rank] = NULL;
     }
 
     output_tail->right = output_head;
 
-    queue->minimum = output_head;
-    fix_min( queue );
+    queue->minimum = min;
 }
 
 /**
@@ -349,34 +470,11 @@ static bool attempt_insert( rank_pairing_heap *queue, rank_pairing_node *node )
     if ( ( queue->roots[rank] != NULL ) && ( queue->roots[rank] != node ) )
         return FALSE;
     queue->roots[rank] = node;
-
-    if ( rank > queue->largest_rank )
-        queue->largest_rank = rank;
+    REGISTRY_SET( queue->registry, rank );
 
     return TRUE;
 }
 
-/**
- * Scans through the roots list starting from the current, potentially
- * inaccurate, minimum to find the tree with the minimum-value
- * root.
- *
- * @param queue Queue to fix
- */
-static void fix_min( rank_pairing_heap *queue )
-{
-    if ( queue->minimum == NULL )
-        return;
-    rank_pairing_node *start = queue->minimum;
-    rank_pairing_node *current = queue->minimum->right;
-    while ( current != start )
-    {
-        if ( current->key < queue->minimum->key )
-            queue->minimum = current;
-        current = current->right;
-    }
-}
-
 /**
  * Propagates rank corrections upward from the initial node using the type-1
  * rank rule.
@@ -480,3 +578,48 @@ static rank_pairing_node* sever_spine( rank_pairing_heap *queue,
 
     return node;
 }
+
+/**
+ * Removes a node from the heap without freeing it.  Its children are split
+ * into half trees that join the root list, and the roots are relinked as
+ * after a deletion.
+ *
+ * @param queue Queue to which the node belongs
+ * @param node  Node to remove
+ */
+static void extract_node( rank_pairing_heap *queue, rank_pairing_node *node )
+{
+    rank_pairing_node *old_min, *left_list, *right_list, *full_list, *current;
+
+    if ( node->parent != NULL )
+    {
+        if ( node->parent->right == node )
+            node->parent->right = NULL;
+        else
+            node->parent->left = NULL;
+    }
+    else
+    {
+        current = node;
+        while ( current->right != node )
+            current = current->right;
+        current->right = node->right;
+    }
+
+    left_list = ( node->left != NULL ) ? sever_spine( queue, node->left ) : NULL;
+    right_list = ( ( node->parent != NULL ) && ( node->right != NULL ) ) ?
+        sever_spine( queue, node->right ) : NULL;
+    merge_lists( queue, left_list, right_list );
+    full_list = pick_min( queue, left_list, right_list );
+
+    if ( queue->minimum == node )
+        queue->minimum = ( node->right == node ) ? full_list : node->right;
+
+    // in order to guarantee linking complies with analysis we save the
+    // original minimum so that we perform a one-pass link on the new
+    // trees before we do general multi-pass linking
+    old_min = queue->minimum;
+    merge_roots( queue, queue->minimum, full_list );
+    queue->minimum = old_min;
+    fix_roots( queue );
+}
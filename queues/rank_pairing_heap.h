@@ -50,8 +50,8 @@ struct rank_pairing_heap_t
     rank_pairing_node *minimum;
     //! An array of roots of the queue, indexed by rank
     rank_pairing_node *roots[MAXRANK];
-    //! Current largest rank in queue
-    uint32_t largest_rank;
+    //! A registry to keep track of non-null entries in roots
+    uint64_t registry;
 } __attribute__ ((aligned(4)));
 
 typedef struct rank_pairing_heap_t rank_pairing_heap;
@@ -167,6 +167,19 @@ key_type pq_delete( rank_pairing_heap *queue, rank_pairing_node *node );
 void pq_decrease_key( rank_pairing_heap *queue, rank_pairing_node *node,
     key_type new_key );
 
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve the heap invariant
+ * given a pointer to the corresponding node.  The node is removed as in a
+ * deletion and reinserted as a new root.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( rank_pairing_heap *queue, rank_pairing_node *node,
+    key_type new_key );
+
 /**
  * Determines whether the queue is empty, or if it holds some items.
  *
@@ -175,5 +188,31 @@ void pq_decrease_key( rank_pairing_heap *queue, rank_pairing_node *node,
  */
 bool pq_empty( rank_pairing_heap *queue );
 
+/**
+ * Writes a snapshot of the queue, every item with its key.  The half-trees are
+ * written in preorder from the minimum along the root list, with hints
+ * holding the rank of each node and which children it has.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( rank_pairing_heap *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  A snapshot of the same
+ * rank rule is relinked into the same half-trees without comparing keys.  A
+ * snapshot of another queue type is restored by inserting its items one by
+ * one.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+rank_pairing_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    rank_pairing_node **handles );
+
 #endif
 
@@ -1,5 +1,17 @@
 #include "rank_relaxed_weak_queue.h"
 
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define SNAPSHOT_LAYOUT     "rank_relaxed_weak"
+#define SNAPSHOT_LEFT       1
+#define SNAPSHOT_RIGHT      2
+#define SNAPSHOT_MIN        4
+#define SNAPSHOT_MARKED     8
+#define SNAPSHOT_REGISTERED 16
+#define SNAPSHOT_RANK       5
+
 //==============================================================================
 // STATIC DECLARATIONS
 //==============================================================================
@@ -35,6 +47,7 @@ static void sever_spine( rank_relaxed_weak_queue *queue,
 static void replace_node( rank_relaxed_weak_queue *queue,
     rank_relaxed_weak_node *node, rank_relaxed_weak_node *replacement );
 static void fix_min( rank_relaxed_weak_queue *queue );
+static rank_relaxed_weak_node* extract_min( rank_relaxed_weak_queue *queue );
 
 static rank_relaxed_weak_node* transformation_cleaning(
     rank_relaxed_weak_queue *queue, rank_relaxed_weak_node *node );
@@ -118,36 +131,9 @@ rank_relaxed_weak_node* pq_find_min( rank_relaxed_weak_queue *queue )
 
 key_type pq_delete_min( rank_relaxed_weak_queue *queue )
 {
-    rank_relaxed_weak_node *old_min = queue->minimum;
+    rank_relaxed_weak_node *old_min = extract_min( queue );
     key_type min_key = old_min->key;
 
-    uint32_t replacement_rank;
-    rank_relaxed_weak_node *replacement = old_min;
-    if( old_min->parent != NULL )
-    {
-        replacement_rank = REGISTRY_LEADER( queue->registry[ROOTS] );
-        replacement = queue->nodes[ROOTS][replacement_rank];
-    }
-
-    // unregister old root so we don't join it into something again
-    unregister_node( queue, ROOTS, old_min );
-    unregister_node( queue, MARKS, old_min );
-
-    unregister_node( queue, ROOTS, replacement );
-    unregister_node( queue, MARKS, replacement );
-    replacement->marked = 0;
-
-    sever_spine( queue, replacement->right );
-    replacement->parent = NULL;
-    replacement->left = NULL;
-    replacement->right = NULL;
-    replacement->rank = 0;
-
-    if( old_min != replacement )
-        replace_node( queue, old_min, replacement );
-
-    fix_min( queue );
-
     pq_free_node( queue->map, 0, old_min );
     queue->size--;
 
@@ -156,10 +142,12 @@ key_type pq_delete_min( rank_relaxed_weak_queue *queue )
 
 key_type pq_delete( rank_relaxed_weak_queue *queue, rank_relaxed_weak_node *node )
 {
+    key_type key = node->key;
+
     pq_decrease_key( queue, node, 0 );
-    key_type min_key = pq_delete_min( queue );
+    pq_delete_min( queue );
 
-    return min_key;
+    return key;
 }
 
 void pq_decrease_key( rank_relaxed_weak_queue *queue, rank_relaxed_weak_node *node,
@@ -177,11 +165,150 @@ void pq_decrease_key( rank_relaxed_weak_queue *queue, rank_relaxed_weak_node *no
         queue->minimum = node;
 }
 
+void pq_increase_key( rank_relaxed_weak_queue *queue,
+    rank_relaxed_weak_node *node, key_type new_key )
+{
+    // bring the node to the top, take it out and reinsert it as a singleton
+    pq_decrease_key( queue, node, 0 );
+    extract_min( queue );
+    node->key = new_key;
+    insert_root( queue, node );
+
+    if( ( queue->minimum == NULL ) || ( new_key < queue->minimum->key ) )
+        queue->minimum = node;
+}
+
 bool pq_empty( rank_relaxed_weak_queue *queue )
 {
     return ( queue->size == 0 );
 }
 
+pq_snapshot_header* pq_serialize( rank_relaxed_weak_queue *queue,
+    size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    rank_relaxed_weak_node **stack = malloc( ( queue->size + 1 ) *
+        sizeof( rank_relaxed_weak_node* ) );
+    uint64_t registry = queue->registry[ROOTS];
+    rank_relaxed_weak_node *node;
+    uint32_t rank, k = 0, top = 0;
+
+    if ( snapshot == NULL || stack == NULL )
+    {
+        free( snapshot );
+        free( stack );
+        return NULL;
+    }
+
+    // each tree is written in preorder, hints record the registries
+    while ( registry )
+    {
+        rank = REGISTRY_LEADER( registry );
+        REGISTRY_UNSET( registry, rank );
+        stack[top++] = queue->nodes[ROOTS][rank];
+        while ( top > 0 )
+        {
+            node = stack[--top];
+            entries[k].item = node->item;
+            entries[k].key = node->key;
+            entries[k].hint = node->rank << SNAPSHOT_RANK;
+            if ( node == queue->minimum )
+                entries[k].hint |= SNAPSHOT_MIN;
+            if ( node->marked )
+                entries[k].hint |= SNAPSHOT_MARKED;
+            if ( queue->nodes[MARKS][node->rank] == node )
+                entries[k].hint |= SNAPSHOT_REGISTERED;
+            if ( node->right != NULL )
+            {
+                entries[k].hint |= SNAPSHOT_RIGHT;
+                stack[top++] = node->right;
+            }
+            if ( node->left != NULL )
+            {
+                entries[k].hint |= SNAPSHOT_LEFT;
+                stack[top++] = node->left;
+            }
+            k++;
+        }
+    }
+    free( stack );
+
+    return snapshot;
+}
+
+rank_relaxed_weak_queue* pq_deserialize( mem_map *map,
+    pq_snapshot_header *snapshot, rank_relaxed_weak_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    rank_relaxed_weak_node *node, *last, *owner;
+    rank_relaxed_weak_node **stack;
+    uint32_t k, top = 0;
+
+    if ( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    rank_relaxed_weak_queue *queue = pq_create( map );
+    if ( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for ( k = 0; k < snapshot->size; k++ )
+        {
+            node = pq_insert( queue, entries[k].item, entries[k].key );
+            if ( handles != NULL )
+                handles[entries[k].item] = node;
+        }
+        return queue;
+    }
+
+    // nodes on the stack still wait for their right child
+    stack = malloc( ( snapshot->size + 1 ) *
+        sizeof( rank_relaxed_weak_node* ) );
+    if ( stack == NULL )
+        exit( -1 );
+
+    last = NULL;
+    for ( k = 0; k < snapshot->size; k++ )
+    {
+        node = pq_alloc_node( map, 0 );
+        ITEM_ASSIGN( node->item, entries[k].item );
+        node->key = entries[k].key;
+        node->rank = entries[k].hint >> SNAPSHOT_RANK;
+        node->marked = ( entries[k].hint & SNAPSHOT_MARKED ) ? 1 : 0;
+        if ( entries[k].hint & SNAPSHOT_MIN )
+            queue->minimum = node;
+        if ( entries[k].hint & SNAPSHOT_REGISTERED )
+            register_node( queue, MARKS, node );
+        if ( handles != NULL )
+            handles[entries[k].item] = node;
+
+        if ( last == NULL )
+            register_node( queue, ROOTS, node );
+        else if ( entries[k-1].hint & SNAPSHOT_LEFT )
+        {
+            last->left = node;
+            node->parent = last;
+        }
+        else
+        {
+            owner = stack[--top];
+            owner->right = node;
+            node->parent = owner;
+        }
+
+        if ( entries[k].hint & SNAPSHOT_RIGHT )
+            stack[top++] = node;
+        // a tree ends at a leaf with no right child still to come
+        last = ( !( entries[k].hint & SNAPSHOT_LEFT ) && top == 0 ) ?
+            NULL : node;
+    }
+
+    free( stack );
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
@@ -741,6 +868,54 @@ static void fix_min( rank_relaxed_weak_queue *queue )
     queue->minimum = min;
 }
 
+/**
+ * Removes the minimum from the heap without freeing it.  A root is taken as a
+ * replacement for the minimum, and the minimum is left as a singleton with
+ * no rank or mark.
+ *
+ * @param queue Queue in which to operate
+ * @return      The former minimum
+ */
+static rank_relaxed_weak_node* extract_min( rank_relaxed_weak_queue *queue )
+{
+    rank_relaxed_weak_node *old_min = queue->minimum;
+
+    uint32_t replacement_rank;
+    rank_relaxed_weak_node *replacement = old_min;
+    if( old_min->parent != NULL )
+    {
+        replacement_rank = REGISTRY_LEADER( queue->registry[ROOTS] );
+        replacement = queue->nodes[ROOTS][replacement_rank];
+    }
+
+    // unregister old root so we don't join it into something again
+    unregister_node( queue, ROOTS, old_min );
+    unregister_node( queue, MARKS, old_min );
+
+    unregister_node( queue, ROOTS, replacement );
+    unregister_node( queue, MARKS, replacement );
+    replacement->marked = 0;
+
+    sever_spine( queue, replacement->right );
+    replacement->parent = NULL;
+    replacement->left = NULL;
+    replacement->right = NULL;
+    replacement->rank = 0;
+
+    if( old_min != replacement )
+        replace_node( queue, old_min, replacement );
+
+    fix_min( queue );
+
+    old_min->parent = NULL;
+    old_min->left = NULL;
+    old_min->right = NULL;
+    old_min->rank = 0;
+    old_min->marked = 0;
+
+    return old_min;
+}
+
 /**
  * Make a marked left child into a marked right child.  Swap subtrees as
  * necessary.
@@ -178,6 +178,19 @@ key_type pq_delete( rank_relaxed_weak_queue *queue,
 void pq_decrease_key( rank_relaxed_weak_queue *queue,
     rank_relaxed_weak_node *node, key_type new_key );
 
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve the heap invariant
+ * given a pointer to the corresponding node.  The node is removed as in a
+ * deletion and reinserted as a new root.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( rank_relaxed_weak_queue *queue, rank_relaxed_weak_node *node,
+    key_type new_key );
+
 /**
  * Determines whether the queue is empty, or if it holds some items.
  *
@@ -186,5 +199,32 @@ void pq_decrease_key( rank_relaxed_weak_queue *queue,
  */
 bool pq_empty( rank_relaxed_weak_queue *queue );
 
+/**
+ * Writes a snapshot of the queue, every item with its key.  Each tree is
+ * written in preorder, with hints holding the rank and mark of each node,
+ * which children it has and whether it is registered as a marked node.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( rank_relaxed_weak_queue *queue,
+    size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  A snapshot of a rank-
+ * relaxed weak queue is relinked into the same trees without comparing keys.
+ * A snapshot of another queue type is restored by inserting its items one by
+ * one.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+rank_relaxed_weak_queue* pq_deserialize( mem_map *map,
+    pq_snapshot_header *snapshot, rank_relaxed_weak_node **handles );
+
 #endif
 
@@ -0,0 +1,418 @@
+#include "smooth_heap.h"
+
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#ifdef SMOOTH_SLIM
+    #define SNAPSHOT_LAYOUT "slim"
+#else
+    #define SNAPSHOT_LAYOUT "smooth"
+#endif
+#define SNAPSHOT_CHILD  1
+#define SNAPSHOT_NEXT   2
+
+//==============================================================================
+// STATIC DECLARATIONS
+//==============================================================================
+
+static smooth_node* merge( smooth_heap *queue, smooth_node *a,
+    smooth_node *b );
+static smooth_node* restructure( smooth_heap *queue, smooth_node *node );
+static void cut( smooth_heap *queue, smooth_node *node );
+static void add_first( smooth_node *parent, smooth_node *child );
+static void add_last( smooth_node *parent, smooth_node *child );
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+smooth_heap* pq_create( mem_map *map )
+{
+    smooth_heap *queue = calloc( 1, sizeof( smooth_heap ) );
+    queue->map = map;
+
+    return queue;
+}
+
+void pq_destroy( smooth_heap *queue )
+{
+    pq_clear( queue );
+    free( queue );
+}
+
+void pq_clear( smooth_heap *queue )
+{
+    mm_clear( queue->map );
+    queue->root = NULL;
+    queue->size = 0;
+}
+
+key_type pq_get_key( smooth_heap *queue, smooth_node *node )
+{
+    return node->key;
+}
+
+item_type* pq_get_item( smooth_heap *queue, smooth_node *node )
+{
+    return (item_type*) &(node->item);
+}
+
+uint32_t pq_get_size( smooth_heap *queue )
+{
+    return queue->size;
+}
+
+smooth_node* pq_insert( smooth_heap *queue, item_type item, key_type key )
+{
+    smooth_node *wrapper = pq_alloc_node( queue->map, 0 );
+    ITEM_ASSIGN( wrapper->item, item );
+    wrapper->key = key;
+    queue->size++;
+
+    queue->root = merge( queue, queue->root, wrapper );
+
+    return wrapper;
+}
+
+smooth_node* pq_find_min( smooth_heap *queue )
+{
+    if ( pq_empty( queue ) )
+        return NULL;
+    return queue->root;
+}
+
+key_type pq_delete_min( smooth_heap *queue )
+{
+    return pq_delete( queue, queue->root );
+}
+
+key_type pq_delete( smooth_heap *queue, smooth_node *node )
+{
+    key_type key = node->key;
+
+    if ( node == queue->root )
+        queue->root = restructure( queue, node->child );
+    else
+    {
+        cut( queue, node );
+        queue->root = merge( queue, queue->root,
+            restructure( queue, node->child ) );
+    }
+
+    pq_free_node( queue->map, 0, node );
+    queue->size--;
+
+    return key;
+}
+
+void pq_decrease_key( smooth_heap *queue, smooth_node *node, key_type new_key )
+{
+    node->key = new_key;
+    if ( node == queue->root || node->parent->key <= new_key )
+        return;
+
+    cut( queue, node );
+    queue->root = merge( queue, queue->root, node );
+}
+
+void pq_increase_key( smooth_heap *queue, smooth_node *node, key_type new_key )
+{
+    smooth_node *children = node->child;
+
+    node->key = new_key;
+    if ( children == NULL )
+        return;
+
+    // the node keeps its place, its children are restructured and merged back
+    node->child = NULL;
+#ifndef SMOOTH_SLIM
+    node->last = NULL;
+#endif
+    children = restructure( queue, children );
+
+    if ( node == queue->root )
+        queue->root = merge( queue, node, children );
+    else
+        queue->root = merge( queue, queue->root, children );
+}
+
+bool pq_empty( smooth_heap *queue )
+{
+    return ( queue->size == 0 );
+}
+
+pq_snapshot_header* pq_serialize( smooth_heap *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    smooth_node **stack = malloc( ( queue->size + 1 ) *
+        sizeof( smooth_node* ) );
+    smooth_node *node;
+    uint32_t k = 0;
+    uint32_t top = 0;
+
+    if ( snapshot == NULL || stack == NULL )
+    {
+        free( snapshot );
+        free( stack );
+        return NULL;
+    }
+
+    // the child and next pointers form a binary tree, written in preorder
+    if ( queue->root != NULL )
+        stack[top++] = queue->root;
+    while ( top > 0 )
+    {
+        node = stack[--top];
+        entries[k].item = node->item;
+        entries[k].key = node->key;
+        entries[k].hint = 0;
+        if ( node->next != NULL )
+        {
+            entries[k].hint |= SNAPSHOT_NEXT;
+            stack[top++] = node->next;
+        }
+        if ( node->child != NULL )
+        {
+            entries[k].hint |= SNAPSHOT_CHILD;
+            stack[top++] = node->child;
+        }
+        k++;
+    }
+    free( stack );
+
+    return snapshot;
+}
+
+smooth_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    smooth_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    smooth_node *node, *last, *owner;
+    smooth_node **stack;
+    uint32_t k;
+    uint32_t top = 0;
+
+    if ( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    smooth_heap *queue = pq_create( map );
+    if ( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for ( k = 0; k < snapshot->size; k++ )
+        {
+            node = pq_insert( queue, entries[k].item, entries[k].key );
+            if ( handles != NULL )
+                handles[entries[k].item] = node;
+        }
+        return queue;
+    }
+
+    // nodes on the stack still wait for their next sibling
+    stack = malloc( ( snapshot->size + 1 ) * sizeof( smooth_node* ) );
+    if ( stack == NULL )
+        exit( -1 );
+
+    last = NULL;
+    for ( k = 0; k < snapshot->size; k++ )
+    {
+        node = pq_alloc_node( map, 0 );
+        ITEM_ASSIGN( node->item, entries[k].item );
+        node->key = entries[k].key;
+        if ( handles != NULL )
+            handles[entries[k].item] = node;
+
+        if ( last == NULL )
+            queue->root = node;
+        else if ( entries[k-1].hint & SNAPSHOT_CHILD )
+        {
+            last->child = node;
+            node->parent = last;
+        }
+        else
+        {
+            owner = stack[--top];
+            owner->next = node;
+            node->prev = owner;
+            node->parent = owner->parent;
+        }
+
+        if ( entries[k].hint & SNAPSHOT_NEXT )
+            stack[top++] = node;
+#ifndef SMOOTH_SLIM
+        else if ( node->parent != NULL )
+            node->parent->last = node;
+#endif
+        last = node;
+    }
+
+    free( stack );
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
+//==============================================================================
+// STATIC METHODS
+//==============================================================================
+
+/**
+ * Merges two trees together, making the root of greater key the leftmost
+ * child of the other.
+ *
+ * @param queue Queue in which to operate
+ * @param a     First tree root
+ * @param b     Second tree root
+ * @return      Resulting tree root
+ */
+static smooth_node* merge( smooth_heap *queue, smooth_node *a,
+    smooth_node *b )
+{
+    if ( a == NULL )
+        return b;
+    else if ( b == NULL )
+        return a;
+
+    if ( b->key < a->key )
+    {
+        add_first( b, a );
+        return b;
+    }
+    else
+    {
+        add_first( a, b );
+        return a;
+    }
+}
+
+/**
+ * Combines a list of siblings into a single tree by stable linking.  The
+ * first pass walks left to right over the increasing prefix of the list.
+ * On reaching a local maximum it links it with its larger neighbour,
+ * repeating while the left neighbour remains the larger one, so that the
+ * whole list ends up increasing.  The second pass then links the sorted
+ * list right to left.
+ *
+ * @param queue Queue in which to operate
+ * @param node  Leftmost node of the list
+ * @return      Root of the resulting tree
+ */
+static smooth_node* restructure( smooth_heap *queue, smooth_node *node )
+{
+    smooth_node *current, *left, *right;
+
+    if ( node == NULL )
+        return NULL;
+
+    current = node;
+    while ( current->next != NULL )
+    {
+        right = current->next;
+        if ( current->key <= right->key )
+        {
+            current = right;
+            continue;
+        }
+
+        // current is a local maximum, link it to the larger neighbour
+        while ( current->prev != NULL && current->prev->key > right->key )
+        {
+            left = current->prev;
+            left->next = right;
+            right->prev = left;
+            add_last( left, current );
+            current = left;
+        }
+
+        left = current->prev;
+        right->prev = left;
+        if ( left != NULL )
+            left->next = right;
+        add_first( right, current );
+        current = right;
+    }
+
+    while ( current->prev != NULL )
+    {
+        left = current->prev;
+        left->next = NULL;
+        add_last( left, current );
+        current = left;
+    }
+    current->parent = NULL;
+
+    return current;
+}
+
+/**
+ * Removes a node from its parent's list of children, leaving it as a
+ * separate tree.
+ *
+ * @param queue Queue in which to operate
+ * @param node  Node to cut
+ */
+static void cut( smooth_heap *queue, smooth_node *node )
+{
+    smooth_node *parent = node->parent;
+
+    if ( node->prev != NULL )
+        node->prev->next = node->next;
+    else
+        parent->child = node->next;
+
+    if ( node->next != NULL )
+        node->next->prev = node->prev;
+#ifndef SMOOTH_SLIM
+    else
+        parent->last = node->prev;
+#endif
+
+    node->parent = NULL;
+    node->next = NULL;
+    node->prev = NULL;
+}
+
+/**
+ * Makes a node the leftmost child of another.
+ *
+ * @param parent    New parent
+ * @param child     Node to add
+ */
+static void add_first( smooth_node *parent, smooth_node *child )
+{
+    child->parent = parent;
+    child->prev = NULL;
+    child->next = parent->child;
+    if ( parent->child != NULL )
+        parent->child->prev = child;
+#ifndef SMOOTH_SLIM
+    else
+        parent->last = child;
+#endif
+    parent->child = child;
+}
+
+/**
+ * Makes a node the rightmost child of another.  The slim variant adds it as
+ * the leftmost child instead.
+ *
+ * @param parent    New parent
+ * @param child     Node to add
+ */
+static void add_last( smooth_node *parent, smooth_node *child )
+{
+#ifdef SMOOTH_SLIM
+    add_first( parent, child );
+#else
+    child->parent = parent;
+    child->next = NULL;
+    child->prev = parent->last;
+    if ( parent->last != NULL )
+        parent->last->next = child;
+    else
+        parent->child = child;
+    parent->last = child;
+#endif
+}
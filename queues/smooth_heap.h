@@ -0,0 +1,215 @@
+#ifndef SMOOTH_HEAP
+#define SMOOTH_HEAP
+
+//==============================================================================
+// DEFINES, INCLUDES, and STRUCTS
+//==============================================================================
+
+#include "queue_common.h"
+
+/**
+ * Holds an inserted element, as well as pointers to maintain tree
+ * structure.  Acts as a handle to clients for the purpose of
+ * mutability.  Each node is contained in a doubly linked list of
+ * siblings, ordered left to right, with null pointers at both ends.  The
+ * slim variant never appends on the right, so it does not track the last
+ * child.
+ */
+struct smooth_node_t
+{
+    //! Parent of this node, null for the root
+    struct smooth_node_t *parent;
+    //! Leftmost child of this node
+    struct smooth_node_t *child;
+#ifndef SMOOTH_SLIM
+    //! Rightmost child of this node
+    struct smooth_node_t *last;
+#endif
+    //! Next node in the list of this node's siblings
+    struct smooth_node_t *next;
+    //! Previous node in the list of this node's siblings
+    struct smooth_node_t *prev;
+
+    //! Pointer to a piece of client data
+    item_type item;
+    //! Key for the item
+    key_type key;
+} __attribute__ ((aligned(4)));
+
+typedef struct smooth_node_t smooth_node;
+typedef smooth_node pq_node_type;
+
+/**
+ * A mutable, self-adjusting Smooth heap.  Maintains a single multiary tree
+ * with no structural constraints other than the standard heap invariant.
+ * Inserted and decreased nodes are linked with the root.  After a deletion
+ * the list of children is restructured by stable linking: each local maximum
+ * is linked with the larger of its two neighbours until the list is sorted,
+ * after which it is linked right to left into a single tree.  A loser linked
+ * to its left neighbour becomes that neighbour's rightmost child, otherwise
+ * it becomes the leftmost child.
+ *
+ * With SMOOTH_SLIM defined this builds the Slim heap instead, which uses the
+ * same restructuring but always makes the loser the leftmost child, saving
+ * a pointer per node.
+ */
+struct smooth_heap_t
+{
+    //! Memory map to use for node allocation
+    mem_map *map;
+    //! The number of items held in the queue
+    uint32_t size;
+    //! Pointer to the minimum node in the queue
+    smooth_node *root;
+} __attribute__ ((aligned(4)));
+
+typedef struct smooth_heap_t smooth_heap;
+typedef smooth_heap pq_type;
+
+//==============================================================================
+// PUBLIC DECLARATIONS
+//==============================================================================
+
+/**
+ * Creates a new, empty queue.
+ *
+ * @param map   Memory map to use for node allocation
+ * @return      Pointer to the new queue
+ */
+smooth_heap* pq_create( mem_map *map );
+
+/**
+ * Frees all the memory used by the queue.
+ *
+ * @param queue Queue to destroy
+ */
+void pq_destroy( smooth_heap *queue );
+
+/**
+ * Deletes all nodes, leaving the queue empty.
+ *
+ * @param queue Queue to clear
+ */
+void pq_clear( smooth_heap *queue );
+
+/**
+ * Returns the key associated with the queried node.
+ *
+ * @param queue Queue to which node belongs
+ * @param node  Node to query
+ * @return      Node's key
+ */
+key_type pq_get_key( smooth_heap *queue, smooth_node *node );
+
+/**
+ * Returns the item associated with the queried node.
+ *
+ * @param queue Queue to which node belongs
+ * @param node  Node to query
+ * @return      Node's item
+ */
+item_type* pq_get_item( smooth_heap *queue, smooth_node *node );
+
+/**
+ * Returns the current size of the queue.
+ *
+ * @param queue Queue to query
+ * @return      Size of queue
+ */
+uint32_t pq_get_size( smooth_heap *queue );
+
+/**
+ * Takes an item-key pair to insert it into the queue and creates a new
+ * corresponding node.  Links the new node with the root.
+ *
+ * @param queue Queue to insert into
+ * @param item  Item to insert
+ * @param key   Key to use for node priority
+ * @return      Pointer to corresponding node
+ */
+smooth_node* pq_insert( smooth_heap *queue, item_type item, key_type key );
+
+/**
+ * Returns the minimum item from the queue without modifying any data.
+ *
+ * @param queue Queue to query
+ * @return      Node with minimum key
+ */
+smooth_node* pq_find_min( smooth_heap *queue );
+
+/**
+ * Deletes the minimum item from the queue and returns its key.  Restructures
+ * the children of the root into a new tree.
+ *
+ * @param queue Queue to query
+ * @return      Minimum key, corresponding to item deleted
+ */
+key_type pq_delete_min( smooth_heap *queue );
+
+/**
+ * Deletes an arbitrary item from the queue.  Cuts the node from its parent,
+ * restructures its children and links the result with the root.
+ *
+ * @param queue Queue in which the node resides
+ * @param node  Node to delete
+ * @return      Key of item deleted
+ */
+key_type pq_delete( smooth_heap *queue, smooth_node *node );
+
+/**
+ * Decreases the key of an item.  Cuts the node's subtree from its parent
+ * and links it with the root.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_decrease_key( smooth_heap *queue, smooth_node *node,
+    key_type new_key );
+
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve the heap invariant
+ * given a pointer to the corresponding node.  The children of the node are
+ * restructured and merged back into the heap.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( smooth_heap *queue, smooth_node *node, key_type new_key );
+
+/**
+ * Determines whether the queue is empty, or if it holds some items.
+ *
+ * @param queue Queue to query
+ * @return      True if queue holds nothing, false otherwise
+ */
+bool pq_empty( smooth_heap *queue );
+
+/**
+ * Writes a snapshot of the queue, every item with its key.  Nodes are written
+ * in preorder over the child and next pointers, with hints marking which of
+ * the two each node has.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( smooth_heap *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  A snapshot of the same
+ * variant is relinked into the same tree without comparing keys.  A snapshot
+ * of another queue type is restored by inserting its items one by one.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+smooth_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    smooth_node **handles );
+
+#endif
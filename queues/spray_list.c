@@ -0,0 +1,642 @@
+#include "spray_list.h"
+
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define IS_MARKED(p)    ( ( (uintptr_t) (p) ) & 1 )
+#define MARKED(p)       ( (spray_tower*) ( ( (uintptr_t) (p) ) | 1 ) )
+#define UNMARKED(p)     ( (spray_tower*) ( ( (uintptr_t) (p) ) & ~( (uintptr_t) 1 ) ) )
+
+#define LOAD(p)         __atomic_load_n( p, __ATOMIC_ACQUIRE )
+#define STORE(p,v)      __atomic_store_n( p, v, __ATOMIC_RELEASE )
+#define CAS(p,e,v)      __atomic_compare_exchange_n( p, e, v, 0, \
+                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE )
+
+#define SNAPSHOT_LAYOUT "spray_list"
+
+//==============================================================================
+// STATIC DECLARATIONS
+//==============================================================================
+
+// unique across all queues so a recycled queue address never matches
+static uint32_t spray_generations = 0;
+
+// per-thread allocation block and random state
+static __thread spray_list *arena_owner = NULL;
+static __thread uint32_t arena_generation = 0;
+static __thread uint8_t *arena_pos = NULL;
+static __thread size_t arena_left = 0;
+static __thread uint64_t random_state = 0;
+
+static void* arena_alloc( spray_list *queue, size_t size );
+static uint64_t next_random( void );
+static uint32_t random_level( void );
+static spray_tower* create_tower( spray_list *queue, key_type key,
+    spray_handle *handle );
+static bool precedes( spray_tower *tower, key_type key, spray_tower *ref );
+static void search( spray_list *queue, key_type key, spray_tower *ref,
+    spray_tower **preds, spray_tower **succs );
+static void link_tower( spray_list *queue, spray_tower *tower );
+static void retire_tower( spray_list *queue, spray_tower *tower );
+static bool claim( spray_tower *tower );
+static spray_tower* claim_from( spray_tower *start );
+static spray_tower* spray( spray_list *queue );
+static int compare_address( const void *a, const void *b );
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+spray_list* pq_create( mem_map *map )
+{
+    spray_list *queue = calloc( 1, sizeof( spray_list ) );
+    queue->map = map;
+    queue->head = calloc( 1, sizeof( spray_tower ) +
+        SPRAY_MAX_LEVEL * sizeof( spray_tower* ) );
+    queue->head->height = SPRAY_MAX_LEVEL;
+    queue->generation = __atomic_add_fetch( &spray_generations, 1,
+        __ATOMIC_RELAXED );
+
+    return queue;
+}
+
+void pq_destroy( spray_list *queue )
+{
+    pq_clear( queue );
+    free( queue->head );
+    free( queue );
+}
+
+void pq_clear( spray_list *queue )
+{
+    spray_block *block, *next;
+    for( block = queue->blocks; block != NULL; block = next )
+    {
+        next = block->next;
+        free( block );
+    }
+
+    queue->blocks = NULL;
+    queue->generation = __atomic_add_fetch( &spray_generations, 1,
+        __ATOMIC_RELAXED );
+    memset( queue->head->next, 0, SPRAY_MAX_LEVEL * sizeof( spray_tower* ) );
+    queue->size = 0;
+}
+
+key_type pq_get_key( spray_list *queue, spray_handle *node )
+{
+    return node->key;
+}
+
+item_type* pq_get_item( spray_list *queue, spray_handle *node )
+{
+    return (item_type*) &(node->item);
+}
+
+uint32_t pq_get_size( spray_list *queue )
+{
+    return LOAD( &queue->size );
+}
+
+spray_handle* pq_insert( spray_list *queue, item_type item, key_type key )
+{
+    spray_handle *wrapper = arena_alloc( queue, sizeof( spray_handle ) );
+    ITEM_ASSIGN( wrapper->item, item );
+    wrapper->key = key;
+
+    spray_tower *tower = create_tower( queue, key, wrapper );
+    link_tower( queue, tower );
+
+    STORE( &wrapper->tower, tower );
+    __atomic_add_fetch( &queue->size, 1, __ATOMIC_RELAXED );
+
+    return wrapper;
+}
+
+spray_handle* pq_find_min( spray_list *queue )
+{
+    spray_tower *succ;
+    spray_tower *current = UNMARKED( LOAD( &queue->head->next[0] ) );
+    while( current != NULL )
+    {
+        succ = LOAD( &current->next[0] );
+        if( !IS_MARKED( succ ) && LOAD( &current->handle->tower ) == current )
+            return current->handle;
+        current = UNMARKED( succ );
+    }
+
+    return NULL;
+}
+
+key_type pq_delete_min( spray_list *queue )
+{
+    spray_tower *tower = spray( queue );
+    if( tower == NULL )
+        return MAX_KEY;
+
+    __atomic_sub_fetch( &queue->size, 1, __ATOMIC_RELAXED );
+    retire_tower( queue, tower );
+
+    return tower->key;
+}
+
+key_type pq_delete( spray_list *queue, spray_handle *node )
+{
+    spray_tower *tower = LOAD( &node->tower );
+    while( tower != NULL )
+    {
+        if( CAS( &node->tower, &tower, NULL ) )
+        {
+            __atomic_sub_fetch( &queue->size, 1, __ATOMIC_RELAXED );
+            retire_tower( queue, tower );
+            return tower->key;
+        }
+    }
+
+    return node->key;
+}
+
+void pq_decrease_key( spray_list *queue, spray_handle *node,
+    key_type new_key )
+{
+    spray_tower *old_tower = LOAD( &node->tower );
+    if( old_tower == NULL || new_key >= old_tower->key )
+        return;
+
+    // the new tower is unclaimable until the handle is swung over to it
+    spray_tower *new_tower = create_tower( queue, new_key, node );
+    link_tower( queue, new_tower );
+
+    while( TRUE )
+    {
+        if( CAS( &node->tower, &old_tower, new_tower ) )
+        {
+            node->key = new_key;
+            retire_tower( queue, old_tower );
+            return;
+        }
+
+        if( old_tower == NULL || new_key >= old_tower->key )
+        {
+            retire_tower( queue, new_tower );
+            return;
+        }
+    }
+}
+
+void pq_increase_key( spray_list *queue, spray_handle *node,
+    key_type new_key )
+{
+    spray_tower *old_tower = LOAD( &node->tower );
+    if( old_tower == NULL || new_key <= old_tower->key )
+        return;
+
+    // as for a decrease, the old tower is retired once the handle moves on
+    spray_tower *new_tower = create_tower( queue, new_key, node );
+    link_tower( queue, new_tower );
+
+    while( TRUE )
+    {
+        if( CAS( &node->tower, &old_tower, new_tower ) )
+        {
+            node->key = new_key;
+            retire_tower( queue, old_tower );
+            return;
+        }
+
+        if( old_tower == NULL || new_key <= old_tower->key )
+        {
+            retire_tower( queue, new_tower );
+            return;
+        }
+    }
+}
+
+bool pq_empty( spray_list *queue )
+{
+    return ( LOAD( &queue->size ) == 0 );
+}
+
+void pq_set_spray_width( spray_list *queue, uint32_t width )
+{
+    queue->spray_width = width;
+}
+
+pq_snapshot_header* pq_serialize( spray_list *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        LOAD( &queue->size ), 1, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    spray_tower *current;
+    uint32_t k = 0;
+
+    if( snapshot == NULL )
+        return NULL;
+
+    // live towers in list order, each with its height as the hint
+    current = UNMARKED( LOAD( &queue->head->next[0] ) );
+    for( ; current != NULL; current = UNMARKED( LOAD( &current->next[0] ) ) )
+    {
+        if( LOAD( &current->handle->tower ) != current )
+            continue;
+        entries[k].item = current->handle->item;
+        entries[k].key = current->key;
+        entries[k].hint = current->height;
+        k++;
+    }
+    SNAPSHOT_WORDS( snapshot )[0] = queue->spray_width;
+
+    return snapshot;
+}
+
+spray_list* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    spray_handle **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    spray_tower *tails[SPRAY_MAX_LEVEL];
+    spray_tower **towers;
+    spray_handle *node;
+    uint32_t i, j, k, height;
+
+    if( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    spray_list *queue = pq_create( map );
+    if( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for( k = 0; k < snapshot->size; k++ )
+        {
+            node = pq_insert( queue, entries[k].item, entries[k].key );
+            if( handles != NULL )
+                handles[entries[k].item] = node;
+        }
+        return queue;
+    }
+
+    towers = malloc( ( snapshot->size + 1 ) * sizeof( spray_tower* ) );
+    if( towers == NULL )
+        exit( -1 );
+
+    for( k = 0; k < snapshot->size; k++ )
+    {
+        node = arena_alloc( queue, sizeof( spray_handle ) );
+        ITEM_ASSIGN( node->item, entries[k].item );
+        node->key = entries[k].key;
+        if( handles != NULL )
+            handles[entries[k].item] = node;
+
+        height = entries[k].hint;
+        if( height < 1 || height > SPRAY_MAX_LEVEL )
+            height = random_level();
+        towers[k] = arena_alloc( queue, sizeof( spray_tower ) +
+            height * sizeof( spray_tower* ) );
+        towers[k]->key = node->key;
+        towers[k]->handle = node;
+        towers[k]->height = height;
+        node->tower = towers[k];
+    }
+
+    // the towers are sorted by key, but equal keys go by address
+    for( i = 0; i < snapshot->size; i = j )
+    {
+        for( j = i + 1; j < snapshot->size &&
+                towers[j]->key == towers[i]->key; j++ );
+        if( j - i > 1 )
+            qsort( towers + i, j - i, sizeof( spray_tower* ),
+                compare_address );
+    }
+
+    // append every tower to each of its levels
+    for( i = 0; i < SPRAY_MAX_LEVEL; i++ )
+        tails[i] = queue->head;
+    for( k = 0; k < snapshot->size; k++ )
+    {
+        for( i = 0; i < towers[k]->height; i++ )
+        {
+            tails[i]->next[i] = towers[k];
+            tails[i] = towers[k];
+        }
+    }
+    for( i = 0; i < SPRAY_MAX_LEVEL; i++ )
+        tails[i]->next[i] = NULL;
+
+    free( towers );
+    queue->spray_width = SNAPSHOT_WORDS( snapshot )[0];
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
+//==============================================================================
+// STATIC METHODS
+//==============================================================================
+
+/**
+ * Carves zeroed memory out of the calling thread's current block, starting a
+ * new block if the thread has none for this queue or its block predates the
+ * last clear.  New blocks are pushed onto the queue's block list so they can be
+ * released together.
+ *
+ * @param queue Queue on whose behalf to allocate
+ * @param size  Number of bytes required
+ * @return      Pointer to the allocated memory
+ */
+static void* arena_alloc( spray_list *queue, size_t size )
+{
+    void *result;
+    spray_block *block;
+
+    size = ( size + 7 ) & ~( (size_t) 7 );
+    if( arena_owner != queue || arena_generation != queue->generation ||
+        arena_left < size )
+    {
+        block = malloc( SPRAY_BLOCK_SIZE );
+        if( block == NULL )
+            exit( -1 );
+
+        block->next = LOAD( &queue->blocks );
+        while( !CAS( &queue->blocks, &block->next, block ) );
+
+        arena_owner = queue;
+        arena_generation = queue->generation;
+        arena_pos = (uint8_t*) block + sizeof( spray_block );
+        arena_left = SPRAY_BLOCK_SIZE - sizeof( spray_block );
+    }
+
+    result = arena_pos;
+    arena_pos += size;
+    arena_left -= size;
+    memset( result, 0, size );
+
+    return result;
+}
+
+/**
+ * Per-thread xorshift64* generator, seeded from the address of its own state
+ * so each thread draws a different sequence.
+ *
+ * @return  Pseudo-random 64-bit value
+ */
+static uint64_t next_random( void )
+{
+    if( random_state == 0 )
+        random_state = ( (uint64_t) (uintptr_t) &random_state ) ^
+            0x9E3779B97F4A7C15ULL;
+
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+
+    return random_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Draws a tower height from the geometric distribution with p = 1/2.
+ *
+ * @return  Height between 1 and SPRAY_MAX_LEVEL
+ */
+static uint32_t random_level( void )
+{
+    uint64_t bits = next_random() | ( ( (uint64_t) 1 ) <<
+        ( SPRAY_MAX_LEVEL - 1 ) );
+
+    return (uint32_t) __builtin_ctzll( bits ) + 1;
+}
+
+/**
+ * Allocates an unlinked tower of random height for the given handle.
+ *
+ * @param queue     Queue on whose behalf to allocate
+ * @param key       Key to order the tower by
+ * @param handle    Handle the tower represents
+ * @return          The new tower
+ */
+static spray_tower* create_tower( spray_list *queue, key_type key,
+    spray_handle *handle )
+{
+    uint32_t height = random_level();
+    spray_tower *tower = arena_alloc( queue, sizeof( spray_tower ) +
+        height * sizeof( spray_tower* ) );
+    tower->key = key;
+    tower->handle = handle;
+    tower->height = height;
+
+    return tower;
+}
+
+/**
+ * Orders towers by key, breaking ties by address so that duplicate keys (and
+ * the old and new towers of a decrease-key) have distinct positions.
+ *
+ * @param tower Tower to compare
+ * @param key   Key of the reference position
+ * @param ref   Tower at the reference position
+ * @return      True if tower belongs strictly before the reference
+ */
+static bool precedes( spray_tower *tower, key_type key, spray_tower *ref )
+{
+    return ( tower->key < key || ( tower->key == key &&
+        (uintptr_t) tower < (uintptr_t) ref ) );
+}
+
+/**
+ * Finds the predecessor and successor of a position at every level,
+ * physically unlinking any marked towers encountered along the way.  Restarts
+ * from the head if an unlink fails because the predecessor was itself marked.
+ *
+ * @param queue Queue to search
+ * @param key   Key of the position
+ * @param ref   Tower at the position, used to break ties
+ * @param preds Output array of predecessors, one per level
+ * @param succs Output array of successors, one per level
+ */
+static void search( spray_list *queue, key_type key, spray_tower *ref,
+    spray_tower **preds, spray_tower **succs )
+{
+    spray_tower *pred, *current, *succ;
+    int32_t level;
+    bool restart;
+
+    do
+    {
+        restart = FALSE;
+        pred = queue->head;
+        for( level = SPRAY_MAX_LEVEL - 1; level >= 0 && !restart; level-- )
+        {
+            current = UNMARKED( LOAD( &pred->next[level] ) );
+            while( current != NULL )
+            {
+                succ = LOAD( &current->next[level] );
+                if( IS_MARKED( succ ) )
+                {
+                    if( !CAS( &pred->next[level], &current, UNMARKED( succ ) ) )
+                    {
+                        restart = TRUE;
+                        break;
+                    }
+                    current = UNMARKED( succ );
+                    continue;
+                }
+
+                if( !precedes( current, key, ref ) )
+                    break;
+
+                pred = current;
+                current = succ;
+            }
+
+            preds[level] = pred;
+            succs[level] = current;
+        }
+    } while( restart );
+}
+
+/**
+ * Links a fresh tower into every level of the list, bottom-up.  The tower is
+ * not yet reachable through its handle, so nothing can mark it meanwhile and
+ * its own successor pointers may be rewritten freely before each attempt.
+ *
+ * @param queue Queue to link into
+ * @param tower Tower to link
+ */
+static void link_tower( spray_list *queue, spray_tower *tower )
+{
+    spray_tower *preds[SPRAY_MAX_LEVEL];
+    spray_tower *succs[SPRAY_MAX_LEVEL];
+    uint32_t level;
+
+    do
+    {
+        search( queue, tower->key, tower, preds, succs );
+        for( level = 0; level < tower->height; level++ )
+            STORE( &tower->next[level], succs[level] );
+    } while( !CAS( &preds[0]->next[0], &succs[0], tower ) );
+
+    for( level = 1; level < tower->height; level++ )
+    {
+        while( !CAS( &preds[level]->next[level], &succs[level], tower ) )
+        {
+            search( queue, tower->key, tower, preds, succs );
+            STORE( &tower->next[level], succs[level] );
+        }
+    }
+}
+
+/**
+ * Marks every level of a tower from the top down and then searches for it so
+ * that it is unlinked.  Only the thread that owns a tower (by having claimed
+ * it or made it stale) retires it.
+ *
+ * @param queue Queue the tower belongs to
+ * @param tower Tower to retire
+ */
+static void retire_tower( spray_list *queue, spray_tower *tower )
+{
+    spray_tower *preds[SPRAY_MAX_LEVEL];
+    spray_tower *succs[SPRAY_MAX_LEVEL];
+    spray_tower *succ;
+    int32_t level;
+
+    for( level = tower->height - 1; level >= 0; level-- )
+    {
+        succ = LOAD( &tower->next[level] );
+        while( !IS_MARKED( succ ) &&
+            !CAS( &tower->next[level], &succ, MARKED( succ ) ) );
+    }
+
+    search( queue, tower->key, tower, preds, succs );
+}
+
+/**
+ * Attempts to remove the item a tower represents by swinging its handle from
+ * the tower to null.  Fails if the tower is stale or the item is gone.
+ *
+ * @param tower Tower to claim
+ * @return      True if this call removed the item
+ */
+static bool claim( spray_tower *tower )
+{
+    spray_tower *expected = tower;
+    return CAS( &tower->handle->tower, &expected, NULL );
+}
+
+/**
+ * Walks the bottom level from a starting tower and claims the first tower
+ * that is unmarked and still current for its handle.
+ *
+ * @param start First tower to consider
+ * @return      Claimed tower, or null if the end of the list was reached
+ */
+static spray_tower* claim_from( spray_tower *start )
+{
+    spray_tower *succ;
+    spray_tower *current = start;
+    while( current != NULL )
+    {
+        succ = LOAD( &current->next[0] );
+        if( !IS_MARKED( succ ) && claim( current ) )
+            return current;
+        current = UNMARKED( succ );
+    }
+
+    return NULL;
+}
+
+/**
+ * Chooses and claims a tower near the front of the list.  Starting from level
+ * floor(log2(width)) - 1 of the head, takes zero or one forward step at each
+ * level on the way down, which lands roughly uniformly among the first width
+ * towers.  Falls back to an exact scan from the head if nothing is claimable
+ * past the landing point.
+ *
+ * @param queue Queue to operate on
+ * @return      Claimed tower, or null if none was found
+ */
+static spray_tower* spray( spray_list *queue )
+{
+    spray_tower *next;
+    spray_tower *first = UNMARKED( LOAD( &queue->head->next[0] ) );
+    spray_tower *current = queue->head;
+    spray_tower *result;
+    uint32_t width = queue->spray_width;
+    int32_t level;
+
+    if( width > 1 )
+    {
+        level = 30 - __builtin_clz( width );
+        for( ; level >= 0; level-- )
+        {
+            if( next_random() & 1 )
+            {
+                next = UNMARKED( LOAD( &current->next[level] ) );
+                if( next != NULL )
+                    current = next;
+            }
+        }
+    }
+
+    if( current == queue->head )
+        return claim_from( first );
+
+    result = claim_from( current );
+    if( result == NULL )
+        result = claim_from( UNMARKED( LOAD( &queue->head->next[0] ) ) );
+
+    return result;
+}
+
+/**
+ * Orders tower pointers by address, as @ref <precedes> breaks ties.
+ *
+ * @param a Pointer to the first tower
+ * @param b Pointer to the second tower
+ * @return  Negative, zero or positive as a lies before, at or after b
+ */
+static int compare_address( const void *a, const void *b )
+{
+    uintptr_t x = (uintptr_t) *( (spray_tower* const*) a );
+    uintptr_t y = (uintptr_t) *( (spray_tower* const*) b );
+
+    return ( x > y ) - ( x < y );
+}
@@ -0,0 +1,259 @@
+#ifndef SPRAY_LIST
+#define SPRAY_LIST
+
+//==============================================================================
+// DEFINES, INCLUDES, and STRUCTS
+//==============================================================================
+
+#include "queue_common.h"
+
+#define SPRAY_MAX_LEVEL     32
+#define SPRAY_BLOCK_SIZE    1048576
+
+struct spray_handle_t;
+
+/**
+ * A single tower in the skiplist.  Towers are immutable once linked apart from
+ * their successor pointers, whose low bit marks the tower as deleted at that
+ * level.  A tower is live only while its handle points back to it, so a
+ * decrease-key links a fresh tower and retires the old one rather than
+ * changing a key in place.
+ */
+struct spray_tower_t
+{
+    //! Key the tower is ordered by
+    key_type key;
+    //! Handle this tower represents
+    struct spray_handle_t *handle;
+    //! Number of levels in the tower
+    uint32_t height;
+    //! Marked successor pointers, one per level
+    struct spray_tower_t *next[];
+} __attribute__ ((aligned(8)));
+
+typedef struct spray_tower_t spray_tower;
+
+/**
+ * Holds an inserted element.  Acts as a handle to clients for the purpose of
+ * mutability.  The tower pointer is the single point of truth for whether the
+ * item is still in the queue; claiming an item means swinging it to null.
+ */
+struct spray_handle_t
+{
+    //! Tower currently representing the item, null once removed
+    spray_tower *tower;
+
+    //! Pointer to a piece of client data
+    item_type item;
+    //! Key for the item
+    key_type key;
+} __attribute__ ((aligned(8)));
+
+typedef struct spray_handle_t spray_handle;
+typedef spray_handle pq_node_type;
+
+/**
+ * Header of a raw allocation block.  Blocks are chained so the whole queue can
+ * be released at once when no thread is operating on it.
+ */
+struct spray_block_t
+{
+    struct spray_block_t *next;
+} __attribute__ ((aligned(8)));
+
+typedef struct spray_block_t spray_block;
+
+/**
+ * A lock-free skiplist priority queue in the style of the SprayList.  Insert,
+ * delete and decrease-key may be called concurrently from any number of
+ * threads.  Delete-min either claims the first live tower (spray width zero)
+ * or performs a random descending walk ("spray") landing roughly uniformly
+ * among the first width towers, which spreads contention away from the head.
+ *
+ * Towers and handles are carved out of per-thread blocks rather than the
+ * (single-threaded) memory map, and unlinked towers are only reclaimed by
+ * @ref <pq_clear> or @ref <pq_destroy>, which must not run concurrently with
+ * any other operation.
+ */
+struct spray_list_t
+{
+    //! Memory map supplied at creation; unused since it is not thread-safe
+    mem_map *map;
+    //! The number of items held in the queue
+    uint32_t size;
+    //! Approximate number of front towers a delete-min chooses among
+    uint32_t spray_width;
+    //! Incremented by each clear so threads abandon stale blocks
+    uint32_t generation;
+    //! All blocks allocated on behalf of this queue
+    spray_block *blocks;
+    //! Sentinel tower of maximum height preceding all keys
+    spray_tower *head;
+} __attribute__ ((aligned(8)));
+
+typedef struct spray_list_t spray_list;
+typedef spray_list pq_type;
+
+//==============================================================================
+// PUBLIC DECLARATIONS
+//==============================================================================
+
+/**
+ * Creates a new, empty queue with a spray width of zero, i.e. with exact
+ * delete-min.
+ *
+ * @param map   Memory map to use for node allocation
+ * @return      Pointer to the new queue
+ */
+spray_list* pq_create( mem_map *map );
+
+/**
+ * Frees all the memory used by the queue.  Not thread-safe.
+ *
+ * @param queue Queue to destroy
+ */
+void pq_destroy( spray_list *queue );
+
+/**
+ * Deletes all nodes, leaving the queue empty.  Not thread-safe.
+ *
+ * @param queue Queue to clear
+ */
+void pq_clear( spray_list *queue );
+
+/**
+ * Returns the key associated with the queried node.
+ *
+ * @param queue Queue to which node belongs
+ * @param node  Node to query
+ * @return      Node's key
+ */
+key_type pq_get_key( spray_list *queue, spray_handle *node );
+
+/**
+ * Returns the item associated with the queried node.
+ *
+ * @param queue Queue to which node belongs
+ * @param node  Node to query
+ * @return      Node's item
+ */
+item_type* pq_get_item( spray_list *queue, spray_handle *node );
+
+/**
+ * Returns the current size of the queue.
+ *
+ * @param queue Queue to query
+ * @return      Size of queue
+ */
+uint32_t pq_get_size( spray_list *queue );
+
+/**
+ * Takes an item-key pair to insert it into the queue and creates a new
+ * corresponding node.  The tower is fully linked before the handle is
+ * published, so the item becomes visible to delete-min all at once.
+ *
+ * @param queue Queue to insert into
+ * @param item  Item to insert
+ * @param key   Key to use for node priority
+ * @return      Pointer to corresponding node
+ */
+spray_handle* pq_insert( spray_list *queue, item_type item, key_type key );
+
+/**
+ * Returns the first live node in the queue without modifying any data.  Under
+ * concurrent modification the result may already be stale.
+ *
+ * @param queue Queue to query
+ * @return      Node with minimum key
+ */
+spray_handle* pq_find_min( spray_list *queue );
+
+/**
+ * Claims and removes an item near the front of the queue.  With a spray width
+ * of zero this is the exact minimum; otherwise the item is chosen roughly
+ * uniformly among the first spray width live items.
+ *
+ * @param queue Queue to query
+ * @return      Key of the removed item, or MAX_KEY if none was found
+ */
+key_type pq_delete_min( spray_list *queue );
+
+/**
+ * Deletes an arbitrary item from the queue.  Does nothing if the item has
+ * already been removed by another operation.
+ *
+ * @param queue Queue in which the node resides
+ * @param node  Pointer to node corresponding to the item to delete
+ * @return      Key of item deleted
+ */
+key_type pq_delete( spray_list *queue, spray_handle *node );
+
+/**
+ * Lowers the key of an item still in the queue.  Links a new tower with the
+ * new key, then atomically moves the handle over to it and retires the old
+ * tower.  Does nothing if the item has already been removed or the new key is
+ * not smaller.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_decrease_key( spray_list *queue, spray_handle *node,
+    key_type new_key );
+
+/**
+ * Raises the key of an item still in the queue in the same way as
+ * @ref <pq_decrease_key>.  Does nothing if the item has already been removed
+ * or the new key is not larger.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( spray_list *queue, spray_handle *node,
+    key_type new_key );
+
+/**
+ * Determines whether the queue is empty, or if it holds some items.
+ *
+ * @param queue Queue to query
+ * @return      True if queue holds nothing, false otherwise
+ */
+bool pq_empty( spray_list *queue );
+
+/**
+ * Sets the spray width used by subsequent delete-min operations.  A width of
+ * zero or one gives exact delete-min.  A common choice is on the order of the
+ * number of threads operating on the queue.
+ *
+ * @param queue Queue to configure
+ * @param width Approximate number of front items to choose among
+ */
+void pq_set_spray_width( spray_list *queue, uint32_t width );
+
+/**
+ * Writes a snapshot of the queue, every item with its key.  Live towers are
+ * written in list order, with the height of each tower as the hint, followed
+ * by the spray width.  Must not run concurrently with any other operation.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( spray_list *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  A snapshot of a spray list
+ * is linked level by level in a single pass, without searching.  A snapshot of
+ * another queue type is restored by inserting its items one by one.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+spray_list* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    spray_handle **handles );
+
+#endif
@@ -1,5 +1,11 @@
 #include "strict_fibonacci_heap.h"
 
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define SNAPSHOT_LAYOUT "strict_fibonacci"
+
 //==============================================================================
 // STATIC DECLARATIONS
 //==============================================================================
@@ -22,6 +28,9 @@ static inline void remove_from_siblings( strict_fibonacci_heap *queue,
 static void link( strict_fibonacci_heap *queue, strict_fibonacci_node *parent,
     strict_fibonacci_node *child );
 static strict_fibonacci_node* select_new_root( strict_fibonacci_heap *queue );
+static void insert_node( strict_fibonacci_heap *queue,
+    strict_fibonacci_node *node );
+static strict_fibonacci_node* extract_min( strict_fibonacci_heap *queue );
 
 //--------------------------------------
 // QUEUE MANAGEMENT
@@ -85,7 +94,7 @@ static void post_delete_min_reduction( strict_fibonacci_heap *queue );
 static void post_decrease_key_reduction( strict_fibonacci_heap *queue );
 
 //--------------------------------------
-// GARBAGE COLLECTION & ALLOCATION
+// RECORD ALLOCATION
 //--------------------------------------
 
 static rank_record* create_rank_record( strict_fibonacci_heap *queue,
@@ -94,9 +103,6 @@ static void release_active_record( strict_fibonacci_heap *queue,
     strict_fibonacci_node *node );
 static void release_rank_record( strict_fibonacci_heap *queue,
     strict_fibonacci_node *node );
-static void release_to_garbage_collector( strict_fibonacci_heap *queue,
-    strict_fibonacci_heap *garbage_queue );
-static void garbage_collection( strict_fibonacci_heap *queue );
 
 //==============================================================================
 // PUBLIC METHODS
@@ -153,26 +159,9 @@ strict_fibonacci_node* pq_insert( strict_fibonacci_heap *queue, item_type item,
         STRICT_NODE_FIB );
     ITEM_ASSIGN( wrapper->item, item );
     wrapper->key = key;
-    wrapper->right = wrapper;
-    wrapper->left = wrapper;
-    wrapper->q_next = wrapper;
-    wrapper->q_prev = wrapper;
-
-    strict_fibonacci_node *parent, *child;
-    if( queue->root == NULL )
-        queue->root = wrapper;
-    else
-    {
-        choose_order_pair( wrapper, queue->root, &parent, &child );
-        link( queue, parent, child );
-        queue->root = parent;
-        enqueue_node( queue, child );
-
-        post_meld_reduction( queue );
-    }
+    insert_node( queue, wrapper );
 
     queue->size++;
-    garbage_collection( queue );
 
     return wrapper;
 }
@@ -190,55 +179,9 @@ key_type pq_delete_min( strict_fibonacci_heap *queue )
         return 0;
 
     key_type key = queue->root->key;
-    strict_fibonacci_node *current, *new_root, *old_root;
-    int i, j;
-
-    old_root = queue->root;
-
-    if( old_root->left_child == NULL )
-    {
-        old_root = queue->root;
-        if( is_active( queue, old_root ) )
-            convert_to_passive( queue, old_root );
-        queue->root = NULL;
-    }
-    else
-    {
-        new_root = select_new_root( queue );
-        remove_from_siblings( queue, new_root );
-        dequeue_node( queue, new_root );
-        queue->root = new_root;
-
-        if( is_active( queue, new_root ) )
-            convert_to_passive( queue, new_root );
-        if( is_active( queue, old_root ) )
-            convert_to_passive( queue, old_root );
-
-        while( old_root->left_child != NULL )
-            link( queue, new_root, old_root->left_child );
-
-        for( i = 0; i < 2; i++ )
-        {
-            current = consume_node( queue );
-            if( current != NULL )
-            {
-                for( j = 0; j < 2; j++ )
-                {
-                    if( current->left_child != NULL &&
-                            !is_active( queue, current->left_child->left ) )
-                        link( queue, new_root, current->left_child->left );
-                    else
-                        break;
-                }
-            }
-        }
-    }
+    strict_fibonacci_node *old_root = extract_min( queue );
 
     pq_free_node( queue->map, STRICT_NODE_FIB, old_root );
-
-    post_delete_min_reduction( queue );
-    garbage_collection( queue );
-
     queue->size--;
 
     return key;
@@ -288,7 +231,21 @@ void pq_decrease_key( strict_fibonacci_heap *queue, strict_fibonacci_node *node,
         increase_loss( queue, old_parent );
 
     post_decrease_key_reduction( queue );
-    garbage_collection( queue );
+}
+
+void pq_increase_key( strict_fibonacci_heap *queue,
+    strict_fibonacci_node *node, key_type new_key )
+{
+    item_type item = node->item;
+
+    // bring the node to the root, take it out and reinsert it as a new node
+    pq_decrease_key( queue, node, 0 );
+    extract_min( queue );
+
+    memset( node, 0, sizeof( strict_fibonacci_node ) );
+    node->item = item;
+    node->key = new_key;
+    insert_node( queue, node );
 }
 
 strict_fibonacci_heap* pq_meld( strict_fibonacci_heap *a,
@@ -340,11 +297,10 @@ strict_fibonacci_heap* pq_meld( strict_fibonacci_heap *a,
     new_heap->root = parent;
     enqueue_node( new_heap, child );
 
-    // take care of some garbage collection
-    release_to_garbage_collector( new_heap, small );
+    // the fix nodes of the smaller heap are embedded in its now passive
+    // nodes, so its fix lists can simply be dropped
     free( small );
     free( big );
-    garbage_collection( new_heap );
 
     return new_heap;
 }
@@ -354,6 +310,62 @@ bool pq_empty( strict_fibonacci_heap *queue )
     return ( queue->size == 0 );
 }
 
+pq_snapshot_header* pq_serialize( strict_fibonacci_heap *queue,
+    size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    strict_fibonacci_node *node;
+    uint32_t k = 0;
+
+    if ( snapshot == NULL )
+        return NULL;
+
+    if ( queue->root == NULL )
+        return snapshot;
+
+    // every node but the root is held in the queue
+    entries[k].item = queue->root->item;
+    entries[k].key = queue->root->key;
+    entries[k].hint = 0;
+    k++;
+    node = queue->q_head;
+    while ( k < queue->size )
+    {
+        entries[k].item = node->item;
+        entries[k].key = node->key;
+        entries[k].hint = 0;
+        k++;
+        node = node->q_next;
+    }
+
+    return snapshot;
+}
+
+strict_fibonacci_heap* pq_deserialize( mem_map *map,
+    pq_snapshot_header *snapshot, strict_fibonacci_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    strict_fibonacci_node *node;
+    uint32_t k;
+
+    if ( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    // the active, rank and fix records cannot be rebuilt without the
+    // restructuring that insertion already performs
+    strict_fibonacci_heap *queue = pq_create( map );
+    for ( k = 0; k < snapshot->size; k++ )
+    {
+        node = pq_insert( queue, entries[k].item, entries[k].key );
+        if ( handles != NULL )
+            handles[entries[k].item] = node;
+    }
+
+    return queue;
+}
+
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
@@ -569,6 +581,92 @@ static strict_fibonacci_node* select_new_root( strict_fibonacci_heap *queue )
     return new_root;
 }
 
+/**
+ * Links a fresh node with the root, enqueueing the loser.  The node must be
+ * zeroed apart from its item and key.
+ *
+ * @param queue Queue in which to operate
+ * @param node  Node to insert
+ */
+static void insert_node( strict_fibonacci_heap *queue,
+    strict_fibonacci_node *node )
+{
+    node->right = node;
+    node->left = node;
+    node->q_next = node;
+    node->q_prev = node;
+
+    strict_fibonacci_node *parent, *child;
+    if( queue->root == NULL )
+        queue->root = node;
+    else
+    {
+        choose_order_pair( node, queue->root, &parent, &child );
+        link( queue, parent, child );
+        queue->root = parent;
+        enqueue_node( queue, child );
+
+        post_meld_reduction( queue );
+    }
+}
+
+/**
+ * Removes the root from the heap without freeing it.  Picks the new root
+ * among its children and performs the usual delete-min restructuring.
+ *
+ * @param queue Queue in which to operate
+ * @return      The former root
+ */
+static strict_fibonacci_node* extract_min( strict_fibonacci_heap *queue )
+{
+    strict_fibonacci_node *current, *new_root;
+    strict_fibonacci_node *old_root = queue->root;
+    int i, j;
+
+    if( old_root->left_child == NULL )
+    {
+        old_root = queue->root;
+        if( is_active( queue, old_root ) )
+            convert_to_passive( queue, old_root );
+        queue->root = NULL;
+    }
+    else
+    {
+        new_root = select_new_root( queue );
+        remove_from_siblings( queue, new_root );
+        dequeue_node( queue, new_root );
+        queue->root = new_root;
+
+        if( is_active( queue, new_root ) )
+            convert_to_passive( queue, new_root );
+        if( is_active( queue, old_root ) )
+            convert_to_passive( queue, old_root );
+
+        while( old_root->left_child != NULL )
+            link( queue, new_root, old_root->left_child );
+
+        for( i = 0; i < 2; i++ )
+        {
+            current = consume_node( queue );
+            if( current != NULL )
+            {
+                for( j = 0; j < 2; j++ )
+                {
+                    if( current->left_child != NULL &&
+                            !is_active( queue, current->left_child->left ) )
+                        link( queue, new_root, current->left_child->left );
+                    else
+                        break;
+                }
+            }
+        }
+    }
+
+    post_delete_min_reduction( queue );
+
+    return old_root;
+}
+
 //--------------------------------------
 // QUEUE MANAGEMENT
 //--------------------------------------
@@ -908,8 +1006,8 @@ static void move_rank( strict_fibonacci_heap *queue, rank_record *rank,
 //--------------------------------------
 
 /**
- * Convert an active node to an active root.  Assign it a fix node and insert it
- * accordingly.
+ * Convert an active node to an active root.  Set up its embedded fix node and
+ * insert it accordingly.
  *
  * @param queue Queue in which to operate
  * @param node  Node to convert
@@ -920,7 +1018,7 @@ static void convert_active_to_root( strict_fibonacci_heap *queue,
     if( is_active( queue, node ) && node->type == STRICT_TYPE_LOSS )
         convert_loss_to_active( queue, node );
 
-    fix_node *fix = pq_alloc_node( queue->map, STRICT_NODE_FIX );
+    fix_node *fix = &( node->fix_record );
     fix->node = node;
     fix->rank = node->rank;
     node->fix = fix;
@@ -930,8 +1028,8 @@ static void convert_active_to_root( strict_fibonacci_heap *queue,
 }
 
 /**
- * Convert an active node to a loss node.  Assign it a fix node and insert it
- * accordingly.
+ * Convert an active node to a loss node.  Set up its embedded fix node and
+ * insert it accordingly.
  *
  * @param queue Queue in which to operate
  * @param node  Node to convert
@@ -939,7 +1037,7 @@ static void convert_active_to_root( strict_fibonacci_heap *queue,
 static void convert_active_to_loss( strict_fibonacci_heap *queue,
     strict_fibonacci_node *node )
 {
-    fix_node *fix = pq_alloc_node( queue->map, STRICT_NODE_FIX );
+    fix_node *fix = &( node->fix_record );
     fix->node = node;
     fix->rank = node->rank;
     node->fix = fix;
@@ -949,8 +1047,7 @@ static void convert_active_to_loss( strict_fibonacci_heap *queue,
 }
 
 /**
- * Convert an active root to an active node.  Remove it from the fix list and
- * free the fix node.
+ * Convert an active root to an active node.  Remove it from the fix list.
  *
  * @param queue Queue in which to operate
  * @param node  Node to convert
@@ -959,14 +1056,12 @@ static void convert_root_to_active( strict_fibonacci_heap *queue,
     strict_fibonacci_node *node )
 {
     remove_fix_node( queue, node->fix, STRICT_FIX_ROOT );
-    pq_free_node( queue->map, STRICT_NODE_FIX, node->fix );
     node->fix = NULL;
     node->type = STRICT_TYPE_ACTIVE;
 }
 
 /**
- * Convert a loss node to an active node.  Remove it from the fix list and
- * free the fix node.
+ * Convert a loss node to an active node.  Remove it from the fix list.
  *
  * @param queue Queue in which to operate
  * @param node  Node to convert
@@ -975,7 +1070,6 @@ static void convert_loss_to_active( strict_fibonacci_heap *queue,
     strict_fibonacci_node *node )
 {
     remove_fix_node( queue, node->fix, STRICT_FIX_LOSS );
-    pq_free_node( queue->map, STRICT_NODE_FIX, node->fix );
     node->fix = NULL;
     node->type = STRICT_TYPE_ACTIVE;
 }
@@ -1022,7 +1116,6 @@ static void convert_to_passive( strict_fibonacci_heap *queue,
     {
         remove_fix_node( queue, node->fix, ( node->type == STRICT_TYPE_ROOT ) ?
             STRICT_FIX_ROOT : STRICT_FIX_LOSS );
-        pq_free_node( queue->map, STRICT_NODE_FIX, node->fix );
         node->fix = NULL;
     }
 
@@ -1258,7 +1351,7 @@ static void post_decrease_key_reduction( strict_fibonacci_heap *queue )
 }
 
 //--------------------------------------
-// GARBAGE COLLECTION & ALLOCATION
+// RECORD ALLOCATION
 //--------------------------------------
 
 /**
@@ -1346,61 +1439,3 @@ static void release_rank_record( strict_fibonacci_heap *queue,
     }
     node->rank = NULL;
 }
-
-/**
- * Releases a queue to the garbage collector.  Appends the fix and rank lists to
- * the collecting queue's garbage lists.
- *
- * @param queue         Queue which which will not be deleted
- * @param garbage_queue Queue to release for garbage collection
- */
-static void release_to_garbage_collector( strict_fibonacci_heap *queue,
-    strict_fibonacci_heap *garbage_queue )
-{
-    int i;
-    fix_node *tail, *head, *g_tail, *g_head;
-
-    for( i = 0; i < 2; i++ )
-    {
-        if( garbage_queue->fix_list[i] != NULL )
-        {
-            if( queue->garbage_fix == NULL )
-                queue->garbage_fix = garbage_queue->fix_list[i];
-            else
-            {
-                head = queue->garbage_fix;
-                tail = head->left;
-                g_head = garbage_queue->fix_list[i];
-                g_tail = g_head->left;
-
-                head->left = g_tail;
-                tail->right = g_head;
-                g_tail->right = head;
-                g_head->left = tail;
-            }
-        }
-    }
-}
-
-/**
- * Properly removes a previously released fix and/or rank node.
- *
- * @param queue Queue in which to operate
- */
-static void garbage_collection( strict_fibonacci_heap *queue )
-{
-    fix_node *fix;
-
-    if( queue->garbage_fix != NULL )
-    {
-        fix = queue->garbage_fix;
-        if( fix->right == fix )
-            queue->garbage_fix = NULL;
-        else
-        {
-            queue->garbage_fix = fix->right;
-            fix->right->left = fix->left;
-            fix->left->right = fix->right;
-        }
-    }
-}
@@ -11,11 +11,11 @@
 #define STRICT_TYPE_ROOT    2
 #define STRICT_TYPE_LOSS    3
 
-// node types for memory map allocation
+// node types for memory map allocation, fix nodes are embedded in the
+// heap nodes and need no type of their own
 #define STRICT_NODE_FIB     0
-#define STRICT_NODE_FIX     1
-#define STRICT_NODE_ACTIVE  2
-#define STRICT_NODE_RANK    3
+#define STRICT_NODE_ACTIVE  1
+#define STRICT_NODE_RANK    2
 
 // modes for fix list operations
 #define STRICT_FIX_ROOT     0
@@ -72,7 +72,8 @@ typedef struct rank_record_t rank_record;
 
 /**
  * A node in a doubly-linked circular list.  Holds a pointer to an active node
- * and a corresponding rank.
+ * and a corresponding rank.  A heap node is in at most one fix list at a
+ * time, so each heap node embeds its own fix node.
  */
 struct fix_node_t
 {
@@ -92,7 +93,8 @@ typedef struct fix_node_t fix_node;
  * to rank and active records if it is active.  The last known type of the node
  * is stored so that a change in type can easily be detected and unnecessary
  * restructuring can be avoided.  Finally, active nodes may also have positive
- * loss and a reference to a node in the fix list.
+ * loss and a reference to a node in the fix list, which points to the
+ * embedded fix record while the node is an active root or has positive loss.
  */
 struct strict_fibonacci_node_t
 {
@@ -112,6 +114,8 @@ struct strict_fibonacci_node_t
     rank_record *rank;
     fix_node *fix;
     uint32_t loss;
+
+    fix_node fix_record;
 } __attribute__ ((aligned(4)));
 
 typedef struct strict_fibonacci_node_t strict_fibonacci_node;
@@ -132,8 +136,6 @@ struct strict_fibonacci_heap_t
     active_record *active;
     rank_record *rank_list;
     fix_node *fix_list[2];
-
-    fix_node *garbage_fix;
 } __attribute__ ((aligned(4)));
 
 typedef struct strict_fibonacci_heap_t strict_fibonacci_heap;
@@ -249,6 +251,19 @@ key_type pq_delete( strict_fibonacci_heap *queue, strict_fibonacci_node *node );
 void pq_decrease_key( strict_fibonacci_heap *queue, strict_fibonacci_node *node,
     key_type new_key );
 
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve the heap invariant
+ * given a pointer to the corresponding node.  The node is removed as in a
+ * deletion and reinserted.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( strict_fibonacci_heap *queue, strict_fibonacci_node *node,
+    key_type new_key );
+
 /**
  * Combines two different item-disjoint queues which share a memory map.
  * Returns a pointer to the resulting queue.
@@ -268,4 +283,30 @@ strict_fibonacci_heap* pq_meld( strict_fibonacci_heap *a,
  */
 bool pq_empty( strict_fibonacci_heap *queue );
 
+/**
+ * Writes a snapshot of the queue, every item with its key.  The root is
+ * written first, followed by the other nodes in the order of the auxiliary
+ * queue.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( strict_fibonacci_heap *queue,
+    size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  The items are always
+ * inserted one by one, since the active, rank and fix records of the heap
+ * cannot be restored without the restructuring insertion already performs.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+strict_fibonacci_heap* pq_deserialize( mem_map *map,
+    pq_snapshot_header *snapshot, strict_fibonacci_node **handles );
+
 #endif
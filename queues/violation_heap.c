@@ -1,5 +1,15 @@
 #include "violation_heap.h"
 
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define SNAPSHOT_LAYOUT     "violation"
+#define SNAPSHOT_CHILD      1
+#define SNAPSHOT_SIBLING    2
+#define SNAPSHOT_ROOT       4
+#define SNAPSHOT_RANK       3
+
 //==============================================================================
 // STATIC DECLARATIONS
 //==============================================================================
@@ -11,13 +21,13 @@ static violation_node* join( violation_heap *queue, violation_node *parent,
     violation_node *child1, violation_node *child2 );
 static void fix_roots( violation_heap *queue );
 static bool attempt_insert( violation_heap *queue, violation_node *node );
-static void set_min( violation_heap *queue );
 static violation_node* find_prev_root( violation_heap *queue, violation_node *node );
 static void propagate_ranks( violation_heap *queue, violation_node *node );
 static void strip_list( violation_heap *queue, violation_node *node );
 static bool is_active( violation_heap *queue, violation_node *node );
 static violation_node* get_parent( violation_heap *queue, violation_node *node );
 static int is_root( violation_heap *queue, violation_node *node );
+static void extract_node( violation_heap *queue, violation_node *node );
 
 //==============================================================================
 // PUBLIC METHODS
@@ -42,7 +52,7 @@ void pq_clear( violation_heap *queue )
     mm_clear( queue->map );
     queue->minimum = NULL;
     memset( queue->roots, 0, 2 * MAXRANK * sizeof( violation_node* ) );
-    queue->largest_rank = 0;
+    queue->registry = 0;
     queue->size = 0;
 }
 
@@ -92,39 +102,8 @@ key_type pq_delete_min( violation_heap *queue )
 key_type pq_delete( violation_heap *queue, violation_node *node )
 {
     key_type key = node->key;
-    violation_node *prev;
-
-    if ( is_root( queue, node ) )
-    {
-        prev = find_prev_root( queue, node );
-        prev->next = node->next;
-    }
-    else
-    {
-        if ( node->next->child == node )
-            node->next->child = node->prev;
-        else
-            node->next->prev = node->prev;
-
-        if ( node->prev != NULL )
-            node->prev->next = node->next;
-    }
-
-    if ( queue->minimum == node )
-    {
-        if ( node->next != node )
-            queue->minimum = node->next;
-        else
-            queue->minimum = node->child;
-    }
-
-    if ( node->child != NULL )
-    {
-        strip_list( queue, node->child );
-        merge_into_roots( queue, node->child );
-    }
-    fix_roots( queue );
 
+    extract_node( queue, node );
     pq_free_node( queue->map, 0, node );
     queue->size--;
 
@@ -216,11 +195,148 @@ void pq_decrease_key( violation_heap *queue, violation_node *node,
     }
 }
 
+void pq_increase_key( violation_heap *queue, violation_node *node,
+    key_type new_key )
+{
+    // take the node out as in a delete and reinsert it as a fresh singleton
+    extract_node( queue, node );
+    node->key = new_key;
+    node->child = NULL;
+    node->next = node;
+    node->prev = NULL;
+    node->rank = 0;
+    merge_into_roots( queue, node );
+}
+
 bool pq_empty( violation_heap *queue )
 {
     return ( queue->size == 0 );
 }
 
+pq_snapshot_header* pq_serialize( violation_heap *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    violation_node **stack = malloc( ( queue->size + 1 ) *
+        sizeof( violation_node* ) );
+    violation_node *node, *sibling;
+    uint32_t k = 0;
+    uint32_t top = 0;
+
+    if ( snapshot == NULL || stack == NULL )
+    {
+        free( snapshot );
+        free( stack );
+        return NULL;
+    }
+
+    // the root list from the minimum and each child list from its parent's
+    // child pointer are written in preorder
+    if ( queue->minimum != NULL )
+        stack[top++] = queue->minimum;
+    while ( top > 0 )
+    {
+        node = stack[--top];
+        entries[k].item = node->item;
+        entries[k].key = node->key;
+        entries[k].hint = node->rank << SNAPSHOT_RANK;
+        if ( is_root( queue, node ) )
+        {
+            entries[k].hint |= SNAPSHOT_ROOT;
+            sibling = ( node->next == queue->minimum ) ? NULL : node->next;
+        }
+        else
+            sibling = node->prev;
+
+        if ( sibling != NULL )
+        {
+            entries[k].hint |= SNAPSHOT_SIBLING;
+            stack[top++] = sibling;
+        }
+        if ( node->child != NULL )
+        {
+            entries[k].hint |= SNAPSHOT_CHILD;
+            stack[top++] = node->child;
+        }
+        k++;
+    }
+    free( stack );
+
+    return snapshot;
+}
+
+violation_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    violation_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    violation_node *node, *last, *owner;
+    violation_node **stack;
+    uint32_t k;
+    uint32_t top = 0;
+
+    if ( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    violation_heap *queue = pq_create( map );
+    if ( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for ( k = 0; k < snapshot->size; k++ )
+        {
+            node = pq_insert( queue, entries[k].item, entries[k].key );
+            if ( handles != NULL )
+                handles[entries[k].item] = node;
+        }
+        return queue;
+    }
+
+    // nodes on the stack still wait for their next sibling
+    stack = malloc( ( snapshot->size + 1 ) * sizeof( violation_node* ) );
+    if ( stack == NULL )
+        exit( -1 );
+
+    last = NULL;
+    for ( k = 0; k < snapshot->size; k++ )
+    {
+        node = pq_alloc_node( map, 0 );
+        ITEM_ASSIGN( node->item, entries[k].item );
+        node->key = entries[k].key;
+        node->rank = entries[k].hint >> SNAPSHOT_RANK;
+        if ( handles != NULL )
+            handles[entries[k].item] = node;
+
+        if ( last == NULL )
+            queue->minimum = node;
+        else if ( entries[k-1].hint & SNAPSHOT_CHILD )
+        {
+            last->child = node;
+            node->next = last;
+        }
+        else
+        {
+            owner = stack[--top];
+            if ( entries[k].hint & SNAPSHOT_ROOT )
+                owner->next = node;
+            else
+            {
+                owner->prev = node;
+                node->next = owner;
+            }
+        }
+
+        if ( entries[k].hint & SNAPSHOT_SIBLING )
+            stack[top++] = node;
+        else if ( entries[k].hint & SNAPSHOT_ROOT )
+            node->next = queue->minimum;
+        last = node;
+    }
+
+    free( stack );
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
@@ -347,7 +463,8 @@ static violation_node* join( violation_heap *queue, violation_node *parent,
 
 /**
  * Iterates through roots and three-way joins trees of the same rank
- * until no three trees remain with the same rank.
+ * until no three trees remain with the same rank.  Relinks the remaining
+ * trees and selects the new minimum, leaving the roots array empty.
  *
  * @param queue Queue whose roots to fix
  */
@@ -357,12 +474,6 @@ static void fix_roots( violation_heap *queue )
     int i;
     int32_t rank;
 
-    for ( i = 0; i <= queue->largest_rank; i++ )
-    {
-        queue->roots[i][0] = NULL;
-        queue->roots[i][1] = NULL;
-    }
-
     if ( queue->minimum == NULL )
         return;
 
@@ -384,35 +495,36 @@ static void fix_roots( violation_heap *queue )
             tail = tail->next;
             queue->roots[rank][0] = NULL;
             queue->roots[rank][1] = NULL;
+            REGISTRY_UNSET( queue->registry, rank );
         }
         current = next;
     }
 
+    // visit only occupied ranks
     head = NULL;
     tail = NULL;
-    for ( i = 0; i <= queue->largest_rank; i++ )
+    queue->minimum = NULL;
+    while ( queue->registry )
     {
-        if ( queue->roots[i][0] != NULL )
-        {
-            if ( head == NULL )
-                head = queue->roots[i][0];
-            else
-                tail->next = queue->roots[i][0];
-            tail = queue->roots[i][0];
-        }
-        if ( queue->roots[i][1] != NULL )
+        rank = REGISTRY_LEADER( queue->registry );
+        REGISTRY_UNSET( queue->registry, rank );
+        for ( i = 0; i < 2; i++ )
         {
+            current = queue->roots[rank][i];
+            if ( current == NULL )
+                break;
             if ( head == NULL )
-                head = queue->roots[i][1];
+                head = current;
             else
-                tail->next = queue->roots[i][1];
-            tail = queue->roots[i][1];
+                tail->next = current;
+            tail = current;
+            if ( queue->minimum == NULL || current->key < queue->minimum->key )
+                queue->minimum = current;
+            queue->roots[rank][i] = NULL;
         }
     }
 
     tail->next = head;
-
-    set_min( queue );
 }
 
 /**
@@ -435,43 +547,14 @@ static bool attempt_insert( violation_heap *queue, violation_node *node )
             queue->roots[rank][1] = node;
     }
     else
+    {
         queue->roots[rank][0] = node;
-
-    if ( rank > queue->largest_rank )
-        queue->largest_rank = rank;
+        REGISTRY_SET( queue->registry, rank );
+    }
 
     return TRUE;
 }
 
-/**
- * Scans through the roots array to find the tree with the minimum-value
- * root.
- *
- * @param queue Queue to fix
- */
-static void set_min( violation_heap *queue )
-{
-    int i;
-    queue->minimum = NULL;
-    for ( i = 0; i <= queue->largest_rank; i++ )
-    {
-        if ( queue->roots[i][0] != NULL )
-        {
-            if ( queue->minimum == NULL )
-                queue->minimum = queue->roots[i][0];
-            else if ( queue->roots[i][0]->key < queue->minimum->key )
-                queue->minimum = queue->roots[i][0];
-        }
-        if ( queue->roots[i][1] != NULL )
-        {
-            if ( queue->minimum == NULL )
-                queue->minimum = queue->roots[i][1];
-            else if ( queue->roots[i][1]->key < queue->minimum->key )
-                queue->minimum = queue->roots[i][1];
-        }
-    }
-}
-
 /**
  * Loops around a singly-linked list of roots to find the root prior to
  * the specified node.
@@ -603,3 +686,46 @@ static int is_root( violation_heap *queue, violation_node *node )
     return ( ( node->prev == NULL ) && ( node->next->prev == NULL ) &&
         ( node->next->child != node ) );
 }
+
+/**
+ * Removes a node from the heap without freeing it.  Its children are added to
+ * the root list and the roots are consolidated.
+ *
+ * @param queue Queue to which the node belongs
+ * @param node  Node to remove
+ */
+static void extract_node( violation_heap *queue, violation_node *node )
+{
+    violation_node *prev;
+
+    if ( is_root( queue, node ) )
+    {
+        prev = find_prev_root( queue, node );
+        prev->next = node->next;
+    }
+    else
+    {
+        if ( node->next->child == node )
+            node->next->child = node->prev;
+        else
+            node->next->prev = node->prev;
+
+        if ( node->prev != NULL )
+            node->prev->next = node->next;
+    }
+
+    if ( queue->minimum == node )
+    {
+        if ( node->next != node )
+            queue->minimum = node->next;
+        else
+            queue->minimum = node->child;
+    }
+
+    if ( node->child != NULL )
+    {
+        strip_list( queue, node->child );
+        merge_into_roots( queue, node->child );
+    }
+    fix_roots( queue );
+}
@@ -0,0 +1,337 @@
+#include "weak_heap.h"
+
+//==============================================================================
+// DEFINES
+//==============================================================================
+
+#define REVERSE(q,i)        ( ( (q)->reverse[(i) >> 6] >> ( (i) & 63 ) ) & 1 )
+#define REVERSE_FLIP(q,i)   ( (q)->reverse[(i) >> 6] ^= ( (uint64_t) 1 ) << ( (i) & 63 ) )
+#define REVERSE_CLEAR(q,i)  ( (q)->reverse[(i) >> 6] &= ~( ( (uint64_t) 1 ) << ( (i) & 63 ) ) )
+
+#define SNAPSHOT_LAYOUT     "weak"
+
+//==============================================================================
+// STATIC DECLARATIONS
+//==============================================================================
+
+static void swap( weak_heap *queue, uint32_t a, uint32_t b );
+static uint32_t d_ancestor( weak_heap *queue, uint32_t index );
+static bool join( weak_heap *queue, uint32_t i, uint32_t j );
+static void sift_up( weak_heap *queue, uint32_t index );
+static void sift_down( weak_heap *queue, uint32_t index );
+#ifndef USE_EAGER
+static void grow_heap( weak_heap *queue );
+#endif
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+weak_heap* pq_create( mem_map *map )
+{
+    weak_heap *queue = calloc( 1, sizeof( weak_heap ) );
+#ifndef USE_EAGER
+    queue->capacity = 64;
+#else
+    queue->capacity = map->capacities[0];
+#endif
+    queue->nodes = calloc( queue->capacity, sizeof( weak_node* ) );
+    queue->reverse = calloc( ( queue->capacity + 63 ) >> 6,
+        sizeof( uint64_t ) );
+    queue->map = map;
+
+    return queue;
+}
+
+void pq_destroy( weak_heap *queue )
+{
+    pq_clear( queue );
+    free( queue->reverse );
+    free( queue->nodes );
+    free( queue );
+}
+
+void pq_clear( weak_heap *queue )
+{
+    mm_clear( queue->map );
+    queue->size = 0;
+}
+
+key_type pq_get_key( weak_heap *queue, weak_node *node )
+{
+    return node->key;
+}
+
+item_type* pq_get_item( weak_heap *queue, weak_node *node )
+{
+    return (item_type*) &(node->item);
+}
+
+uint32_t pq_get_size( weak_heap *queue )
+{
+    return queue->size;
+}
+
+weak_node* pq_insert( weak_heap *queue, item_type item, key_type key )
+{
+    weak_node *node = pq_alloc_node( queue->map, 0 );
+    ITEM_ASSIGN( node->item, item );
+    node->key = key;
+
+#ifndef USE_EAGER
+    if( queue->size == queue->capacity )
+        grow_heap( queue );
+#endif
+    node->index = queue->size++;
+    queue->nodes[node->index] = node;
+
+    // a first child is always the left one
+    REVERSE_CLEAR( queue, node->index );
+    if ( ( node->index & 1 ) == 0 )
+        REVERSE_CLEAR( queue, node->index >> 1 );
+
+    sift_up( queue, node->index );
+
+    return node;
+}
+
+weak_node* pq_find_min( weak_heap *queue )
+{
+    if ( pq_empty( queue ) )
+        return NULL;
+    return queue->nodes[0];
+}
+
+key_type pq_delete_min( weak_heap *queue )
+{
+    weak_node *node = queue->nodes[0];
+    key_type key = node->key;
+
+    queue->size--;
+    if ( queue->size > 0 )
+    {
+        queue->nodes[0] = queue->nodes[queue->size];
+        queue->nodes[0]->index = 0;
+        sift_down( queue, 0 );
+    }
+
+    pq_free_node( queue->map, 0, node );
+
+    return key;
+}
+
+key_type pq_delete( weak_heap *queue, weak_node* node )
+{
+    uint32_t i, j;
+
+    // win every join on the way up, as if the key were minimal
+    for ( j = node->index; j != 0; j = i )
+    {
+        i = d_ancestor( queue, j );
+        swap( queue, i, j );
+        REVERSE_FLIP( queue, j );
+    }
+
+    return pq_delete_min( queue );
+}
+
+void pq_decrease_key( weak_heap *queue, weak_node *node,
+    key_type new_key )
+{
+    node->key = new_key;
+    sift_up( queue, node->index );
+}
+
+void pq_increase_key( weak_heap *queue, weak_node *node,
+    key_type new_key )
+{
+    node->key = new_key;
+    sift_down( queue, node->index );
+}
+
+bool pq_empty( weak_heap *queue )
+{
+    return ( queue->size == 0 );
+}
+
+pq_snapshot_header* pq_serialize( weak_heap *queue, size_t *length )
+{
+    pq_snapshot_header *snapshot = pq_snapshot_create( SNAPSHOT_LAYOUT,
+        queue->size, 0, length );
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    uint32_t i;
+
+    if( snapshot == NULL )
+        return NULL;
+
+    for( i = 0; i < queue->size; i++ )
+    {
+        entries[i].item = queue->nodes[i]->item;
+        entries[i].key = queue->nodes[i]->key;
+        entries[i].hint = REVERSE( queue, i );
+    }
+
+    return snapshot;
+}
+
+weak_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    weak_node **handles )
+{
+    pq_snapshot_entry *entries = SNAPSHOT_ENTRIES( snapshot );
+    weak_node *node;
+    uint32_t i;
+
+    if( snapshot->magic != PQ_SNAPSHOT_MAGIC )
+        return NULL;
+
+    weak_heap *queue = pq_create( map );
+    if( !pq_snapshot_matches( snapshot, SNAPSHOT_LAYOUT ) )
+    {
+        for( i = 0; i < snapshot->size; i++ )
+        {
+            node = pq_insert( queue, entries[i].item, entries[i].key );
+            if( handles != NULL )
+                handles[entries[i].item] = node;
+        }
+        return queue;
+    }
+
+#ifndef USE_EAGER
+    while( queue->capacity < snapshot->size )
+        grow_heap( queue );
+#endif
+    for( i = 0; i < snapshot->size; i++ )
+    {
+        node = pq_alloc_node( map, 0 );
+        ITEM_ASSIGN( node->item, entries[i].item );
+        node->key = entries[i].key;
+        node->index = i;
+        queue->nodes[i] = node;
+        if( entries[i].hint )
+            REVERSE_FLIP( queue, i );
+        if( handles != NULL )
+            handles[entries[i].item] = node;
+    }
+    queue->size = snapshot->size;
+
+    return queue;
+}
+
+//==============================================================================
+// STATIC METHODS
+//==============================================================================
+
+/**
+ * Exchanges the nodes at two positions, updating their index records.
+ *
+ * @param queue Queue to which both nodes belong
+ * @param a     First position
+ * @param b     Second position
+ */
+static void swap( weak_heap *queue, uint32_t a, uint32_t b )
+{
+    weak_node *temp = queue->nodes[a];
+    queue->nodes[a] = queue->nodes[b];
+    queue->nodes[b] = temp;
+    queue->nodes[a]->index = a;
+    queue->nodes[b]->index = b;
+}
+
+/**
+ * Finds the distinguished ancestor of a position, the parent of the first
+ * ancestor (or itself) which is a right child.  The element there is
+ * ordered before everything in the position's subtree.
+ *
+ * @param queue Queue to query
+ * @param index Position to start from, must not be the root
+ * @return      Position of the distinguished ancestor
+ */
+static uint32_t d_ancestor( weak_heap *queue, uint32_t index )
+{
+    while ( ( index & 1 ) == REVERSE( queue, index >> 1 ) )
+        index >>= 1;
+    return index >> 1;
+}
+
+/**
+ * Restores the order between a position and its distinguished ancestor.  If
+ * the descendant is smaller, the elements are swapped and the descendant's
+ * subtrees exchanged by flipping its reverse bit.
+ *
+ * @param queue Queue in which to operate
+ * @param i     Distinguished ancestor of j
+ * @param j     Descendant position
+ * @return      True if the elements were swapped
+ */
+static bool join( weak_heap *queue, uint32_t i, uint32_t j )
+{
+    if ( queue->nodes[j]->key < queue->nodes[i]->key )
+    {
+        swap( queue, i, j );
+        REVERSE_FLIP( queue, j );
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * Joins a position with its distinguished ancestors until an ancestor wins.
+ *
+ * @param queue Queue in which to operate
+ * @param index Position of a potentially violating node
+ */
+static void sift_up( weak_heap *queue, uint32_t index )
+{
+    uint32_t i;
+    while ( index != 0 )
+    {
+        i = d_ancestor( queue, index );
+        if ( !join( queue, i, index ) )
+            break;
+        index = i;
+    }
+}
+
+/**
+ * Restores order below a position whose key may have grown, such as a new
+ * root.  Descends the leftmost path of the position's right subtree, then
+ * joins the position with each node on it from the bottom up.
+ *
+ * @param queue Queue in which to operate
+ * @param index Position of a potentially violating node
+ */
+static void sift_down( weak_heap *queue, uint32_t index )
+{
+    uint32_t j, k;
+
+    // the root has a single child, which heads its right subtree
+    j = ( index << 1 ) + 1 - REVERSE( queue, index );
+    if ( j >= queue->size )
+        return;
+
+    while ( ( k = ( j << 1 ) + REVERSE( queue, j ) ) < queue->size )
+        j = k;
+
+    for ( ; j != index; j >>= 1 )
+        join( queue, index, j );
+}
+
+#ifndef USE_EAGER
+static void grow_heap( weak_heap *queue )
+{
+    uint32_t new_capacity = queue->capacity * 2;
+    weak_node **new_array = realloc( queue->nodes, new_capacity *
+        sizeof( weak_node* ) );
+    uint64_t *new_reverse = realloc( queue->reverse,
+        ( new_capacity >> 6 ) * sizeof( uint64_t ) );
+
+    if( new_array == NULL || new_reverse == NULL )
+        exit( -1 );
+
+    memset( new_reverse + ( queue->capacity >> 6 ), 0,
+        ( ( new_capacity - queue->capacity ) >> 6 ) * sizeof( uint64_t ) );
+    queue->capacity = new_capacity;
+    queue->nodes = new_array;
+    queue->reverse = new_reverse;
+}
+#endif
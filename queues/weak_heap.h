@@ -0,0 +1,203 @@
+#ifndef WEAK_HEAP
+#define WEAK_HEAP
+
+//==============================================================================
+// DEFINES, INCLUDES, and STRUCTS
+//==============================================================================
+
+#include "queue_common.h"
+
+/**
+ * Holds an inserted element, as well as the current index in the node array.
+ * Acts as a handle to clients for the purpose of mutability.
+ */
+struct weak_node_t
+{
+    //! Index for the item in the "tree" array
+    uint32_t index;
+
+    //! Pointer to a piece of client data
+    item_type item;
+    //! Key for the item
+    key_type key;
+} __attribute__ ((aligned(4)));
+
+typedef struct weak_node_t weak_node;
+typedef weak_node pq_node_type;
+
+/**
+ * A mutable, array-based weak heap.  Each element is no greater than the
+ * elements in its right subtree, and the root has no left subtree.  Position
+ * i has children 2i + r(i) and 2i + 1 - r(i), where the reverse bits r are
+ * kept in a bit vector, so swapping two subtrees is a single bit flip.
+ * Deleting the minimum takes at most ceil(lg n) comparisons, for
+ * n lg n - n + O(n) over a full sort.
+ */
+struct weak_heap_t
+{
+    //! Memory map to use for node allocation
+    mem_map *map;
+    //! The array of node pointers encoding the tree structure
+    weak_node **nodes;
+    //! Reverse bits, one per array position
+    uint64_t *reverse;
+    //! The number of items held in the queue
+    uint32_t size;
+    //! Current capacity of the heap
+    uint32_t capacity;
+} __attribute__ ((aligned(4)));
+
+typedef struct weak_heap_t weak_heap;
+typedef weak_heap pq_type;
+
+//==============================================================================
+// PUBLIC DECLARATIONS
+//==============================================================================
+
+/**
+ * Creates a new, empty queue.
+ *
+ * @param map   Memory map to use for node allocation
+ * @return      Pointer to the new queue
+ */
+weak_heap* pq_create( mem_map *map );
+
+/**
+ * Frees all the memory used by the queue.
+ *
+ * @param queue Queue to destroy
+ */
+void pq_destroy( weak_heap *queue );
+
+/**
+ * Removes all items from the queue, leaving it empty.
+ *
+ * @param queue Queue to clear
+ */
+void pq_clear( weak_heap *queue );
+
+/**
+ * Returns the key associated with the queried node.
+ *
+ * @param queue Queue to which node belongs
+ * @param node  Node to query
+ * @return      Node's key
+ */
+key_type pq_get_key( weak_heap *queue, weak_node *node );
+
+/**
+ * Returns the item associated with the queried node.
+ *
+ * @param queue Queue to which node belongs
+ * @param node  Node to query
+ * @return      Node's item
+ */
+item_type* pq_get_item( weak_heap *queue, weak_node *node );
+
+/**
+ * Returns the current size of the queue.
+ *
+ * @param queue Queue to query
+ * @return      Size of queue
+ */
+uint32_t pq_get_size( weak_heap *queue );
+
+/**
+ * Takes an item-key pair to insert into the queue and creates a new
+ * corresponding node.  Places the node in the next open spot and joins it
+ * with its distinguished ancestors until the weak heap order holds.
+ *
+ * @param queue Queue to insert into
+ * @param item  Item to insert
+ * @param key   Key to use for node priority
+ * @return      Pointer to corresponding node
+ */
+weak_node* pq_insert( weak_heap *queue, item_type item, key_type key );
+
+/**
+ * Returns the minimum item from the queue without modifying the queue.
+ *
+ * @param queue Queue to query
+ * @return      Node with minimum key
+ */
+weak_node* pq_find_min( weak_heap *queue );
+
+/**
+ * Removes the minimum item from the queue and returns it.  Moves the last
+ * node to the root and joins it bottom-up with the nodes on the leftmost
+ * path of the root's right subtree.
+ *
+ * @param queue Queue to query
+ * @return      Minimum key, corresponding to item deleted
+ */
+key_type pq_delete_min( weak_heap *queue ) ;
+
+/**
+ * Removes an arbitrary item from the queue.  Swaps the node up along its
+ * distinguished ancestors to the root, as if its key were minimal, and
+ * then removes it as the minimum.
+ *
+ * @param queue Queue in which the node resides
+ * @param node  Pointer to node corresponding to the target item
+ * @return      Key of item removed
+ */
+key_type pq_delete( weak_heap *queue, weak_node* node );
+
+/**
+ * If the item in the queue is modified in such a way as to decrease the
+ * key, then this function will update the queue to preserve the heap invariant
+ * given a pointer to the corresponding node.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_decrease_key( weak_heap *queue, weak_node *node,
+    key_type new_key );
+
+/**
+ * If the item in the queue is modified in such a way as to increase the key,
+ * then this function will update the queue to preserve the heap invariant
+ * given a pointer to the corresponding node.  Joins the node with the leftmost
+ * path of its right subtree from the bottom up, as after a deletion at the
+ * root.
+ *
+ * @param queue     Queue in which the node resides
+ * @param node      Node to change
+ * @param new_key   New key to use for the given node
+ */
+void pq_increase_key( weak_heap *queue, weak_node *node, key_type new_key );
+
+/**
+ * Determines whether the queue is empty, or if it holds some items.
+ *
+ * @param queue Queue to query
+ * @return      True if queue holds nothing, false otherwise
+ */
+bool pq_empty( weak_heap *queue );
+
+/**
+ * Writes a snapshot of the queue, every item with its key.  Nodes are written
+ * in array order, each with its reverse bit as the hint.
+ *
+ * @param queue     Queue to save
+ * @param length    Output length of the snapshot in bytes
+ * @return          Snapshot allocated with malloc, NULL on failure
+ */
+pq_snapshot_header* pq_serialize( weak_heap *queue, size_t *length );
+
+/**
+ * Creates a queue holding the items of a snapshot.  A snapshot of a weak heap
+ * is copied straight into the array without comparing keys.  A snapshot of
+ * another queue type is restored by inserting its items one by one.
+ *
+ * @param map       Memory map to use for node allocation
+ * @param snapshot  Snapshot to restore
+ * @param handles   Table indexed by item that receives the node of each
+ *                  item, or NULL
+ * @return          Pointer to the new queue, NULL if the snapshot is invalid
+ */
+weak_heap* pq_deserialize( mem_map *map, pq_snapshot_header *snapshot,
+    weak_node **handles );
+
+#endif
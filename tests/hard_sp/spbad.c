@@ -18,6 +18,11 @@
 #include <math.h>
 
 #include "random.c"
+#include "../../csr_tools.h"
+
+/* binary CSR copy of the output, see csr_tools.h */
+csr_builder *csr_out = NULL;
+char        *csr_path = NULL;
 
 #define DASH '-'
 #define VERY_FAR 100000000
@@ -31,6 +36,7 @@ double ceil(double);  /* I've found this out through hard experience */
 #define PRINT_ARC( i, j, length )\
 {\
    printf ("a %8ld %8ld %12ld\n", i, j, length );\
+   if ( csr_out != NULL ) csr_builder_add_arc ( csr_out, i, j, length );\
 }
 
 /* generator of shortest path problems 
@@ -74,7 +80,7 @@ char* argv[];
   if (( args[0] == DASH ) && ( args[1] == 'h'))
       goto help;
 
-  if (argc > 4) goto usage;
+  if (argc > 5) goto usage;
 
   /* first parameter - number of nodes */
   np = 1;
@@ -90,6 +96,11 @@ char* argv[];
   seed = 31415; /* default */
  
  for (np = 3; np < argc; np++) {
+    if (argv[np][0] == DASH && argv[np][1] == 'b') {
+      /* binary CSR copy of the graph */
+      csr_path = &argv[np][2];
+      continue;
+    }
     strcpy ( args, argv[np] );
     if (args[0] != DASH) goto usage;
     if (args[1] == 'l')
@@ -110,6 +121,12 @@ char* argv[];
   head = (long *) calloc(n+1, sizeof(long));
   
 
+  if (csr_path != NULL)
+    if ((csr_out = csr_builder_create(CSR_PROBLEM_SP, n, m)) == NULL) {
+      fprintf(stderr, "\nCan't obtain memory for binary graph\n\n");
+      exit(2);
+    }
+
   /* start output */
   printf ("c bad problem for Dijkstra's algorithm\n");
   printf ("c extended DIMACS format\nc\n" );
@@ -118,6 +135,8 @@ char* argv[];
 
   source = 1;
   printf ("n %8ld\nc\n", source );
+  if (csr_out != NULL)
+    csr_out->source = source;
 
   /* generate cycle */
   for (i = 1; i < n; i++)
@@ -180,6 +199,15 @@ char* argv[];
       }
   }
 
+  /* binary CSR version of everything printed above */
+  if (csr_out != NULL) {
+    fflush(stdout);
+    if (csr_builder_write(csr_out, csr_path) != 0) {
+      fprintf(stderr, "\nCan't write binary graph to '%s'\n\n", csr_path);
+      exit(2);
+    }
+  }
+
   /* all is done */
   exit (0);
 
@@ -187,7 +215,7 @@ char* argv[];
 
  usage:
   fprintf ( stderr,
-	      "\nusage: %s  n  d [-l#i] [-s#i]\n help:  %s -h\n must have n > 1, 1 <= d < n\n\n", argv[0], argv[0]);
+	      "\nusage: %s  n  d [-l#i] [-s#i] [-b<file>]\n help:  %s -h\n must have n > 1, 1 <= d < n\n\n", argv[0], argv[0]);
 
   exit (4);
 
@@ -196,7 +224,7 @@ char* argv[];
  help:
 
   fprintf ( stderr, 
-	      "\n'%s' - Dijkstra-worst-case shortest path problem generator.\n Generates problems in extended DIMACS format.\n \n %s  n d [ -l#i] \n #i - integer number   #f - real number\n \n n     - number of nodes, must be 2 or more\n, d     - out-degree, must be 1 or more\n, -l#i  - arc lengths multiplier         (default 1)\n -s#i  - seed \n",
+	      "\n'%s' - Dijkstra-worst-case shortest path problem generator.\n Generates problems in extended DIMACS format.\n \n %s  n d [ -l#i] \n #i - integer number   #f - real number\n \n n     - number of nodes, must be 2 or more\n, d     - out-degree, must be 1 or more\n, -l#i  - arc lengths multiplier         (default 1)\n -s#i  - seed \n -b<file> - also write the graph in binary CSR form to <file>\n",
 argv[0], argv[0], argv[0] );
 
 exit (0);
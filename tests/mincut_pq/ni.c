@@ -44,8 +44,10 @@
 
 #include "../../trace_tools.h"
 #include "types_ni.h"
+#ifndef NI_BENCH
 #include "heap.h"
 #include "heap.c"
+#endif
 /**CH5 comented out #include "timer.c"*/ 
 
 /************************************************ shared macros *******/
@@ -96,7 +98,6 @@ arc  **aStack;             /* set of arcs to contract */
 arc  **aTOS;               /* top of stack pointer */
 
 int64_t minCap;            /* minimum cut capacity seen */
-heap   h;
 
 long   input_n,            /* original number of nodes */
        currentN,          /* current number of nodes */
@@ -117,6 +118,9 @@ arc *lastA;
 
 arc   d_arc;                 /* dummy arc - for technical reasons */
 
+#ifndef NI_BENCH
+heap   h;
+
 int trace_file;
 pq_trace_header header;
 pq_op_create op_create;
@@ -127,6 +131,51 @@ pq_op_find_min op_find_min;
 pq_op_delete_min op_delete_min;
 pq_op_delete_min op_get_size;
 
+/************************************ priority queue interface *******/
+/* phase() reaches the queue only through the Q* macros.  Here they   */
+/* drive the 3-ary heap of heap.c and record every call in the trace; */
+/* ni_bench.c defines NI_BENCH and maps them onto a pq_* queue.       */
+
+#define QInit() makeHeap ( h, input_n )
+
+#define QNonEmpty() nonEmptyH ( h )
+
+#define QInsert( v ) \
+{\
+  hInsert ( h, v );\
+  op_insert.node_id = v - nodes;\
+  op_insert.item = v - nodes;\
+  op_insert.key = MAX_INT64 - v -> key;\
+  pq_trace_write_op( trace_file, &op_insert );\
+  header.op_count++;\
+  header.node_ids++;\
+}
+
+#define QExtractMax( v ) \
+{\
+  extractMax ( h, v );\
+  pq_trace_write_op( trace_file, &op_delete_min );\
+  header.op_count++;\
+}
+
+/* a key increase in this max-queue moves the node towards the top, */
+/* which on the complemented keys is a decrease-key in a min-queue  */
+#define QIncreaseKey( v ) \
+{\
+  increaseKey ( h, v, v -> key );\
+  op_decrease_key.node_id = v - nodes;\
+  op_decrease_key.key = MAX_INT64 - v -> key;\
+  pq_trace_write_op( trace_file, &op_decrease_key );\
+  header.op_count++;\
+}
+
+#define QTraceSize() \
+{\
+  pq_trace_write_op( trace_file, &op_get_size );\
+  header.op_count++;\
+}
+#endif
+
 #ifdef HYBRID
 node *last_node;		
 #endif
@@ -342,21 +391,11 @@ void *phase ( node *v )
 
   numPhases++;
 
-  hInsert(h, v);
-/***CH5***/
-    op_insert.node_id = v - nodes;
-    op_insert.item = v - nodes;
-    op_insert.key = MAX_INT64 - v->key;
-    pq_trace_write_op( trace_file, &op_insert );
-    header.op_count++;
-    header.node_ids++;
-    
+  QInsert ( v );
+
   do {
 
-    extractMax ( h, v1 );
-/***CH5**/
-    pq_trace_write_op( trace_file, &op_delete_min );
-    header.op_count++;
+    QExtractMax ( v1 );
 
     /* scan v */
     phaseScans++;
@@ -366,10 +405,9 @@ void *phase ( node *v )
     alphaP += v1 -> cap -  2 * (v1 -> key>>32);
 
 /***CH5***/
-    pq_trace_write_op( trace_file, &op_get_size );
-    header.op_count++;
+    QTraceSize ();
 
-    if ( alphaP < minCap && nonEmptyH( h )) {
+    if ( alphaP < minCap && QNonEmpty ()) {
       newMinCut++;
       minCap = alphaP;
 #ifdef SAVECUT
@@ -389,29 +427,16 @@ void *phase ( node *v )
 	}
 	if ( (int64_t)(w -> key & MASK_PRIO) == 0 ) {
 	  w -> key = (int64_t)(newKey << 32) | (int64_t)(w - nodes);
-	  hInsert ( h, w );
-/***CH5***/
-    op_insert.node_id = w - nodes;
-    op_insert.item = w - nodes;
-    op_insert.key = MAX_INT64 - w->key;
-    pq_trace_write_op( trace_file, &op_insert );
-    header.op_count++;
-    header.node_ids++;
-	  
+	  QInsert ( w );
 	}
 	else {
 	  w -> key = (int64_t)(newKey<<32) | (int64_t)(w-nodes);
-	  increaseKey ( h, w, w->key );
-/***CH5***/
-    op_decrease_key.node_id = w - nodes;
-    op_decrease_key.key = MAX_INT64 - w->key;
-    pq_trace_write_op( trace_file, &op_decrease_key );
-    header.op_count++;
+	  QIncreaseKey ( w );
 	}
       }
     }
 
-  } while ( nonEmptyH ( h ) );
+  } while ( QNonEmpty () );
 
 
   if ( phaseScans == currentN ) 
@@ -459,9 +484,11 @@ void mainInit ()
 
   newMinCut = 0;
 /*  timeStamp = 0; */
-  makeHeap ( h, input_n );
+  QInit ();
 
-  aStack = (arc **) calloc ( 2 * input_m + 1, sizeof (arc*));
+  /* kept across runs, ni_bench.c solves the same graph repeatedly */
+  if ( aStack == NULL )
+    aStack = (arc **) calloc ( 2 * input_m + 1, sizeof (arc*));
   if ( aStack == NULL ) {
     fprintf( stderr, "can't obtain enough memory to solve this problem\n");
     exit ( 4 );
@@ -784,7 +811,52 @@ int PR34(arc *a)
 #endif
 #endif
 
-int trace_file;
+void minCut ()
+/* alternate contraction and scanning phases until one node is left */
+{
+  node  *v;
+  int beforen;
+  int first_iteration = 1;
+
+  do {
+    compact ();
+
+#ifdef HYBRID
+    PR_Hybrid(last_node);
+    if ( currentN <= 2 )
+      break;
+#else
+#ifndef NO_PR
+
+    if (first_iteration)
+      {
+	beforen = currentN * 10;
+	while ((currentN <= beforen *.5) && (currentN >= 3)) {
+	  beforen = currentN;
+	  PRTest12();
+	}
+/**CH5  printf("c pnodes:  %12d\n",currentN);*/
+/**CH5  printf("c ptime: %14.2f\n", timer() - t); */ 
+
+	first_iteration = 0; 
+      }
+    else
+      PRTest12();
+
+    if ( currentN <= 1 )
+      break;
+#endif
+#endif
+
+    v = findLeader ( nodes );
+    phase ( v );
+    if ( currentN <= 1 )
+      break;
+
+  } while ( 1 );
+}
+
+#ifndef NI_BENCH
 
 main (argc, argv )
 
@@ -793,11 +865,6 @@ char *argv[];
 
 {
 
-  arc *a;
-  node  *v;
-  int beforen;
-  int first_iteration = 1;
-
   header.op_count = 0;
   header.pq_ids = 1;
   header.node_ids = 0;
@@ -833,7 +900,6 @@ char *argv[];
 
   /* initialization */
   mainInit ();
-  v = nodes;
 
 /**CH5 printf("c nodes:   %12d    arcs:     %15d\n", input_n, input_m);*/
 
@@ -841,42 +907,7 @@ char *argv[];
 
   cutCapInit ();
   /* main loop */
-  do {
-    compact ();
-
-#ifdef HYBRID
-    PR_Hybrid(last_node);
-    if ( currentN <= 2 )
-      break;
-#else
-#ifndef NO_PR
-
-    if (first_iteration)
-      {
-	beforen = currentN * 10;
-	while ((currentN <= beforen *.5) && (currentN >= 3)) {
-	  beforen = currentN;
-	  PRTest12();
-	}
-/**CH5  printf("c pnodes:  %12d\n",currentN);*/
-/**CH5  printf("c ptime: %14.2f\n", timer() - t); */ 
-
-	first_iteration = 0; 
-      }
-    else
-      PRTest12();
-
-    if ( currentN <= 1 )
-      break;
-#endif
-#endif
-
-    v = findLeader ( nodes );
-    phase ( v );
-    if ( currentN <= 1 )
-      break;
-
-  } while ( 1 );
+  minCut ();
 
     pq_trace_write_op( trace_file, &op_destroy );
     header.op_count++;
@@ -887,3 +918,5 @@ char *argv[];
 
 }
 
+#endif
+
@@ -0,0 +1,276 @@
+/***********************************************************/
+/*                                                         */
+/*     In-process Nagamochi-Ibaraki min-cut benchmark      */
+/*                                                         */
+/***********************************************************/
+
+/*
+ * Runs the min-cut code of ni.c directly against the queue selected at compile
+ * time through the pq_* API (same USE_* flags as the trace driver) instead of
+ * its built-in 3-ary heap.  ni.c is included with NI_BENCH defined, which
+ * drops its heap, its trace output and its main and leaves the queue calls in
+ * phase() to the Q* macros below.  The max-queue is mapped onto the min-queue
+ * exactly as in the traces: keys are stored as MAX_INT64 - key and a key
+ * increase becomes pq_decrease_key.  Usage:
+ *
+ *   ni_<queue> [reps] < problem
+ *
+ * The problem is read once (text or its binary .csr cache, see csr_tools.h)
+ * and the graph is restored from a snapshot before every run, so each run
+ * performs exactly the same contractions.  One line is printed with the
+ * queue operation counts, the peak number of queue nodes, the cut found and
+ * the average wall time.  Built with CACHEGRIND, a single untimed run is
+ * made, which is meant to be profiled with valgrind --tool=cachegrind.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+
+#ifdef USE_EAGER
+    #include "../../memory_management_eager.h"
+#elif USE_LAZY
+    #include "../../memory_management_lazy.h"
+#else
+    #include "../../memory_management_dumb.h"
+#endif
+
+#ifdef USE_BINOMIAL
+    #include "../../queues/binomial_queue.h"
+#elif defined USE_EXPLICIT_2
+    #include "../../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_4
+    #include "../../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_8
+    #include "../../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_16
+    #include "../../queues/explicit_heap.h"
+#elif defined USE_FIBONACCI
+    #include "../../queues/fibonacci_heap.h"
+#elif defined USE_IMPLICIT_2
+    #include "../../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_4
+    #include "../../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_8
+    #include "../../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_16
+    #include "../../queues/implicit_heap.h"
+#elif defined USE_WEAK
+    #include "../../queues/weak_heap.h"
+#elif defined USE_PAIRING
+    #include "../../queues/pairing_heap.h"
+#elif defined USE_SMOOTH
+    #include "../../queues/smooth_heap.h"
+#elif defined USE_QUAKE
+    #include "../../queues/quake_heap.h"
+#elif defined USE_RANK_PAIRING
+    #include "../../queues/rank_pairing_heap.h"
+#elif defined USE_RANK_RELAXED_WEAK
+    #include "../../queues/rank_relaxed_weak_queue.h"
+#elif defined USE_STRICT_FIBONACCI
+    #include "../../queues/strict_fibonacci_heap.h"
+#elif defined USE_VIOLATION
+    #include "../../queues/violation_heap.h"
+#elif defined USE_HOLLOW
+    #include "../../queues/hollow_heap.h"
+#endif
+
+#ifdef USE_STRICT_FIBONACCI
+    static uint32_t mem_types = 3;
+    static uint32_t mem_sizes[3] =
+    {
+        sizeof( strict_fibonacci_node ),
+        sizeof( active_record ),
+        sizeof( rank_record )
+    };
+    static uint32_t mem_capacities[3] =
+    {
+        0,
+        1000,
+        1000
+    };
+#elif defined USE_HOLLOW
+    static uint32_t mem_types = 2;
+    static uint32_t mem_sizes[2] =
+    {
+        sizeof( hollow_item ),
+        sizeof( hollow_node )
+    };
+    static uint32_t mem_capacities[2] =
+    {
+        0,
+        0
+    };
+#elif defined USE_QUAKE
+    static uint32_t mem_types = 2;
+    static uint32_t mem_sizes[2] =
+    {
+        sizeof( quake_item ),
+        sizeof( quake_node )
+    };
+    static uint32_t mem_capacities[2] =
+    {
+        0,
+        0
+    };
+#else
+    static uint32_t mem_types = 1;
+    static uint32_t mem_sizes[1] =
+    {
+        sizeof( pq_node_type )
+    };
+    static uint32_t mem_capacities[1] =
+    {
+        0
+    };
+#endif
+
+#define NI_BENCH
+
+// queue under test and the handle of every graph node currently in it
+static pq_type *queue;
+static pq_node_type **handles;
+
+static uint64_t count_insert;
+static uint64_t count_delete_min;
+static uint64_t count_decrease_key;
+
+#define QInit()
+
+#define QNonEmpty() ( !pq_empty( queue ) )
+
+#define QInsert( v )                                                        \
+{                                                                           \
+    handles[(v) - nodes] = pq_insert( queue, (v) - nodes,                   \
+        MAX_INT64 - (v)->key );                                             \
+    count_insert++;                                                         \
+}
+
+// items are node ids, so the maximum is recovered before it is deleted
+#define QExtractMax( v )                                                    \
+{                                                                           \
+    v = nodes + *pq_get_item( queue, pq_find_min( queue ) );                \
+    pq_delete_min( queue );                                                 \
+    count_delete_min++;                                                     \
+}
+
+#define QIncreaseKey( v )                                                   \
+{                                                                           \
+    pq_decrease_key( queue, handles[(v) - nodes], MAX_INT64 - (v)->key );   \
+    count_decrease_key++;                                                   \
+}
+
+#define QTraceSize()
+
+#include "ni.c"
+
+#ifndef CACHEGRIND
+static uint64_t elapsed_usec( struct timeval *t0, struct timeval *t1 );
+#endif
+
+int main( int argc, char **argv )
+{
+    uint32_t r;
+#ifndef CACHEGRIND
+    struct timeval t0, t1;
+    uint64_t total_time = 0;
+#endif
+
+    uint32_t reps = ( argc > 1 ) ? atoi( argv[1] ) : 3;
+    if( reps < 1 )
+    {
+        fprintf( stderr, "usage: %s [reps] < problem\n", argv[0] );
+        return -1;
+    }
+
+    parse();
+
+    // contraction rewrites both arrays, so runs start from a copy of them
+    uint64_t node_count = sentinelNode - nodes;
+    uint64_t arc_count = ( last_r_arc + 1 ) - arcs;
+    node *node_copy = malloc( node_count * sizeof( node ) );
+    arc *arc_copy = malloc( arc_count * sizeof( arc ) );
+    handles = calloc( node_count, sizeof( pq_node_type* ) );
+    if( node_copy == NULL || arc_copy == NULL || handles == NULL )
+    {
+        fprintf( stderr, "Calloc fail.\n" );
+        return -1;
+    }
+    memcpy( node_copy, nodes, node_count * sizeof( node ) );
+    memcpy( arc_copy, arcs, arc_count * sizeof( arc ) );
+
+    mem_capacities[0] = node_count;
+#ifdef USE_QUAKE
+    // decay keeps each height at most ALPHA times the one below, bounding
+    // internal nodes by ALPHA / ( 1 - ALPHA ) = 3 per item
+    mem_capacities[1] = ( node_count * 3 ) + 1;
+#endif
+#ifdef USE_HOLLOW
+    // rebuilds keep hollow nodes from outnumbering the items
+    mem_capacities[1] = ( node_count << 1 ) + 1;
+#endif
+
+#ifdef USE_EAGER
+    mem_map *map = mm_create( mem_types, mem_sizes, mem_capacities );
+#else
+    mem_map *map = mm_create( mem_types, mem_sizes );
+#endif
+
+#ifdef CACHEGRIND
+    reps = 1;
+#endif
+    for( r = 0; r < reps; r++ )
+    {
+        memcpy( nodes, node_copy, node_count * sizeof( node ) );
+        memcpy( arcs, arc_copy, arc_count * sizeof( arc ) );
+        count_insert = 0;
+        count_delete_min = 0;
+        count_decrease_key = 0;
+        mm_clear( map );
+
+#ifndef CACHEGRIND
+        gettimeofday( &t0, NULL );
+#endif
+        queue = pq_create( map );
+        mainInit();
+        cutCapInit();
+        minCut();
+        pq_destroy( queue );
+#ifndef CACHEGRIND
+        gettimeofday( &t1, NULL );
+        total_time += elapsed_usec( &t0, &t1 );
+#endif
+    }
+
+    printf( "ni n=%ld m=%ld phases=%ld scans=%ld inserts=%llu "
+        "delete_mins=%llu decrease_keys=%llu peak_nodes=%u mincut=%lld",
+        input_n, input_m, numPhases, numScans,
+        (unsigned long long) count_insert,
+        (unsigned long long) count_delete_min,
+        (unsigned long long) count_decrease_key, mm_peak_nodes( map, 0 ),
+        (long long) minCap );
+#ifndef CACHEGRIND
+    uint64_t run_time = total_time / reps;
+    uint64_t ops = count_insert + count_delete_min + count_decrease_key;
+    printf( " time_us=%llu ops_per_sec=%.0f", (unsigned long long) run_time,
+        ops / ( ( run_time + 1 ) / 1e6 ) );
+#endif
+    printf( "\n" );
+
+    mm_destroy( map );
+    free( handles );
+    free( arc_copy );
+    free( node_copy );
+
+    return 0;
+}
+
+#ifndef CACHEGRIND
+static uint64_t elapsed_usec( struct timeval *t0, struct timeval *t1 )
+{
+    return ( t1->tv_sec - t0->tv_sec ) * 1000000 +
+        ( t1->tv_usec - t0->tv_usec );
+}
+#endif
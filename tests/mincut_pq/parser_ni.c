@@ -1,6 +1,9 @@
 /* parser for getting  DIMACS format input and transforming the
    data to the internal representation */
 
+#include <unistd.h>
+#include "../../csr_tools.h"
+
 #define MAXLINE       100	/* max line length in the input file */
 #define ARC_FIELDS      3	/* no of fields in arc line  */
 #define P_FIELDS        3       /* no of fields in problem line */
@@ -76,9 +79,11 @@ long    no_lines=0,             /* no of current input line */
         no_alines=0;            /* no of arc-lines */
 
 char    in_line[MAXLINE],       /* for reading input line */
-        pr_type[3];             /* for reading type of the problem */
+        pr_type[4];             /* for reading type of the problem */
 
 long    k;                      /* temporary */
+uint64_t c;                     /* arc number in the cache */
+csr_graph *cache;               /* binary version of the input */
 int     err_no;                 /* no of detected error */
 
 /* -------------- error numbers & error messages ---------------- */
@@ -132,6 +137,81 @@ static char *err_message[] =
   };
 /* --------------------------------------------------------------- */
 
+/* allocates nodes and arcs once input_n and input_m are known */
+#define ALLOCATE_ARCS \
+{ \
+  n = input_n + 1; \
+  m = 2 * input_m; \
+  pnodes    = (node *) calloc ( n+1, sizeof(node) ); \
+  parcs     = (arc *)  calloc ( m+3, sizeof(arc) ); \
+  if ( pnodes == NULL || parcs == NULL ) \
+    /* memory is not allocated */ \
+    { err_no = EN6; goto error; } \
+  for ( i_n = pnodes; i_n < pnodes + n + 1; i_n++ ) \
+    i_n -> first = NULL; \
+  /* setting pointer to the first arc */ \
+  sentinel_arc = parcs + input_m + 1; \
+  r_arcs   = sentinel_arc + 1; \
+  arc_current = sentinel_arc - 1; \
+  r_arc_current = r_arcs; \
+  node_max = 0; \
+  node_min = n; \
+}
+
+/* stores arc (tail, head, acap) and its reverse */
+#define STORE_ARC \
+{ \
+  i_n    = pnodes + tail; \
+  j_n    = pnodes + head; \
+  arc_current       -> head    = j_n; \
+  arc_current       -> cap     = acap; \
+  arc_current       -> next    = i_n -> first; \
+  i_n -> first = arc_current; \
+  r_arc_current -> head    = i_n; \
+  r_arc_current -> cap     = acap; \
+  r_arc_current -> next    = j_n -> first; \
+  j_n -> first = r_arc_current; \
+  /* searching for minimum and maximum node */ \
+  if ( head < node_min ) node_min = head; \
+  if ( tail < node_min ) node_min = tail; \
+  if ( head > node_max ) node_max = head; \
+  if ( tail > node_max ) node_max = tail; \
+  no_alines   ++; \
+  arc_current --; \
+  r_arc_current ++; \
+}
+
+/* --------------------------------------------------------------- */
+
+/* a binary cache of the input (see csr_tools.h) replaces the text;
+   arcs are replayed grouped by tail, so unless the text is sorted by
+   tail the adjacency lists come out in a different (equally valid) order */
+
+cache = csr_map_cached ( STDIN_FILENO );
+if ( cache != NULL && cache -> problem != CSR_PROBLEM_CUT )
+  { csr_destroy ( cache ); cache = NULL; }
+
+if ( cache != NULL )
+  {
+    input_n = cache -> declared_nodes;
+    input_m = cache -> arc_count;
+    ALLOCATE_ARCS;
+
+    for ( k = 0; k < cache -> node_count; k ++ )
+      {
+        tail = cache -> first_id + k;
+        for ( c = cache -> offsets[k]; c < cache -> offsets[k+1]; c ++ )
+          {
+            head = cache -> first_id + cache -> targets[c];
+            acap = cache -> weights[c];
+            STORE_ARC;
+          }
+      }
+
+    csr_destroy ( cache );
+    goto parsed;
+  }
+
 while ( gets ( in_line ) != NULL )
   {
   no_lines ++;
@@ -167,28 +247,7 @@ while ( gets ( in_line ) != NULL )
 		    /*wrong value of no of arcs or nodes*/
 		    { err_no = EN4; goto error; }
 
-		n = input_n + 1;
-		m = 2 * input_m;
-
-
-		/* allocating memory */
-                pnodes    = (node *) calloc ( n+1, sizeof(node) );
-		parcs     = (arc *)  calloc ( m+3, sizeof(arc) );
-
-                if ( pnodes == NULL || parcs == NULL )
-                    /* memory is not allocated */
-		    { err_no = EN6; goto error; }
-		     
-		for ( i_n = pnodes; i_n < pnodes + n + 1; i_n++ )
-		  i_n -> first = NULL;
-
-		/* setting pointer to the first arc */
-		sentinel_arc = parcs + input_m + 1;
-		r_arcs   = sentinel_arc + 1;
-		arc_current = sentinel_arc - 1;
-		r_arc_current = r_arcs;
-                node_max = 0;
-                node_min = n;
+		ALLOCATE_ARCS;
                 break;
 
       case 'a':                    /* arc description */
@@ -215,29 +274,7 @@ while ( gets ( in_line ) != NULL )
                     /* wrong value of nodes */
 		    { err_no = EN17; goto error; }
 
-		i_n    = pnodes + tail;
-		j_n    = pnodes + head;
-
-                /* storing information about the arc */
-		arc_current       -> head    = j_n;
-		arc_current       -> cap     = acap;
-		arc_current       -> next    = i_n -> first;
-		i_n -> first = arc_current;
-		
-		r_arc_current -> head    = i_n;
-		r_arc_current -> cap     = acap;
-		r_arc_current -> next    = j_n -> first;
-		j_n -> first = r_arc_current;
-
-		/* searching for minimum and maximum node */
-                if ( head < node_min ) node_min = head;
-                if ( tail < node_min ) node_min = tail;
-                if ( head > node_max ) node_max = head;
-                if ( tail > node_max ) node_max = tail;
-
-		no_alines   ++;
-		arc_current --;
-		r_arc_current ++;
+		STORE_ARC;
 
 		break;
 
@@ -260,6 +297,8 @@ if ( no_lines == 0 ) /* empty input */
 if ( no_alines < input_m ) /* not enough arcs */
   { err_no = EN19; goto error; } 
 
+ parsed:
+
 sentinelNode = pnodes + node_max + 1;
 
 arcs = arc_current + 1;
@@ -1,294 +1,417 @@
-/**********************************************************
- *
- * PQRandom.c - generates a random set of priority
- * queue function call traces for a DIMACS priority
- * queue driver
- *
- * pq.c - a  basic heap implementation
- * dimacs_input.c - functions for reading in commands
- *
- * queue items:
- * name - uint32_t : unique,persistent name for each item.
- * prio - uint64_t: high 32 bits is random priority in [1,MAXPRIO]
- *                  low 32 bits is a copy of the name to ensure unique priorities
- *
- * Benjamin Chang (bcchang@unix.amherst.edu) 8/96
- * Modified by Dan Larkin (dhlarkin@cs.princeton.edu) 6/12
- *********************************************************/
-
-#include <stdio.h>
-#include <time.h>
-#include <fcntl.h>
-#include <unistd.h>
-#include <stdlib.h>
-
-#include "dimacs_input.h"
-#include "pq.h"
-#include "../../trace_tools.h"
-
-#define MASK_PRIO 0xFFFFFFFF00000000
-#define MASK_NAME 0x00000000FFFFFFFF
-
-#define PQ_MIN(a,b) ( ( b < a ) ? b : a )
-
-#define true 1
-#define false 0
-
-/* Q is the priority queue */
-pq_ptr Q;
-
-int trace_file;
-
-/* newname is an increasing value - each new item gets a unique name */
-uint64_t newname=1;
-
-long int seed=0;  /* seed value */
-uint64_t Maxprio = 0x00000000FFFFFFFF;  /* Max priority */
-uint64_t init;    /* number of initial inserts */
-uint64_t reps;    /* number of repetitions of main loop */
-
-pq_trace_header header;
-pq_op_create op_create;
-pq_op_destroy op_destroy;
-pq_op_insert op_insert;
-pq_op_decrease_key op_decrease_key;
-pq_op_find_min op_find_min;
-pq_op_delete_min op_delete_min;
-
-/* with[]: flags to determine whether to perform each op. in main loop */
-int with[6]={false,false,false,false,false,false};
-cmd2type cmdstable[5]={"NUL","ins","dcr","fmn","dmn"};
-
-/****************** my_rand () ***************************************/
-/* return integers in [0,range-1] */
-uint64_t my_rand(uint64_t range)
-{
-  double foo;
-  foo=((double) drand48() * (double)range);
-  return (uint64_t) foo;
-}
-
-/**************** dcr_amnt () *********************************************/
-/* return a new random priority in [min,prio]
-   where min is the current minimum priority and prio is the current prio */
-uint64_t dcr_amnt (pr_type prio)
-{
- it_type minitem=HeapFindMin(Q);
- uint64_t minprio = ( prioval(Q,minitem) & MASK_PRIO ) >> 32;
- uint64_t realprio = ( prio & MASK_PRIO ) >> 32;
- uint64_t name = prio & MASK_NAME;
-
- uint64_t new=my_rand(realprio-minprio)+minprio;
-
- return ( new << 32 ) | name;
-}
-
-/**************** dcr_amnt () *********************************************/
-/* return a new random priority in [min,prio]
-   where min is the current minimum priority and prio is the current prio */
-uint64_t dcr_min_amnt (pr_type prio)
-{
- it_type minitem=HeapFindMin(Q);
- uint64_t minprio = ( prioval(Q,minitem) & MASK_PRIO ) >> 32;
- uint64_t name = prio & MASK_NAME;
-
- uint64_t new=minprio;
- if( new > 0 )
-  new--;
-
- return ( new << 32 ) | name;
-}
-
-/****************************** DoInsert ***********************************/
-void DoInsert ()
-{
-  in_type info;
-  pr_type prio;
-
-  if (Q->size>MAXITEMS) {
-          printf ("Too many items.  increase MAXITEMS.\n");
-          exit(1);
-	}
-  else {
-   info=newname;
-
-   prio=(my_rand(Maxprio)<<32) | newname;
-   HeapInsert (Q,info,prio);
-
-    op_insert.node_id = newname;
-    op_insert.item = (uint32_t) info;
-    op_insert.key = prio;
-    pq_trace_write_op( trace_file, &op_insert );
-
-   ++newname;
-   header.op_count++;
-   header.node_ids++;
- }
-}
-/**************************** DoDecrease ***********************************/
-void DoDecrease ()
-{
-  it_type item;
-  pr_type newprio;
-  pr_type oldprio;
-
-  if (Q->size) {
-    item=my_rand(Q->size)+1;
-
-    oldprio=Q->data[item].prio;
-    newprio=dcr_amnt (oldprio);
-    HeapDecreaseKey (Q,item,newprio);
-
-    op_decrease_key.node_id = (uint32_t)(oldprio & MASK_NAME);
-    op_decrease_key.key = newprio;
-    pq_trace_write_op( trace_file, &op_decrease_key );
-
-    header.op_count++;
-  }
-}
-
-/**************************** DoDecreaseMin ********************************/
-void DoDecreaseMin ()
-{
-  it_type item;
-  pr_type newprio;
-  pr_type oldprio;
-
-  if (Q->size) {
-    item=my_rand(Q->size)+1;
-
-    oldprio=Q->data[item].prio;
-    newprio=dcr_min_amnt (oldprio);
-    HeapDecreaseKey (Q,item,newprio);
-
-    op_decrease_key.node_id = (uint32_t)(oldprio & MASK_NAME);
-    op_decrease_key.key = newprio;
-    pq_trace_write_op( trace_file, &op_decrease_key );
-
-    header.op_count++;
-  }
-}
-/***************************** DoFindMin ********************************/
-void DoFindMin ()
-{
-  HeapFindMin(Q);
-
-    pq_trace_write_op( trace_file, &op_find_min );
-
-    header.op_count++;
-}
-
-/*************************** DoDeleteMin () **********************************/
-void DoDeleteMin ()
-{
-  HeapExtractMin(Q);
-
-    pq_trace_write_op( trace_file, &op_delete_min );
-
-    header.op_count++;
-}
-
-int main ( int argc, char** argv )
-{
-  header.op_count = 0;
-  header.pq_ids = 1;
-  header.node_ids = 1;
-  op_create.pq_id = 0;
-  op_destroy.pq_id = 0;
-  op_insert.pq_id = 0;
-  op_find_min.pq_id = 0;
-  op_delete_min.pq_id = 0;
-  op_decrease_key.pq_id = 0;
-  op_create.code = PQ_OP_CREATE;
-  op_destroy.code = PQ_OP_DESTROY;
-  op_insert.code = PQ_OP_INSERT;
-  op_find_min.code = PQ_OP_FIND_MIN;
-  op_delete_min.code = PQ_OP_DELETE_MIN;
-  op_decrease_key.code = PQ_OP_DECREASE_KEY;
-
-
-  int i, j;
-
-  int totins, totsize;
-  heap_type heap;
-  Q=&heap;
-  HeapConstruct (Q);
-
-    // parse cli
-    if( argc != 10 )
-    {
-        printf("Invalid usage.");
-        return -1;
-    }
-
-    trace_file = open( argv[1], O_RDWR | O_CREAT | O_TRUNC, S_IRWXU );
-    if( trace_file < 0 )
-    {
-        printf("Failed to open trace file.\n");
-        return -1;
-    }
-
-    // spaceholder
-    pq_trace_write_header( trace_file, header );
-
-
-    seed = atoi( argv[2] );
-    init = (uint64_t) atoi( argv[3] );
-    reps = (uint64_t) atoi( argv[4] );
-    with[ins_cmd] = atoi( argv[ins_cmd+4] );
-    with[dcr_cmd] = atoi( argv[dcr_cmd+4] );
-    with[dcr_min_cmd] = atoi( argv[dcr_min_cmd+4] );
-    with[fmn_cmd] = atoi( argv[fmn_cmd+4] );
-    with[dmn_cmd] = atoi( argv[dmn_cmd+4] );
-    //Maxprio = PQ_MIN( Maxprio, atoi( argv[10] ) );
-    Maxprio = 0x7FFFFFFF;
-
-
-  /* find total number inserts */
-  totins = init;
-  if (with[1]) totins += reps;
-  /* find max heap size */
-  totsize = init;
-  if (with[ins_cmd] && (!with[dmn_cmd])) totsize += reps;
-  if ( totsize > MAXITEMS-1 ) {
-     printf("Too big. Please recompile with bigger MAXITEMS\n");
-     exit(1);
-   }
-
-    pq_trace_write_op( trace_file, &op_create );
-    header.op_count++;
-
-  //seed = (int) time(0);
-  srand48(seed);
-
-  for (i=0;i<init;++i)
-    DoInsert ();
-
-
-  for (i=0;i<reps;++i) {
-    for(j=0; j < with[ins_cmd]; j++) {
-      DoInsert ();
-    }
-    for(j=0; j < with[dcr_cmd]; j++) {
-      DoDecrease ();
-    }
-    for(j=0; j < with[dcr_min_cmd]; j++) {
-      DoDecreaseMin ();
-    }
-    if (with[fmn_cmd]) {
-      DoFindMin ();
-    }
-    if (with[dmn_cmd]) {
-      DoDeleteMin ();
-    }
-  }/*for */
-
-    pq_trace_write_op( trace_file, &op_destroy );
-    header.op_count++;
-    pq_trace_write_header( trace_file, header );
-    pq_trace_flush_buffer( trace_file );
-    close(trace_file);
-    free( Q->data );
-
-    return 0;
-}/* main */
+/**********************************************************
+ *
+ * PQRandom.c - generates a random set of priority
+ * queue function call traces for a DIMACS priority
+ * queue driver
+ *
+ * pq.c - a  basic heap implementation
+ * dimacs_input.c - functions for reading in commands
+ *
+ * queue items:
+ * name - uint32_t : unique,persistent name for each item.
+ * prio - uint64_t: high 32 bits is random priority in [1,MAXPRIO]
+ *                  low 32 bits is a copy of the name to ensure unique priorities
+ *
+ * Benjamin Chang (bcchang@unix.amherst.edu) 8/96
+ * Modified by Dan Larkin (dhlarkin@cs.princeton.edu) 6/12
+ *********************************************************/
+
+#include <stdio.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "dimacs_input.h"
+#include "pq.h"
+#include "../../trace_tools.h"
+
+#define MASK_PRIO 0xFFFFFFFF00000000
+#define MASK_NAME 0x00000000FFFFFFFF
+
+#define PQ_MIN(a,b) ( ( b < a ) ? b : a )
+
+#define MAX_SEGMENTS 256
+
+#define true 1
+#define false 0
+
+/*
+ * The main loop may be split into segments that are generated in parallel.
+ * Each segment runs against its own shadow heap with its own random stream
+ * and writes its operations to a precomputed region of the trace file.
+ * Segment 0 starts right after the create operation; every later segment
+ * starts with a clear operation, so the replayed queue is empty when the
+ * segment's initial inserts begin.  Names are assigned from disjoint ranges,
+ * so the stitched trace uses each node_id exactly once.
+ */
+typedef struct {
+  heap_type heap;
+  unsigned short xsubi[3];  /* erand48 state */
+  uint64_t newname;         /* next unused name */
+  uint64_t reps;            /* repetitions of the main loop in this segment */
+  int clear;                /* whether to start with a clear operation */
+  uint64_t op_count;        /* operations written */
+  off_t offset;             /* trace file offset of the first operation */
+  int status;               /* 0 on success, -1 on write failure */
+  pq_trace_writer *writer;
+} segment_type;
+
+int trace_file;
+
+long int seed=0;  /* seed value */
+uint64_t Maxprio = 0x00000000FFFFFFFF;  /* Max priority */
+uint64_t init;    /* number of initial inserts */
+uint64_t reps;    /* number of repetitions of main loop */
+
+pq_trace_header header;
+pq_op_create op_create;
+pq_op_destroy op_destroy;
+pq_op_clear op_clear;
+pq_op_insert op_insert;
+pq_op_decrease_key op_decrease_key;
+pq_op_find_min op_find_min;
+pq_op_delete_min op_delete_min;
+
+/* with[]: flags to determine whether to perform each op. in main loop */
+int with[6]={false,false,false,false,false,false};
+cmd2type cmdstable[5]={"NUL","ins","dcr","fmn","dmn"};
+
+/****************** my_rand () ***************************************/
+/* return integers in [0,range-1] */
+uint64_t my_rand(segment_type *S, uint64_t range)
+{
+  double foo;
+  foo=((double) erand48(S->xsubi) * (double)range);
+  return (uint64_t) foo;
+}
+
+/**************** dcr_amnt () *********************************************/
+/* return a new random priority in [min,prio]
+   where min is the current minimum priority and prio is the current prio */
+uint64_t dcr_amnt (segment_type *S, pr_type prio)
+{
+ pq_ptr Q=&S->heap;
+ it_type minitem=HeapFindMin(Q);
+ uint64_t minprio = ( prioval(Q,minitem) & MASK_PRIO ) >> 32;
+ uint64_t realprio = ( prio & MASK_PRIO ) >> 32;
+ uint64_t name = prio & MASK_NAME;
+
+ uint64_t new=my_rand(S,realprio-minprio)+minprio;
+
+ return ( new << 32 ) | name;
+}
+
+/**************** dcr_amnt () *********************************************/
+/* return a new random priority in [min,prio]
+   where min is the current minimum priority and prio is the current prio */
+uint64_t dcr_min_amnt (segment_type *S, pr_type prio)
+{
+ pq_ptr Q=&S->heap;
+ it_type minitem=HeapFindMin(Q);
+ uint64_t minprio = ( prioval(Q,minitem) & MASK_PRIO ) >> 32;
+ uint64_t name = prio & MASK_NAME;
+
+ uint64_t new=minprio;
+ if( new > 0 )
+  new--;
+
+ return ( new << 32 ) | name;
+}
+
+/****************************** WriteOp ***********************************/
+void WriteOp (segment_type *S, void *op)
+{
+  if (pq_trace_writer_op (S->writer, op) != 0)
+    S->status = -1;
+  S->op_count++;
+}
+
+/****************************** DoInsert ***********************************/
+void DoInsert (segment_type *S)
+{
+  in_type info;
+  pr_type prio;
+  pq_op_insert op = op_insert;
+
+  info=S->newname;
+
+  prio=(my_rand(S,Maxprio)<<32) | S->newname;
+  HeapInsert (&S->heap,info,prio);
+
+  op.node_id = S->newname;
+  op.item = (uint32_t) info;
+  op.key = prio;
+  WriteOp (S, &op);
+
+  ++S->newname;
+}
+/**************************** DoDecrease ***********************************/
+void DoDecrease (segment_type *S)
+{
+  it_type item;
+  pr_type newprio;
+  pr_type oldprio;
+  pq_op_decrease_key op = op_decrease_key;
+
+  if (S->heap.size) {
+    item=my_rand(S,S->heap.size)+1;
+
+    oldprio=S->heap.data[item].prio;
+    newprio=dcr_amnt (S,oldprio);
+    HeapDecreaseKey (&S->heap,item,newprio);
+
+    op.node_id = (uint32_t)(oldprio & MASK_NAME);
+    op.key = newprio;
+    WriteOp (S, &op);
+  }
+}
+
+/**************************** DoDecreaseMin ********************************/
+void DoDecreaseMin (segment_type *S)
+{
+  it_type item;
+  pr_type newprio;
+  pr_type oldprio;
+  pq_op_decrease_key op = op_decrease_key;
+
+  if (S->heap.size) {
+    item=my_rand(S,S->heap.size)+1;
+
+    oldprio=S->heap.data[item].prio;
+    newprio=dcr_min_amnt (S,oldprio);
+    HeapDecreaseKey (&S->heap,item,newprio);
+
+    op.node_id = (uint32_t)(oldprio & MASK_NAME);
+    op.key = newprio;
+    WriteOp (S, &op);
+  }
+}
+/***************************** DoFindMin ********************************/
+void DoFindMin (segment_type *S)
+{
+  HeapFindMin(&S->heap);
+
+  WriteOp (S, &op_find_min);
+}
+
+/*************************** DoDeleteMin () **********************************/
+void DoDeleteMin (segment_type *S)
+{
+  if (S->heap.size) {
+    HeapExtractMin(&S->heap);
+
+    WriteOp (S, &op_delete_min);
+  }
+}
+
+/*************************** SegmentBytes () *********************************/
+/* length in bytes of the operations a segment of r repetitions writes.  The
+   shadow heap size does not depend on the random stream, so this is known
+   before generation starts and the segments can be placed in the file */
+uint64_t SegmentBytes (uint64_t r, int clear)
+{
+  uint64_t inserts, decreases, finds, deletes;
+  uint64_t active;
+
+  inserts = init + r * with[ins_cmd];
+  finds = with[fmn_cmd] ? r : 0;
+  if (with[ins_cmd]) {
+    /* the heap is never empty when it is decreased or deleted from */
+    active = r;
+    deletes = with[dmn_cmd] ? r : 0;
+  }
+  else if (with[dmn_cmd]) {
+    active = PQ_MIN(r, init);
+    deletes = active;
+  }
+  else {
+    active = init ? r : 0;
+    deletes = 0;
+  }
+  decreases = active * (with[dcr_cmd] + with[dcr_min_cmd]);
+
+  return inserts * sizeof(pq_op_insert)
+    + decreases * sizeof(pq_op_decrease_key)
+    + finds * sizeof(pq_op_find_min)
+    + deletes * sizeof(pq_op_delete_min)
+    + (clear ? sizeof(pq_op_clear) : 0);
+}
+
+/*************************** RunSegment () ***********************************/
+void* RunSegment (void *arg)
+{
+  segment_type *S = (segment_type*) arg;
+  uint64_t i;
+  int j;
+
+  HeapConstruct (&S->heap);
+
+  if (S->clear)
+    WriteOp (S, &op_clear);
+
+  for (i=0;i<init;++i)
+    DoInsert (S);
+
+
+  for (i=0;i<S->reps;++i) {
+    for(j=0; j < with[ins_cmd]; j++) {
+      DoInsert (S);
+    }
+    for(j=0; j < with[dcr_cmd]; j++) {
+      DoDecrease (S);
+    }
+    for(j=0; j < with[dcr_min_cmd]; j++) {
+      DoDecreaseMin (S);
+    }
+    if (with[fmn_cmd]) {
+      DoFindMin (S);
+    }
+    if (with[dmn_cmd]) {
+      DoDeleteMin (S);
+    }
+  }/*for */
+
+  if (pq_trace_writer_destroy (S->writer) != 0)
+    S->status = -1;
+  free (S->heap.data);
+
+  return NULL;
+}
+
+int main ( int argc, char** argv )
+{
+  header.op_count = 0;
+  header.pq_ids = 1;
+  header.node_ids = 1;
+  op_create.pq_id = 0;
+  op_destroy.pq_id = 0;
+  op_clear.pq_id = 0;
+  op_insert.pq_id = 0;
+  op_find_min.pq_id = 0;
+  op_delete_min.pq_id = 0;
+  op_decrease_key.pq_id = 0;
+  op_create.code = PQ_OP_CREATE;
+  op_destroy.code = PQ_OP_DESTROY;
+  op_clear.code = PQ_OP_CLEAR;
+  op_insert.code = PQ_OP_INSERT;
+  op_find_min.code = PQ_OP_FIND_MIN;
+  op_delete_min.code = PQ_OP_DELETE_MIN;
+  op_decrease_key.code = PQ_OP_DECREASE_KEY;
+
+
+  int s;
+  int segments = 1;
+  uint64_t totnames;
+  off_t offset;
+  segment_type *S;
+  pthread_t threads[MAX_SEGMENTS];
+
+    // parse cli
+    if( argc != 10 && argc != 11 )
+    {
+        printf("usage: %s file seed init reps ins dcr dcr_min fmn dmn "
+            "[segments]\n", argv[0]);
+        return -1;
+    }
+
+    seed = atol( argv[2] );
+    init = strtoull( argv[3], NULL, 10 );
+    reps = strtoull( argv[4], NULL, 10 );
+    with[ins_cmd] = atoi( argv[ins_cmd+4] );
+    with[dcr_cmd] = atoi( argv[dcr_cmd+4] );
+    with[dcr_min_cmd] = atoi( argv[dcr_min_cmd+4] );
+    with[fmn_cmd] = atoi( argv[fmn_cmd+4] );
+    with[dmn_cmd] = atoi( argv[dmn_cmd+4] );
+    if( argc == 11 )
+        segments = atoi( argv[10] );
+    //Maxprio = PQ_MIN( Maxprio, atoi( argv[10] ) );
+    Maxprio = 0x7FFFFFFF;
+
+    if( segments < 1 || segments > MAX_SEGMENTS )
+    {
+        printf("Segments must be between 1 and %d.\n", MAX_SEGMENTS);
+        return -1;
+    }
+
+  /* names share the low 32 bits of each priority, so they must fit */
+  totnames = 1 + segments * init + reps * with[ins_cmd];
+  if ( totnames > MASK_NAME ) {
+     printf("Too many inserts for 32-bit node ids.\n");
+     exit(1);
+   }
+
+    trace_file = open( argv[1], O_RDWR | O_CREAT | O_TRUNC, S_IRWXU );
+    if( trace_file < 0 )
+    {
+        printf("Failed to open trace file.\n");
+        return -1;
+    }
+
+    // spaceholder
+    pq_trace_write_header( trace_file, header );
+    pq_trace_write_op( trace_file, &op_create );
+    pq_trace_flush_buffer( trace_file );
+    header.op_count++;
+
+  S = calloc (segments, sizeof(segment_type));
+  if (S == NULL) {
+    printf("Malloc fail.\n");
+    exit(1);
+  }
+
+  /* lay the segments out back to back; segment 0 reproduces the
+     srand48(seed) stream of the sequential generator */
+  offset = sizeof(pq_trace_header) + sizeof(pq_op_create);
+  uint64_t name = 1;
+  for (s=0;s<segments;++s) {
+    S[s].reps = reps / segments + ( (uint64_t) s < reps % segments );
+    S[s].clear = ( s > 0 );
+    S[s].newname = name;
+    S[s].offset = offset;
+    S[s].xsubi[0] = 0x330E;
+    S[s].xsubi[1] = (unsigned short) ( seed + s );
+    S[s].xsubi[2] = (unsigned short) ( ( seed + s ) >> 16 );
+    S[s].writer = pq_trace_writer_create (trace_file, offset,
+      PQ_TRACE_BUFFER_SIZE);
+    if (S[s].writer == NULL) {
+      printf("Failed to create trace writer.\n");
+      exit(1);
+    }
+
+    name += init + S[s].reps * with[ins_cmd];
+    offset += SegmentBytes (S[s].reps, S[s].clear);
+  }
+
+  for (s=1;s<segments;++s) {
+    if (pthread_create (&threads[s], NULL, RunSegment, &S[s]) != 0) {
+      printf("Failed to start segment thread.\n");
+      exit(1);
+    }
+  }
+  RunSegment (&S[0]);
+
+  int status = 0;
+  for (s=0;s<segments;++s) {
+    if (s > 0)
+      pthread_join (threads[s], NULL);
+    status |= S[s].status;
+    header.op_count += S[s].op_count;
+  }
+  header.node_ids = (uint32_t) name;
+  free (S);
+
+    lseek( trace_file, offset, SEEK_SET );
+    pq_trace_write_op( trace_file, &op_destroy );
+    header.op_count++;
+    if( pq_trace_write_header( trace_file, header ) != 0 || status != 0 )
+    {
+        printf("Failed to write trace file.\n");
+        close(trace_file);
+        return -1;
+    }
+    close(trace_file);
+
+    return 0;
+}/* main */
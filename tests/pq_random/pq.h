@@ -1,5 +1,4 @@
-#define MAXITEMS 160000000
-#define MAXNAMES 160000000
+#define INITIAL_ITEMS 1024
 
 #include <stdint.h>
 
@@ -14,6 +13,7 @@ typedef struct {
 
 typedef struct {
   long size;
+  long capacity;    /* cells allocated in data, including data[0] */
   cell *data;
 } heap_type;
 
@@ -24,8 +24,9 @@ pr_type HeapExtractMin (heap_type *);
 pr_type prioval (heap_type *,it_type);
 in_type infoval (heap_type *,it_type);
 void HeapConstruct (heap_type *H);
-void HeapNodeExchange (heap_type *A,int x,int y);
-void Heapify (heap_type *A,int i);
+void HeapGrow (heap_type *A);
+void HeapNodeExchange (heap_type *A,long x,long y);
+void Heapify (heap_type *A,long i);
 void printheap (heap_type *A);
 it_type HeapInsert (heap_type *A,in_type name,pr_type key);
 void HeapDecreaseKey (heap_type *A, it_type node, pr_type key);
@@ -0,0 +1,232 @@
+/***********************************************************/
+/*                                                         */
+/*        A* point-to-point search workload generator      */
+/*                                                         */
+/***********************************************************/
+
+/*
+ * Reads an extended DIMACS shortest path problem (spgrid grids are the
+ * intended input) and runs A* from its source to a target node against the
+ * queue selected at compile time through the pq_* API.  Usage:
+ *
+ *   astar_<queue> [reps [percent [target [trace]]]] < problem
+ *
+ * The generated graphs carry no coordinates and allow zero-length arcs, so
+ * the heuristic is derived from exact distances instead: an untimed reverse
+ * search from the target gives d(v), and h(v) = floor( d(v) * percent / 100 ).
+ * It is consistent for any percent up to 100, since h(u) - h(v) never exceeds
+ * the length of an arc (u,v).  percent 0 is plain Dijkstra stopped at the
+ * target, 100 walks straight down the shortest path; the default is 75.  The
+ * default target, also chosen by a target of 0, is the last node that is not
+ * the source: the far corner of an spgrid grid.
+ *
+ * One line is printed with the average wall time and the queue operation
+ * counts, and the distance found is checked against the reverse search.
+ * Given a trace file, a single run is made and its queue calls are written to
+ * it, see pq_workload.c.
+ */
+
+#include "pq_workload.c"
+
+static pq_node_type **handles;
+static uint64_t *dist;
+static bool *closed;
+
+static uint32_t search( mem_map *map, csr_graph *graph, uint32_t source,
+    uint32_t target, uint64_t *h, uint64_t *result );
+
+int main( int argc, char **argv )
+{
+    uint32_t r, v, scans = 0;
+    uint64_t total_time = 0;
+    struct timeval t0, t1;
+
+    uint32_t reps = ( argc > 1 ) ? atoi( argv[1] ) : 3;
+    uint64_t percent = ( argc > 2 ) ? strtoull( argv[2], NULL, 10 ) : 75;
+    if( reps < 1 || percent > 100 )
+    {
+        fprintf( stderr, "usage: %s [reps [percent [target [trace]]]] "
+            "< problem\n", argv[0] );
+        return -1;
+    }
+
+    csr_graph *graph = load_graph();
+    if( graph == NULL )
+    {
+        fprintf( stderr, "Calloc fail.\n" );
+        return -1;
+    }
+    csr_graph *reverse = transpose( graph, FALSE );
+
+    // spgrid appends its artificial source after the grid
+    uint32_t target = graph->node_count - 1;
+    if( target == graph->source && target > 0 )
+        target--;
+    if( argc > 3 && atoi( argv[3] ) > 0 )
+        target = atoi( argv[3] ) - 1;
+    if( target >= graph->node_count )
+    {
+        fprintf( stderr, "Target out of range.\n" );
+        return -1;
+    }
+
+    uint64_t *h = malloc( graph->node_count * sizeof( uint64_t ) );
+    handles = malloc( graph->node_count * sizeof( pq_node_type* ) );
+    dist = malloc( graph->node_count * sizeof( uint64_t ) );
+    closed = malloc( graph->node_count * sizeof( bool ) );
+    trace_ids = malloc( graph->node_count * sizeof( uint32_t ) );
+    if( reverse == NULL || h == NULL || handles == NULL || dist == NULL ||
+        closed == NULL || trace_ids == NULL )
+    {
+        fprintf( stderr, "Calloc fail.\n" );
+        return -1;
+    }
+
+    // exact distances to the target, scaled down into the heuristic
+    mem_map *map = create_map( graph->node_count );
+    search( map, reverse, target, graph->node_count, NULL, h );
+    uint64_t expected = h[graph->source];
+    for( v = 0; v < graph->node_count; v++ )
+    {
+        if( h[v] != UNREACHED )
+            h[v] = h[v] * percent / 100;
+    }
+
+    if( argc > 4 )
+    {
+        if( trace_open( argv[4] ) != 0 )
+        {
+            fprintf( stderr, "Failed to open trace file.\n" );
+            return -1;
+        }
+        reps = 1;
+    }
+
+    for( r = 0; r < reps; r++ )
+    {
+        mm_clear( map );
+        gettimeofday( &t0, NULL );
+        scans = search( map, graph, graph->source, target, h, dist );
+        gettimeofday( &t1, NULL );
+        total_time += elapsed_usec( &t0, &t1 );
+    }
+    if( trace_file >= 0 )
+        trace_close();
+
+    uint64_t run_time = total_time / reps;
+    uint64_t ops = count_insert + count_delete_min + count_decrease_key;
+    printf( "astar n=%u m=%llu source=%u target=%u percent=%llu "
+        "time_us=%llu scans=%u inserts=%llu delete_mins=%llu "
+        "decrease_keys=%llu dk_per_dm=%.2f ops_per_sec=%.0f dist=%lld %s\n",
+        graph->node_count, (unsigned long long) graph->arc_count,
+        graph->source + 1, target + 1, (unsigned long long) percent,
+        (unsigned long long) run_time, scans,
+        (unsigned long long) count_insert,
+        (unsigned long long) count_delete_min,
+        (unsigned long long) count_decrease_key,
+        (double) count_decrease_key / ( count_delete_min + 1 ),
+        ops / ( ( run_time + 1 ) / 1e6 ),
+        ( dist[target] == UNREACHED ) ? -1LL : (long long) dist[target],
+        ( dist[target] == expected ) ? "ok" : "mismatch" );
+
+    mm_destroy( map );
+    free( trace_ids );
+    free( closed );
+    free( dist );
+    free( handles );
+    free( h );
+    csr_destroy( reverse );
+    csr_destroy( graph );
+
+    return 0;
+}
+
+/**
+ * Best-first search from the source, keyed by distance plus heuristic.  With a
+ * consistent heuristic a node's distance is final once it is deleted, so
+ * closed nodes are never reopened.  Nodes the heuristic marks as unable to
+ * reach the target are not queued.  The search stops when the target is
+ * deleted; a target of node_count or more searches the whole graph, which
+ * with no heuristic is Dijkstra's algorithm.
+ *
+ * @param map       Memory map for queue nodes
+ * @param graph     Graph to search
+ * @param source    Start node
+ * @param target    Node at which to stop
+ * @param h         Heuristic per node, or NULL for none
+ * @param result    Output distances from the source
+ * @return          Number of nodes deleted from the queue
+ */
+static uint32_t search( mem_map *map, csr_graph *graph, uint32_t source,
+    uint32_t target, uint64_t *h, uint64_t *result )
+{
+    uint32_t u, v, scans = 0;
+    uint64_t j, candidate;
+    uint64_t n = graph->node_count;
+    key_type key;
+
+    count_insert = 0;
+    count_delete_min = 0;
+    count_decrease_key = 0;
+
+    for( u = 0; u < n; u++ )
+    {
+        result[u] = UNREACHED;
+        closed[u] = FALSE;
+        handles[u] = NULL;
+    }
+    if( h != NULL && h[source] == UNREACHED )
+        return 0;
+
+    pq_type *queue = pq_create( map );
+    record_op( PQ_OP_CREATE );
+
+    result[source] = 0;
+    key = ( ( h == NULL ) ? 0 : h[source] ) * n + source;
+    handles[source] = pq_insert( queue, source, key );
+    record_insert( source, key );
+    count_insert++;
+
+    while( record_op( PQ_OP_EMPTY ), !pq_empty( queue ) )
+    {
+        u = *pq_get_item( queue, pq_find_min( queue ) );
+        pq_delete_min( queue );
+        record_op( PQ_OP_DELETE_MIN );
+        count_delete_min++;
+        handles[u] = NULL;
+        closed[u] = TRUE;
+        scans++;
+        if( u == target )
+            break;
+
+        for( j = graph->offsets[u]; j < graph->offsets[u+1]; j++ )
+        {
+            v = graph->targets[j];
+            candidate = result[u] + graph->weights[j];
+            if( closed[v] || candidate >= result[v] )
+                continue;
+            if( h != NULL && h[v] == UNREACHED )
+                continue;
+
+            result[v] = candidate;
+            key = ( candidate + ( ( h == NULL ) ? 0 : h[v] ) ) * n + v;
+            if( handles[v] == NULL )
+            {
+                handles[v] = pq_insert( queue, v, key );
+                record_insert( v, key );
+                count_insert++;
+            }
+            else
+            {
+                pq_decrease_key( queue, handles[v], key );
+                record_decrease_key( v, key );
+                count_decrease_key++;
+            }
+        }
+    }
+
+    pq_destroy( queue );
+    record_op( PQ_OP_DESTROY );
+
+    return scans;
+}
@@ -12,7 +12,78 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
 #include "types_dh.h"
+#include "../../../csr_tools.h"
+
+
+/* ----------------------------------------------------------------- */
+
+/* Builds the parser's output directly from a binary CSR cache of the
+   input (see csr_tools.h), skipping the text entirely.  Arcs are already
+   in the order the text parser below would put them.
+   Returns 0 on success, 1 if there is no usable cache. */
+
+static int parse_cached ( long *n_ad, long *m_ad, node **nodes_ad,
+                          arc **arcs_ad, node **source_ad, long *node_min_ad,
+                          char *problem_name )
+{
+csr_graph *cache;
+node      *nodes;
+arc       *arcs;
+uint32_t   node_min, node_total, i;
+uint64_t   k;
+
+cache = csr_map_cached ( STDIN_FILENO );
+if ( cache == NULL ) return (1);
+if ( cache -> problem != CSR_PROBLEM_SP )
+  { csr_destroy ( cache ); return (1); }
+
+node_min   = cache -> first_id;
+node_total = node_min + cache -> node_count;
+if ( cache -> declared_nodes > node_total ) node_total = cache -> declared_nodes;
+
+nodes = (node*) calloc ( node_total + 2, sizeof(node) );
+arcs  = (arc*)  calloc ( cache -> arc_count + 1, sizeof(arc) );
+if ( nodes == NULL || arcs == NULL )
+  {
+    printf ( "\nPrs%d: line 0 of input - %s\n", 4,
+             "can't obtain enough memory to solve this problem." );
+    exit (1);
+  }
+
+for ( i = 0; i <= cache -> node_count; i ++ )
+  ( nodes + node_min + i ) -> first = arcs + cache -> offsets[i];
+
+for ( k = 0; k < cache -> arc_count; k ++ )
+  {
+    arcs[k].head = nodes + node_min + cache -> targets[k];
+    arcs[k].len  = cache -> weights[k];
+  }
+
+*m_ad = cache -> arc_count;
+*n_ad = cache -> node_count;
+*source_ad = nodes + node_min + cache -> source;
+*node_min_ad = node_min;
+*nodes_ad = nodes + node_min;
+*arcs_ad = arcs;
+
+if ( cache -> name[0] != '\0' )
+  strcpy ( problem_name, cache -> name );
+else
+  strcpy ( problem_name, "unknown" );
+
+if ( cache -> source >= cache -> node_count ||
+     (*source_ad) -> first == ((*source_ad) + 1) -> first )
+  {
+    printf ( "\nPrs%d: line 0 of input - %s\n", 19,
+             "source doesn't have output arcs." );
+    exit (1);
+  }
+
+csr_destroy ( cache );
+return (0);
+}
 
 
 /* ----------------------------------------------------------------- */
@@ -123,6 +194,11 @@ static char *err_message[] =
   };
 /* --------------------------------------------------------------- */
 
+/* a binary cache of the input makes the text superfluous */
+if ( parse_cached ( n_ad, m_ad, nodes_ad, arcs_ad,
+                    source_ad, node_min_ad, problem_name ) == 0 )
+  return (0);
+
 /* The main loop:
         -  reads the line of the input,
         -  analises its type,
@@ -0,0 +1,363 @@
+/***********************************************************/
+/*                                                         */
+/*   Shared code of the Prim and A* workload generators    */
+/*                                                         */
+/***********************************************************/
+
+/*
+ * Included by prim_bench.c and astar_bench.c.  Selects the queue under test
+ * from the same USE_* flags as the trace driver, loads an extended DIMACS
+ * problem into CSR and optionally records every queue call made through the
+ * record_* helpers as a trace (see trace_tools.h).
+ *
+ * Keys are made unique as value * node_count + node, so every exact queue
+ * extracts nodes in the same order and produces the same trace; trace node
+ * ids are handed out in insertion order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "types_dh.h"
+#include "parser_dh.c"
+#include "../../../csr_tools.h"
+#include "../../../trace_tools.h"
+
+#ifdef USE_EAGER
+    #include "../../../memory_management_eager.h"
+#elif USE_LAZY
+    #include "../../../memory_management_lazy.h"
+#else
+    #include "../../../memory_management_dumb.h"
+#endif
+
+#ifdef USE_BINOMIAL
+    #include "../../../queues/binomial_queue.h"
+#elif defined USE_EXPLICIT_2
+    #include "../../../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_4
+    #include "../../../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_8
+    #include "../../../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_16
+    #include "../../../queues/explicit_heap.h"
+#elif defined USE_FIBONACCI
+    #include "../../../queues/fibonacci_heap.h"
+#elif defined USE_IMPLICIT_2
+    #include "../../../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_4
+    #include "../../../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_8
+    #include "../../../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_16
+    #include "../../../queues/implicit_heap.h"
+#elif defined USE_WEAK
+    #include "../../../queues/weak_heap.h"
+#elif defined USE_PAIRING
+    #include "../../../queues/pairing_heap.h"
+#elif defined USE_SMOOTH
+    #include "../../../queues/smooth_heap.h"
+#elif defined USE_QUAKE
+    #include "../../../queues/quake_heap.h"
+#elif defined USE_RANK_PAIRING
+    #include "../../../queues/rank_pairing_heap.h"
+#elif defined USE_RANK_RELAXED_WEAK
+    #include "../../../queues/rank_relaxed_weak_queue.h"
+#elif defined USE_STRICT_FIBONACCI
+    #include "../../../queues/strict_fibonacci_heap.h"
+#elif defined USE_VIOLATION
+    #include "../../../queues/violation_heap.h"
+#elif defined USE_HOLLOW
+    #include "../../../queues/hollow_heap.h"
+#endif
+
+#ifdef USE_STRICT_FIBONACCI
+    static uint32_t mem_types = 3;
+    static uint32_t mem_sizes[3] =
+    {
+        sizeof( strict_fibonacci_node ),
+        sizeof( active_record ),
+        sizeof( rank_record )
+    };
+    static uint32_t mem_capacities[3] =
+    {
+        0,
+        1000,
+        1000
+    };
+#elif defined USE_HOLLOW
+    static uint32_t mem_types = 2;
+    static uint32_t mem_sizes[2] =
+    {
+        sizeof( hollow_item ),
+        sizeof( hollow_node )
+    };
+    static uint32_t mem_capacities[2] =
+    {
+        0,
+        0
+    };
+#elif defined USE_QUAKE
+    static uint32_t mem_types = 2;
+    static uint32_t mem_sizes[2] =
+    {
+        sizeof( quake_item ),
+        sizeof( quake_node )
+    };
+    static uint32_t mem_capacities[2] =
+    {
+        0,
+        0
+    };
+#else
+    static uint32_t mem_types = 1;
+    static uint32_t mem_sizes[1] =
+    {
+        sizeof( pq_node_type )
+    };
+    static uint32_t mem_capacities[1] =
+    {
+        0
+    };
+#endif
+
+#define UNREACHED       0xFFFFFFFFFFFFFFFF
+
+// queue operations of the last run
+static uint64_t count_insert;
+static uint64_t count_delete_min;
+static uint64_t count_decrease_key;
+
+// trace output, inactive while trace_file is negative
+static int trace_file = -1;
+static pq_trace_header header;
+static uint32_t *trace_ids;
+
+/**
+ * Loads the problem on stdin, from its binary cache if there is one.
+ *
+ * @return  Graph with node ids relative to the first node, or NULL
+ */
+static csr_graph* load_graph( void )
+{
+    long n, m, nmin, i;
+    node *ndp, *source;
+    arc *arp, *a;
+    char name[31];
+    uint64_t j = 0;
+
+    // a binary cache of the input is used as is, avoiding the text parser
+    csr_graph *graph = csr_map_cached( STDIN_FILENO );
+    if( graph != NULL && graph->problem != CSR_PROBLEM_SP )
+    {
+        csr_destroy( graph );
+        graph = NULL;
+    }
+    if( graph != NULL )
+        return graph;
+
+    // the parser's arcs are already grouped by tail
+    parse( &n, &m, &ndp, &arp, &source, &nmin, name );
+    graph = csr_create( n, ndp[n].first - ndp[0].first );
+    if( graph != NULL )
+    {
+        graph->source = source - ndp;
+        for( i = 0; i < n; i++ )
+        {
+            graph->offsets[i] = j;
+            for( a = ndp[i].first; a != ndp[i+1].first; a++, j++ )
+            {
+                graph->targets[j] = a->head - ndp;
+                graph->weights[j] = a->len;
+            }
+        }
+        graph->offsets[n] = j;
+    }
+    free( ndp - nmin );
+    free( arp );
+
+    return graph;
+}
+
+/**
+ * Builds the graph with every arc reversed, or with every arc present in both
+ * directions.
+ *
+ * @param graph     Graph to transpose
+ * @param symmetric True to keep the original arcs as well
+ * @return          New graph, or NULL on allocation failure
+ */
+static csr_graph* transpose( csr_graph *graph, bool symmetric )
+{
+    uint32_t u, v;
+    uint64_t j, k;
+    uint64_t arc_count = graph->arc_count << ( symmetric ? 1 : 0 );
+    csr_graph *result = csr_create( graph->node_count, arc_count );
+    if( result == NULL )
+        return NULL;
+    result->source = graph->source;
+
+    // count in-degrees (plus out-degrees), then fill by prefix sums
+    memset( result->offsets, 0, ( graph->node_count + 1 ) * sizeof( uint64_t ) );
+    for( u = 0; u < graph->node_count; u++ )
+    {
+        for( j = graph->offsets[u]; j < graph->offsets[u+1]; j++ )
+        {
+            result->offsets[graph->targets[j] + 1]++;
+            if( symmetric )
+                result->offsets[u + 1]++;
+        }
+    }
+    for( u = 0; u < graph->node_count; u++ )
+        result->offsets[u+1] += result->offsets[u];
+
+    for( u = 0; u < graph->node_count; u++ )
+    {
+        for( j = graph->offsets[u]; j < graph->offsets[u+1]; j++ )
+        {
+            v = graph->targets[j];
+            k = result->offsets[v]++;
+            result->targets[k] = u;
+            result->weights[k] = graph->weights[j];
+            if( symmetric )
+            {
+                k = result->offsets[u]++;
+                result->targets[k] = v;
+                result->weights[k] = graph->weights[j];
+            }
+        }
+    }
+
+    // filling advanced every offset to the next node's start
+    for( u = graph->node_count; u > 0; u-- )
+        result->offsets[u] = result->offsets[u-1];
+    result->offsets[0] = 0;
+
+    return result;
+}
+
+/**
+ * Opens a trace file and writes a placeholder header.
+ *
+ * @param path  File to create
+ * @return      0 on success, -1 otherwise
+ */
+static int trace_open( const char *path )
+{
+    trace_file = open( path, O_RDWR | O_CREAT | O_TRUNC, S_IRWXU );
+    if( trace_file < 0 )
+        return -1;
+
+    header.op_count = 0;
+    header.pq_ids = 1;
+    header.node_ids = 0;
+
+    return pq_trace_write_header( trace_file, header );
+}
+
+/**
+ * Writes the final header and closes the trace.
+ */
+static void trace_close( void )
+{
+    pq_trace_write_header( trace_file, header );
+    pq_trace_flush_buffer( trace_file );
+    close( trace_file );
+    trace_file = -1;
+}
+
+/**
+ * Records an operation that takes no arguments beyond the queue.
+ *
+ * @param code  Operation code
+ */
+static void record_op( uint32_t code )
+{
+    pq_op_empty op;
+    if( trace_file < 0 )
+        return;
+
+    op.code = code;
+    op.pq_id = 0;
+    pq_trace_write_op( trace_file, &op );
+    header.op_count++;
+}
+
+/**
+ * Records an insertion, assigning the node its trace id.
+ *
+ * @param v     Graph node inserted
+ * @param key   Key used
+ */
+static void record_insert( uint32_t v, key_type key )
+{
+    pq_op_insert op;
+    if( trace_file < 0 )
+        return;
+
+    trace_ids[v] = header.node_ids++;
+    op.code = PQ_OP_INSERT;
+    op.pq_id = 0;
+    op.node_id = trace_ids[v];
+    op.key = key;
+    op.item = trace_ids[v];
+    pq_trace_write_op( trace_file, &op );
+    header.op_count++;
+}
+
+/**
+ * Records a decrease-key.
+ *
+ * @param v     Graph node changed
+ * @param key   New key
+ */
+static void record_decrease_key( uint32_t v, key_type key )
+{
+    pq_op_decrease_key op;
+    if( trace_file < 0 )
+        return;
+
+    op.code = PQ_OP_DECREASE_KEY;
+    op.pq_id = 0;
+    op.node_id = trace_ids[v];
+    op.key = key;
+    pq_trace_write_op( trace_file, &op );
+    header.op_count++;
+}
+
+/**
+ * Creates the memory map for a graph of the given size.
+ *
+ * @param node_count    Largest number of items held at once
+ * @return              New map
+ */
+static mem_map* create_map( uint32_t node_count )
+{
+    mem_capacities[0] = node_count;
+#ifdef USE_QUAKE
+    // decay keeps each height at most ALPHA times the one below, bounding
+    // internal nodes by ALPHA / ( 1 - ALPHA ) = 3 per item
+    mem_capacities[1] = ( node_count * 3 ) + 1;
+#endif
+#ifdef USE_HOLLOW
+    // rebuilds keep hollow nodes from outnumbering the items
+    mem_capacities[1] = ( node_count << 1 ) + 1;
+#endif
+
+#ifdef USE_EAGER
+    return mm_create( mem_types, mem_sizes, mem_capacities );
+#else
+    return mm_create( mem_types, mem_sizes );
+#endif
+}
+
+static uint64_t elapsed_usec( struct timeval *t0, struct timeval *t1 )
+{
+    return ( t1->tv_sec - t0->tv_sec ) * 1000000 +
+        ( t1->tv_usec - t0->tv_usec );
+}
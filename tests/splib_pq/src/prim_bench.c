@@ -0,0 +1,195 @@
+/***********************************************************/
+/*                                                         */
+/*     Prim's minimum spanning tree workload generator     */
+/*                                                         */
+/***********************************************************/
+
+/*
+ * Reads an extended DIMACS shortest path problem (e.g. from sprand or spgrid)
+ * as an undirected graph, every arc standing for an edge of its length, and
+ * runs Prim's algorithm against the queue selected at compile time through
+ * the pq_* API.  Unreachable parts of the graph start new trees, so the result
+ * is a minimum spanning forest.  Usage:
+ *
+ *   prim_<queue> [reps [trace]] < problem
+ *
+ * One line is printed with the average wall time and the queue operation
+ * counts.  On dense graphs almost every edge scan lowers a key, so the
+ * decrease-key to delete-min ratio approaches the average degree, far above
+ * what Dijkstra on the same graph produces.  Given a trace file, a single run
+ * is made and its queue calls are written to it, see pq_workload.c.
+ */
+
+#include "pq_workload.c"
+
+static csr_graph *graph;
+static pq_node_type **handles;
+static uint64_t *best;
+static bool *in_tree;
+
+static void prim( mem_map *map, uint64_t *weight, uint32_t *trees );
+
+int main( int argc, char **argv )
+{
+    uint32_t r, trees = 0;
+    uint64_t weight = 0, total_time = 0;
+    struct timeval t0, t1;
+
+    uint32_t reps = ( argc > 1 ) ? atoi( argv[1] ) : 3;
+    if( reps < 1 )
+    {
+        fprintf( stderr, "usage: %s [reps [trace]] < problem\n", argv[0] );
+        return -1;
+    }
+
+    csr_graph *directed = load_graph();
+    if( directed == NULL )
+    {
+        fprintf( stderr, "Calloc fail.\n" );
+        return -1;
+    }
+    graph = transpose( directed, TRUE );
+    csr_destroy( directed );
+    if( graph == NULL )
+    {
+        fprintf( stderr, "Calloc fail.\n" );
+        return -1;
+    }
+
+    handles = malloc( graph->node_count * sizeof( pq_node_type* ) );
+    best = malloc( graph->node_count * sizeof( uint64_t ) );
+    in_tree = malloc( graph->node_count * sizeof( bool ) );
+    trace_ids = malloc( graph->node_count * sizeof( uint32_t ) );
+    if( handles == NULL || best == NULL || in_tree == NULL ||
+        trace_ids == NULL )
+    {
+        fprintf( stderr, "Calloc fail.\n" );
+        return -1;
+    }
+
+    if( argc > 2 )
+    {
+        if( trace_open( argv[2] ) != 0 )
+        {
+            fprintf( stderr, "Failed to open trace file.\n" );
+            return -1;
+        }
+        reps = 1;
+    }
+
+    mem_map *map = create_map( graph->node_count );
+    for( r = 0; r < reps; r++ )
+    {
+        mm_clear( map );
+        gettimeofday( &t0, NULL );
+        prim( map, &weight, &trees );
+        gettimeofday( &t1, NULL );
+        total_time += elapsed_usec( &t0, &t1 );
+    }
+    if( trace_file >= 0 )
+        trace_close();
+
+    uint64_t run_time = total_time / reps;
+    uint64_t ops = count_insert + count_delete_min + count_decrease_key;
+    printf( "prim n=%u edges=%llu time_us=%llu inserts=%llu "
+        "delete_mins=%llu decrease_keys=%llu dk_per_dm=%.2f "
+        "ops_per_sec=%.0f trees=%u weight=%llu\n", graph->node_count,
+        (unsigned long long) ( graph->arc_count >> 1 ),
+        (unsigned long long) run_time,
+        (unsigned long long) count_insert,
+        (unsigned long long) count_delete_min,
+        (unsigned long long) count_decrease_key,
+        (double) count_decrease_key / ( count_delete_min + 1 ),
+        ops / ( ( run_time + 1 ) / 1e6 ), trees,
+        (unsigned long long) weight );
+
+    mm_destroy( map );
+    free( trace_ids );
+    free( in_tree );
+    free( best );
+    free( handles );
+    csr_destroy( graph );
+
+    return 0;
+}
+
+/**
+ * Grows a tree from every node not yet spanned.  A node's key is the length
+ * of its lightest edge to the tree; its item is its id, so the minimum's id is
+ * recovered via pq_get_item before it is deleted.
+ *
+ * @param map       Memory map for queue nodes
+ * @param weight    Output total weight of the forest
+ * @param trees     Output number of trees
+ */
+static void prim( mem_map *map, uint64_t *weight, uint32_t *trees )
+{
+    uint32_t root, u, v;
+    uint64_t j, total = 0;
+    uint64_t n = graph->node_count;
+    key_type key;
+
+    count_insert = 0;
+    count_delete_min = 0;
+    count_decrease_key = 0;
+    *trees = 0;
+
+    for( u = 0; u < n; u++ )
+    {
+        best[u] = UNREACHED;
+        in_tree[u] = FALSE;
+        handles[u] = NULL;
+    }
+
+    pq_type *queue = pq_create( map );
+    record_op( PQ_OP_CREATE );
+
+    for( root = 0; root < n; root++ )
+    {
+        if( in_tree[root] )
+            continue;
+
+        (*trees)++;
+        best[root] = 0;
+        handles[root] = pq_insert( queue, root, root );
+        record_insert( root, root );
+        count_insert++;
+
+        while( record_op( PQ_OP_EMPTY ), !pq_empty( queue ) )
+        {
+            u = *pq_get_item( queue, pq_find_min( queue ) );
+            pq_delete_min( queue );
+            record_op( PQ_OP_DELETE_MIN );
+            count_delete_min++;
+            handles[u] = NULL;
+            in_tree[u] = TRUE;
+            total += best[u];
+
+            for( j = graph->offsets[u]; j < graph->offsets[u+1]; j++ )
+            {
+                v = graph->targets[j];
+                if( in_tree[v] || graph->weights[j] >= best[v] )
+                    continue;
+
+                best[v] = graph->weights[j];
+                key = best[v] * n + v;
+                if( handles[v] == NULL )
+                {
+                    handles[v] = pq_insert( queue, v, key );
+                    record_insert( v, key );
+                    count_insert++;
+                }
+                else
+                {
+                    pq_decrease_key( queue, handles[v], key );
+                    record_decrease_key( v, key );
+                    count_decrease_key++;
+                }
+            }
+        }
+    }
+
+    pq_destroy( queue );
+    record_op( PQ_OP_DESTROY );
+    *weight = total;
+}
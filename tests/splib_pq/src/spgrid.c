@@ -4,6 +4,11 @@
 #include <values.h>
 
 #include "random.c"
+#include "../../../csr_tools.h"
+
+/* binary CSR copy of the output, see csr_tools.h */
+csr_builder *csr_out = NULL;
+char        *csr_path = NULL;
 
 #define DASH '-'
 #define VERY_FAR 100000000
@@ -22,6 +27,7 @@
 l = length;\
 if ( p_f ) l += ( p[i] - p[j] );\
 printf ("a %8ld %8ld %12ld\n", i, j, l );\
+if ( csr_out != NULL ) csr_builder_add_arc ( csr_out, i, j, l );\
 }
 
 char   *graph_type[] =
@@ -155,6 +161,11 @@ if ( ( seed = atoi ( argv[3] ) )  <=  0  )  goto usage;
 
 for ( np = 4; np < argc; np ++ )
   {
+    if ( argv[np][0] == DASH && argv[np][1] == 'b' )
+      { /* binary CSR copy of the graph */
+	csr_path = &argv[np][2];
+	continue;
+      }
     strcpy ( args, argv[np] );
     if ( args[0] != DASH ) goto usage;
 
@@ -376,6 +387,11 @@ if ( n >= (double)MAXLONG || m >= (double)MAXLONG )
 if ( ip_f )
    mess = (long*) calloc ( Y, sizeof ( long ) );
 
+if ( csr_path != NULL )
+  if ( ( csr_out = csr_builder_create ( CSR_PROBLEM_SP, n0, m0 ) ) == NULL )
+    { fprintf ( stderr, "\nCan't obtain memory for binary graph\n\n" );
+      exit ( 2 ); }
+
 /* printing title */
 printf ("c grid network for shortest paths problem\n");
 printf ("c extended DIMACS format\nc\n" );
@@ -388,6 +404,10 @@ if ( i_f )  printf ("%c", 'i');
 if ( s_f )  printf ("%c", 's');
 if ( p_f )  printf ("%c", 'p');
 printf ("\nc\n");
+if ( csr_out != NULL )
+  snprintf ( csr_out -> name, CSR_NAME_LENGTH - 1, "gr_%ldx%ld_%ld_%s%s%s%s%s",
+             X, Y, seed,
+             c_f ? "c" : "", a_f ? "a" : "", i_f ? "i" : "", s_f ? "s" : "", p_f ? "p" : "" );
 
 /* printing additional information  */
 if ( cw_f )
@@ -419,6 +439,7 @@ printf ("p sp %8ld %8ld\nc\n", n0, m0 );
 
 printf ("n %8ld\nc\n", n0 );
 source = ( s_f ) ? n0-1 : n0;
+if ( csr_out != NULL ) csr_out -> source = n0;
 
 if ( p_f ) /* generating potentials */
   {
@@ -559,6 +580,14 @@ for ( x = 0; x < X-1; x ++ )
     }
  }
 /* all is done */
+if ( csr_out != NULL )
+  { /* binary CSR version of everything printed above */
+    fflush ( stdout );
+    if ( csr_builder_write ( csr_out, csr_path ) != 0 )
+      { fprintf ( stderr, "\nCan't write binary graph to '%s'\n\n", csr_path );
+        exit ( 2 ); }
+  }
+
 exit (ext);
 
 /* ----- wrong usage ----- */
@@ -598,6 +627,7 @@ Generates problems in extended DIMACS format.\n\
 -pl#i - #i is the upper bound on potentials           (default il)\n\
 -pm#i - #i is the lower bound on potentials           (default im)\n\
 \n\
+-b<file> - also write the graph in binary CSR form to <file>\n\
 -hh    - extended help \n\n",
 argv[0], argv[0], argv[0] );
 
@@ -665,6 +695,7 @@ fprintf (fout,
 -sl#i  - #i is the upper bound on art. arc lengths    (default 100000000)\n\
 -sm#i  - #i is the lower bound on art. arc lengths    (default sl)\n\
 \n\
+-b<file>       - also write the graph in binary CSR form to <file>\n\
 -hh file_name  - save this help in the file 'file_name'\n\n"
 );
 exit (0);
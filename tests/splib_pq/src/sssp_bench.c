@@ -0,0 +1,677 @@
+/***********************************************************/
+/*                                                         */
+/*     In-process single-source shortest path benchmark    */
+/*                                                         */
+/***********************************************************/
+
+/*
+ * Reads an extended DIMACS shortest path problem from stdin once, converts it
+ * to CSR (or maps its binary .csr cache, see csr_tools.h) and then times
+ *   - Dijkstra's algorithm against the queue selected at compile time through
+ *     the pq_* API (same USE_* flags as the trace driver), and
+ *   - a multi-threaded delta-stepping variant for 1, 2, 4, ... threads.
+ *
+ * Unlike trace replay, the queue shares the cache with the graph, which is
+ * what real routing code sees.  Usage:
+ *
+ *   sssp_<queue> [max_threads [delta [reps]]] < problem
+ *
+ * A delta of 0 picks max_arc_length / average_degree.  One line is printed per
+ * run with wall time, relaxations per second and speedup over one thread;
+ * every run's distances are checked against Dijkstra's.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include <pthread.h>
+
+#include "types_dh.h"
+#include "parser_dh.c"
+#include "../../../csr_tools.h"
+
+#ifdef USE_EAGER
+    #include "../../../memory_management_eager.h"
+#elif USE_LAZY
+    #include "../../../memory_management_lazy.h"
+#else
+    #include "../../../memory_management_dumb.h"
+#endif
+
+#ifdef USE_BINOMIAL
+    #include "../../../queues/binomial_queue.h"
+#elif defined USE_EXPLICIT_2
+    #include "../../../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_4
+    #include "../../../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_8
+    #include "../../../queues/explicit_heap.h"
+#elif defined USE_EXPLICIT_16
+    #include "../../../queues/explicit_heap.h"
+#elif defined USE_FIBONACCI
+    #include "../../../queues/fibonacci_heap.h"
+#elif defined USE_IMPLICIT_2
+    #include "../../../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_4
+    #include "../../../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_8
+    #include "../../../queues/implicit_heap.h"
+#elif defined USE_IMPLICIT_16
+    #include "../../../queues/implicit_heap.h"
+#elif defined USE_PAIRING
+    #include "../../../queues/pairing_heap.h"
+#elif defined USE_QUAKE
+    #include "../../../queues/quake_heap.h"
+#elif defined USE_RANK_PAIRING
+    #include "../../../queues/rank_pairing_heap.h"
+#elif defined USE_RANK_RELAXED_WEAK
+    #include "../../../queues/rank_relaxed_weak_queue.h"
+#elif defined USE_STRICT_FIBONACCI
+    #include "../../../queues/strict_fibonacci_heap.h"
+#elif defined USE_VIOLATION
+    #include "../../../queues/violation_heap.h"
+#elif defined USE_SPRAY_LIST
+    #include "../../../queues/spray_list.h"
+#endif
+
+#ifdef USE_STRICT_FIBONACCI
+    static uint32_t mem_types = 3;
+    static uint32_t mem_sizes[3] =
+    {
+        sizeof( strict_fibonacci_node ),
+        sizeof( active_record ),
+        sizeof( rank_record )
+    };
+    static uint32_t mem_capacities[3] =
+    {
+        0,
+        1000,
+        1000
+    };
+#elif defined USE_QUAKE
+    static uint32_t mem_types = 2;
+    static uint32_t mem_sizes[2] =
+    {
+        sizeof( quake_item ),
+        sizeof( quake_node )
+    };
+    static uint32_t mem_capacities[2] =
+    {
+        0,
+        0
+    };
+#else
+    static uint32_t mem_types = 1;
+    static uint32_t mem_sizes[1] =
+    {
+        sizeof( pq_node_type )
+    };
+    static uint32_t mem_capacities[1] =
+    {
+        0
+    };
+#endif
+
+#define MAX_THREADS     256
+#define GRAB_SIZE       256
+#define UNREACHED       0xFFFFFFFFFFFFFFFF
+
+#define PHASE_LIGHT     0
+#define PHASE_HEAVY     1
+#define PHASE_EXIT      2
+
+/**
+ * Growable array of node ids.
+ */
+typedef struct node_list_t
+{
+    uint32_t *data;
+    uint64_t size;
+    uint64_t capacity;
+} node_list;
+
+/**
+ * Per-thread state for delta-stepping.  Padded so that counters of
+ * neighbouring workers do not share a cache line.
+ */
+typedef struct worker_t
+{
+    uint32_t id;
+    //! nodes whose distance this worker improved in the current phase
+    node_list improved;
+    //! nodes this worker expanded in the current bucket
+    node_list settled;
+    uint64_t relaxations;
+    uint64_t improvements;
+    uint8_t padding[64];
+} worker;
+
+// graph and state shared with the delta-stepping workers
+static csr_graph *graph;
+static uint64_t *dist;
+static uint64_t *expanded;
+static uint64_t *settled_in;
+static uint64_t delta;
+static uint64_t current_bucket;
+static node_list frontier;
+static uint64_t frontier_next;
+static uint32_t phase;
+static uint32_t thread_count;
+static worker workers[MAX_THREADS];
+static pthread_barrier_t phase_start;
+static pthread_barrier_t phase_end;
+
+static void list_push( node_list *list, uint32_t value );
+static uint64_t elapsed_usec( struct timeval *t0, struct timeval *t1 );
+static csr_graph* build_csr( long n, node *nodes, node *source );
+static int dijkstra( mem_map *map, pq_node_type **handles, uint64_t *result,
+    uint64_t *relaxations, uint64_t *improvements );
+static void delta_stepping( uint64_t *relaxations, uint64_t *improvements );
+static void relax( worker *self, uint32_t u, uint64_t d, bool light );
+static void* delta_worker( void *arg );
+
+int main( int argc, char **argv )
+{
+    long n, m, nmin;
+    node *ndp, *source;
+    arc *arp;
+    char name[31];
+    uint32_t i, r, t;
+    struct timeval t0, t1;
+
+    uint32_t max_threads = ( argc > 1 ) ? atoi( argv[1] ) : 1;
+    delta = ( argc > 2 ) ? strtoull( argv[2], NULL, 10 ) : 0;
+    uint32_t reps = ( argc > 3 ) ? atoi( argv[3] ) : 3;
+    if( max_threads < 1 || max_threads > MAX_THREADS || reps < 1 )
+    {
+        fprintf( stderr, "usage: %s [max_threads [delta [reps]]] < problem\n",
+            argv[0] );
+        return -1;
+    }
+
+    // a binary cache of the input is used as is, avoiding the text parser
+    graph = csr_map_cached( STDIN_FILENO );
+    if( graph != NULL && graph->problem != CSR_PROBLEM_SP )
+    {
+        csr_destroy( graph );
+        graph = NULL;
+    }
+    if( graph == NULL )
+    {
+        parse( &n, &m, &ndp, &arp, &source, &nmin, name );
+        graph = build_csr( n, ndp, source );
+        free( ndp - nmin );
+        free( arp );
+    }
+    if( graph == NULL )
+    {
+        fprintf( stderr, "Calloc fail.\n" );
+        return -1;
+    }
+
+    if( delta == 0 )
+    {
+        delta = csr_max_weight( graph ) * (uint64_t) graph->node_count /
+            ( graph->arc_count + 1 );
+        if( delta == 0 )
+            delta = 1;
+    }
+
+    uint64_t *reference = malloc( graph->node_count * sizeof( uint64_t ) );
+    dist = malloc( graph->node_count * sizeof( uint64_t ) );
+    expanded = malloc( graph->node_count * sizeof( uint64_t ) );
+    settled_in = malloc( graph->node_count * sizeof( uint64_t ) );
+    pq_node_type **handles = malloc( graph->node_count *
+        sizeof( pq_node_type* ) );
+    if( reference == NULL || dist == NULL || expanded == NULL ||
+        settled_in == NULL || handles == NULL )
+    {
+        fprintf( stderr, "Calloc fail.\n" );
+        return -1;
+    }
+
+    mem_capacities[0] = graph->node_count;
+#ifdef USE_QUAKE
+    // decay keeps each height at most ALPHA times the one below, bounding
+    // internal nodes by ALPHA / ( 1 - ALPHA ) = 3 per item
+    mem_capacities[1] = ( graph->node_count * 3 ) + 1;
+#endif
+
+#ifdef USE_EAGER
+    mem_map *map = mm_create( mem_types, mem_sizes, mem_capacities );
+#else
+    mem_map *map = mm_create( mem_types, mem_sizes );
+#endif
+
+    printf( "graph: n=%u m=%llu source=%u delta=%llu\n", graph->node_count,
+        (unsigned long long) graph->arc_count, graph->source,
+        (unsigned long long) delta );
+
+    // sequential Dijkstra through the queue under test
+    uint64_t relaxations = 0, improvements = 0, checksum = 0;
+    uint64_t total_time = 0;
+    for( r = 0; r < reps; r++ )
+    {
+        mm_clear( map );
+        gettimeofday( &t0, NULL );
+        if( dijkstra( map, handles, reference, &relaxations,
+                &improvements ) != 0 )
+        {
+            fprintf( stderr, "Queue reported no minimum while non-empty.\n" );
+            return -1;
+        }
+        gettimeofday( &t1, NULL );
+        total_time += elapsed_usec( &t0, &t1 );
+    }
+    for( i = 0; i < graph->node_count; i++ )
+    {
+        if( reference[i] != UNREACHED )
+            checksum += reference[i];
+    }
+
+    uint64_t dijkstra_time = total_time / reps;
+    printf( "dijkstra threads=1 time_us=%llu relaxations=%llu "
+        "improvements=%llu relax_per_sec=%.0f checksum=%llu\n",
+        (unsigned long long) dijkstra_time,
+        (unsigned long long) relaxations,
+        (unsigned long long) improvements,
+        relaxations / ( ( dijkstra_time + 1 ) / 1e6 ),
+        (unsigned long long) checksum );
+
+    // delta-stepping with doubling thread counts
+    pthread_t threads[MAX_THREADS];
+    uint64_t base_time = 0, step_time;
+    uint32_t mismatches;
+    for( thread_count = 1; thread_count <= max_threads; thread_count <<= 1 )
+    {
+        pthread_barrier_init( &phase_start, NULL, thread_count + 1 );
+        pthread_barrier_init( &phase_end, NULL, thread_count + 1 );
+        for( t = 0; t < thread_count; t++ )
+        {
+            workers[t].id = t;
+            pthread_create( &threads[t], NULL, delta_worker, &workers[t] );
+        }
+
+        total_time = 0;
+        for( r = 0; r < reps; r++ )
+        {
+            gettimeofday( &t0, NULL );
+            delta_stepping( &relaxations, &improvements );
+            gettimeofday( &t1, NULL );
+            total_time += elapsed_usec( &t0, &t1 );
+        }
+
+        phase = PHASE_EXIT;
+        pthread_barrier_wait( &phase_start );
+        for( t = 0; t < thread_count; t++ )
+            pthread_join( threads[t], NULL );
+        pthread_barrier_destroy( &phase_start );
+        pthread_barrier_destroy( &phase_end );
+
+        mismatches = 0;
+        for( i = 0; i < graph->node_count; i++ )
+        {
+            if( dist[i] != reference[i] )
+                mismatches++;
+        }
+
+        step_time = total_time / reps;
+        if( thread_count == 1 )
+            base_time = step_time;
+        printf( "delta_stepping threads=%u time_us=%llu relaxations=%llu "
+            "improvements=%llu relax_per_sec=%.0f speedup=%.2f "
+            "vs_dijkstra=%.2f mismatches=%u\n", thread_count,
+            (unsigned long long) step_time,
+            (unsigned long long) relaxations,
+            (unsigned long long) improvements,
+            relaxations / ( ( step_time + 1 ) / 1e6 ),
+            (double) base_time / ( step_time + 1 ),
+            (double) dijkstra_time / ( step_time + 1 ), mismatches );
+    }
+
+    for( t = 0; t < MAX_THREADS; t++ )
+    {
+        free( workers[t].improved.data );
+        free( workers[t].settled.data );
+    }
+    free( frontier.data );
+    mm_destroy( map );
+    free( handles );
+    free( settled_in );
+    free( expanded );
+    free( dist );
+    free( reference );
+    csr_destroy( graph );
+
+    return 0;
+}
+
+/**
+ * Appends a value to a list, doubling its capacity as needed.
+ *
+ * @param list  List to append to
+ * @param value Value to append
+ */
+static void list_push( node_list *list, uint32_t value )
+{
+    if( list->size == list->capacity )
+    {
+        list->capacity = ( list->capacity == 0 ) ? 1024 : list->capacity * 2;
+        list->data = realloc( list->data, list->capacity * sizeof( uint32_t ) );
+        if( list->data == NULL )
+            exit( -1 );
+    }
+
+    list->data[list->size++] = value;
+}
+
+static uint64_t elapsed_usec( struct timeval *t0, struct timeval *t1 )
+{
+    return ( t1->tv_sec - t0->tv_sec ) * 1000000 +
+        ( t1->tv_usec - t0->tv_usec );
+}
+
+/**
+ * Converts the parser's node/arc representation, whose arcs are already
+ * grouped by tail, to CSR with node ids relative to the first node.
+ *
+ * @param n         Number of nodes
+ * @param nodes     First node, as returned by the parser
+ * @param source    Source node
+ * @return          New graph, or NULL on allocation failure
+ */
+static csr_graph* build_csr( long n, node *nodes, node *source )
+{
+    long i;
+    arc *a;
+    uint64_t j = 0;
+    csr_graph *result = csr_create( n, nodes[n].first - nodes[0].first );
+    if( result == NULL )
+        return NULL;
+
+    result->source = source - nodes;
+    for( i = 0; i < n; i++ )
+    {
+        result->offsets[i] = j;
+        for( a = nodes[i].first; a != nodes[i+1].first; a++, j++ )
+        {
+            result->targets[j] = a->head - nodes;
+            result->weights[j] = a->len;
+        }
+    }
+    result->offsets[n] = j;
+
+    return result;
+}
+
+/**
+ * Textbook Dijkstra against the queue under test.  The item stored with each
+ * node is its id, so the minimum's id is recovered via pq_get_item before it is
+ * deleted.
+ *
+ * @param map           Memory map for queue nodes
+ * @param handles       Scratch array of queue handles, one per graph node
+ * @param result        Output distances
+ * @param relaxations   Output number of arcs examined
+ * @param improvements  Output number of distance improvements
+ * @return              0 on success, -1 if the queue lost track of its minimum
+ */
+static int dijkstra( mem_map *map, pq_node_type **handles, uint64_t *result,
+    uint64_t *relaxations, uint64_t *improvements )
+{
+    uint32_t u, v;
+    uint64_t j, d, candidate;
+    uint64_t relax_count = 0, improve_count = 0;
+    pq_node_type *min;
+
+    for( u = 0; u < graph->node_count; u++ )
+    {
+        result[u] = UNREACHED;
+        handles[u] = NULL;
+    }
+
+    pq_type *queue = pq_create( map );
+    result[graph->source] = 0;
+    handles[graph->source] = pq_insert( queue, graph->source, 0 );
+
+    while( !pq_empty( queue ) )
+    {
+        min = pq_find_min( queue );
+        if( min == NULL )
+        {
+            pq_destroy( queue );
+            return -1;
+        }
+        u = *pq_get_item( queue, min );
+        d = pq_get_key( queue, min );
+        pq_delete_min( queue );
+        handles[u] = NULL;
+
+        for( j = graph->offsets[u]; j < graph->offsets[u+1]; j++ )
+        {
+            relax_count++;
+            v = graph->targets[j];
+            candidate = d + graph->weights[j];
+            if( candidate < result[v] )
+            {
+                improve_count++;
+                result[v] = candidate;
+                if( handles[v] == NULL )
+                    handles[v] = pq_insert( queue, v, candidate );
+                else
+                    pq_decrease_key( queue, handles[v], candidate );
+            }
+        }
+    }
+
+    pq_destroy( queue );
+    *relaxations = relax_count;
+    *improvements = improve_count;
+
+    return 0;
+}
+
+/**
+ * Coordinates one delta-stepping run on the worker pool.  Buckets hold node
+ * ids lazily: a node may appear in several buckets and is skipped unless its
+ * current distance still falls in the bucket being processed.  Within a bucket,
+ * light arcs (length <= delta) are relaxed repeatedly until the bucket stays
+ * empty, then heavy arcs of every node settled in it are relaxed once.  The
+ * workers' improved nodes are distributed into buckets here, sequentially.
+ *
+ * @param relaxations   Output number of arcs examined
+ * @param improvements  Output number of distance improvements
+ */
+static void delta_stepping( uint64_t *relaxations, uint64_t *improvements )
+{
+    uint32_t i, t, v;
+    uint64_t j, k, b;
+    uint64_t bucket_count = csr_max_weight( graph ) / delta + 2;
+    node_list *buckets = calloc( bucket_count, sizeof( node_list ) );
+    node_list swap;
+
+    for( i = 0; i < graph->node_count; i++ )
+    {
+        dist[i] = UNREACHED;
+        expanded[i] = UNREACHED;
+        settled_in[i] = UNREACHED;
+    }
+    for( t = 0; t < thread_count; t++ )
+    {
+        workers[t].relaxations = 0;
+        workers[t].improvements = 0;
+    }
+
+    dist[graph->source] = 0;
+    list_push( &buckets[0], graph->source );
+    current_bucket = 0;
+
+    while( TRUE )
+    {
+        // find the next non-empty bucket, if any
+        for( k = 0; k < bucket_count; k++ )
+        {
+            if( buckets[( current_bucket + k ) % bucket_count].size > 0 )
+                break;
+        }
+        if( k == bucket_count )
+            break;
+        current_bucket += k;
+        b = current_bucket % bucket_count;
+
+        for( t = 0; t < thread_count; t++ )
+            workers[t].settled.size = 0;
+
+        phase = PHASE_LIGHT;
+        while( buckets[b].size > 0 )
+        {
+            swap = frontier;
+            frontier = buckets[b];
+            buckets[b] = swap;
+            buckets[b].size = 0;
+            frontier_next = 0;
+
+            pthread_barrier_wait( &phase_start );
+            pthread_barrier_wait( &phase_end );
+
+            for( t = 0; t < thread_count; t++ )
+            {
+                for( j = 0; j < workers[t].improved.size; j++ )
+                {
+                    v = workers[t].improved.data[j];
+                    list_push( &buckets[( dist[v] / delta ) % bucket_count], v );
+                }
+                workers[t].improved.size = 0;
+            }
+        }
+
+        phase = PHASE_HEAVY;
+        pthread_barrier_wait( &phase_start );
+        pthread_barrier_wait( &phase_end );
+
+        for( t = 0; t < thread_count; t++ )
+        {
+            for( j = 0; j < workers[t].improved.size; j++ )
+            {
+                v = workers[t].improved.data[j];
+                list_push( &buckets[( dist[v] / delta ) % bucket_count], v );
+            }
+            workers[t].improved.size = 0;
+        }
+    }
+
+    *relaxations = 0;
+    *improvements = 0;
+    for( t = 0; t < thread_count; t++ )
+    {
+        *relaxations += workers[t].relaxations;
+        *improvements += workers[t].improvements;
+    }
+
+    for( k = 0; k < bucket_count; k++ )
+        free( buckets[k].data );
+    free( buckets );
+}
+
+/**
+ * Relaxes either the light or the heavy arcs of a node at distance d,
+ * lowering target distances with a CAS loop and recording each improvement.
+ *
+ * @param self  Calling worker
+ * @param u     Node whose arcs to relax
+ * @param d     Distance of u
+ * @param light True for arcs of length at most delta, false for the rest
+ */
+static void relax( worker *self, uint32_t u, uint64_t d, bool light )
+{
+    uint32_t v;
+    uint64_t j, candidate, old;
+
+    for( j = graph->offsets[u]; j < graph->offsets[u+1]; j++ )
+    {
+        if( ( graph->weights[j] <= delta ) != light )
+            continue;
+
+        self->relaxations++;
+        v = graph->targets[j];
+        candidate = d + graph->weights[j];
+        old = __atomic_load_n( &dist[v], __ATOMIC_RELAXED );
+        while( candidate < old )
+        {
+            if( __atomic_compare_exchange_n( &dist[v], &old, candidate, 0,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+            {
+                self->improvements++;
+                list_push( &self->improved, v );
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Worker loop for delta-stepping.  In a light phase, workers grab chunks of
+ * the frontier and expand each node whose distance still lies in the current
+ * bucket and has not already been expanded at that distance.  In a heavy
+ * phase, each worker relaxes the heavy arcs of the nodes it settled.
+ *
+ * @param arg   This worker's state
+ * @return      Nothing
+ */
+static void* delta_worker( void *arg )
+{
+    worker *self = (worker*) arg;
+    uint64_t start, end, j, d, old;
+    uint32_t u;
+
+    while( TRUE )
+    {
+        pthread_barrier_wait( &phase_start );
+        if( phase == PHASE_EXIT )
+            break;
+
+        if( phase == PHASE_LIGHT )
+        {
+            while( ( start = __atomic_fetch_add( &frontier_next, GRAB_SIZE,
+                __ATOMIC_RELAXED ) ) < frontier.size )
+            {
+                end = start + GRAB_SIZE;
+                if( end > frontier.size )
+                    end = frontier.size;
+
+                for( j = start; j < end; j++ )
+                {
+                    u = frontier.data[j];
+                    d = __atomic_load_n( &dist[u], __ATOMIC_RELAXED );
+                    if( d / delta != current_bucket )
+                        continue;
+
+                    old = __atomic_exchange_n( &expanded[u], d,
+                        __ATOMIC_RELAXED );
+                    if( old == d )
+                        continue;
+
+                    if( __atomic_exchange_n( &settled_in[u], current_bucket,
+                        __ATOMIC_RELAXED ) != current_bucket )
+                        list_push( &self->settled, u );
+
+                    relax( self, u, d, TRUE );
+                }
+            }
+        }
+        else
+        {
+            for( j = 0; j < self->settled.size; j++ )
+            {
+                u = self->settled.data[j];
+                relax( self, u, dist[u], FALSE );
+            }
+        }
+
+        pthread_barrier_wait( &phase_end );
+    }
+
+    return NULL;
+}
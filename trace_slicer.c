@@ -0,0 +1,1019 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "trace_tools.h"
+
+#define NO_QUEUE    0xFFFFFFFF
+
+// orders for renumber
+#define RENUMBER_FIRST      0
+#define RENUMBER_COACCESS   1
+#define RENUMBER_RECYCLE    2
+
+// direct-mapped cache of handle table lines, to rate a numbering: 4096 lines
+// of eight 8-byte handles
+#define LOOKUP_LINES        4096
+#define LOOKUP_SHIFT        3
+
+/**
+ * Precedes each checkpoint in a checkpoint file.  It is followed by the ids
+ * of the queues alive at that point and by one checkpoint_node per item
+ * held, queue by queue.
+ */
+typedef struct checkpoint_record_t
+{
+    //! index of the first operation not applied
+    uint64_t op_index;
+    //! trace file offset of that operation
+    uint64_t offset;
+    uint32_t queue_count;
+    uint32_t node_count;
+} __attribute__ ((packed, aligned(4))) checkpoint_record;
+
+typedef struct checkpoint_node_t
+{
+    uint32_t pq_id;
+    uint32_t node_id;
+    key_type key;
+    item_type item;
+} __attribute__ ((packed, aligned(4))) checkpoint_node;
+
+/**
+ * One queue of the trace as a binary heap of node ids, ordered by key and
+ * then by node id.
+ */
+typedef struct ref_queue_t
+{
+    uint32_t *heap;
+    uint32_t size;
+    uint32_t capacity;
+    int alive;
+    //! items held that were kept by sampling
+    uint32_t sampled;
+} ref_queue;
+
+static pq_trace_header header;
+static int out_file;
+static uint64_t written;
+static ref_queue *queues;
+static key_type *keys;
+static item_type *items;
+//! heap position of each node id
+static uint32_t *pos;
+//! queue holding each node id, NO_QUEUE if none
+static uint32_t *owner;
+//! whether sampling kept the last insertion of each node id
+static uint8_t *kept;
+static uint64_t rng_state;
+//! one past the position of the last operation on each node id, for
+//! renumbering
+static uint64_t *last_use;
+
+static int checkpoint( int argc, char **argv );
+static int window( int argc, char **argv );
+static int sample( int argc, char **argv );
+static int renumber( int argc, char **argv );
+static int open_trace( const char *name );
+static int create_output( const char *name );
+static int finish_output( const char *name );
+static void write_op( void *op );
+static uint32_t apply( void *op );
+static void write_checkpoint( FILE *file, uint64_t op_index,
+    uint64_t offset );
+static int read_checkpoint( FILE *file, uint64_t first, uint64_t *op_index,
+    uint64_t *offset );
+static int ref_insert( uint32_t pq_id, uint32_t node_id, key_type key,
+    item_type item );
+static void ref_remove( uint32_t node_id );
+static void ref_release( uint32_t pq_id );
+static int before( uint32_t a, uint32_t b );
+static void sift_up( ref_queue *queue, uint32_t i );
+static void sift_down( ref_queue *queue, uint32_t i );
+static double uniform( void );
+static int has_node( uint32_t code );
+static int by_last_use( const void *a, const void *b );
+static int lookup_hit( uint32_t *lines, uint32_t node_id );
+
+/**
+ * Cuts existing traces into smaller ones that replay quickly, or renumbers
+ * their nodes.
+ *
+ *   trace_slicer checkpoint trace checkpoints interval
+ *   trace_slicer window trace out first last [checkpoints]
+ *   trace_slicer sample trace out rate [seed]
+ *   trace_slicer renumber trace out first|coaccess|recycle
+ *
+ * checkpoint replays the trace against reference heaps and saves their state
+ * every interval operations: the live queues, the (node id, key, item) of
+ * every item and the trace offset to resume from.
+ *
+ * window writes operations first to last - 1 of the trace, preceded by a
+ * reconstruction of the state before operation first: a create for every live
+ * queue and an insert for every item it holds, in heap order.  Queues still
+ * alive at the end are destroyed, so the window is a complete trace for
+ * trace_driver.  Given a checkpoint file, the trace is read from the last
+ * checkpoint at or before first instead of from its start.  A window with
+ * first equal to last holds only the reconstruction, which times the part of
+ * a window's replay that is not the window itself.
+ *
+ * sample keeps each insertion with probability rate together with every
+ * later operation on that node, including the delete-min that removes it.
+ * Since the deleted item is the minimum of all items, it is also the minimum
+ * of the kept ones, so the subtrace stays consistent and each kind of node
+ * operation keeps its share of the trace.  Find-min, get-size and empty are
+ * kept with probability rate, queue creation and destruction always.
+ *
+ * renumber rewrites the node ids, which the drivers use to index their table
+ * of handles, so that successive operations touch nearby entries.  Traces
+ * that use vertex ids as node ids, like those of ni, scatter these lookups
+ * over the whole table.  first numbers the nodes in order of first
+ * appearance.  coaccess sorts them by the position of the last operation on
+ * them, so nodes last used together sit together.  recycle gives each
+ * insertion the id most recently freed by a delete, delete-min, clear or
+ * destroy, so the ids stay below the peak number of live items and the
+ * recently used part of the table is reused.  The output header holds the
+ * new number of node ids.  To rate a numbering, the handle lookups of the
+ * node operations are run through a 256 KB direct-mapped cache, and its hit
+ * rate is printed for the old and the new ids.
+ *
+ * All of them assume unique keys, as in every generated trace, since the
+ * reference heaps break ties by node id and a queue may not.  Except for
+ * renumber, node ids and queue ids are those of the input trace.
+ */
+int main( int argc, char **argv )
+{
+    int result;
+
+    if( argc < 2 )
+        result = 1;
+    else if( strcmp( argv[1], "checkpoint" ) == 0 )
+        result = checkpoint( argc, argv );
+    else if( strcmp( argv[1], "window" ) == 0 )
+        result = window( argc, argv );
+    else if( strcmp( argv[1], "sample" ) == 0 )
+        result = sample( argc, argv );
+    else if( strcmp( argv[1], "renumber" ) == 0 )
+        result = renumber( argc, argv );
+    else
+        result = 1;
+
+    if( result == 1 )
+    {
+        fprintf( stderr, "usage: %s checkpoint trace checkpoints interval\n"
+            "       %s window trace out first last [checkpoints]\n"
+            "       %s sample trace out rate [seed]\n"
+            "       %s renumber trace out first|coaccess|recycle\n",
+            argv[0], argv[0], argv[0], argv[0] );
+        return -1;
+    }
+
+    return result;
+}
+
+/**
+ * Saves the reference state every interval operations.
+ *
+ * @param argc  Argument count of the program
+ * @param argv  Arguments of the program
+ * @return      0 on success, 1 on bad arguments, -1 on failure
+ */
+static int checkpoint( int argc, char **argv )
+{
+    pq_op_blank op;
+    uint64_t i, interval;
+    uint64_t saved = 0;
+
+    if( argc < 5 || ( interval = strtoull( argv[4], NULL, 10 ) ) == 0 )
+        return 1;
+
+    int trace_file = open_trace( argv[2] );
+    if( trace_file < 0 )
+        return -1;
+    FILE *file = fopen( argv[3], "wb" );
+    if( file == NULL )
+    {
+        fprintf( stderr, "Could not open %s.\n", argv[3] );
+        return -1;
+    }
+    fwrite( &header, sizeof( pq_trace_header ), 1, file );
+
+    for( i = 0; i < header.op_count; i++ )
+    {
+        if( i > 0 && i % interval == 0 )
+        {
+            write_checkpoint( file, i, lseek( trace_file, 0, SEEK_CUR ) );
+            saved++;
+        }
+        if( pq_trace_read_op( trace_file, &op ) != 0 || apply( &op ) ==
+                NO_QUEUE - 1 )
+            goto invalid;
+    }
+
+    close( trace_file );
+    if( fclose( file ) != 0 )
+    {
+        fprintf( stderr, "Failed to write %s.\n", argv[3] );
+        return -1;
+    }
+    printf( "%s: %llu checkpoints every %llu of %llu ops\n", argv[3],
+        (unsigned long long) saved, (unsigned long long) interval,
+        (unsigned long long) header.op_count );
+
+    return 0;
+
+invalid:
+    fprintf( stderr, "Invalid operation %llu.\n", (unsigned long long) i );
+    return -1;
+}
+
+/**
+ * Writes a window of the trace behind a reconstruction of its initial state.
+ *
+ * @param argc  Argument count of the program
+ * @param argv  Arguments of the program
+ * @return      0 on success, 1 on bad arguments, -1 on failure
+ */
+static int window( int argc, char **argv )
+{
+    pq_op_blank op;
+    pq_op_create op_create;
+    pq_op_insert op_insert;
+    pq_op_destroy op_destroy;
+    uint64_t i, first, last, resumed = 0, offset;
+    uint64_t restored = 0;
+    uint32_t pq_id, j, node_id;
+
+    if( argc < 6 )
+        return 1;
+    first = strtoull( argv[4], NULL, 10 );
+    last = strtoull( argv[5], NULL, 10 );
+    if( last < first )
+        return 1;
+
+    int trace_file = open_trace( argv[2] );
+    if( trace_file < 0 )
+        return -1;
+    if( last > header.op_count )
+        last = header.op_count;
+    if( first > last )
+        first = last;
+
+    if( argc > 6 )
+    {
+        FILE *file = fopen( argv[6], "rb" );
+        if( file == NULL )
+        {
+            fprintf( stderr, "Could not open %s.\n", argv[6] );
+            return -1;
+        }
+        if( read_checkpoint( file, first, &resumed, &offset ) != 0 )
+            return -1;
+        fclose( file );
+        if( resumed > 0 )
+            lseek( trace_file, offset, SEEK_SET );
+    }
+
+    for( i = resumed; i < first; i++ )
+    {
+        if( pq_trace_read_op( trace_file, &op ) != 0 || apply( &op ) ==
+                NO_QUEUE - 1 )
+            goto invalid;
+    }
+
+    if( create_output( argv[3] ) != 0 )
+        return -1;
+
+    for( pq_id = 0; pq_id < header.pq_ids; pq_id++ )
+    {
+        if( !queues[pq_id].alive )
+            continue;
+        op_create.code = PQ_OP_CREATE;
+        op_create.pq_id = pq_id;
+        write_op( &op_create );
+        for( j = 0; j < queues[pq_id].size; j++ )
+        {
+            node_id = queues[pq_id].heap[j];
+            op_insert.code = PQ_OP_INSERT;
+            op_insert.pq_id = pq_id;
+            op_insert.node_id = node_id;
+            op_insert.key = keys[node_id];
+            op_insert.item = items[node_id];
+            write_op( &op_insert );
+            restored++;
+        }
+    }
+
+    for( ; i < last; i++ )
+    {
+        if( pq_trace_read_op( trace_file, &op ) != 0 || apply( &op ) ==
+                NO_QUEUE - 1 )
+            goto invalid;
+        write_op( &op );
+    }
+    close( trace_file );
+
+    for( pq_id = 0; pq_id < header.pq_ids; pq_id++ )
+    {
+        if( !queues[pq_id].alive )
+            continue;
+        op_destroy.code = PQ_OP_DESTROY;
+        op_destroy.pq_id = pq_id;
+        write_op( &op_destroy );
+    }
+
+    if( finish_output( argv[3] ) != 0 )
+        return -1;
+
+    printf( "%s: ops %llu to %llu, read from op %llu, %llu items restored, "
+        "%llu ops\n", argv[3], (unsigned long long) first,
+        (unsigned long long) last, (unsigned long long) resumed,
+        (unsigned long long) restored,
+        (unsigned long long) header.op_count );
+
+    return 0;
+
+invalid:
+    fprintf( stderr, "Invalid operation %llu.\n", (unsigned long long) i );
+    return -1;
+}
+
+/**
+ * Writes a subtrace of the operations on a random sample of insertions.
+ *
+ * @param argc  Argument count of the program
+ * @param argv  Arguments of the program
+ * @return      0 on success, 1 on bad arguments, -1 on failure
+ */
+static int sample( int argc, char **argv )
+{
+    pq_op_blank op;
+    pq_op_insert *op_insert = (pq_op_insert*) &op;
+    uint64_t i;
+    uint32_t node_id, pq_id;
+    uint32_t *op_ids = ( (uint32_t*) &op ) + 1;
+    int keep;
+
+    if( argc < 5 )
+        return 1;
+    double rate = atof( argv[4] );
+    rng_state = ( argc > 5 ) ? strtoull( argv[5], NULL, 10 ) : 1;
+    if( rate <= 0 || rate > 1 )
+        return 1;
+    rng_state = rng_state * 0x9E3779B97F4A7C15ULL + 1;
+
+    int trace_file = open_trace( argv[2] );
+    if( trace_file < 0 )
+        return -1;
+    if( create_output( argv[3] ) != 0 )
+        return -1;
+
+    for( i = 0; i < header.op_count; i++ )
+    {
+        if( pq_trace_read_op( trace_file, &op ) != 0 )
+            goto invalid;
+
+        // decide before apply, which forgets the queue of deleted nodes
+        pq_id = op_ids[0];
+        node_id = op_ids[1];
+        switch( op.code )
+        {
+            case PQ_OP_INSERT:
+                kept[op_insert->node_id] = ( uniform() < rate );
+                keep = kept[op_insert->node_id];
+                if( keep )
+                    queues[pq_id].sampled++;
+                break;
+            case PQ_OP_GET_KEY:
+            case PQ_OP_GET_ITEM:
+            case PQ_OP_DECREASE_KEY:
+            case PQ_OP_INCREASE_KEY:
+                keep = ( node_id < header.node_ids && kept[node_id] );
+                break;
+            case PQ_OP_DELETE:
+                keep = ( node_id < header.node_ids && kept[node_id] );
+                if( keep && pq_id < header.pq_ids )
+                    queues[pq_id].sampled--;
+                break;
+            case PQ_OP_FIND_MIN:
+            case PQ_OP_GET_SIZE:
+            case PQ_OP_EMPTY:
+                // an empty subtrace queue may not support every query
+                keep = ( uniform() < rate && pq_id < header.pq_ids &&
+                    ( op.code != PQ_OP_FIND_MIN ||
+                    queues[pq_id].sampled > 0 ) );
+                break;
+            default:
+                keep = 1;
+                break;
+        }
+
+        node_id = apply( &op );
+        if( node_id == NO_QUEUE - 1 )
+            goto invalid;
+        if( op.code == PQ_OP_DELETE_MIN )
+        {
+            keep = ( node_id != NO_QUEUE && kept[node_id] );
+            if( keep )
+                queues[pq_id].sampled--;
+        }
+
+        if( keep )
+            write_op( &op );
+    }
+    close( trace_file );
+
+    if( finish_output( argv[3] ) != 0 )
+        return -1;
+
+    printf( "%s: %llu of %llu ops\n", argv[3], (unsigned long long) written,
+        (unsigned long long) i );
+
+    return 0;
+
+invalid:
+    fprintf( stderr, "Invalid operation %llu.\n", (unsigned long long) i );
+    return -1;
+}
+
+/**
+ * Writes the trace with its node ids renumbered for locality of the driver's
+ * handle table.
+ *
+ * @param argc  Argument count of the program
+ * @param argv  Arguments of the program
+ * @return      0 on success, 1 on bad arguments, -1 on failure
+ */
+static int renumber( int argc, char **argv )
+{
+    pq_op_blank op;
+    uint64_t i;
+    uint32_t node_id, pq_id, j, mode;
+    uint32_t *op_ids = ( (uint32_t*) &op ) + 1;
+    uint32_t *order, *rename, *free_ids;
+    uint32_t next_id = 0, free_count = 0;
+    uint32_t lines_old[LOOKUP_LINES], lines_new[LOOKUP_LINES];
+    uint64_t hits_old = 0, hits_new = 0, accesses = 0;
+
+    if( argc < 5 )
+        return 1;
+    if( strcmp( argv[4], "first" ) == 0 )
+        mode = RENUMBER_FIRST;
+    else if( strcmp( argv[4], "coaccess" ) == 0 )
+        mode = RENUMBER_COACCESS;
+    else if( strcmp( argv[4], "recycle" ) == 0 )
+        mode = RENUMBER_RECYCLE;
+    else
+        return 1;
+
+    int trace_file = open_trace( argv[2] );
+    if( trace_file < 0 )
+        return -1;
+    rename = malloc( header.node_ids * sizeof( uint32_t ) );
+    free_ids = malloc( header.node_ids * sizeof( uint32_t ) );
+    if( header.node_ids > 0 && ( rename == NULL || free_ids == NULL ) )
+    {
+        fprintf( stderr, "Malloc fail.\n" );
+        return -1;
+    }
+    memset( rename, 0xFF, header.node_ids * sizeof( uint32_t ) );
+    memset( lines_old, 0xFF, sizeof( lines_old ) );
+    memset( lines_new, 0xFF, sizeof( lines_new ) );
+
+    // rank the node ids by the last operation on them
+    if( mode == RENUMBER_COACCESS )
+    {
+        last_use = calloc( header.node_ids, sizeof( uint64_t ) );
+        order = malloc( header.node_ids * sizeof( uint32_t ) );
+        if( header.node_ids > 0 && ( last_use == NULL || order == NULL ) )
+        {
+            fprintf( stderr, "Malloc fail.\n" );
+            return -1;
+        }
+        for( i = 0; i < header.op_count; i++ )
+        {
+            if( pq_trace_read_op( trace_file, &op ) != 0 )
+                goto invalid;
+            if( has_node( op.code ) && op_ids[1] < header.node_ids )
+                last_use[op_ids[1]] = i + 1;
+        }
+        for( node_id = 0; node_id < header.node_ids; node_id++ )
+        {
+            if( last_use[node_id] > 0 )
+                order[next_id++] = node_id;
+        }
+        qsort( order, next_id, sizeof( uint32_t ), by_last_use );
+        for( j = 0; j < next_id; j++ )
+            rename[order[j]] = j;
+        free( order );
+        free( last_use );
+        lseek( trace_file, sizeof( pq_trace_header ), SEEK_SET );
+    }
+
+    if( create_output( argv[3] ) != 0 )
+        return -1;
+
+    for( i = 0; i < header.op_count; i++ )
+    {
+        if( pq_trace_read_op( trace_file, &op ) != 0 )
+            goto invalid;
+        pq_id = op_ids[0];
+        node_id = op_ids[1];
+
+        // a cleared or destroyed queue hands back the ids of all its nodes
+        if( mode == RENUMBER_RECYCLE && pq_id < header.pq_ids &&
+                ( op.code == PQ_OP_CREATE || op.code == PQ_OP_DESTROY ||
+                op.code == PQ_OP_CLEAR ) )
+        {
+            for( j = 0; j < queues[pq_id].size; j++ )
+                free_ids[free_count++] = rename[queues[pq_id].heap[j]];
+        }
+
+        node_id = apply( &op );
+        if( node_id == NO_QUEUE - 1 )
+            goto invalid;
+        if( mode == RENUMBER_RECYCLE && node_id != NO_QUEUE )
+            free_ids[free_count++] = rename[node_id];
+
+        if( has_node( op.code ) && op_ids[1] < header.node_ids )
+        {
+            node_id = op_ids[1];
+            if( op.code == PQ_OP_INSERT && mode == RENUMBER_RECYCLE )
+                rename[node_id] = ( free_count > 0 ) ?
+                    free_ids[--free_count] : next_id++;
+            else if( rename[node_id] == NO_QUEUE )
+                rename[node_id] = next_id++;
+
+            hits_old += lookup_hit( lines_old, node_id );
+            hits_new += lookup_hit( lines_new, rename[node_id] );
+            accesses++;
+
+            op_ids[1] = rename[node_id];
+            if( op.code == PQ_OP_DELETE && mode == RENUMBER_RECYCLE )
+                free_ids[free_count++] = rename[node_id];
+        }
+
+        write_op( &op );
+    }
+    close( trace_file );
+
+    printf( "%s: %u of %u node ids, %llu lookups, %.1f%% to %.1f%% cached\n",
+        argv[3], next_id, header.node_ids, (unsigned long long) accesses,
+        100.0 * hits_old / ( accesses ? accesses : 1 ),
+        100.0 * hits_new / ( accesses ? accesses : 1 ) );
+
+    header.node_ids = next_id;
+    if( finish_output( argv[3] ) != 0 )
+        return -1;
+    free( rename );
+    free( free_ids );
+
+    return 0;
+
+invalid:
+    fprintf( stderr, "Invalid operation %llu.\n", (unsigned long long) i );
+    return -1;
+}
+
+/**
+ * Opens a trace, reads its header and allocates the reference state.
+ *
+ * @param name  Trace to open
+ * @return      File positioned at the first operation, -1 on failure
+ */
+static int open_trace( const char *name )
+{
+    int file = open( name, O_RDONLY );
+    if( file < 0 || pq_trace_read_header( file, &header ) != 0 )
+    {
+        fprintf( stderr, "Could not read %s.\n", name );
+        return -1;
+    }
+
+    queues = calloc( header.pq_ids, sizeof( ref_queue ) );
+    keys = calloc( header.node_ids, sizeof( key_type ) );
+    items = calloc( header.node_ids, sizeof( item_type ) );
+    pos = calloc( header.node_ids, sizeof( uint32_t ) );
+    owner = malloc( header.node_ids * sizeof( uint32_t ) );
+    kept = calloc( header.node_ids, sizeof( uint8_t ) );
+    if( ( header.pq_ids > 0 && queues == NULL ) || ( header.node_ids > 0 &&
+            ( keys == NULL || items == NULL || pos == NULL ||
+            owner == NULL || kept == NULL ) ) )
+    {
+        fprintf( stderr, "Malloc fail.\n" );
+        return -1;
+    }
+    memset( owner, 0xFF, header.node_ids * sizeof( uint32_t ) );
+
+    return file;
+}
+
+/**
+ * Creates the output trace with a placeholder header.
+ *
+ * @param name  Trace to create
+ * @return      0 on success, -1 on failure
+ */
+static int create_output( const char *name )
+{
+    pq_trace_header blank = header;
+
+    out_file = open( name, O_RDWR | O_CREAT | O_TRUNC, S_IRWXU );
+    if( out_file < 0 )
+    {
+        fprintf( stderr, "Failed to open %s.\n", name );
+        return -1;
+    }
+    blank.op_count = 0;
+    pq_trace_write_header( out_file, blank );
+
+    return 0;
+}
+
+/**
+ * Writes the final header of the output trace, with the ids of the input
+ * trace and the number of operations written, and closes it.
+ *
+ * @param name  Name of the output trace
+ * @return      0 on success, -1 on failure
+ */
+static int finish_output( const char *name )
+{
+    header.op_count = written;
+    if( pq_trace_write_header( out_file, header ) != 0 ||
+            pq_trace_flush_buffer( out_file ) != 0 )
+    {
+        fprintf( stderr, "Failed to write %s.\n", name );
+        return -1;
+    }
+    close( out_file );
+
+    return 0;
+}
+
+static void write_op( void *op )
+{
+    pq_trace_write_op( out_file, op );
+    written++;
+}
+
+/**
+ * Applies an operation to the reference state.
+ *
+ * @param op    Operation to apply
+ * @return      Node id removed by a delete-min, NO_QUEUE if none, and
+ *              NO_QUEUE - 1 if the operation does not fit the state
+ */
+static uint32_t apply( void *op )
+{
+    uint32_t code = *( (uint32_t*) op );
+    uint32_t pq_id = ( (uint32_t*) op )[1];
+    uint32_t node_id, dst_id, i;
+    pq_op_insert *op_insert;
+    pq_op_meld *op_meld;
+    key_type key;
+
+    if( code == PQ_OP_MELD )
+    {
+        op_meld = (pq_op_meld*) op;
+        dst_id = op_meld->pq_dst_id;
+        if( op_meld->pq_src1_id >= header.pq_ids ||
+                op_meld->pq_src2_id >= header.pq_ids ||
+                dst_id >= header.pq_ids )
+            return NO_QUEUE - 1;
+
+        // the sources are consumed, and the destination holds both
+        uint32_t sources[2] = { op_meld->pq_src1_id, op_meld->pq_src2_id };
+        for( i = 0; i < 2; i++ )
+        {
+            ref_queue *source = queues + sources[i];
+            if( sources[i] == dst_id || ( i == 1 && sources[1] == sources[0] ) )
+                continue;
+            while( source->size > 0 )
+            {
+                node_id = source->heap[0];
+                ref_remove( node_id );
+                if( ref_insert( dst_id, node_id, keys[node_id],
+                        items[node_id] ) != 0 )
+                    return NO_QUEUE - 1;
+            }
+            queues[dst_id].sampled += source->sampled;
+            source->sampled = 0;
+            source->alive = 0;
+        }
+        queues[dst_id].alive = 1;
+        return NO_QUEUE;
+    }
+
+    if( pq_id >= header.pq_ids )
+        return NO_QUEUE - 1;
+    ref_queue *queue = queues + pq_id;
+
+    switch( code )
+    {
+        case PQ_OP_CREATE:
+            ref_release( pq_id );
+            queue->alive = 1;
+            break;
+        case PQ_OP_DESTROY:
+            ref_release( pq_id );
+            queue->alive = 0;
+            break;
+        case PQ_OP_CLEAR:
+            ref_release( pq_id );
+            break;
+        case PQ_OP_INSERT:
+            op_insert = (pq_op_insert*) op;
+            if( op_insert->node_id >= header.node_ids ||
+                    owner[op_insert->node_id] != NO_QUEUE ||
+                    ref_insert( pq_id, op_insert->node_id, op_insert->key,
+                    op_insert->item ) != 0 )
+                return NO_QUEUE - 1;
+            break;
+        case PQ_OP_DELETE:
+            node_id = ( (pq_op_delete*) op )->node_id;
+            if( node_id >= header.node_ids || owner[node_id] != pq_id )
+                return NO_QUEUE - 1;
+            ref_remove( node_id );
+            break;
+        case PQ_OP_DELETE_MIN:
+            if( queue->size == 0 )
+                return NO_QUEUE - 1;
+            node_id = queue->heap[0];
+            ref_remove( node_id );
+            return node_id;
+        case PQ_OP_DECREASE_KEY:
+        case PQ_OP_INCREASE_KEY:
+            node_id = ( (pq_op_decrease_key*) op )->node_id;
+            key = ( (pq_op_decrease_key*) op )->key;
+            if( node_id >= header.node_ids || owner[node_id] != pq_id )
+                return NO_QUEUE - 1;
+            keys[node_id] = key;
+            sift_up( queue, pos[node_id] );
+            sift_down( queue, pos[node_id] );
+            break;
+        default:
+            break;
+    }
+
+    return NO_QUEUE;
+}
+
+static void write_checkpoint( FILE *file, uint64_t op_index,
+    uint64_t offset )
+{
+    checkpoint_record record;
+    checkpoint_node node;
+    uint32_t pq_id, j;
+
+    record.op_index = op_index;
+    record.offset = offset;
+    record.queue_count = 0;
+    record.node_count = 0;
+    for( pq_id = 0; pq_id < header.pq_ids; pq_id++ )
+    {
+        record.queue_count += queues[pq_id].alive;
+        record.node_count += queues[pq_id].size;
+    }
+    fwrite( &record, sizeof( checkpoint_record ), 1, file );
+
+    for( pq_id = 0; pq_id < header.pq_ids; pq_id++ )
+    {
+        if( queues[pq_id].alive )
+            fwrite( &pq_id, sizeof( uint32_t ), 1, file );
+    }
+    for( pq_id = 0; pq_id < header.pq_ids; pq_id++ )
+    {
+        for( j = 0; j < queues[pq_id].size; j++ )
+        {
+            node.pq_id = pq_id;
+            node.node_id = queues[pq_id].heap[j];
+            node.key = keys[node.node_id];
+            node.item = items[node.node_id];
+            fwrite( &node, sizeof( checkpoint_node ), 1, file );
+        }
+    }
+}
+
+/**
+ * Loads the last checkpoint at or before an operation into the reference
+ * state, which must be empty.
+ *
+ * @param file      Checkpoint file of the open trace
+ * @param first     Operation to reach
+ * @param op_index  Output index of the next operation, 0 if no checkpoint
+ *                  fits
+ * @param offset    Output trace offset of the next operation
+ * @return          0 on success, -1 on failure
+ */
+static int read_checkpoint( FILE *file, uint64_t first, uint64_t *op_index,
+    uint64_t *offset )
+{
+    pq_trace_header saved;
+    checkpoint_record record, best;
+    checkpoint_node node;
+    long best_position = -1;
+    uint32_t pq_id, j;
+
+    if( fread( &saved, sizeof( pq_trace_header ), 1, file ) != 1 ||
+            memcmp( &saved, &header, sizeof( pq_trace_header ) ) != 0 )
+    {
+        fprintf( stderr, "Checkpoints do not belong to the trace.\n" );
+        return -1;
+    }
+
+    while( fread( &record, sizeof( checkpoint_record ), 1, file ) == 1 &&
+            record.op_index <= first )
+    {
+        best = record;
+        best_position = ftell( file );
+        fseek( file, record.queue_count * sizeof( uint32_t ) +
+            (long) record.node_count * sizeof( checkpoint_node ), SEEK_CUR );
+    }
+
+    *op_index = 0;
+    if( best_position < 0 )
+        return 0;
+
+    fseek( file, best_position, SEEK_SET );
+    for( j = 0; j < best.queue_count; j++ )
+    {
+        if( fread( &pq_id, sizeof( uint32_t ), 1, file ) != 1 ||
+                pq_id >= header.pq_ids )
+            goto corrupt;
+        queues[pq_id].alive = 1;
+    }
+    for( j = 0; j < best.node_count; j++ )
+    {
+        if( fread( &node, sizeof( checkpoint_node ), 1, file ) != 1 ||
+                node.pq_id >= header.pq_ids ||
+                node.node_id >= header.node_ids ||
+                owner[node.node_id] != NO_QUEUE ||
+                ref_insert( node.pq_id, node.node_id, node.key,
+                node.item ) != 0 )
+            goto corrupt;
+    }
+
+    *op_index = best.op_index;
+    *offset = best.offset;
+
+    return 0;
+
+corrupt:
+    fprintf( stderr, "Corrupt checkpoint at op %llu.\n",
+        (unsigned long long) best.op_index );
+    return -1;
+}
+
+static int ref_insert( uint32_t pq_id, uint32_t node_id, key_type key,
+    item_type item )
+{
+    ref_queue *queue = queues + pq_id;
+
+    if( queue->size == queue->capacity )
+    {
+        uint32_t grown = ( queue->capacity == 0 ) ? 1024 :
+            queue->capacity << 1;
+        uint32_t *heap = realloc( queue->heap, grown * sizeof( uint32_t ) );
+        if( heap == NULL )
+        {
+            fprintf( stderr, "Malloc fail.\n" );
+            return -1;
+        }
+        queue->heap = heap;
+        queue->capacity = grown;
+    }
+
+    keys[node_id] = key;
+    items[node_id] = item;
+    owner[node_id] = pq_id;
+    pos[node_id] = queue->size;
+    queue->heap[queue->size++] = node_id;
+    sift_up( queue, pos[node_id] );
+
+    return 0;
+}
+
+static void ref_remove( uint32_t node_id )
+{
+    ref_queue *queue = queues + owner[node_id];
+    uint32_t i = pos[node_id];
+    uint32_t last = queue->heap[--queue->size];
+
+    owner[node_id] = NO_QUEUE;
+    if( i == queue->size )
+        return;
+
+    queue->heap[i] = last;
+    pos[last] = i;
+    sift_up( queue, i );
+    sift_down( queue, pos[last] );
+}
+
+/**
+ * Empties a queue, as on clear or destroy.
+ *
+ * @param pq_id Queue to empty
+ */
+static void ref_release( uint32_t pq_id )
+{
+    ref_queue *queue = queues + pq_id;
+    uint32_t j;
+
+    for( j = 0; j < queue->size; j++ )
+        owner[queue->heap[j]] = NO_QUEUE;
+    queue->size = 0;
+    queue->sampled = 0;
+}
+
+static int before( uint32_t a, uint32_t b )
+{
+    return keys[a] < keys[b] || ( keys[a] == keys[b] && a < b );
+}
+
+static void sift_up( ref_queue *queue, uint32_t i )
+{
+    uint32_t node_id = queue->heap[i];
+
+    while( i > 0 && before( node_id, queue->heap[( i - 1 ) >> 1] ) )
+    {
+        queue->heap[i] = queue->heap[( i - 1 ) >> 1];
+        pos[queue->heap[i]] = i;
+        i = ( i - 1 ) >> 1;
+    }
+    queue->heap[i] = node_id;
+    pos[node_id] = i;
+}
+
+static void sift_down( ref_queue *queue, uint32_t i )
+{
+    uint32_t node_id = queue->heap[i];
+    uint32_t child;
+
+    while( ( child = ( i << 1 ) + 1 ) < queue->size )
+    {
+        if( child + 1 < queue->size &&
+                before( queue->heap[child + 1], queue->heap[child] ) )
+            child++;
+        if( !before( queue->heap[child], node_id ) )
+            break;
+        queue->heap[i] = queue->heap[child];
+        pos[queue->heap[i]] = i;
+        i = child;
+    }
+    queue->heap[i] = node_id;
+    pos[node_id] = i;
+}
+
+/**
+ * Draws a uniform number from xorshift64*, so that samples are reproducible
+ * across platforms.
+ *
+ * @return  Number in [0, 1)
+ */
+static double uniform( void )
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return ( rng_state * 0x2545F4914F6CDD1DULL >> 11 ) * 0x1.0p-53;
+}
+
+static int has_node( uint32_t code )
+{
+    return ( code == PQ_OP_INSERT || code == PQ_OP_GET_KEY ||
+        code == PQ_OP_GET_ITEM || code == PQ_OP_DELETE ||
+        code == PQ_OP_DECREASE_KEY || code == PQ_OP_INCREASE_KEY );
+}
+
+static int by_last_use( const void *a, const void *b )
+{
+    uint32_t x = *( (const uint32_t*) a );
+    uint32_t y = *( (const uint32_t*) b );
+
+    if( last_use[x] != last_use[y] )
+        return ( last_use[x] < last_use[y] ) ? -1 : 1;
+    return ( x < y ) ? -1 : ( x > y );
+}
+
+/**
+ * Looks up the handle of a node id in a direct-mapped cache of handle table
+ * lines, loading its line on a miss.
+ *
+ * @param lines     Line held by each slot of the cache
+ * @param node_id   Node id to look up
+ * @return          1 on a hit, 0 on a miss
+ */
+static int lookup_hit( uint32_t *lines, uint32_t node_id )
+{
+    uint32_t line = node_id >> LOOKUP_SHIFT;
+    uint32_t *slot = lines + ( line & ( LOOKUP_LINES - 1 ) );
+
+    if( *slot == line )
+        return 1;
+    *slot = line;
+    return 0;
+}
@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include "trace_tools.h"
 
 //==============================================================================
@@ -5,7 +6,7 @@
 //==============================================================================
 
 // some internal implementation details
-#define PQ_OP_BUFFER_LEN    131072
+#define PQ_TRACE_MAX_FILES  1024
 #define MASK_PRIO 0xFFFFFFFF00000000
 #define MASK_NAME 0x00000000FFFFFFFF
 #define PQ_MAX(a,b) ( (a >= b) ? a : b )
@@ -15,7 +16,7 @@
 // STATIC DECLARATIONS
 //==============================================================================
 
-static const size_t pq_op_lengths[13] =
+static const size_t pq_op_lengths[14] =
 {
     sizeof( pq_op_create ),
     sizeof( pq_op_destroy ),
@@ -29,13 +30,18 @@ static const size_t pq_op_lengths[13] =
     sizeof( pq_op_delete_min ),
     sizeof( pq_op_decrease_key ),
     sizeof( pq_op_meld ),
-    sizeof( pq_op_empty )
+    sizeof( pq_op_empty ),
+    sizeof( pq_op_increase_key )
 };
 
-static size_t pq_op_buffer_pos = 0;
-static uint8_t pq_op_buffer[PQ_OP_BUFFER_LEN];
+// writers backing the descriptor-based interface, indexed by descriptor
+static pq_trace_writer *pq_file_writers[PQ_TRACE_MAX_FILES];
+static pthread_mutex_t pq_file_writers_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t pq_file_buffer_size = PQ_TRACE_BUFFER_SIZE;
 
-static int buffered_write( int file, uint8_t* data, size_t length );
+static pq_trace_writer* file_writer( int file );
+static int writer_submit( pq_trace_writer *writer );
+static void* writer_thread( void *arg );
 
 //==============================================================================
 // PUBLIC METHODS
@@ -65,13 +71,11 @@ int pq_trace_read_header( int file, pq_trace_header *header )
 
 int pq_trace_write_op( int file, void *op )
 {
-    uint32_t code = *((uint32_t*) op);
-    ssize_t length = pq_op_lengths[code];
-    ssize_t bytes = buffered_write( file, op, length );
-    if( bytes != length )
+    pq_trace_writer *writer = file_writer( file );
+    if( writer == NULL )
         return -1;
 
-    return 0;
+    return pq_trace_writer_op( writer, op );
 }
 
 int pq_trace_read_op( int file, void *op )
@@ -91,33 +95,224 @@ int pq_trace_read_op( int file, void *op )
 
 int pq_trace_flush_buffer( int file )
 {
-    size_t to_write = pq_op_buffer_pos;
-    int bytes = write( file, pq_op_buffer, to_write );
-    if( bytes != to_write )
+    if( file < 0 || file >= PQ_TRACE_MAX_FILES )
+        return -1;
+
+    pthread_mutex_lock( &pq_file_writers_lock );
+    pq_trace_writer *writer = pq_file_writers[file];
+    pq_file_writers[file] = NULL;
+    pthread_mutex_unlock( &pq_file_writers_lock );
+
+    if( writer == NULL )
+        return 0;
+
+    // leave the descriptor positioned after the data, as write() would have
+    off_t end = writer->offset + writer->fill;
+    int status = pq_trace_writer_destroy( writer );
+    if( status == -1 || lseek( file, end, SEEK_SET ) == -1 )
         return -1;
 
-    pq_op_buffer_pos = 0;
+    return 0;
+}
+
+void pq_trace_set_buffer_size( size_t size )
+{
+    pthread_mutex_lock( &pq_file_writers_lock );
+    pq_file_buffer_size = size;
+    pthread_mutex_unlock( &pq_file_writers_lock );
+}
+
+pq_trace_writer* pq_trace_writer_create( int file, off_t offset,
+    size_t buffer_size )
+{
+    pq_trace_writer *writer = calloc( 1, sizeof( pq_trace_writer ) );
+    if( writer == NULL )
+        return NULL;
+
+    writer->file = file;
+    writer->offset = offset;
+    writer->buffer_size = PQ_MAX( buffer_size, sizeof( pq_op_blank ) );
+    writer->buffers[0] = malloc( writer->buffer_size );
+    writer->buffers[1] = malloc( writer->buffer_size );
+    if( writer->buffers[0] == NULL || writer->buffers[1] == NULL )
+        goto fail;
+
+    pthread_mutex_init( &writer->lock, NULL );
+    pthread_cond_init( &writer->cond, NULL );
+    if( pthread_create( &writer->thread, NULL, writer_thread, writer ) != 0 )
+    {
+        pthread_cond_destroy( &writer->cond );
+        pthread_mutex_destroy( &writer->lock );
+        goto fail;
+    }
+
+    return writer;
+
+fail:
+    free( writer->buffers[0] );
+    free( writer->buffers[1] );
+    free( writer );
+    return NULL;
+}
+
+int pq_trace_writer_op( pq_trace_writer *writer, void *op )
+{
+    uint32_t code = *((uint32_t*) op);
+    size_t length = pq_op_lengths[code];
+
+    if( writer->buffer_size - writer->fill < length )
+    {
+        if( writer_submit( writer ) == -1 )
+            return -1;
+    }
+
+    memcpy( writer->buffers[writer->active] + writer->fill, op, length );
+    writer->fill += length;
 
-    return bytes;
+    return 0;
+}
+
+int pq_trace_writer_flush( pq_trace_writer *writer )
+{
+    int status = writer_submit( writer );
+
+    pthread_mutex_lock( &writer->lock );
+    while( writer->pending != NULL )
+        pthread_cond_wait( &writer->cond, &writer->lock );
+    if( writer->error )
+        status = -1;
+    pthread_mutex_unlock( &writer->lock );
+
+    return status;
+}
+
+int pq_trace_writer_destroy( pq_trace_writer *writer )
+{
+    int status = writer_submit( writer );
+
+    pthread_mutex_lock( &writer->lock );
+    writer->done = 1;
+    pthread_cond_broadcast( &writer->cond );
+    pthread_mutex_unlock( &writer->lock );
+    pthread_join( writer->thread, NULL );
+
+    if( writer->error )
+        status = -1;
+
+    pthread_cond_destroy( &writer->cond );
+    pthread_mutex_destroy( &writer->lock );
+    free( writer->buffers[0] );
+    free( writer->buffers[1] );
+    free( writer );
+
+    return status;
 }
 
 //==============================================================================
 // STATIC METHODS
 //==============================================================================
 
-static int buffered_write( int file, uint8_t* data, size_t length )
+/**
+ * Returns the writer backing the given descriptor, creating one at the
+ * descriptor's current position if there is none yet.
+ *
+ * @param file  Descriptor to look up
+ * @return      Pointer to the writer, or NULL on failure
+ */
+static pq_trace_writer* file_writer( int file )
 {
-    int status;
+    if( file < 0 || file >= PQ_TRACE_MAX_FILES )
+        return NULL;
 
-    if( PQ_OP_BUFFER_LEN - pq_op_buffer_pos - 1 < length )
+    pthread_mutex_lock( &pq_file_writers_lock );
+    pq_trace_writer *writer = pq_file_writers[file];
+    if( writer == NULL )
     {
-        status = pq_trace_flush_buffer( file );
-        if( status == -1 )
-            return status;
+        off_t offset = lseek( file, 0, SEEK_CUR );
+        if( offset != -1 )
+            writer = pq_trace_writer_create( file, offset,
+                pq_file_buffer_size );
+        pq_file_writers[file] = writer;
     }
+    pthread_mutex_unlock( &pq_file_writers_lock );
+
+    return writer;
+}
+
+/**
+ * Hands the active buffer to the background thread and switches to the other
+ * one, waiting first if the previous buffer is still being written.
+ *
+ * @param writer    Writer whose active buffer to submit
+ * @return          0 on success, -1 if a previous write failed
+ */
+static int writer_submit( pq_trace_writer *writer )
+{
+    if( writer->fill == 0 )
+        return writer->error ? -1 : 0;
+
+    pthread_mutex_lock( &writer->lock );
+    while( writer->pending != NULL )
+        pthread_cond_wait( &writer->cond, &writer->lock );
+    writer->pending = writer->buffers[writer->active];
+    writer->pending_length = writer->fill;
+    writer->pending_offset = writer->offset;
+    pthread_cond_broadcast( &writer->cond );
+    int status = writer->error ? -1 : 0;
+    pthread_mutex_unlock( &writer->lock );
+
+    writer->offset += writer->fill;
+    writer->active ^= 1;
+    writer->fill = 0;
+
+    return status;
+}
 
-    memcpy( pq_op_buffer + pq_op_buffer_pos, data, length );
-    pq_op_buffer_pos += length;
+/**
+ * Background loop.  Writes each submitted buffer at its offset and marks the
+ * writer idle again.
+ *
+ * @param arg   Writer to serve
+ * @return      NULL
+ */
+static void* writer_thread( void *arg )
+{
+    pq_trace_writer *writer = (pq_trace_writer*) arg;
+
+    pthread_mutex_lock( &writer->lock );
+    while( 1 )
+    {
+        while( writer->pending == NULL && !writer->done )
+            pthread_cond_wait( &writer->cond, &writer->lock );
+        if( writer->pending == NULL )
+            break;
+
+        uint8_t *data = writer->pending;
+        size_t remaining = writer->pending_length;
+        off_t offset = writer->pending_offset;
+        pthread_mutex_unlock( &writer->lock );
+
+        int failed = 0;
+        while( remaining > 0 )
+        {
+            ssize_t bytes = pwrite( writer->file, data, remaining, offset );
+            if( bytes <= 0 )
+            {
+                failed = 1;
+                break;
+            }
+            data += bytes;
+            remaining -= bytes;
+            offset += bytes;
+        }
+
+        pthread_mutex_lock( &writer->lock );
+        if( failed )
+            writer->error = 1;
+        writer->pending = NULL;
+        pthread_cond_broadcast( &writer->cond );
+    }
+    pthread_mutex_unlock( &writer->lock );
 
-    return length;
+    return NULL;
 }
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <pthread.h>
 #include "typedefs.h"
 
 // operation codes for identification
@@ -25,6 +26,10 @@
 #define PQ_OP_DECREASE_KEY  10
 #define PQ_OP_MELD          11
 #define PQ_OP_EMPTY         12
+#define PQ_OP_INCREASE_KEY  13
+
+// default size of each of a trace writer's two buffers
+#define PQ_TRACE_BUFFER_SIZE    ( 1 << 22 )
 
 /**
  * Contains info about the trace file.  pq_ids and node_ids are the number of
@@ -117,6 +122,14 @@ struct pq_op_decrease_key
     key_type key;
 } __attribute__ ((packed, aligned(4)));
 
+struct pq_op_increase_key
+{
+    uint32_t code;
+    uint32_t pq_id;
+    uint32_t node_id;
+    key_type key;
+} __attribute__ ((packed, aligned(4)));
+
 struct pq_op_meld
 {
     uint32_t code;
@@ -146,6 +159,7 @@ typedef struct pq_op_delete_min pq_op_delete_min;
 typedef struct pq_op_decrease_key pq_op_decrease_key;
 typedef struct pq_op_meld pq_op_meld;
 typedef struct pq_op_empty pq_op_empty;
+typedef struct pq_op_increase_key pq_op_increase_key;
 
 /**
  * Dummy struct.  Primarily for use as a placeholder for allocation and to
@@ -154,6 +168,49 @@ typedef struct pq_op_empty pq_op_empty;
  */
 typedef struct pq_op_insert pq_op_blank;
 
+/**
+ * Double-buffered trace writer.  Operations are appended to one buffer while
+ * a background thread writes the other to the file, so trace generation only
+ * waits on I/O when it outruns the disk.  Each writer owns its buffers and
+ * writes at an explicit file offset, so several writers may target different
+ * regions of the same file or different files at once.
+ */
+struct pq_trace_writer_t
+{
+    //! file being written
+    int file;
+    //! file offset at which the next full buffer is written
+    off_t offset;
+    //! capacity of each buffer in bytes
+    size_t buffer_size;
+    //! the two buffers
+    uint8_t *buffers[2];
+    //! index of the buffer currently being filled
+    int active;
+    //! bytes in the active buffer
+    size_t fill;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    //! buffer handed to the background thread, NULL when it is idle
+    uint8_t *pending;
+    //! length of the pending buffer
+    size_t pending_length;
+    //! offset at which the pending buffer is written
+    off_t pending_offset;
+    //! set once no more buffers will be submitted
+    int done;
+    //! set if any background write failed
+    int error;
+};
+
+typedef struct pq_trace_writer_t pq_trace_writer;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 //==============================================================================
 // PUBLIC DECLARATIONS
 //==============================================================================
@@ -182,7 +239,10 @@ int pq_trace_read_header( int file, pq_trace_header *header );
 
 /**
  * Takes any priority queue operation struct and writes to the current position
- * in the input file.  Detects operation type based on code field.
+ * in the input file.  Detects operation type based on code field.  Writes go
+ * through a pq_trace_writer kept for the descriptor, so they complete in the
+ * background; distinct files may be written from different threads, but a
+ * single file must only be written from one thread at a time.
  *
  * @param file  File to write to
  * @param op    Operation to write out
@@ -202,11 +262,64 @@ int pq_trace_write_op( int file, void *op );
 int pq_trace_read_op( int file, void *op );
 
 /**
- * Flushes any outstanding writes to the trace file.  Must be called before
- * closing the file.
+ * Flushes any outstanding writes to the trace file and waits for them to
+ * complete, leaving the file positioned after the last operation.  Must be
+ * called before closing the file.
  *
  * @param file  File to write to
+ * @return      0 on success, -1 on error
  */
 int pq_trace_flush_buffer( int file );
 
+/**
+ * Sets the buffer size used by writers that pq_trace_write_op creates from
+ * now on.  Defaults to PQ_TRACE_BUFFER_SIZE.
+ *
+ * @param size  Capacity of each of the two buffers in bytes
+ */
+void pq_trace_set_buffer_size( size_t size );
+
+/**
+ * Creates a double-buffered writer and starts its background thread.
+ *
+ * @param file          File to write to
+ * @param offset        File offset of the first byte written
+ * @param buffer_size   Capacity of each of the two buffers in bytes
+ * @return              Pointer to the new writer, or NULL on failure
+ */
+pq_trace_writer* pq_trace_writer_create( int file, off_t offset,
+    size_t buffer_size );
+
+/**
+ * Appends an operation to the writer.  Detects operation type based on code
+ * field.  Blocks only if both buffers are full.
+ *
+ * @param writer    Writer to append to
+ * @param op        Operation to write out
+ * @return          0 on success, -1 if a previous write failed
+ */
+int pq_trace_writer_op( pq_trace_writer *writer, void *op );
+
+/**
+ * Submits the partially filled buffer and waits until everything appended so
+ * far has reached the file.
+ *
+ * @param writer    Writer to flush
+ * @return          0 if every write succeeded, -1 otherwise
+ */
+int pq_trace_writer_flush( pq_trace_writer *writer );
+
+/**
+ * Writes any outstanding data, stops the background thread and releases the
+ * writer.  Does not close the file.
+ *
+ * @param writer    Writer to release
+ * @return          0 if every write succeeded, -1 otherwise
+ */
+int pq_trace_writer_destroy( pq_trace_writer *writer );
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif